@@ -0,0 +1,253 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <new>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include "types.h"
+
+/**
+ * @brief 只追加的字符串堆（bump 分配器）
+ *
+ * 按 kBlockSize 成块向系统申请内存，块内顺序分配，不支持单独释放；
+ * 整个 arena 析构时一次释放所有块。一个 RowStore 段内的所有单元格都分配在
+ * 该段的 arena 中，加载和删除大表时不再有逐个单元格的 malloc/free。
+ *
+ * 已分配的内存地址在 arena 析构前不变；只允许一个线程分配，
+ * 其他线程可以并发读取已发布的内容。
+ */
+class StringArena
+{
+public:
+    static constexpr size_t kBlockSize = 32 * 1024;
+
+    StringArena() = default;
+    StringArena(const StringArena &) = delete;
+    StringArena &operator=(const StringArena &) = delete;
+
+    /**
+     * @brief 分配 n 字节，按 align 对齐
+     */
+    void *allocate(size_t n, size_t align = alignof(std::max_align_t))
+    {
+        size_t pad = (align - reinterpret_cast<uintptr_t>(cur) % align) % align;
+        if (pad + n > left)
+            return allocateSlow(n, align);
+        char *p = cur + pad;
+        cur = p + n;
+        left -= pad + n;
+        return p;
+    }
+
+    /**
+     * @brief 复制字符串内容到 arena，返回其地址（不以 '\0' 结尾）
+     */
+    const char *copy(std::string_view s)
+    {
+        char *p = static_cast<char *>(allocate(s.size(), 1));
+        std::memcpy(p, s.data(), s.size());
+        return p;
+    }
+
+    /**
+     * @brief 已向系统申请的字节数
+     */
+    size_t capacity() const { return reserved; }
+
+private:
+    /**
+     * @brief 当前块放不下时申请新块；大于 kBlockSize / 4 的请求单独成块，不浪费当前块的剩余空间
+     */
+    void *allocateSlow(size_t n, size_t align);
+
+    std::vector<std::unique_ptr<char[]>> blocks; ///< 所有已申请的块
+    char *cur = nullptr;                         ///< 当前块中下一个空闲字节
+    size_t left = 0;                             ///< 当前块剩余字节数
+    size_t reserved = 0;                         ///< 已申请的总字节数
+};
+
+/**
+ * @brief 16 字节的单元格句柄
+ *
+ * 不超过 kInline 字节的值直接存放在句柄内（大多数数字和短名称），
+ * 更长的值存放在 StringArena 中，句柄内保存前 4 个字节与指针。
+ *
+ * DATE/TIMESTAMP 列的有效值是原生单元格：arena 中依次存放 int64 原生值与规范文本，
+ * 比较、排序、区间过滤直接读取整数，输出时读取文本，都不需要再解析。
+ *
+ * NULL 是单独的状态（len 中的标志位），不再是值为 "NULL" 的字符串；文本形式仍读作 "NULL"。
+ */
+class Cell
+{
+public:
+    static constexpr size_t kInline = 12;
+    static constexpr uint32_t kNative = 0x80000000u;           ///< len 的最高位：原生单元格
+    static constexpr uint32_t kNull = 0x40000000u;             ///< len 的次高位：NULL
+    static constexpr uint32_t kLengthMask = ~(kNative | kNull); ///< len 中的字节数
+
+    Cell() : len(0), data{} {}
+
+    /**
+     * @brief NULL 单元格
+     */
+    static Cell makeNull()
+    {
+        Cell c;
+        c.len = kNull | 4;
+        std::memcpy(c.data, "NULL", 4);
+        return c;
+    }
+
+    /**
+     * @brief 构造单元格，长值复制到 arena
+     */
+    Cell(std::string_view s, StringArena &arena) : len(uint32_t(s.size())), data{}
+    {
+        if (s.size() <= kInline)
+        {
+            std::memcpy(data, s.data(), s.size());
+            return;
+        }
+        const char *p = arena.copy(s);
+        std::memcpy(data, s.data(), 4);
+        std::memcpy(data + 4, &p, sizeof(p));
+    }
+
+    /**
+     * @brief 构造原生单元格：value 与规范文本 text 一起复制到 arena
+     */
+    Cell(std::string_view text, int64_t value, StringArena &arena) : len(uint32_t(text.size()) | kNative), data{}
+    {
+        char *p = static_cast<char *>(arena.allocate(sizeof(value) + text.size(), alignof(int64_t)));
+        std::memcpy(p, &value, sizeof(value));
+        std::memcpy(p + sizeof(value), text.data(), text.size());
+        std::memcpy(data, text.data(), std::min<size_t>(text.size(), 4));
+        const char *q = p;
+        std::memcpy(data + 4, &q, sizeof(q));
+    }
+
+    std::string_view view() const
+    {
+        uint32_t n = len & kLengthMask;
+        if (n <= kInline && !(len & kNative))
+            return std::string_view(data, n);
+        const char *p;
+        std::memcpy(&p, data + 4, sizeof(p));
+        if (len & kNative)
+            return std::string_view(p + sizeof(int64_t), n);
+        return std::string_view(p, n);
+    }
+    size_t size() const { return len & kLengthMask; }
+
+    /**
+     * @brief 是否为原生单元格
+     */
+    bool native() const { return len & kNative; }
+
+    /**
+     * @brief 是否为 NULL
+     */
+    bool isNull() const { return len & kNull; }
+
+    /**
+     * @brief 原生单元格的整数值（DATE 为天数，TIMESTAMP 为微秒）
+     */
+    int64_t nativeValue() const
+    {
+        const char *p;
+        int64_t v;
+        std::memcpy(&p, data + 4, sizeof(p));
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    bool operator==(const Cell &o) const
+    {
+        // 长度与前 4 个字节不同即可判定不等，不必访问 arena
+        if (len != o.len || std::memcmp(data, o.data, 4) != 0)
+            return false;
+        return len <= kInline ? std::memcmp(data + 4, o.data + 4, kInline - 4) == 0 : view() == o.view();
+    }
+    bool operator!=(const Cell &o) const { return !(*this == o); }
+
+private:
+    uint32_t len;       ///< 值的字节数
+    char data[kInline]; ///< 内联的值（不足部分补 0）；长值时为前 4 个字节 + arena 中的地址
+};
+
+static_assert(sizeof(Cell) == 16 && sizeof(const char *) <= 8, "Cell should stay 16 bytes");
+
+/**
+ * @brief 一行的单元格数组视图（数组本身也分配在 arena 中）
+ */
+struct CellSpan
+{
+    const Cell *data = nullptr;
+    uint32_t count = 0;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    std::string_view operator[](size_t i) const { return data[i].view(); }
+    const Cell *begin() const { return data; }
+    const Cell *end() const { return data + count; }
+
+    bool operator==(const CellSpan &o) const
+    {
+        if (count != o.count)
+            return false;
+        for (uint32_t i = 0; i < count; i++)
+            if (data[i] != o.data[i])
+                return false;
+        return true;
+    }
+    bool operator!=(const CellSpan &o) const { return !(*this == o); }
+
+    /**
+     * @brief 在 arena 中为 cells 指向的 n 个值建立单元格数组
+     * @param cells 迭代器，元素可转换为 std::string_view
+     */
+    template <class It>
+    static CellSpan build(It cells, size_t n, StringArena &arena)
+    {
+        return build(cells, n, arena, [](size_t)
+                     { return DataType::TEXT; });
+    }
+
+    /**
+     * @brief 同上，typeAt(i) 给出第 i 个值所在列的类型：DATE/TIMESTAMP 的有效值解析为原生单元格，
+     *        文本改写为规范形式，BOOL 的有效值改写为 "true" / "false"；无法解析的值按原样存放。
+     *        值为 "NULL" 时（任何类型）存为 NULL 单元格
+     */
+    template <class It, class TypeAt>
+    static CellSpan build(It cells, size_t n, StringArena &arena, TypeAt typeAt)
+    {
+        CellSpan span;
+        if (n == 0)
+            return span;
+        Cell *out = static_cast<Cell *>(arena.allocate(n * sizeof(Cell), alignof(Cell)));
+        for (size_t i = 0; i < n; i++, ++cells)
+        {
+            std::string_view s(*cells);
+            DataType type = typeAt(i);
+            int64_t value;
+            bool truth;
+            if (s == "NULL")
+                new (&out[i]) Cell(Cell::makeNull());
+            else if (type == DataType::BOOL && parseBool(s, truth))
+                new (&out[i]) Cell(truth ? "true" : "false", arena);
+            else if (isTemporal(type) && parseTemporal(type, s, value))
+            {
+                char text[kTemporalTextMax];
+                new (&out[i]) Cell(std::string_view(text, formatTemporal(type, value, text)), value, arena);
+            }
+            else
+                new (&out[i]) Cell(s, arena);
+        }
+        span.data = out;
+        span.count = uint32_t(n);
+        return span;
+    }
+};
@@ -0,0 +1,101 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "types.h"
+
+/**
+ * @brief 列的编码方式
+ */
+enum class ColumnEncoding : uint8_t
+{
+    PLAIN, // 逐个值：长度 + 字节
+    RLE,   // 连续重复的值存为 (重复次数, 值)
+    DELTA, // INT/DATE/TIMESTAMP：首值 + 相邻差值减去最小差值后按固定位宽打包
+    LZ     // PLAIN 的内容再做 LZ77 压缩
+};
+
+/**
+ * @brief 一个块中解码出的一列：各值首尾相接存放，NULL 读作 "NULL"
+ */
+struct DecodedColumn
+{
+    std::string bytes;          ///< 各值首尾相接
+    std::vector<uint32_t> ends; ///< 第 k 个值在 bytes 中的结束位置
+
+    size_t size() const { return ends.size(); }
+    std::string_view operator[](size_t k) const
+    {
+        uint32_t begin = k ? ends[k - 1] : 0;
+        return std::string_view(bytes).substr(begin, ends[k] - begin);
+    }
+};
+
+/**
+ * @brief 表文件的列式压缩块编码器
+ *
+ * 表文件的数据部分每 RowStore::kSegmentRows 行一块，块内按列存放，每列各自选择最小的编码：
+ * - DELTA：INT/DATE/TIMESTAMP 列（值都是规范形式时）相邻差值减去最小差值（参考帧）后按固定位宽打包，
+ *   自增的 id、按时间顺序写入的日期每行只需 0~2 位
+ * - RLE：重复较多的列
+ * - LZ：其余文本，64 KB 窗口、最短匹配 4 字节的 LZ77
+ * - PLAIN：以上都不更小时
+ * NULL 另存为每行一位的位图，值序列只包含非 NULL 的值。
+ *
+ * 块格式：u32 块体字节数 | u32 行数 | 各列依次为 u8 编码、u8 是否有 NULL、[NULL 位图]、变长整数数据长度、数据。
+ * 不依赖任何压缩库。
+ */
+class ChunkEncoder
+{
+public:
+    static constexpr size_t kHeaderSize = 8; ///< 块头（块体字节数与行数）
+
+    explicit ChunkEncoder(std::vector<DataType> types);
+
+    /**
+     * @brief 加入一行，cells 的个数须等于列数（值在调用期间被复制）
+     */
+    void addRow(const std::vector<std::string_view> &cells);
+
+    /**
+     * @brief 已加入的行数
+     */
+    size_t rows() const { return rowCount; }
+
+    /**
+     * @brief 编码已加入的行并追加到 out，然后清空
+     * @return 追加的字节数
+     */
+    size_t finish(std::string &out);
+
+    /**
+     * @brief 上一次 finish() 中各列选择的编码
+     */
+    const std::vector<ColumnEncoding> &encodings() const { return chosen; }
+
+private:
+    std::vector<DataType> types;                  ///< 各列的类型
+    std::vector<std::vector<std::string>> values; ///< 各列已加入的值
+    std::vector<ColumnEncoding> chosen;           ///< 上一次各列选择的编码
+    size_t rowCount = 0;                          ///< 已加入的行数
+};
+
+/**
+ * @brief 读取块头
+ * @param bytes 从块头开始的字节（至少 kHeaderSize 个）
+ * @param size 输出块体字节数（不含块头）
+ * @param rows 输出行数
+ * @return 字节不足或行数超过 RowStore::kSegmentRows（块头损坏）时返回 false
+ */
+bool readChunkHeader(std::string_view bytes, uint32_t &size, uint32_t &rows);
+
+/**
+ * @brief 解码一个完整的块
+ * @param block 块头与块体
+ * @param types 各列的类型（须与编码时一致）
+ * @param columns 输出：每列一个 DecodedColumn，值的个数都等于块的行数
+ * @return 块不完整或格式错误时返回 false
+ */
+bool decodeChunk(std::string_view block, const std::vector<DataType> &types, std::vector<DecodedColumn> &columns);
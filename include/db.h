@@ -2,7 +2,75 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
 #include "table.h"
+#include "stats.h"
+#include "mvcc.h"
+#include "wal.h"
+#include "membudget.h"
+#include "pagecache.h"
+#include "metrics.h"
+#include "slowlog.h"
+#include "partition.h"
+#include "matview.h"
+#include "resultcache.h"
+
+/**
+ * @brief 目录中的一张表：表数据、统计信息及保护它们的读写锁
+ */
+struct TableEntry
+{
+    Table table;                                       ///< 表数据
+    TableStats stats;                                  ///< ANALYZE 得到的统计信息（rowCount 为 0 表示没有）
+    mutable std::shared_mutex latch;                   ///< 读写数据时共享持有；改 schema、压缩、替换统计信息时独占持有
+    std::mutex writeMutex;                             ///< 串行化同一张表上的写操作
+    bool dropped = false;                              ///< 已被 dropTable 移出目录，持有旧引用的调用者应放弃
+    std::atomic<uint64_t> dirtyBytes{0};               ///< 自上次写入表文件以来提交到本表的重做日志字节数，0 表示表文件是最新的
+    StatementMetrics metrics;                          ///< 本表上语句的运行统计（随表的加载、重建重新开始）
+    std::shared_ptr<const PartitionScheme> partitions; ///< 分区定义，普通表为空；通过 atomic_load/atomic_store 访问，独占持有 latch 时才替换
+    std::string partitionOf;                           ///< 本表是分区时为所属分区表的表名
+    mutable SketchCache sketches;                      ///< APPROX_COUNT_DISTINCT 按块缓存的 sketch
+    std::shared_ptr<const ViewList> views;             ///< 以本表为基表的物化视图，没有时为空；通过 atomic_load/atomic_store 访问，持有 catalogMutex 时才替换
+    std::atomic<uint64_t> version{0};                  ///< 数据版本：每次提交、改表结构后递增，结果缓存据此判断结果是否过期
+};
+
+/**
+ * @brief 一条写语句对一张表的修改
+ */
+struct TableWrite
+{
+    std::string lname;                 ///< 小写表名
+    std::shared_ptr<TableEntry> entry; ///< 表（写语句持有其 DmlTable 锁）
+    WriteSet ws;                       ///< 本语句在该表上产生的版本
+};
+
+/**
+ * @brief INSERT ... ON CONFLICT 的处理方式
+ */
+struct OnConflict
+{
+    std::string column;                                   ///< 判断冲突的列（须有 PRIMARY KEY 或 UNIQUE 约束），为空时取主键
+    std::vector<std::pair<std::string, std::string>> set; ///< DO UPDATE SET 的列与新值，为空表示 DO NOTHING
+};
+
+/**
+ * @brief TABLESAMPLE 子句：每个行版本独立地以 percent% 的概率被抽中（BERNOULLI）
+ */
+struct TableSample
+{
+    double percent = 100;    ///< 抽样比例，(0, 100]
+    bool repeatable = false; ///< 为 true 时用 seed 作随机种子，同一数据上的抽样结果可重复；否则每次随机
+    uint64_t seed = 0;       ///< 随机种子（REPEATABLE）
+};
+
+struct Transaction;
+class StatementScope;
 
 /**
  * @brief 简易的内存型 SQL 数据库实现
@@ -13,14 +81,46 @@
  * - 创建带列类型的表
  * - 插入、查询、更新、删除数据
  * - 增删列
- * - 聚合函数 (sum, avg, min, max, count)
+ * - 聚合函数 (sum, avg, min, max, count)；APPROX_COUNT_DISTINCT 用按块缓存的 HyperLogLog 估计不同值个数，
+ *   TABLESAMPLE 在抽样的行上估计 COUNT / SUM / AVG 并给出误差范围
+ * - ANALYZE 收集列统计信息，供代价模型选择访问路径
+ * - 显式事务 (BEGIN / COMMIT / ROLLBACK)
+ * - HASH / RANGE 分区表：按条件裁剪分区、并行扫描各分区，整个分区可以直接删除
+ * - PRIMARY KEY / UNIQUE 约束：由列上的哈希索引在插入、更新时检查，按键的等值查询通过索引定位，
+ *   INSERT ... ON CONFLICT DO UPDATE 只探测一次索引
+ * - LIKE 查询：列上的有序索引服务前缀模式，三元组索引服务子串模式，没有索引时用 SIMD 筛选子串
+ * - 物化视图（SELECT 键, COUNT / SUM / AVG ... GROUP BY 键）：每次提交把写集合作为增量应用到分组上，
+ *   查询视图只读取分组；分组随检查点保存在 <基表>.views
+ * - 查询结果缓存（默认关闭）：不在事务中的 SELECT 与聚合按语句缓存输出，表有新的提交或改表结构后自动失效
  * - 保存和加载所有表
+ * - 按语句类型与按表的运行统计（计数、扫描/返回行数、写盘字节、耗时分布）
+ * - 慢查询日志
  *
- * 内部通过 `unordered_map<std::string, Table>` 存储多个表。
+ * 内部通过 `unordered_map<std::string, shared_ptr<TableEntry>>` 存储多个表。
+ * 删除只打墓碑标记，已删除行比例达到阈值的表由后台压缩线程回收。
+ *
+ * 持久化：每次提交把修改以逻辑记录追加到重做日志 `minidb.wal`，
+ * 等日志 fsync 后才返回（并发提交的事务共享一次 fsync，即组提交）；
+ * 表文件只在检查点时重写：后台线程定期（或脏数据超过阈值时）把有修改的表写入表文件，
+ * 并截断日志中已包含在表文件里的记录；加载时重放表文件之后提交的日志记录。
+ * 设置页缓存后表按需分页打开，数据量可以远大于内存（见 setPageCacheSize）。
+ *
+ * 线程安全：所有公开方法都可以被多个线程并发调用。
+ * - 表目录是不可变快照，查找表只需原子读取指针，不加锁；建表/删表时复制后整体替换
+ * - 每张表一把读写锁：增删改查都只共享持有，增删列和压缩独占持有
+ * - 行数据多版本存储（MVCC）：读者按快照读取，写者追加新版本，二者互不阻塞；
+ *   同一张表上的写者之间由 writeMutex 串行化
+ * - 事务属于调用 begin() 的线程（可通过 detachTransaction/attachTransaction 转交）；
+ *   未开启事务时每条语句单独提交
  */
 class sqlDB
 {
 public:
+    sqlDB();
+    ~sqlDB();
+    sqlDB(const sqlDB &) = delete;
+    sqlDB &operator=(const sqlDB &) = delete;
+
     /**
      * @brief 创建带列类型的表
      * @param name 表名
@@ -28,6 +128,29 @@ public:
      */
     void createTableWithTypes(std::string &name, std::vector<Column> &cols);
 
+    /**
+     * @brief 创建分区表，每个分区是一张名为 <表名>#<分区名> 的表
+     * @param name 表名
+     * @param cols 列名和类型组成的向量
+     * @param scheme 分区定义（分区列须是 cols 中的列，type 由列类型决定）
+     */
+    void createPartitionedTable(std::string &name, std::vector<Column> &cols, PartitionScheme scheme);
+
+    /**
+     * @brief 在 RANGE 分区表的最后添加一个分区
+     * @param tableName 表名
+     * @param part 分区名
+     * @param upper 上界（不含），为空表示 MAXVALUE
+     */
+    void addPartition(const std::string &tableName, const std::string &part, const std::string &upper);
+
+    /**
+     * @brief 删除分区及其中所有的行，只删除分区的表文件，不扫描任何行（分区表上有物化视图时除外）
+     * @param tableName 表名
+     * @param part 分区名
+     */
+    void dropPartition(const std::string &tableName, const std::string &part);
+
     /**
      * @brief 向指定表插入数据
      * @param name 表名
@@ -36,6 +159,16 @@ public:
      */
     void insertInto(std::string &name, const std::vector<std::string> &values, const std::vector<std::string> &cols);
 
+    /**
+     * @brief 插入一行；与已有的行在唯一列上冲突时改为修改该行（INSERT ... ON CONFLICT DO UPDATE / DO NOTHING）
+     * @param name 表名
+     * @param values 插入的值（顺序与列对应）
+     * @param cols 指定插入的列名（可选，用于部分列插入）
+     * @param onConflict 冲突列与冲突时的修改
+     */
+    void upsert(std::string &name, const std::vector<std::string> &values, const std::vector<std::string> &cols,
+                const OnConflict &onConflict);
+
     /**
      * @brief 查询表中的所有数据
      * @param name 表名
@@ -49,6 +182,30 @@ public:
                    const std::string &whereVal = "", const std::string &orderBy = "",
                    bool desc = false, int limit = -1);
 
+    /**
+     * @brief 按区间条件查询，DATE/TIMESTAMP 列按原生整数比较
+     * @param name 表名
+     * @param col 条件列名
+     * @param range 区间
+     * @param orderBy 排序列名（默认空表示不排序）
+     * @param desc 是否降序（默认 false 升序）
+     * @param limit 限制返回行数（默认 -1 表示无限制）
+     */
+    void selectRange(const std::string &name, const std::string &col, const ValueRange &range,
+                     const std::string &orderBy = "", bool desc = false, int limit = -1);
+
+    /**
+     * @brief 按 LIKE 条件查询（% 匹配任意个字符，_ 匹配一个字符，不区分大小写）
+     * @param name 表名
+     * @param col 条件列名
+     * @param pattern 模式
+     * @param orderBy 排序列名（默认空表示不排序）
+     * @param desc 是否降序（默认 false 升序）
+     * @param limit 限制返回行数（默认 -1 表示无限制）
+     */
+    void selectLike(const std::string &name, const std::string &col, const std::string &pattern,
+                    const std::string &orderBy = "", bool desc = false, int limit = -1);
+
     /**
      * @brief 更新表中满足条件的行
      * @param name 表名
@@ -69,14 +226,14 @@ public:
     void deleteRows(const std::string &name, const std::string &whereCol, const std::string &whereVal);
 
     /**
-     * @brief 保存所有表到文件
+     * @brief 把有修改的表保存到文件（检查点），并截断重做日志中已写入表文件的记录
      *
-     * 文件名可通过内部约定自动生成，通常与表名关联。
+     * 文件名可通过内部约定自动生成，通常与表名关联。后台检查点线程也会定期调用。
      */
     void saveAll();
 
     /**
-     * @brief 从文件加载多个表
+     * @brief 从文件加载多个表，并重放重做日志中表文件之后提交的修改
      * @param tableNames 需要加载的表名列表
      */
     void loadAll(const std::vector<std::string> &tableNames);
@@ -101,20 +258,362 @@ public:
      */
     void dropColumn(const std::string &tableName, const std::string &colName);
 
+    /**
+     * @brief 在列上建立 LIKE 索引
+     * @param tableName 表名
+     * @param colName 列名
+     * @param trigram true 建立三元组索引（服务 '%abc%'），false 建立有序索引（服务 'abc%'）
+     */
+    void createIndex(const std::string &tableName, const std::string &colName, bool trigram);
+
+    /**
+     * @brief 删除列上的 LIKE 索引
+     * @param tableName 表名
+     * @param colName 列名
+     */
+    void dropIndex(const std::string &tableName, const std::string &colName);
+
+    /**
+     * @brief 创建物化视图：SELECT <key>, <cols>... FROM <table> GROUP BY <key>，之后随基表的提交增量更新
+     * @param name 视图名
+     * @param table 基表名（可以是分区表）
+     * @param key 分组键列名
+     * @param cols 聚合列（COUNT / SUM / AVG）
+     */
+    void createMaterializedView(const std::string &name, const std::string &table, const std::string &key,
+                                const std::vector<ViewColumn> &cols);
+
+    /**
+     * @brief 删除物化视图
+     * @param name 视图名
+     */
+    void dropMaterializedView(const std::string &name);
+
     /**
      * @brief 对指定列进行聚合运算
      * @param name 表名
-     * @param func 聚合函数名称 (sum, avg, min, max, count)
+     * @param func 聚合函数名称 (sum, avg, min, max, count, approx_count_distinct)
      * @param col 目标列名
      */
     void aggregate(const std::string &name, const std::string &func, std::string &col);
 
+    /**
+     * @brief 在抽样的行上近似计算聚合，输出估计值与 95% 置信区间的半宽
+     * @param name 表名
+     * @param func 聚合函数名称 (count, sum, avg)
+     * @param col 目标列名
+     * @param sample 抽样比例与随机种子
+     */
+    void aggregate(const std::string &name, const std::string &func, std::string &col, const TableSample &sample);
+
     /**
      * @brief 列出当前数据库中的所有表名
      * @return 表名列表
      */
     std::vector<std::string> listTables() const;
 
+    /**
+     * @brief 收集表的列统计信息并保存到 <表名>.stats
+     * @param name 表名
+     */
+    void analyze(const std::string &name);
+
+    /**
+     * @brief 在当前线程开启显式事务
+     *
+     * 之后本线程的增删改查都在事务开始时的快照上进行（快照隔离），
+     * 修改在 commit() 前对其他线程不可见。建表、删表、增删列不受事务控制，立即生效。
+     */
+    void begin();
+
+    /**
+     * @brief 提交当前线程的事务，返回时修改已写入重做日志并落盘
+     */
+    void commit();
+
+    /**
+     * @brief 回滚当前线程的事务，撤销其所有修改
+     */
+    void rollback();
+
+    /**
+     * @brief 当前线程是否有进行中的事务
+     */
+    bool inTransaction() const;
+
+    /**
+     * @brief 从当前线程取下进行中的事务（没有时返回 nullptr）
+     *
+     * 服务器按连接而不是按线程维护事务：工作线程执行某个连接的请求前
+     * attachTransaction()，执行后 detachTransaction() 交还给连接保存。
+     */
+    std::shared_ptr<Transaction> detachTransaction();
+
+    /**
+     * @brief 把 detachTransaction() 取下的事务绑定到当前线程（nullptr 表示无事务）
+     */
+    void attachTransaction(std::shared_ptr<Transaction> txn);
+
+    /**
+     * @brief 运行统计的快照：每类语句与目录中每张表的计数、写盘字节、执行/落盘耗时与延迟分布
+     *
+     * 记录只是对线程分片上的计数器做 relaxed 原子加，不加锁；本方法把各分片相加。
+     */
+    MetricsSnapshot metrics() const;
+
+    /**
+     * @brief 以文本输出运行统计（SHOW STATS）
+     */
+    void showStats() const;
+
+    /**
+     * @brief 把运行统计的文本快照写入文件（先写临时文件再重命名，读者不会看到写了一半的文件）
+     * @param path 文件路径
+     * @return 是否写入成功
+     */
+    bool exportStats(const std::string &path) const;
+
+    /**
+     * @brief 设置慢查询日志：总耗时不小于阈值的语句连同执行细节追加到日志文件
+     * @param thresholdMs 阈值（毫秒），小于 0 表示关闭（默认关闭）
+     * @param path 日志文件，为空时使用数据目录下的 slow_query.log
+     * @param maxBytes 单个文件的上限，超过后轮转，默认 64MB
+     * @param keepFiles 轮转后保留的旧文件个数，默认 3
+     */
+    void setSlowQueryLog(double thresholdMs, const std::string &path = "", uint64_t maxBytes = 64 << 20,
+                         int keepFiles = 3);
+
+    /**
+     * @brief 设置触发后台压缩的已删除行比例
+     * @param ratio 取值 (0, 1]，默认 0.3
+     */
+    void setCompactionRatio(double ratio);
+
+    /**
+     * @brief 设置查询内存预算，超出预算的排序改为外部排序
+     * @param perQuery 单个查询的上限（字节），默认 64MB
+     * @param global 所有查询合计的上限（字节），默认 256MB
+     */
+    void setMemoryBudget(size_t perQuery, size_t global);
+
+    /**
+     * @brief 设置页缓存容量：非 0 时之后加载的表按需分页打开，行在访问时才从表文件载入
+     * @param bytes 缓存的字节数，默认 0（整表加载到内存）
+     */
+    void setPageCacheSize(size_t bytes);
+
+    /**
+     * @brief 设置后台检查点的时间间隔
+     * @param ms 毫秒，默认 60000
+     */
+    void setCheckpointInterval(int ms);
+
+    /**
+     * @brief 设置提前触发检查点的脏数据量
+     * @param bytes 自上次检查点以来提交的重做日志字节数，默认 16MB
+     */
+    void setCheckpointThreshold(uint64_t bytes);
+
+    /**
+     * @brief 设置查询结果缓存的容量，超出时淘汰最久未使用的结果
+     * @param bytes 字节数，默认 0（关闭并清空缓存）
+     */
+    void setResultCacheSize(size_t bytes);
+
 private:
-    std::unordered_map<std::string, Table> tables; ///< 内部存储的表集合（键为表名）
+    friend class StatementScope;
+    using Catalog = std::unordered_map<std::string, std::shared_ptr<TableEntry>>;
+
+    /**
+     * @brief 无锁查找表（读取当前目录快照）
+     * @param lname 小写表名
+     * @return 表不存在时返回 nullptr
+     */
+    std::shared_ptr<TableEntry> findTable(const std::string &lname) const;
+
+    /**
+     * @brief 分区表中可能包含满足条件的行的分区
+     * @param lname 分区表的小写表名
+     * @param parent 分区表（调用方持有其锁）
+     * @param whereCol 条件列，不是分区列（或为空）时不裁剪
+     * @param whereVal 等值条件的值
+     * @param range 非空时为区间条件
+     * @return 各分区的小写表名与表，按分区顺序；目录中找不到的分区跳过
+     */
+    std::vector<std::pair<std::string, std::shared_ptr<TableEntry>>>
+    partitionsFor(const std::string &lname, const TableEntry &parent, const std::string &whereCol,
+                  const std::string &whereVal, const ValueRange *range) const;
+
+    /**
+     * @brief 在目录中查找物化视图
+     * @param lname 小写视图名
+     * @param base 非空时输出其基表
+     * @return 视图不存在时返回 nullptr
+     */
+    std::shared_ptr<AggregateView> findView(const std::string &lname, std::shared_ptr<TableEntry> *base = nullptr) const;
+
+    /**
+     * @brief selectAll 查询的是物化视图时的实现：按键升序输出各分组，只支持键上的等值条件（按原始文本精确匹配）、
+     *        按键升序排序与 LIMIT
+     * @param filtered 是否有区间或 LIKE 条件（不支持）
+     * @return 输出的分组数
+     */
+    size_t selectView(const AggregateView &view, const std::string &whereCol, const std::string &whereVal,
+                      bool filtered, const std::string &orderBy, bool desc, int limit);
+
+    /**
+     * @brief 提交时把表（或分区）上的写集合应用到基表的物化视图（调用方持有提交锁）
+     */
+    void applyViews(const TableEntry &entry, const WriteSet &ws, uint64_t ts) const;
+
+    /**
+     * @brief 把表上的物化视图写入 <表名>.views，没有视图时删除该文件
+     * @param now 调用前取得的最新提交时间戳
+     */
+    void saveViews(const std::string &lname, const TableEntry &entry, uint64_t now);
+
+    /**
+     * @brief 新建一张空表并写出表文件（调用方持有 catalogMutex，之后自行放入目录）
+     */
+    std::shared_ptr<TableEntry> newTable(const std::string &lname, const std::vector<Column> &cols);
+
+    /**
+     * @brief 把表移出目录并删除其文件（调用方持有 catalogMutex）
+     * @return 表文件是否删除成功
+     */
+    bool removeTable(const std::string &lname);
+
+    /**
+     * @brief insertInto 与 upsert 的实现
+     * @param onConflict 非空时冲突的行按它修改，否则违反唯一约束时报错
+     */
+    void insertRow(const std::string &name, const std::vector<std::string> &values,
+                   const std::vector<std::string> &cols, const OnConflict *onConflict);
+
+    /**
+     * @brief 两个 aggregate 的实现
+     * @param sample 非空时只读取抽样的行（TABLESAMPLE）
+     */
+    void aggregateRows(const std::string &name, const std::string &func, const std::string &col,
+                       const TableSample *sample);
+
+    /**
+     * @brief createIndex 与 dropIndex 的实现
+     * @param kinds 要加入或去掉的索引种类（TextIndex::kSorted / kTrigram）
+     * @param add true 加入，false 去掉
+     */
+    void alterTextIndex(const std::string &tableName, const std::string &colName, uint8_t kinds, bool add);
+
+    /**
+     * @brief selectAll、selectRange 与 selectLike 的实现
+     * @param range 非空时按区间过滤 whereCol
+     * @param like 非空时按 LIKE 模式过滤 whereCol（whereVal 为模式的原文，只用于结果缓存）；
+     *             二者都为空时按 whereVal 等值过滤
+     */
+    void selectWhere(const std::string &name, const std::string &whereCol, const std::string &whereVal,
+                     const ValueRange *range, const LikePattern *like, const std::string &orderBy,
+                     bool desc, int limit);
+
+    /**
+     * @brief 当前线程在本数据库上的事务，没有时返回 nullptr
+     */
+    std::shared_ptr<Transaction> activeTxn() const;
+
+    /**
+     * @brief 结束一条写语句：自动提交模式下立即提交，事务中则并入事务的写集合
+     * @param writes 本语句在各表上的修改（分区表的一条语句可能修改多个分区，在同一次提交中生效）
+     * @param txn 当前事务，nullptr 表示自动提交
+     * @return 需要等待落盘的 LSN，0 表示无需等待
+     */
+    uint64_t finishWrite(const std::vector<TableWrite> &writes, Transaction *txn);
+
+    /**
+     * @brief 写冲突：提示并在事务中时回滚整个事务（调用方已撤销本语句的修改并释放表锁）
+     */
+    void abortWrite(const std::string &lname, Transaction *txn);
+
+    /**
+     * @brief 撤销事务在各表上的修改并注销其快照
+     */
+    void rollbackTxn(Transaction &txn);
+
+    /**
+     * @brief 把一次增删列作为单独的提交写入重做日志（调用方独占持有该表）
+     * @return 需要等待落盘的 LSN
+     */
+    uint64_t logSchemaChange(const std::string &lname, TableEntry &entry, const std::string &change);
+
+    /**
+     * @brief 把分区表的一次增删列同样应用到各分区（调用方独占持有分区表，期间没有语句访问各分区）
+     * @param change 修改一个分区的表结构，返回写入重做日志的变更
+     * @return 需要等待落盘的 LSN，不是分区表时为 0
+     */
+    template <class Fn>
+    uint64_t alterPartitions(const std::string &lname, const TableEntry &parent, Fn &&change);
+
+    /**
+     * @brief 表的数据或结构发生变化：递增其版本（分区同时递增所属的分区表），使缓存的结果失效。
+     *        提交在时间戳发布之后调用，改表结构在释放独占锁之前调用
+     */
+    void touch(TableEntry &entry);
+
+    /**
+     * @brief 等待日志落盘，等待时间计入当前语句的落盘耗时
+     * @return 落盘失败时输出错误并返回 false，调用方不再报告语句成功
+     */
+    bool awaitDurable(uint64_t lsn);
+
+    /**
+     * @brief 记录一次提交给表带来的脏数据，总量越过阈值时唤醒检查点线程
+     */
+    void markDirty(TableEntry &entry, uint64_t bytes);
+
+    /**
+     * @brief 检查点写出按需分页的表后，条件允许时让它改为分页打开新文件
+     */
+    void remapTable(TableEntry &entry, const std::string &lname, const TableFileIndex &index, uint64_t ts);
+
+    /**
+     * @brief 后台检查点线程主循环：按时间间隔或脏数据量调用 saveAll()
+     */
+    void flushLoop();
+
+    /**
+     * @brief 若表需要压缩，则加入后台压缩队列（调用方须持有该表的锁）
+     */
+    void scheduleCompaction(const std::string &lname, const Table &t);
+
+    /**
+     * @brief 后台压缩线程主循环：等待待压缩的表，物理移除已删除行
+     */
+    void compactionLoop();
+
+    TxnManager txns;                          ///< 分配事务号与提交时间戳
+    ResultCache results;                      ///< 查询结果缓存
+    std::atomic<uint64_t> versionClock{0};    ///< 分配表的数据版本，删除后重建的同名表也不会重复
+    MemoryBudget memory{64 << 20, 256 << 20}; ///< 查询工作内存预算
+    PageCache pages;                          ///< 按需分页的表共享的段缓存，须比表目录后析构
+    RedoLog wal;                              ///< 重做日志（组提交）
+    std::shared_ptr<const Catalog> tables;    ///< 表目录快照（键为表名），只通过 atomic_load/atomic_store 访问
+    std::mutex catalogMutex;                  ///< 串行化建表、删表、加载等修改目录的操作
+
+    std::mutex compactMutex;                           ///< 保护压缩队列与 stopping
+    std::condition_variable compactCv;                 ///< 唤醒后台压缩线程
+    std::unordered_set<std::string> pendingCompaction; ///< 等待压缩的表名
+    std::atomic<double> compactionRatio{0.3};          ///< 触发压缩的已删除行比例
+    bool stopping = false;                             ///< 析构时通知压缩线程退出
+    std::thread compactor;                             ///< 后台压缩线程
+
+    std::mutex checkpointMutex;                        ///< 串行化检查点，保护各表的 checkpointTs 与 .views 文件
+    std::atomic<uint64_t> dirtyBytes{0};               ///< 所有表的 dirtyBytes 之和
+    std::atomic<uint64_t> checkpointBytes{16 << 20};   ///< 脏数据超过该值时提前做检查点
+    std::atomic<int> checkpointIntervalMs{60000};      ///< 检查点间隔
+    std::mutex flushMutex;                             ///< 保护 flushRequested 与 flushStopping
+    std::condition_variable flushCv;                   ///< 唤醒检查点线程
+    bool flushRequested = false;                       ///< 不等间隔到期，立即检查一次
+    bool flushStopping = false;                        ///< 析构时通知检查点线程退出
+    std::thread flusher;                               ///< 后台检查点线程
+
+    StatementMetrics statementMetrics[size_t(StatementKind::COUNT)]; ///< 按语句类型的运行统计
+    SlowQueryLog slowLog;                                            ///< 慢查询日志
 };
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include "membudget.h"
+
+/**
+ * @brief 外部归并排序
+ *
+ * 按排序键（字典序）排列若干 (键, 内容) 记录。记录先缓存在内存中，
+ * 缓冲区无法再从 MemoryReservation 申请到内存时，排序后作为一个有序段写入数据目录下的
+ * 临时文件 <sort_编号_段号>.sortrun 并清空缓冲区；最后对所有有序段与剩余的缓冲区做 k 路归并。
+ * 有序段超过 kMaxFanIn 个时先逐轮把相邻的 kMaxFanIn 个段归并为一个，同时打开的文件数因此有上限。
+ * 内存占用以预算为上限（加上每个打开的有序段一条记录的读取缓冲），而与记录总数无关。
+ * 临时文件在析构时删除。写出或读取有序段失败（磁盘已满、打开的文件过多等）时排序作废，
+ * valid() 返回 false，merge() 不输出任何记录。
+ */
+class ExternalSorter
+{
+public:
+    /**
+     * @param mem 缓冲区从中申请内存
+     * @param desc 是否降序
+     */
+    ExternalSorter(MemoryReservation &mem, bool desc);
+    ~ExternalSorter();
+    ExternalSorter(const ExternalSorter &) = delete;
+    ExternalSorter &operator=(const ExternalSorter &) = delete;
+
+    static constexpr size_t kMaxFanIn = 64; ///< 一次归并最多同时读取的有序段数
+
+    /**
+     * @brief 加入一条记录（排序已作废时忽略）
+     */
+    void add(std::string_view key, std::string payload);
+
+    /**
+     * @brief 按顺序输出所有记录的内容，emit 返回 false 时提前结束（例如达到 LIMIT）
+     * @return 写出或读取有序段失败时返回 false，原因见 error()；
+     *         打不开有序段时在输出任何记录之前失败，读到一半才发现文件损坏时已输出的记录无法收回
+     */
+    bool merge(const std::function<bool(const std::string &)> &emit);
+
+    /**
+     * @brief 已写出的有序段个数
+     */
+    size_t runCount() const { return runs.size(); }
+
+    bool valid() const { return err.empty(); }
+    const std::string &error() const { return err; }
+
+private:
+    struct Record
+    {
+        std::string key;
+        std::string payload;
+    };
+
+    /**
+     * @brief 排序缓冲区（desc 时降序）
+     */
+    void sortBuffer();
+
+    /**
+     * @brief 把缓冲区排序后写成一个有序段，并归还其内存
+     */
+    void spill();
+
+    /**
+     * @brief 新的有序段文件名
+     */
+    std::string runPath();
+
+    /**
+     * @brief 按顺序归并有序段 runs[first, last)（withBuffer 时再加上排好序的缓冲区），逐条交给 emit
+     * @return 打开或读取有序段失败时记下原因并返回 false
+     */
+    bool mergeRuns(size_t first, size_t last, bool withBuffer, const std::function<bool(Record &)> &emit);
+
+    /**
+     * @brief 把相邻的每 kMaxFanIn 个有序段归并为一个，直到不超过 kMaxFanIn 个
+     */
+    bool reduceRuns();
+
+    MemoryReservation &mem;
+    bool desc;
+    uint64_t id;                   ///< 本次排序的编号，用于生成临时文件名
+    uint64_t nextRun = 0;          ///< 下一个有序段文件的编号
+    std::vector<Record> buffer;    ///< 尚未写出的记录
+    std::vector<std::string> runs; ///< 已写出的有序段文件，按写出顺序（键相同时靠前的先输出）
+    std::string err;               ///< 失败的原因，非空时排序作废
+};
@@ -0,0 +1,104 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <shared_mutex>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief 在 haystack 中查找 needle，不区分 ASCII 大小写
+ *
+ * 先用 needle 的首字节与末字节筛选候选位置（有 SSE2 时一次检查 16 个位置，
+ * 两个字节各与大小写两种形式比较），两端都相同的位置再比较中间部分。
+ * @param needle 须已转为小写
+ * @return 第一次出现的位置，没有时返回 std::string_view::npos
+ */
+size_t findCaseless(std::string_view haystack, std::string_view needle);
+
+/**
+ * @brief SQL LIKE 模式：% 匹配任意个字符，_ 匹配一个字节；不区分 ASCII 大小写，不支持转义
+ *
+ * 模式按 % 切成片段：第一个片段须出现在值的开头，最后一个须出现在结尾，
+ * 中间的片段依次取最左的出现位置（贪心对只含 % 的模式是完备的）。
+ * 与等值条件不同，值的首尾空白不去掉。
+ */
+class LikePattern
+{
+public:
+    explicit LikePattern(std::string_view pattern);
+
+    /**
+     * @brief 值 s 是否匹配模式
+     */
+    bool matches(std::string_view s) const;
+
+    /**
+     * @brief 模式开头的字面前缀（小写，到第一个 % 或 _ 为止），匹配的值都以它开头
+     */
+    const std::string &prefix() const { return lead; }
+
+    /**
+     * @brief 模式中所有不含通配符的最长片段（小写），匹配的值都含有它们
+     */
+    const std::vector<std::string> &literals() const { return runs; }
+
+private:
+    /**
+     * @brief 片段 seg 是否出现在 s 的 pos 处
+     */
+    static bool matchAt(std::string_view s, size_t pos, const std::string &seg);
+
+    /**
+     * @brief 片段 seg 在 s 中 from 之后第一次出现的位置
+     */
+    static size_t find(std::string_view s, size_t from, const std::string &seg);
+
+    std::vector<std::string> segments; ///< 按 % 切开的片段（小写，可能为空），_ 保留为通配符
+    std::string lead;                  ///< 字面前缀
+    std::vector<std::string> runs;     ///< 不含通配符的最长片段
+};
+
+/**
+ * @brief 文本列上的 LIKE 索引，收录规范化（转为小写）的值：
+ *        - 有序索引：值 -> 行版本下标，按前缀查找一段连续的键
+ *        - 三元组索引：值中每 3 个连续字节 -> 含有它的行版本下标（升序），按片段的三元组求交
+ *
+ * 与 KeyIndex 相同，收录所有行版本（NULL 除外），查得的是候选，
+ * 调用方再按快照判断可见性并用 LikePattern 复核；写者追加时加入，读者同时查找，由内部的读写锁保护。
+ */
+class TextIndex
+{
+public:
+    static constexpr uint8_t kSorted = 1;  ///< 有序索引
+    static constexpr uint8_t kTrigram = 2; ///< 三元组索引
+
+    explicit TextIndex(uint8_t kinds) : kinds(kinds) {}
+
+    uint8_t kind() const { return kinds; }
+
+    /**
+     * @brief 加入第 row 个行版本的值 value
+     */
+    void add(std::string_view value, size_t row);
+
+    /**
+     * @brief 按模式查找候选行版本，按下标升序；有字面前缀时用有序索引，
+     *        否则（或前缀范围比最短的三元组列表还长时）用三元组索引（需要至少一个不短于 3 字节的字面片段）
+     * @return 两种方式都不可用时返回 false
+     */
+    bool candidates(const LikePattern &pattern, std::vector<size_t> &out) const;
+
+    /**
+     * @brief candidates() 对该模式是否可用（不实际查找）
+     */
+    bool usable(const LikePattern &pattern) const;
+
+private:
+    uint8_t kinds;                                               ///< kSorted / kTrigram 的组合
+    mutable std::shared_mutex mtx;                               ///< 写者加入与读者查找互斥
+    std::multimap<std::string, size_t> byValue;                  ///< 有序索引：小写的值 -> 行版本下标
+    std::unordered_map<uint32_t, std::vector<size_t>> trigrams; ///< 三元组 -> 行版本下标（升序、不重复）
+};
@@ -0,0 +1,149 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+#include "table.h"
+#include "mvcc.h"
+
+/**
+ * @brief 物化视图的一个输出列：聚合函数与其参数列
+ */
+struct ViewColumn
+{
+    std::string func;   ///< COUNT / SUM / AVG（大写）
+    std::string column; ///< 参数列名，COUNT(*) 为 "*"
+};
+
+/**
+ * @brief 物化的分组聚合：SELECT <键列>, <聚合>, ... FROM <基表> GROUP BY <键列>
+ *
+ * 每个分组保存行数以及各参数列的和与非 NULL 值个数，COUNT / SUM / AVG 都由它们算出；
+ * 基表的每次提交把写集合作为增量应用：新版本加入所在分组，被结束的旧版本从分组中减去
+ * （UPDATE 是二者之和），行数减到 0 的分组被删除。读取只需遍历分组，与基表的行数无关。
+ * MIN / MAX 在删除后无法增量维护，不支持。
+ *
+ * 分组键取单元格的原始文本，NULL 自成一组；参数列为 NULL 或不能解析为数值的值不计入和与个数。
+ * 增量只在提交时应用，回滚的修改不会进入视图；读到的是最近一次提交之后的结果。
+ */
+class AggregateView
+{
+public:
+    /**
+     * @param name 视图名（小写）
+     * @param table 基表名（小写）
+     * @param key 分组键列名
+     * @param cols 聚合列
+     */
+    AggregateView(std::string name, std::string table, std::string key, std::vector<ViewColumn> cols);
+
+    const std::string &name() const { return viewName; }
+    const std::string &table() const { return baseTable; }
+    const std::string &key() const { return keyColumn; }
+    const std::vector<ViewColumn> &columns() const { return outputs; }
+
+    /**
+     * @brief 键列或某个聚合列的参数是否为 col（不区分大小写）
+     */
+    bool uses(const std::string &col) const;
+
+    /**
+     * @brief 检查键列与参数列在表中都存在
+     * @param error 不存在时输出原因
+     */
+    bool bind(const Table &t, std::string &error) const;
+
+    /**
+     * @brief 按快照 snap 下 sources（基表，或分区表的各分区）中可见的行重新计算所有分组
+     * @param ts 结果对应的提交时间戳
+     */
+    void rebuild(const std::vector<const Table *> &sources, const Snapshot &snap, uint64_t ts);
+
+    /**
+     * @brief 提交时应用表 t（基表或其分区）上的写集合，调用方持有提交锁，各次调用按 ts 递增
+     */
+    void apply(const Table &t, const WriteSet &ws, uint64_t ts);
+
+    /**
+     * @brief 表 t 的第 i 个行版本从视图中减去（sign = -1）或加入（sign = 1）
+     */
+    void applyRow(const Table &t, size_t i, int sign);
+
+    /**
+     * @brief 输出列名：键列与各聚合（如 SUM(amount)）
+     */
+    std::vector<std::string> header() const;
+
+    /**
+     * @brief 按键升序对各分组的一行（键与各聚合值，已格式化）调用 fn
+     * @param key 非空时只输出该键的分组
+     * @param limit 最多输出的分组数，-1 表示不限
+     * @return 输出的分组数
+     */
+    size_t forEachGroup(const std::string *key, int limit, const std::function<void(const std::vector<std::string> &)> &fn) const;
+
+    /**
+     * @brief 分组数
+     */
+    size_t groupCount() const;
+
+    /**
+     * @brief 自上次 serialize() 以来是否应用过提交
+     */
+    bool dirty() const;
+
+    /**
+     * @brief 序列化定义与分组，并清除 dirty 标记
+     * @param now 调用前取得的最新提交时间戳；此前的提交都已应用，结果对应 max(now, 最后应用的提交)
+     */
+    std::string serialize(uint64_t now);
+
+    /**
+     * @brief 从 serialize() 的结果中读取下一个视图
+     * @param pos 读取位置，返回时指向下一个视图
+     * @param ts 输出分组对应的提交时间戳
+     * @return 格式错误或已读完时返回 nullptr
+     */
+    static std::shared_ptr<AggregateView> parse(const std::string &text, size_t &pos, uint64_t &ts);
+
+private:
+    /**
+     * @brief 一个分组的累计值
+     */
+    struct Group
+    {
+        int64_t rows = 0;            ///< 行数，即 COUNT(*)
+        std::vector<double> sums;    ///< 各参数列的和
+        std::vector<int64_t> counts; ///< 各参数列的非 NULL 数值个数
+    };
+
+    /**
+     * @brief 调用方持有 mtx；keyCol / args 为按当前表结构解析的列下标
+     */
+    void addRow(const Table &t, const RowRef &row, size_t keyCol, const std::vector<int> &args, int sign);
+
+    /**
+     * @brief 按表 t 的当前列顺序解析键列（返回值）与各参数列的下标（args，与 measures 对应）
+     * @return 键列不存在时返回 -1
+     */
+    int resolve(const Table &t, std::vector<int> &args) const;
+
+    std::string viewName;              ///< 视图名
+    std::string baseTable;             ///< 基表名
+    std::string keyColumn;             ///< 分组键列名
+    std::vector<ViewColumn> outputs;   ///< 聚合列
+    std::vector<std::string> measures; ///< 聚合用到的参数列（不含 *，不重复）
+    std::vector<int> measureOf;        ///< outputs[k] 的参数列在 measures 中的下标，COUNT(*) 为 -1
+
+    mutable std::mutex mtx;              ///< 保护以下成员：提交线程应用增量，查询与检查点读取
+    std::map<std::string, Group> groups; ///< 分组键 -> 累计值
+    uint64_t appliedTs = 0;              ///< 最后应用的提交时间戳
+    bool changed = true;                 ///< 自上次 serialize() 以来是否有修改
+};
+
+/// 一张基表上的物化视图
+using ViewList = std::vector<std::shared_ptr<AggregateView>>;
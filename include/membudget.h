@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+/**
+ * @brief 查询内存预算
+ *
+ * 所有查询共享一个全局上限，每个查询另有自己的上限。查询通过 MemoryReservation
+ * 申请内存，申请失败时应改用占用内存更少的算法（例如排序改为外部排序），而不是继续分配。
+ * 只统计查询的工作内存（排序缓冲区等），不包括表数据本身。
+ */
+class MemoryBudget
+{
+public:
+    MemoryBudget(size_t perQuery, size_t global) : perQueryLimit(perQuery), globalLimit(global) {}
+
+    /**
+     * @brief 从全局预算中申请 bytes 字节
+     * @return 超出全局上限时不申请并返回 false
+     */
+    bool tryAcquire(size_t bytes)
+    {
+        size_t cur = inUse.load(std::memory_order_relaxed);
+        do
+        {
+            if (cur + bytes > globalLimit.load(std::memory_order_relaxed))
+                return false;
+        } while (!inUse.compare_exchange_weak(cur, cur + bytes, std::memory_order_relaxed));
+        return true;
+    }
+
+    void release(size_t bytes) { inUse.fetch_sub(bytes, std::memory_order_relaxed); }
+
+    /**
+     * @brief 当前所有查询已申请的字节数
+     */
+    size_t used() const { return inUse.load(std::memory_order_relaxed); }
+
+    std::atomic<size_t> perQueryLimit; ///< 单个查询的上限
+    std::atomic<size_t> globalLimit;   ///< 所有查询合计的上限
+
+private:
+    std::atomic<size_t> inUse{0};
+};
+
+/**
+ * @brief 单个查询持有的内存预算，析构时归还
+ */
+class MemoryReservation
+{
+public:
+    explicit MemoryReservation(MemoryBudget &b) : budget(b) {}
+    ~MemoryReservation() { budget.release(held); }
+    MemoryReservation(const MemoryReservation &) = delete;
+    MemoryReservation &operator=(const MemoryReservation &) = delete;
+
+    /**
+     * @brief 再申请 bytes 字节
+     * @return 超出本查询或全局上限时不申请并返回 false
+     */
+    bool grow(size_t bytes)
+    {
+        if (held + bytes > budget.perQueryLimit.load(std::memory_order_relaxed) || !budget.tryAcquire(bytes))
+            return false;
+        held += bytes;
+        return true;
+    }
+
+    /**
+     * @brief 归还全部已申请的内存
+     */
+    void reset()
+    {
+        budget.release(held);
+        held = 0;
+    }
+
+    size_t size() const { return held; }
+
+private:
+    MemoryBudget &budget;
+    size_t held = 0;
+};
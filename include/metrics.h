@@ -0,0 +1,141 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include "resultcache.h"
+
+/**
+ * @brief 语句的类型，运行统计按类型分别累计
+ */
+enum class StatementKind
+{
+    SELECT,
+    INSERT,
+    UPDATE,
+    DELETE,
+    AGGREGATE,
+    ANALYZE,
+    DDL,        ///< 建表、删表、增删列
+    TXN,        ///< BEGIN / COMMIT / ROLLBACK；事务中写入的日志字节与落盘等待计在 COMMIT 上
+    CHECKPOINT, ///< saveAll（含后台检查点）
+    COUNT       ///< 类型个数
+};
+
+/**
+ * @brief 语句类型的名称（SHOW STATS 输出中使用）
+ */
+const char *statementKindName(StatementKind kind);
+
+/**
+ * @brief HDR 风格的延迟分桶：每个 2 的幂区间再等分 kSubBuckets 份
+ *
+ * 桶的相对宽度不超过 1/kSubBuckets，因此按桶估计的分位数相对误差在 12.5% 以内；
+ * 覆盖 1ns 到约 2^40ns（18 分钟），更长的延迟计入最后一个桶。
+ */
+struct LatencyBuckets
+{
+    static constexpr int kSubBits = 3;
+    static constexpr uint64_t kSubBuckets = uint64_t(1) << kSubBits;
+    static constexpr int kMaxShift = 37;
+    static constexpr size_t kCount = (kMaxShift + 2) * kSubBuckets;
+
+    /**
+     * @brief 延迟 ns 所在桶的下标
+     */
+    static size_t index(uint64_t ns);
+
+    /**
+     * @brief 第 idx 个桶的上界（桶内延迟都不超过它）
+     */
+    static uint64_t upperBound(size_t idx);
+};
+
+/**
+ * @brief 一组语句统计的汇总结果
+ */
+struct StatementSummary
+{
+    uint64_t count = 0;        ///< 语句数
+    uint64_t rowsScanned = 0;  ///< 扫描的行版本数
+    uint64_t rowsReturned = 0; ///< 返回给客户端的行数
+    uint64_t rowsWritten = 0;  ///< 插入、更新、删除的行数
+    uint64_t bytesWritten = 0; ///< 写入重做日志与表文件的字节数
+    uint64_t execNanos = 0;    ///< 执行耗时（总耗时减去落盘耗时）
+    uint64_t persistNanos = 0; ///< 等待日志落盘、写表文件的耗时
+    uint64_t maxNanos = 0;     ///< 最长的一条语句的总耗时
+    std::vector<uint64_t> buckets = std::vector<uint64_t>(LatencyBuckets::kCount); ///< 总耗时的分布
+
+    /**
+     * @brief 第 q 分位的总耗时（纳秒，取所在桶的上界，不超过 maxNanos），没有语句时为 0
+     */
+    uint64_t percentile(double q) const;
+};
+
+/**
+ * @brief 一组语句（某类语句，或某张表上的语句）的计数与延迟分布
+ *
+ * 按线程分片：每个线程固定写其中一个分片，分片内都是 relaxed 原子量且按缓存行对齐，
+ * 记录时既不加锁也很少与其他线程争用同一缓存行；读取时把各分片相加，
+ * 得到的是近似一致的快照（并发记录中的语句可能只计入了一部分字段）。
+ */
+class StatementMetrics
+{
+public:
+    StatementMetrics() = default;
+    StatementMetrics(const StatementMetrics &) = delete;
+    StatementMetrics &operator=(const StatementMetrics &) = delete;
+
+    /**
+     * @brief 记录一条语句
+     * @param totalNanos 总耗时
+     * @param persistNanos 其中落盘的耗时
+     */
+    void record(uint64_t totalNanos, uint64_t persistNanos, uint64_t rowsScanned, uint64_t rowsReturned,
+                uint64_t rowsWritten, uint64_t bytesWritten);
+
+    /**
+     * @brief 各分片相加的结果
+     */
+    StatementSummary summary() const;
+
+private:
+    static constexpr size_t kShards = 8;
+
+    struct alignas(64) Shard
+    {
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> rowsScanned;
+        std::atomic<uint64_t> rowsReturned;
+        std::atomic<uint64_t> rowsWritten;
+        std::atomic<uint64_t> bytesWritten;
+        std::atomic<uint64_t> execNanos;
+        std::atomic<uint64_t> persistNanos;
+        std::atomic<uint64_t> maxNanos;
+        std::atomic<uint64_t> buckets[LatencyBuckets::kCount];
+    };
+
+    Shard shards[kShards]{}; ///< 值初始化，所有计数从 0 开始
+};
+
+/**
+ * @brief 数据库运行统计的快照（sqlDB::metrics() 返回）
+ */
+struct MetricsSnapshot
+{
+    std::vector<std::pair<std::string, StatementSummary>> statements; ///< 按语句类型，顺序同 StatementKind
+    std::vector<std::pair<std::string, StatementSummary>> tables;     ///< 按表名排序，只含目录中的表
+    ResultCacheStats resultCache;                                     ///< 查询结果缓存，capacity 为 0 表示未开启
+
+    /**
+     * @brief 某类语句的汇总
+     */
+    const StatementSummary &statement(StatementKind kind) const { return statements[size_t(kind)].second; }
+
+    /**
+     * @brief 文本格式：每类语句、每张表一行，开启结果缓存时再加一节缓存的统计；SHOW STATS 与 exportStats 都使用该格式
+     */
+    std::string format() const;
+};
@@ -0,0 +1,147 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <set>
+#include <cstddef>
+
+/**
+ * @brief 多版本并发控制(MVCC)使用的时间戳约定
+ *
+ * 每个行版本带有 [begin, end) 两个时间戳：
+ * - 已提交的版本使用提交时间戳（单调递增，从 kBootstrapTs 开始）
+ * - 未提交的版本使用 kTxnFlag | 事务号 作为标记，只对本事务可见
+ * - end 为 kInfinityTs 表示该版本尚未被删除或覆盖
+ */
+constexpr uint64_t kTxnFlag = uint64_t(1) << 63;   ///< 最高位为 1 表示未提交事务的标记
+constexpr uint64_t kInfinityTs = ~uint64_t(0);     ///< 版本仍然有效
+constexpr uint64_t kBootstrapTs = 1;               ///< 从文件加载的版本使用的提交时间戳
+constexpr uint64_t kLatestTs = kTxnFlag - 1;       ///< 比任何提交时间戳都大
+
+/**
+ * @brief 读快照：能看到提交时间戳不超过 ts 的版本，以及事务 txn 自己写入的版本
+ */
+struct Snapshot
+{
+    uint64_t ts = kLatestTs; ///< 快照时间戳
+    uint64_t txn = 0;        ///< 所属事务号，0 表示只读快照
+
+    /**
+     * @brief 能看到所有已提交版本的快照（用于落盘、单独使用 Table 时）
+     */
+    static Snapshot latest() { return Snapshot{}; }
+
+    /**
+     * @brief 判断 [begin, end) 的版本对该快照是否可见
+     */
+    bool sees(uint64_t begin, uint64_t end) const
+    {
+        // 扫描时逐行调用，写成没有分支的形式：提交时间戳总小于 kTxnFlag，因此 begin <= ts 只对已提交的版本成立，
+        // end > ts 对所有未提交的标记都成立，再排除本事务自己的标记（本事务已结束的版本不可见）
+        uint64_t mine = kTxnFlag | txn;
+        return ((begin <= ts) | (begin == mine)) & (((end > ts) & (end != mine)) | (end == kInfinityTs));
+    }
+};
+
+/**
+ * @brief 一次写操作在某张表上产生的版本：新追加的版本与被结束的旧版本（均为行号）
+ */
+struct WriteSet
+{
+    std::vector<size_t> inserted; ///< begin 为事务标记的新版本
+    std::vector<size_t> ended;    ///< end 为事务标记的旧版本
+
+    bool empty() const { return inserted.empty() && ended.empty(); }
+};
+
+/**
+ * @brief 分配事务号与提交时间戳
+ *
+ * 写操作先以 kTxnFlag | 事务号 标记新版本的 begin 和旧版本的 end，
+ * 然后在 commit() 中把这些标记替换为提交时间戳，最后才推进 lastCommitted。
+ * 读者的快照取自 lastCommitted，因此要么看到一次提交的全部修改，要么全都看不到。
+ */
+class TxnManager
+{
+public:
+    /**
+     * @brief 分配新的事务号（已带 kTxnFlag，可直接用作版本标记）
+     */
+    uint64_t beginTxn() { return kTxnFlag | nextTxn.fetch_add(1); }
+
+    /**
+     * @brief 取当前最新的只读快照
+     */
+    Snapshot snapshot(uint64_t txnMarker = 0) const
+    {
+        return Snapshot{lastCommitted.load(std::memory_order_acquire), txnMarker & ~kTxnFlag};
+    }
+
+    /**
+     * @brief 为显式事务取快照并登记，事务结束前 gcHorizon() 不会越过它
+     */
+    Snapshot beginSnapshot(uint64_t txnMarker)
+    {
+        std::lock_guard<std::mutex> lock(activeMutex);
+        Snapshot snap = snapshot(txnMarker);
+        active.insert(snap.ts);
+        return snap;
+    }
+
+    /**
+     * @brief 注销 beginSnapshot() 登记的快照
+     */
+    void endSnapshot(const Snapshot &snap)
+    {
+        std::lock_guard<std::mutex> lock(activeMutex);
+        auto it = active.find(snap.ts);
+        if (it != active.end())
+            active.erase(it);
+    }
+
+    /**
+     * @brief 确保之后分配的提交时间戳大于 ts（恢复时跳过日志和表文件中已用过的时间戳）
+     */
+    void advanceTo(uint64_t ts)
+    {
+        std::lock_guard<std::mutex> lock(commitMutex);
+        if (ts > lastCommitted.load(std::memory_order_relaxed))
+            lastCommitted.store(ts, std::memory_order_release);
+    }
+
+    /**
+     * @brief 提交：分配提交时间戳并调用 publish(ts) 把标记替换为 ts，之后对新快照可见
+     * @return 提交时间戳
+     */
+    template <class Fn>
+    uint64_t commit(Fn &&publish)
+    {
+        std::lock_guard<std::mutex> lock(commitMutex);
+        uint64_t ts = lastCommitted.load(std::memory_order_relaxed) + 1;
+        publish(ts);
+        lastCommitted.store(ts, std::memory_order_release);
+        return ts;
+    }
+
+    /**
+     * @brief 不再被任何快照需要的版本的时间戳上界：end <= 该值的版本可以回收
+     *
+     * 语句级快照只在持有表的共享锁期间使用，而回收时持有该表的独占锁，
+     * 所以只需考虑显式事务登记的快照；没有时取最新的提交时间戳。
+     */
+    uint64_t gcHorizon()
+    {
+        std::lock_guard<std::mutex> lock(activeMutex);
+        uint64_t last = lastCommitted.load(std::memory_order_acquire);
+        return active.empty() ? last : std::min(last, *active.begin());
+    }
+
+private:
+    std::atomic<uint64_t> lastCommitted{kBootstrapTs}; ///< 最近一次提交的时间戳
+    std::atomic<uint64_t> nextTxn{1};                  ///< 下一个事务号
+    std::mutex commitMutex;                            ///< 串行化提交，保证时间戳按顺序可见
+    std::mutex activeMutex;                            ///< 保护 active
+    std::multiset<uint64_t> active;                    ///< 进行中的显式事务的快照时间戳
+};
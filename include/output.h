@@ -0,0 +1,48 @@
+#pragma once
+#include <iostream>
+
+/**
+ * @brief 当前线程的输出目标
+ *
+ * sqlDB 与 SQL 解析器的查询结果、提示信息都写到 dbOut()，错误写到 dbErr()。
+ * 默认分别为 std::cout 和 std::cerr；服务器的工作线程执行请求时
+ * 用 OutputCapture 把二者重定向到该请求的响应缓冲区，线程之间互不影响。
+ */
+inline std::ostream *&outSink()
+{
+    thread_local std::ostream *sink = &std::cout;
+    return sink;
+}
+
+inline std::ostream *&errSink()
+{
+    thread_local std::ostream *sink = &std::cerr;
+    return sink;
+}
+
+inline std::ostream &dbOut() { return *outSink(); }
+inline std::ostream &dbErr() { return *errSink(); }
+
+/**
+ * @brief 在作用域内把当前线程的 dbOut()/dbErr() 都重定向到 os
+ */
+class OutputCapture
+{
+public:
+    explicit OutputCapture(std::ostream &os) : prevOut(outSink()), prevErr(errSink())
+    {
+        outSink() = &os;
+        errSink() = &os;
+    }
+    ~OutputCapture()
+    {
+        outSink() = prevOut;
+        errSink() = prevErr;
+    }
+    OutputCapture(const OutputCapture &) = delete;
+    OutputCapture &operator=(const OutputCapture &) = delete;
+
+private:
+    std::ostream *prevOut;
+    std::ostream *prevErr;
+};
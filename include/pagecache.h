@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+class RowStore;
+
+/**
+ * @brief 按需分页打开的表共享的段缓存
+ *
+ * 登记所有已载入内存的可换出段及其字节数，合计超过容量时按 CLOCK（二次机会）淘汰：
+ * 指针依次扫过各段，最近被访问过的段清除访问标记后跳过，否则换出。
+ * 换出只是丢弃行存储对段内容的引用，正在读取该段的 RowRef 读完后才真正释放内存。
+ */
+class PageCache
+{
+public:
+    explicit PageCache(size_t capacity = 0) : limit(capacity) {}
+    PageCache(const PageCache &) = delete;
+    PageCache &operator=(const PageCache &) = delete;
+
+    /**
+     * @brief 设置容量（字节），0 表示不分页；缩小后在下次载入段时淘汰到容量以内
+     */
+    void setCapacity(size_t bytes) { limit.store(bytes, std::memory_order_relaxed); }
+    size_t capacity() const { return limit.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 登记 store 刚载入的第 seg 段，超出容量时淘汰其他段
+     */
+    void admit(RowStore *store, size_t seg, size_t bytes);
+
+    /**
+     * @brief 移除 store 的所有段（行存储释放或重新打开前调用）
+     */
+    void forget(const RowStore *store);
+
+    /**
+     * @brief 已登记段的字节数
+     */
+    size_t used() const;
+
+    /**
+     * @brief 累计从表文件载入段的次数
+     */
+    uint64_t faults() const { return faultCount.load(std::memory_order_relaxed); }
+
+private:
+    struct Entry
+    {
+        RowStore *store;
+        size_t seg;
+        size_t bytes;
+    };
+
+    mutable std::mutex mtx;                ///< 保护 ring、hand 与 usedBytes
+    std::vector<Entry> ring;               ///< 已载入的可换出段，CLOCK 指针在其中循环
+    size_t hand = 0;                       ///< CLOCK 指针
+    size_t usedBytes = 0;                  ///< ring 中各段的字节数之和
+    std::atomic<size_t> limit;             ///< 容量
+    std::atomic<uint64_t> faultCount{0};   ///< 累计载入次数
+};
@@ -26,4 +26,15 @@
  * @author
  *  moyuh
  */
-void runSQLConsole(sqlDB &db);
\ No newline at end of file
+void runSQLConsole(sqlDB &db);
+
+/**
+ * @brief 解析并执行一条 SQL 命令
+ *
+ * 支持的命令与 runSQLConsole() 相同。结果与提示信息写到当前线程的 dbOut()，
+ * 服务器模式下由工作线程重定向到请求的响应中。
+ *
+ * @param db 数据库对象
+ * @param line 一条完整的 SQL 命令
+ */
+void executeSQL(sqlDB &db, const std::string &line);
@@ -0,0 +1,111 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <cstddef>
+#include "types.h"
+
+/**
+ * @brief 分区方式
+ */
+enum class PartitionKind : uint8_t
+{
+    HASH, // 按分区列值的哈希对分区数取模
+    RANGE // 按分区列值落在哪个上界之下
+};
+
+/**
+ * @brief 一个分区
+ */
+struct PartitionDef
+{
+    std::string name;  ///< 分区名（小写），分区的数据存放在表 <表名>#<分区名>
+    std::string upper; ///< RANGE：上界（不含），为空表示 MAXVALUE；HASH 不使用
+};
+
+/**
+ * @brief 表的分区定义：分区列、分区方式与各分区，负责把行分配到分区、按条件裁剪分区
+ *
+ * 每个分区是目录中一张普通的表（名为 <表名>#<分区名>），各自有表文件、重做日志记录与检查点，
+ * 分区表本身只保存表结构；分区定义保存在 <表名>.parts。
+ *
+ * - HASH：值的哈希（FNV-1a，与平台无关，保存后的分配方式不会变）对分区数取模；只有等值条件能裁剪
+ * - RANGE：各分区按上界递增排列，分区 k 存放 上界[k-1] <= 值 < 上界[k] 的行，
+ *   最后一个分区的上界可以是 MAXVALUE；NULL 与无法解析的值放入第一个分区。等值与区间条件都能裁剪
+ *
+ * 值的比较方式与 WHERE 条件相同（见 db.cc 中的 ColumnFilter）：DATE/TIMESTAMP 按原生整数，
+ * 数值列的区间按数值，其余按去掉首尾空白、不区分大小写的文本，因此裁剪不会漏掉满足条件的行。
+ */
+class PartitionScheme
+{
+public:
+    static constexpr size_t npos = size_t(-1);
+
+    PartitionKind kind = PartitionKind::HASH; ///< 分区方式
+    std::string column;                       ///< 分区列名
+    DataType type = DataType::TEXT;           ///< 分区列的类型
+    std::vector<PartitionDef> parts;          ///< 各分区（RANGE 按上界递增）
+
+    /**
+     * @brief 检查定义（分区名不重复、RANGE 上界能解析且递增、MAXVALUE 只能在最后），
+     *        并预先计算各上界的比较键；修改 parts 或 type 之后须重新调用
+     * @param error 不合法时输出原因
+     */
+    bool build(std::string &error);
+
+    /**
+     * @brief 值为 value 的行所在的分区
+     * @return 分区下标；RANGE 中值不小于最后一个上界（且没有 MAXVALUE 分区）时返回 npos
+     */
+    size_t route(std::string_view value) const;
+
+    /**
+     * @brief 分区列等于 value 的行可能所在的分区
+     */
+    std::vector<size_t> prune(std::string_view value) const;
+
+    /**
+     * @brief 分区列落在 range 内的行可能所在的分区（HASH 与无法解析的边界返回全部分区）
+     */
+    std::vector<size_t> prune(const ValueRange &range) const;
+
+    /**
+     * @brief 分区名为 part 的下标，不存在时返回 npos
+     */
+    size_t find(const std::string &part) const;
+
+    /**
+     * @brief 第 k 个分区的表名
+     */
+    std::string tableName(const std::string &table, size_t k) const { return table + "#" + parts[k].name; }
+
+    /**
+     * @brief 保存到文件（先写临时文件再重命名）
+     */
+    bool saveToFile(const std::string &path) const;
+
+    /**
+     * @brief 从文件读取（type 不保存，由调用方按表结构设置后再 build()）
+     * @return 文件不存在或格式错误时返回 false
+     */
+    bool loadFromFile(const std::string &path);
+
+private:
+    /**
+     * @brief RANGE 的比较键：按字节比较与按值比较同序，NULL 或无法解析时为空
+     */
+    std::optional<std::string> rangeKey(std::string_view value) const;
+
+    /**
+     * @brief HASH 的哈希键：等值条件下相等的值得到相同的键
+     */
+    std::string hashKey(std::string_view value) const;
+
+    /**
+     * @brief 比较键为 key 的值所在的 RANGE 分区
+     */
+    size_t routeKey(const std::string &key) const;
+
+    std::vector<std::string> upperKeys; ///< RANGE：各分区上界的比较键（MAXVALUE 分区除外）
+};
@@ -0,0 +1,145 @@
+#pragma once
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <streambuf>
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief 查询结果缓存的统计
+ */
+struct ResultCacheStats
+{
+    size_t capacity = 0;        ///< 容量（字节），0 表示关闭
+    size_t bytes = 0;           ///< 已缓存的字节数
+    size_t entries = 0;         ///< 已缓存的结果数
+    uint64_t hits = 0;          ///< 命中次数
+    uint64_t misses = 0;        ///< 未命中次数（含过期）
+    uint64_t invalidations = 0; ///< 因表版本变化而丢弃的结果数
+    uint64_t evictions = 0;     ///< 因容量不足而淘汰的结果数
+};
+
+/**
+ * @brief 只读语句的结果缓存：规范化的语句 -> 输出文本，按字节数限制容量，LRU 淘汰
+ *
+ * 每个结果记下生成它时所读表的版本号，表的版本在每次提交、改表结构后递增，
+ * 查找时版本不同的结果视为过期并丢弃，因此不需要在写路径上主动清理缓存。
+ * 单个结果超过容量的 1/4 时不缓存，一次大查询不会挤掉其余所有的结果。
+ */
+class ResultCache
+{
+public:
+    /**
+     * @brief 设置容量并淘汰超出的结果，0 表示关闭（清空缓存）
+     */
+    void setCapacity(size_t bytes);
+
+    bool enabled() const { return cap.load(std::memory_order_relaxed) > 0; }
+
+    /**
+     * @brief 单个结果的上限（字节）
+     */
+    size_t maxResultBytes() const { return cap.load(std::memory_order_relaxed) / 4; }
+
+    /**
+     * @brief 查找语句 key 在表版本 version 下的结果，命中时移到 LRU 的最前面
+     * @param rows 输出结果的行数
+     * @return 没有或已过期时返回 nullptr
+     */
+    std::shared_ptr<const std::string> get(const std::string &key, uint64_t version, uint64_t &rows);
+
+    /**
+     * @brief 存入语句 key 在表版本 version 下的结果（替换同一语句的旧结果），超出容量时淘汰最久未使用的
+     */
+    void put(const std::string &key, uint64_t version, std::string text, uint64_t rows);
+
+    ResultCacheStats stats() const;
+
+private:
+    struct Entry
+    {
+        std::string key;                         ///< 规范化的语句
+        uint64_t version;                        ///< 生成结果时表的版本
+        std::shared_ptr<const std::string> text; ///< 输出文本（命中的读者在锁外输出）
+        uint64_t rows;                           ///< 结果的行数（记入语句统计）
+        size_t bytes;                            ///< 计入容量的字节数
+    };
+
+    /**
+     * @brief 移除一个结果（调用方持有 mtx）
+     */
+    void erase(std::list<Entry>::iterator it);
+
+    /**
+     * @brief 淘汰到不超过容量（调用方持有 mtx）
+     */
+    void shrink();
+
+    std::atomic<size_t> cap{0};                                        ///< 容量
+    mutable std::mutex mtx;                                            ///< 保护以下成员
+    std::list<Entry> lru;                                              ///< 最近使用的在前
+    std::unordered_map<std::string, std::list<Entry>::iterator> byKey; ///< 语句 -> lru 中的结果
+    size_t used = 0;                                                   ///< 已缓存的字节数
+    uint64_t hits = 0, misses = 0, invalidations = 0, evictions = 0;   ///< 统计
+};
+
+/**
+ * @brief 在作用域内记录当前线程写到 dbOut() 的输出，同时照常输出
+ *
+ * 结果缓存未命中时用它取得语句的输出文本：输出仍然立即写到原来的目标（顺序与不缓存时相同），
+ * 另外保留一份副本；超过 limit 字节后不再保留。写到 dbErr() 的内容同样照常输出，
+ * 但说明语句出错，结果不可缓存。
+ */
+class ResultRecorder
+{
+public:
+    explicit ResultRecorder(size_t limit);
+    ~ResultRecorder();
+    ResultRecorder(const ResultRecorder &) = delete;
+    ResultRecorder &operator=(const ResultRecorder &) = delete;
+
+    /**
+     * @brief 副本是否完整且没有错误输出（可以缓存）
+     */
+    bool complete() const;
+
+    /**
+     * @brief 取走输出的副本
+     */
+    std::string take() { return std::move(out.copy); }
+
+private:
+    /**
+     * @brief 转发到目标流并保留副本的缓冲区
+     */
+    class Tee : public std::streambuf
+    {
+    public:
+        Tee(std::ostream &target, size_t limit) : target(target), limit(limit) {}
+
+        std::string copy;       ///< 输出的副本
+        bool written = false;   ///< 是否有过输出
+        bool truncated = false; ///< 副本超过上限后被丢弃
+
+    protected:
+        int_type overflow(int_type c) override;
+        std::streamsize xsputn(const char *s, std::streamsize n) override;
+        int sync() override;
+
+    private:
+        void keep(const char *s, size_t n);
+
+        std::ostream &target;
+        size_t limit;
+    };
+
+    Tee out, err;                      ///< dbOut() / dbErr() 的缓冲区
+    std::ostream outStream, errStream; ///< 作用域内的 dbOut() / dbErr()
+    std::ostream *prevOut, *prevErr;   ///< 原来的输出目标
+    int uncaught;                      ///< 构造时未处理的异常数，之后有异常抛出时结果不完整
+};
@@ -0,0 +1,224 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include "table.h"
+
+/*
+ * 按列的 C++ 类型与比较运算特化的扫描算子
+ *
+ * 过滤与聚合都按段（RowStore::kSegmentRows 行，与可见位图一一对应）处理：
+ * 调用方对每段只按比较方式、运算符分派一次，先把段内候选行的值解码为 int64_t / double 数组，
+ * 再交给按值类型与运算符实例化的循环；循环内没有类型判断与分支，编译器可以向量化。
+ */
+
+/// 区间下界、上界的比较方式
+enum class Bound
+{
+    NONE,      // 无此边界
+    INCLUSIVE, // 包含等号
+    EXCLUSIVE  // 不包含等号
+};
+
+// 值 v 与边界 b 的比较，写成与逐行比较相同的形式（只用 <，值为 NaN 时的结果也相同）
+struct AtLeast
+{
+    template <class T>
+    bool operator()(const T &v, const T &b) const { return !(v < b); }
+};
+struct Above
+{
+    template <class T>
+    bool operator()(const T &v, const T &b) const { return b < v; }
+};
+struct AtMost
+{
+    template <class T>
+    bool operator()(const T &v, const T &b) const { return !(b < v); }
+};
+struct Below
+{
+    template <class T>
+    bool operator()(const T &v, const T &b) const { return v < b; }
+};
+struct Unbounded
+{
+    template <class T>
+    bool operator()(const T &, const T &) const { return true; }
+};
+
+/**
+ * @brief 按上下界的比较方式选出一对运算符，以 fn(下界运算符, 上界运算符) 调用一次
+ */
+template <class Fn>
+inline void withBoundOps(Bound low, Bound high, Fn &&fn)
+{
+    auto withHigh = [&](auto lowOp)
+    {
+        switch (high)
+        {
+        case Bound::NONE:
+            fn(lowOp, Unbounded());
+            return;
+        case Bound::INCLUSIVE:
+            fn(lowOp, AtMost());
+            return;
+        default:
+            fn(lowOp, Below());
+            return;
+        }
+    };
+    switch (low)
+    {
+    case Bound::NONE:
+        withHigh(Unbounded());
+        return;
+    case Bound::INCLUSIVE:
+        withHigh(AtLeast());
+        return;
+    default:
+        withHigh(Above());
+        return;
+    }
+}
+
+/**
+ * @brief 把文本解析为 double，不分配内存
+ * @param whole 为 true 时整个值（可带尾随空白）须为数字；
+ *              为 false 时同 std::stod：忽略开头的空白、取最长的数字前缀，溢出视为失败
+ */
+inline bool parseDouble(std::string_view s, bool whole, double &v)
+{
+    // INT 列的值通常是不超过 15 位的十进制整数：直接累加得到的 double 是精确值，与 strtod 相同
+    size_t k = !s.empty() && (s[0] == '-' || s[0] == '+');
+    if (s.size() > k && s.size() - k <= 15)
+    {
+        int64_t n = 0;
+        size_t i = k;
+        for (; i < s.size() && s[i] >= '0' && s[i] <= '9'; i++)
+            n = n * 10 + (s[i] - '0');
+        if (i == s.size())
+        {
+            v = s[0] == '-' ? -double(n) : double(n);
+            return true;
+        }
+    }
+    char buf[64];
+    std::string heap;
+    const char *begin = buf;
+    if (s.size() < sizeof(buf))
+    {
+        std::memcpy(buf, s.data(), s.size());
+        buf[s.size()] = '\0';
+    }
+    else
+    {
+        heap.assign(s);
+        begin = heap.c_str();
+    }
+    char *end;
+    errno = 0;
+    v = std::strtod(begin, &end);
+    if (end == begin)
+        return false;
+    if (!whole)
+        return errno != ERANGE;
+    while (*end == ' ' || *end == '\t')
+        end++;
+    return *end == '\0';
+}
+
+/**
+ * @brief 把一段中 mask 置位的行的值解码到 values[行下标 - base]，解码失败的行从 mask 中清除
+ * @param values RowStore::kSegmentRows 个元素，未置位的行对应的元素保持原值
+ * @param decode (const RowRef &, T &) -> bool
+ */
+template <class T, class Decode>
+inline void decodeSegment(const Table &t, size_t base, uint64_t *mask, T *values, Decode &&decode)
+{
+    for (size_t w = 0; w < ColumnBitmap::kWords; w++)
+        for (uint64_t bits = mask[w]; bits; bits &= bits - 1)
+        {
+            size_t b = w * 64 + size_t(__builtin_ctzll(bits));
+            if (!decode(t.rows[base + b], values[b]))
+                mask[w] &= ~(uint64_t(1) << (b & 63));
+        }
+}
+
+/**
+ * @brief 同 decodeSegment()，但解码成功的值按行的顺序紧凑地追加到 out（聚合只需要值，不需要行号）
+ */
+template <class T, class Decode>
+inline void gatherSegment(const Table &t, size_t base, const uint64_t *mask, std::vector<T> &out, Decode &&decode)
+{
+    T v;
+    forEachSetBit(mask, ColumnBitmap::kWords, base, [&](size_t i)
+                  {
+                      if (decode(t.rows[i], v))
+                          out.push_back(v); });
+}
+
+/**
+ * @brief 按区间筛选一段已解码的值：mask 中只保留 lowOp(v, low) 且 highOp(v, high) 的行
+ * @param values RowStore::kSegmentRows 个元素，与 mask 的位一一对应
+ */
+template <class T, class LowOp, class HighOp>
+inline void selectBetween(const T *values, const T &low, const T &high, uint64_t *mask, LowOp lowOp, HighOp highOp)
+{
+    for (size_t w = 0; w < ColumnBitmap::kWords; w++)
+    {
+        const T *v = values + w * 64;
+        uint64_t bits = 0;
+        for (size_t b = 0; b < 64; b++)
+            bits |= uint64_t(lowOp(v[b], low) & highOp(v[b], high)) << b;
+        mask[w] &= bits;
+    }
+}
+
+/**
+ * @brief 逐行筛选一段：mask 中只保留 pred(行) 为真的行（比较方式已由调用方选定，循环内不再分派）
+ */
+template <class Pred>
+inline void selectRows(const Table &t, size_t base, uint64_t *mask, Pred &&pred)
+{
+    for (size_t w = 0; w < ColumnBitmap::kWords; w++)
+        for (uint64_t bits = mask[w]; bits; bits &= bits - 1)
+        {
+            size_t b = size_t(__builtin_ctzll(bits));
+            if (!pred(t.rows[base + w * 64 + b]))
+                mask[w] &= ~(uint64_t(1) << b);
+        }
+}
+
+/**
+ * @brief 按顺序累加 n 个值（与逐个相加的结果相同）
+ */
+template <class T>
+inline T sumValues(const T *values, size_t n, T sum)
+{
+    for (size_t i = 0; i < n; i++)
+        sum += values[i];
+    return sum;
+}
+
+/**
+ * @brief 按 better 求 n 个值中的最值（MIN 为 std::less，MAX 为 std::greater），与之前的结果 best 合并
+ * @param found 输入时 best 是否已有值；n 不为 0 时输出 true
+ */
+template <class T, class Better>
+inline void foldExtreme(const T *values, size_t n, T &best, bool &found, Better better)
+{
+    size_t i = 0;
+    if (!found && n > 0)
+    {
+        best = values[i++];
+        found = true;
+    }
+    for (; i < n; i++)
+        best = better(values[i], best) ? values[i] : best;
+}
@@ -0,0 +1,159 @@
+#pragma once
+#include "db.h"
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * minidb-server：通过 TCP 或 Unix 套接字对外提供 SQL 服务
+ *
+ * 协议：请求与响应都是一帧 = 4 字节大端长度 + 内容。
+ * - 请求内容是一条 SQL 命令（与控制台输入的一行相同）
+ * - 响应内容是该命令的输出文本（与控制台看到的相同）
+ * 同一连接上可以不等响应连续发送多条请求（流水线），响应按请求顺序返回。
+ * 客户端发送完请求后可以只关闭写方向（shutdown(SHUT_WR)）：已收到的请求照常执行，响应全部发出后才关闭连接。
+ * 事务属于连接：BEGIN 之后同一连接上的语句都在该事务中执行，连接断开时未提交的事务回滚。
+ *
+ * 结构：一个事件循环线程用非阻塞 epoll 负责 accept、读取并切分请求、写回响应；
+ * 语句交给工作线程池执行。同一连接的请求由同一时刻最多一个工作线程按顺序执行，
+ * 不同连接的请求并行执行，并发控制由 sqlDB 自身负责。
+ */
+
+/**
+ * @brief 一个客户端连接
+ */
+struct Connection
+{
+    int fd = -1;
+    std::string inbuf;      ///< 尚未切分成完整请求的字节，只由事件循环访问
+    bool wantWrite = false; ///< 是否已注册 EPOLLOUT，只由事件循环访问
+
+    std::mutex mtx;                   ///< 保护以下成员
+    std::deque<std::string> requests; ///< 待执行的请求
+    std::string outbuf;               ///< 待发送的响应帧
+    bool busy = false;                ///< 已交给工作线程（在队列中或正在执行）
+    bool inputClosed = false;         ///< 对端已关闭写方向：不再读取，执行完剩余请求、发完响应后关闭
+    bool closed = false;              ///< 连接已关闭，剩余请求不再执行
+    std::shared_ptr<Transaction> txn; ///< 连接上进行中的事务，只由持有 busy 的工作线程访问
+};
+
+/**
+ * @brief 为内容加上 4 字节大端长度前缀
+ */
+void appendFrame(std::string &out, const std::string &payload);
+
+/**
+ * @brief epoll 事件循环 + 工作线程池
+ */
+class Server
+{
+public:
+    Server(sqlDB &db, size_t workers) : db(db), workerCount(workers ? workers : 1) {}
+    ~Server();
+    Server(const Server &) = delete;
+    Server &operator=(const Server &) = delete;
+
+    /**
+     * @brief 监听 TCP 地址
+     * @return 失败时输出原因并返回 false
+     */
+    bool listenTcp(const std::string &host, int port);
+
+    /**
+     * @brief 监听 Unix 套接字（已存在的同名文件会被替换）
+     */
+    bool listenUnix(const std::string &path);
+
+    /**
+     * @brief 运行事件循环直到 stop()，返回前回滚所有连接上未提交的事务
+     */
+    void run();
+
+    /**
+     * @brief 请求事件循环退出（可在信号处理函数中、或其他线程中调用）
+     */
+    void stop();
+
+private:
+    bool fail(const char *what);
+
+    void watch(int fd, uint32_t events, int op);
+
+    /**
+     * @brief 连接当前应关注的事件：对端关闭写方向后不再关注可读，有待发送的响应时关注可写（调用方持有 c->mtx）
+     */
+    static uint32_t interest(const Connection &c);
+
+    void acceptAll(int lfd);
+
+    /**
+     * @brief 读取全部可读数据，切分出完整的请求帧交给工作线程
+     */
+    void onReadable(const std::shared_ptr<Connection> &c);
+
+    /**
+     * @brief 对端关闭了写方向：停止读取，剩余请求执行完、响应发完后由 writeOut() 关闭连接
+     */
+    void stopReading(const std::shared_ptr<Connection> &c);
+
+    /**
+     * @brief 发送 outbuf，写不完时注册 EPOLLOUT 等待下次可写；对端已关闭写方向且没有剩余工作时关闭连接
+     */
+    void writeOut(const std::shared_ptr<Connection> &c);
+
+    /**
+     * @brief 发送工作线程刚产生的响应
+     */
+    void flushPending();
+
+    /**
+     * @brief 通知事件循环该连接有新的响应或状态变化
+     */
+    void notifyLoop(const std::shared_ptr<Connection> &c);
+
+    /**
+     * @brief 关闭连接；若有未提交的事务且没有工作线程在处理该连接，交给工作线程回滚
+     */
+    void closeConn(const std::shared_ptr<Connection> &c);
+
+    void schedule(const std::shared_ptr<Connection> &c);
+
+    void workerLoop();
+
+    /**
+     * @brief 在工作线程中按顺序执行一个连接的请求
+     *
+     * 执行前把连接的事务绑定到本线程，执行后取下交还连接；
+     * 连续执行 kBatch 个请求后若还有剩余，把连接放回队尾，避免一个流水线很深的连接独占线程。
+     */
+    void serve(const std::shared_ptr<Connection> &c);
+
+    /**
+     * @brief 停止工作线程，关闭所有连接并回滚其未提交的事务
+     */
+    void shutdown();
+
+    sqlDB &db;
+    size_t workerCount;
+    int epfd = -1;
+    std::atomic<int> wakeFd{-1};       ///< eventfd：工作线程有响应要发送、或收到停止信号时唤醒事件循环
+    std::atomic<bool> stopping{false}; ///< 无锁，可在信号处理函数中设置
+    std::vector<int> listeners;
+    std::string unixPath;
+    std::unordered_map<int, std::shared_ptr<Connection>> conns; ///< 只由事件循环访问
+
+    std::mutex pendingMutex;
+    std::vector<std::shared_ptr<Connection>> pendingWrites; ///< 有新响应待发送的连接
+
+    std::mutex queueMutex;
+    std::condition_variable queueCv;
+    std::deque<std::shared_ptr<Connection>> runQueue; ///< 有请求待执行的连接
+    bool workersStop = false;
+    std::vector<std::thread> workers;
+};
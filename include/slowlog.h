@@ -0,0 +1,105 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <fstream>
+#include <string>
+#include <cstdint>
+
+/**
+ * @brief 一条慢查询记录
+ */
+struct SlowQueryRecord
+{
+    const char *kind = "";          ///< 语句类型
+    std::string statement;          ///< SQL 原文；直接调用 C++ 接口时为空
+    const char *accessPath = "-";   ///< 选择的访问路径，不扫描表的语句为 "-"
+    uint64_t totalNanos = 0;        ///< 总耗时
+    uint64_t filterNanos = 0;       ///< 扫描并按 WHERE 过滤的耗时
+    uint64_t sortNanos = 0;         ///< ORDER BY 排序（含外部排序的归并）的耗时
+    uint64_t persistNanos = 0;      ///< 等待日志落盘、写文件的耗时
+    uint64_t rowsScanned = 0;       ///< 扫描的行版本数
+    uint64_t rowsReturned = 0;      ///< 返回的行数
+};
+
+/**
+ * @brief 慢查询日志：总耗时达到阈值的语句追加到文件，每条一行
+ *
+ * 文件超过上限时轮转：<path> 改名为 <path>.1，原来的 <path>.1 改名为 <path>.2，依此类推，
+ * 只保留 keepFiles 个旧文件，因此占用的磁盘空间有上限。
+ * 未启用或未达到阈值时，判断只是一次 relaxed 原子读取；写文件在互斥锁下进行。
+ */
+class SlowQueryLog
+{
+public:
+    SlowQueryLog() = default;
+    SlowQueryLog(const SlowQueryLog &) = delete;
+    SlowQueryLog &operator=(const SlowQueryLog &) = delete;
+
+    /**
+     * @brief 启用慢查询日志
+     * @param path 日志文件路径（追加写入）
+     * @param thresholdNanos 记录总耗时不小于该值的语句
+     * @param maxBytes 单个文件的上限，超过后轮转
+     * @param keepFiles 保留的旧文件个数
+     * @return 文件无法打开时返回 false，日志保持关闭
+     */
+    bool open(const std::string &path, uint64_t thresholdNanos, uint64_t maxBytes, int keepFiles);
+
+    /**
+     * @brief 关闭慢查询日志
+     */
+    void close();
+
+    /**
+     * @brief 耗时 totalNanos 的语句是否应当记录（未启用时总是 false）
+     */
+    bool shouldLog(uint64_t totalNanos) const { return totalNanos >= threshold.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 追加一条记录，必要时先轮转
+     */
+    void write(const SlowQueryRecord &r);
+
+private:
+    /**
+     * @brief 把当前文件改名为 <path>.1 并依次后移旧文件，然后重新打开空文件（调用方持有 mtx）
+     */
+    void rotate();
+
+    std::atomic<uint64_t> threshold{UINT64_MAX}; ///< 记录阈值（纳秒），UINT64_MAX 表示未启用
+    std::mutex mtx;                               ///< 保护以下成员
+    std::ofstream out;                            ///< 当前日志文件
+    std::string path;                             ///< 日志文件路径
+    uint64_t size = 0;                            ///< 当前文件的字节数
+    uint64_t maxBytes = 0;                        ///< 单个文件的上限
+    int keepFiles = 0;                            ///< 保留的旧文件个数
+};
+
+/**
+ * @brief 在作用域内登记当前线程正在执行的 SQL 原文
+ *
+ * executeSQL() 解析命令前设置，慢查询记录据此写出语句原文；只保存指针，不复制字符串。
+ */
+class StatementText
+{
+public:
+    explicit StatementText(const std::string &text) : prev(current())
+    {
+        current() = &text;
+    }
+    ~StatementText() { current() = prev; }
+    StatementText(const StatementText &) = delete;
+    StatementText &operator=(const StatementText &) = delete;
+
+    /**
+     * @brief 当前线程正在执行的 SQL 原文，没有时为 nullptr
+     */
+    static const std::string *&current()
+    {
+        thread_local const std::string *text = nullptr;
+        return text;
+    }
+
+private:
+    const std::string *prev;
+};
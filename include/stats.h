@@ -0,0 +1,207 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include "table.h"
+
+/**
+ * @brief HyperLogLog 基数估计器
+ *
+ * 使用 2^precision 个 6 bit 寄存器（这里按字节存放）估计不同值的个数，
+ * 标准误差约为 1.04 / sqrt(2^precision)。precision = 12 时约 1.6%，占用 4KB。
+ * 两个精度相同的 sketch 可以通过 merge() 合并，结果等价于对两者输入的并集估计。
+ */
+class HyperLogLog
+{
+public:
+    explicit HyperLogLog(uint8_t precision = 12);
+
+    /**
+     * @brief 加入一个值
+     * @param value 原始字符串值（内部会做 64 位哈希）
+     */
+    void add(std::string_view value);
+
+    /**
+     * @brief 加入一个已经计算好的 64 位哈希值
+     */
+    void addHash(uint64_t hash);
+
+    /**
+     * @brief 与另一个同精度的 sketch 合并（逐寄存器取最大值）
+     */
+    void merge(const HyperLogLog &other);
+
+    /**
+     * @brief 估计不同值的个数（含小基数 linear counting 修正）
+     */
+    double estimate() const;
+
+    uint8_t precision() const { return p; }
+    const std::vector<uint8_t> &registers() const { return regs; }
+
+private:
+    uint8_t p;
+    std::vector<uint8_t> regs;
+};
+
+/**
+ * @brief 对字符串做 64 位哈希（std::hash 之后再经过 splitmix64 混洗）
+ */
+uint64_t hashValue(std::string_view value);
+
+/**
+ * @brief 按块缓存的列 HyperLogLog sketch，供 APPROX_COUNT_DISTINCT 合并
+ *
+ * 一块为 kChunkRows 个连续的行版本。行版本写入后不再改变，已写满且全部行对快照可见的块，
+ * 其 sketch 与快照无关，可以缓存并在之后的查询中直接合并；其余的块每次逐行计算。
+ * 行号或列布局改变（Table::rowsEpoch 变化）后整体作废。
+ */
+class SketchCache
+{
+public:
+    static constexpr size_t kChunkSegments = 64;                                  ///< 每块的段数
+    static constexpr size_t kChunkRows = kChunkSegments * RowStore::kSegmentRows; ///< 每块的行版本数
+
+    /**
+     * @brief 第 col 列第 chunk 块的 sketch；没有缓存（或 epoch 不同）时调用 build() 生成并缓存
+     */
+    template <class Build>
+    std::shared_ptr<const HyperLogLog> get(size_t col, size_t chunk, uint64_t epoch, Build build)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (epoch != cachedEpoch)
+            {
+                sketches.clear();
+                cachedEpoch = epoch;
+            }
+            auto it = sketches.find({col, chunk});
+            if (it != sketches.end())
+                return it->second;
+        }
+        // 在锁外生成，并发的查询可能重复生成同一块，结果相同
+        auto sketch = std::make_shared<const HyperLogLog>(build());
+        std::lock_guard<std::mutex> lock(mtx);
+        if (epoch == cachedEpoch)
+            sketches[{col, chunk}] = sketch;
+        return sketch;
+    }
+
+private:
+    std::mutex mtx;                                                                   ///< 保护以下成员
+    uint64_t cachedEpoch = 0;                                                         ///< sketches 对应的 Table::rowsEpoch
+    std::map<std::pair<size_t, size_t>, std::shared_ptr<const HyperLogLog>> sketches; ///< (列, 块) -> sketch
+};
+
+/**
+ * @brief 第 col 列中对 snap 可见、不为 NULL 的值的 HyperLogLog sketch
+ * @param cache 非空时写满且全部可见的块使用（并填充）按块缓存的 sketch
+ * @param rowsRead 输出逐行读取的行数（不含直接合并的块）
+ */
+HyperLogLog sketchColumn(const Table &t, size_t col, const Snapshot &snap, SketchCache *cache, size_t &rowsRead);
+
+/**
+ * @brief 单列统计信息
+ */
+struct ColumnStats
+{
+    std::string name;                ///< 列名
+    DataType type = DataType::TEXT;  ///< 列类型（决定 min/max 与直方图按数值还是字典序比较）
+    uint64_t nullCount = 0;          ///< "NULL" 或空值的个数
+    double distinct = 0;             ///< 不同值个数估计（HyperLogLog）
+    std::string minVal;              ///< 最小值（无非空值时为空）
+    std::string maxVal;              ///< 最大值
+    std::vector<std::string> bounds; ///< 等深直方图各桶的上界，每桶行数近似相同
+
+    /**
+     * @brief 估计 `col = value` 的选择率（0 ~ 1）
+     * @param rowCount 表的总行数
+     *
+     * 若 value 同时是多个桶的上界，说明它是高频值，按所占桶数估计；
+     * 否则按 (非空行比例 / 不同值个数) 的均匀假设估计。
+     */
+    double equalSelectivity(const std::string &value, uint64_t rowCount) const;
+
+    /**
+     * @brief 估计 `col < value` 的选择率（0 ~ 1），基于直方图桶插值
+     */
+    double lessThanSelectivity(const std::string &value, uint64_t rowCount) const;
+};
+
+/**
+ * @brief 整张表的统计信息，由 ANALYZE 生成并保存在 <表名>.stats 中
+ */
+struct TableStats
+{
+    uint64_t rowCount = 0;             ///< 行数
+    std::vector<ColumnStats> columns;  ///< 每列统计
+
+    /**
+     * @brief 按列名（大小写不敏感）查找列统计
+     * @return 未找到返回 nullptr
+     */
+    const ColumnStats *find(const std::string &colName) const;
+
+    /**
+     * @brief 将统计信息写入 <表名>.stats
+     */
+    void saveToFile(const std::string &name) const;
+
+    /**
+     * @brief 从 <表名>.stats 读取统计信息
+     * @return 文件不存在或格式错误时返回 false
+     */
+    bool loadFromFile(const std::string &name);
+};
+
+/**
+ * @brief 扫描整张表计算统计信息
+ * @param t 目标表
+ * @param snap 读快照，只统计对它可见的行
+ * @param buckets 等深直方图的桶数
+ */
+TableStats analyzeTable(const Table &t, const Snapshot &snap = Snapshot::latest(), size_t buckets = 32);
+
+/**
+ * @brief 访问路径
+ */
+enum class AccessPath
+{
+    FULL_SCAN,    // 顺序扫描全部行
+    INDEX_LOOKUP, // 通过索引直接定位满足条件的行
+    SAMPLE_SCAN,  // 按比例抽样读取部分行（TABLESAMPLE）
+    VIEW_READ,    // 读取物化视图的分组，不扫描基表
+    RESULT_CACHE  // 返回结果缓存中的结果，不读取表
+};
+
+/**
+ * @brief 访问路径的名称（慢查询日志中使用）
+ */
+const char *accessPathName(AccessPath path);
+
+/**
+ * @brief 代价模型给出的扫描计划
+ */
+struct ScanPlan
+{
+    AccessPath path = AccessPath::FULL_SCAN; ///< 选择的访问路径
+    double estimatedRows = 0;                ///< 估计满足条件的行数
+    double cost = 0;                         ///< 估计代价（以顺序读取一行为 1）
+};
+
+/**
+ * @brief 根据统计信息为 `WHERE whereCol = whereVal` 选择访问路径
+ * @param stats 表统计信息（rowCount 为 0 时视为没有统计，按 tableRows 估计）
+ * @param tableRows 表当前实际行数
+ * @param whereCol 条件列（为空表示无条件）
+ * @param whereVal 条件值
+ * @param hasIndex whereCol 上是否有可用的索引
+ * @param unique 索引是否为唯一索引（PRIMARY KEY / UNIQUE），此时估计结果至多一行
+ */
+ScanPlan chooseAccessPath(const TableStats &stats, size_t tableRows, const std::string &whereCol,
+                          const std::string &whereVal, bool hasIndex, bool unique = false);
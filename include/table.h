@@ -11,23 +11,418 @@
 #include <sys/types.h>
 #include <cerrno>
 #include <cstring>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <optional>
+#include <unordered_map>
 #include "types.h"
+#include "mvcc.h"
+#include "arena.h"
+#include "like.h"
+
+/**
+ * @brief 列约束
+ */
+enum class ColumnConstraint : uint8_t
+{
+    NONE,       // 无约束
+    UNIQUE,     // 值不重复（NULL 除外，可以有多个 NULL）
+    PRIMARY_KEY // 值不重复且不为 NULL，每张表至多一个
+};
 
 /**
  * @brief 表示一个列(Column)，包含列名和数据类型
  */
 struct Column
 {
-    std::string name; ///< 列名
-    DataType type;    ///< 列的数据类型
+    std::string name;                                     ///< 列名
+    DataType type;                                        ///< 列的数据类型
+    std::string defaultValue = "NULL";                    ///< 默认值：插入时未指定该列、或该列加入前写入的旧行读到的值
+    ColumnConstraint constraint = ColumnConstraint::NONE; ///< 列约束，由该列上的唯一索引（KeyIndex）保证
+    uint8_t textIndex = 0;                                ///< LIKE 索引的种类（TextIndex::kSorted / kTrigram），0 表示没有
 };
 
 /**
  * @brief 表示一行(Row)，存储为字符串向量
+ *
+ * 用于构造新行、生成重做记录等需要独立持有数据的场合；写入 RowStore 后以 PackedRow 存放。
  */
 struct Row
 {
     std::vector<std::string> values; ///< 一行中的各个单元格值
+    uint32_t version = 0;            ///< 写入该行时表的 schema 版本
+};
+
+/**
+ * @brief RowStore 中存放的行：单元格句柄数组及其长值都在所在段的 arena 中
+ *
+ * values 按写入该行时的 schema 版本排列，需通过 Table::cell() 按当前列读取。
+ */
+struct PackedRow
+{
+    CellSpan values;      ///< 一行中的各个单元格
+    uint32_t version = 0; ///< 写入该行时表的 schema 版本
+};
+
+/**
+ * @brief 从 RowStore 读出的一行
+ *
+ * 行所在的段可以被换出时，pin 保持段的内容在 RowRef 存活期间有效，
+ * 因此由 values 得到的视图不能比 RowRef 活得更久；常驻段的 pin 为空。
+ */
+struct RowRef
+{
+    CellSpan values;                 ///< 一行中的各个单元格
+    uint32_t version = 0;            ///< 写入该行时表的 schema 版本
+    std::shared_ptr<const void> pin; ///< 可换出段的内容
+};
+
+/**
+ * @brief 表文件的分段索引（<表名>.idx），按需分页打开时据此定位各段而不必读取整个文件
+ */
+struct TableFileIndex
+{
+    uint64_t fileSize = 0;        ///< 对应的表文件大小，与实际不符时索引作废
+    uint64_t checkpointTs = 0;    ///< 对应的表文件表头中的检查点
+    size_t rowCount = 0;          ///< 文件中的行数
+    std::vector<uint64_t> chunks; ///< 每 RowStore::kSegmentRows 行一段，各段第一行在文件中的偏移
+    bool columnar = false;        ///< 数据部分为列式压缩块（每段一块），否则为逐行文本；由表头决定，不写入索引
+};
+
+class PageCache;
+
+/**
+ * @brief 一段中某个物理列位置的位图，段内每行一位
+ *
+ * 写者追加行时在发布行数之前置位，读者只读取已发布的行对应的位，因此用 relaxed 原子访问即可。
+ */
+struct ColumnBitmap
+{
+    static constexpr size_t kWords = 16; ///< 每段的字数（RowStore::kSegmentRows / 64）
+
+    std::atomic<uint64_t> valid[kWords]; ///< 值不为 NULL
+    std::atomic<uint64_t> truth[kWords]; ///< 值为 "true"（只在 BOOL 列置位）
+};
+
+/**
+ * @brief 从 RowStore 读出的一段的列位图
+ */
+struct SegmentBitmap
+{
+    const ColumnBitmap *bits = nullptr; ///< 为空表示段内的行都取该列的默认值
+    std::shared_ptr<const void> pin;    ///< 可换出段的内容
+};
+
+/**
+ * @brief 对 words 中每个置位的位按从低到高的顺序调用 fn(base + 位序号)
+ */
+template <class Fn>
+inline void forEachSetBit(const uint64_t *words, size_t count, size_t base, Fn fn)
+{
+    for (size_t w = 0; w < count; w++)
+        for (uint64_t bits = words[w]; bits; bits &= bits - 1)
+            fn(base + w * 64 + size_t(__builtin_ctzll(bits)));
+}
+
+/**
+ * @brief 只追加的分段行存储，每个行版本带 MVCC 的 [begin, end) 时间戳
+ *
+ * 行按 kSegmentRows 一段分配，段一旦分配就不再移动；段目录扩容时旧目录保留到 clear()。
+ * 每段带一个 StringArena，段内各行的单元格数组与长字符串都从中分配，随段一起释放。
+ * 因此在单个写者追加的同时，并发读者访问下标小于已发布 size() 的行始终安全。
+ * 行内容发布后不再修改，修改只通过追加新版本和设置旧版本的 end 完成。
+ *
+ * 按需分页打开（openFile）时，表文件中的完整段只登记其在文件中的位置，
+ * 第一次读取时才载入并登记到 PageCache，之后可能被换出、再次读取时重新载入。
+ * 行内容不可变，换出无需写回；时间戳与内容分开存放且始终在内存中，
+ * 表文件中未被修改过的段不分配时间戳数组。文件末尾不满一段的行与之后追加的行常驻内存。
+ *
+ * 每段还按物理列位置维护 ColumnBitmap（有效位与 BOOL 真值位），聚合与过滤可以按 64 行一个字
+ * 做与运算和 popcount，不必逐行读取单元格；段内各行的 schema 版本不一致时位图不可用。
+ */
+class RowStore
+{
+public:
+    static constexpr size_t kSegmentBits = 10;
+    static constexpr size_t kSegmentRows = size_t(1) << kSegmentBits;
+    static constexpr size_t kBitmapColumns = 64; ///< 维护位图的物理列位置数，之后的列逐行读取
+    static_assert(ColumnBitmap::kWords * 64 == kSegmentRows, "one bitmap word per 64 rows");
+
+    RowStore() = default;
+    ~RowStore();
+    RowStore(const RowStore &) = delete;
+    RowStore &operator=(const RowStore &) = delete;
+
+    /**
+     * @brief 已发布的行版本个数
+     */
+    size_t size() const { return count.load(std::memory_order_acquire); }
+    bool empty() const { return size() == 0; }
+
+    /**
+     * @brief 读取第 i 个行版本，所在段已换出时从表文件重新载入
+     */
+    RowRef operator[](size_t i) const
+    {
+        Segment &seg = segment(i);
+        RowRef r;
+        const Payload *p = seg.resident;
+        if (!p)
+        {
+            std::shared_ptr<const Payload> loaded = load(i >> kSegmentBits);
+            p = loaded.get();
+            r.pin = std::move(loaded);
+        }
+        const PackedRow &row = p->rows[i & (kSegmentRows - 1)];
+        r.values = row.values;
+        r.version = row.version;
+        return r;
+    }
+    uint64_t beginTs(size_t i) const
+    {
+        const Slot *m = segment(i).meta.load(std::memory_order_acquire);
+        return m ? m[i & (kSegmentRows - 1)].begin.load(std::memory_order_acquire) : kBootstrapTs;
+    }
+    uint64_t endTs(size_t i) const
+    {
+        const Slot *m = segment(i).meta.load(std::memory_order_acquire);
+        return m ? m[i & (kSegmentRows - 1)].end.load(std::memory_order_acquire) : kInfinityTs;
+    }
+    /**
+     * @brief 第 seg 段中下标小于 n 且对 snap 可见的行，每行一位；段的时间戳数组只取一次
+     * @param out ColumnBitmap::kWords 个字
+     */
+    void visibleBits(size_t seg, size_t n, const Snapshot &snap, uint64_t *out) const;
+
+    void setBegin(size_t i, uint64_t ts) { slots(segment(i))[i & (kSegmentRows - 1)].begin.store(ts, std::memory_order_release); }
+    void setEnd(size_t i, uint64_t ts) { slots(segment(i))[i & (kSegmentRows - 1)].end.store(ts, std::memory_order_release); }
+
+    /**
+     * @brief 追加一个行版本并发布（同一时刻只能有一个写者）
+     * @param cells 指向 n 个可转换为 string_view 的值，复制到所在段的 arena
+     * @param n 单元格个数
+     * @param version 行的 schema 版本
+     * @param columns 各值所在的列，DATE/TIMESTAMP 列的值存为原生单元格；为空时都按文本存放
+     * @return 新版本的下标
+     */
+    template <class It>
+    size_t append(It cells, size_t n, uint32_t version, uint64_t begin, uint64_t end = kInfinityTs,
+                  const std::vector<Column> *columns = nullptr)
+    {
+        size_t i = count.load(std::memory_order_relaxed);
+        Segment &seg = segmentFor(i);
+        seg.resident->place(i & (kSegmentRows - 1), cells, n, version, [columns](size_t c)
+                            { return columns && c < columns->size() ? (*columns)[c].type : DataType::TEXT; });
+        Slot &s = slots(seg)[i & (kSegmentRows - 1)];
+        s.begin.store(begin, std::memory_order_relaxed);
+        s.end.store(end, std::memory_order_relaxed);
+        count.store(i + 1, std::memory_order_release);
+        return i;
+    }
+
+    /**
+     * @brief 读取第 seg 段的列位图，所在段已换出时从表文件重新载入
+     * @param posOf 由段内行的 schema 版本给出列的物理位置，-1 表示取列默认值
+     * @return 段内各行的 schema 版本不一致、或该位置没有位图时返回 false，调用方须逐行读取
+     */
+    template <class PosOf>
+    bool columnBitmap(size_t seg, PosOf posOf, SegmentBitmap &out) const
+    {
+        Segment &s = *dir.load(std::memory_order_acquire)[seg];
+        const Payload *p = s.resident;
+        std::shared_ptr<const Payload> loaded;
+        if (!p)
+        {
+            loaded = load(seg);
+            p = loaded.get();
+        }
+        if (p->mixed.load(std::memory_order_relaxed))
+            return false;
+        int pos = posOf(p->version.load(std::memory_order_relaxed));
+        out.bits = nullptr;
+        out.pin = std::move(loaded);
+        if (pos < 0)
+            return true;
+        if (size_t(pos) >= kBitmapColumns)
+            return false;
+        out.bits = p->bitmaps[pos].load(std::memory_order_relaxed);
+        return out.bits != nullptr;
+    }
+
+    /**
+     * @brief 释放所有行（调用方须保证没有并发读者）
+     */
+    void clear();
+
+    /**
+     * @brief 与 other 交换全部内容（调用方须保证两者都没有并发读者）
+     */
+    void swap(RowStore &other);
+
+    /**
+     * @brief 按需分页打开表文件（调用方须保证行存储为空且没有并发读者）
+     * @param path 表文件
+     * @param index 表文件的分段索引
+     * @param cache 可换出的段登记到该缓存
+     * @param types 表文件中各列的类型，载入段时 DATE/TIMESTAMP 列的值存为原生单元格
+     * @return 文件无法打开时返回 false
+     */
+    bool openFile(const std::string &path, const TableFileIndex &index, PageCache &cache,
+                  std::vector<DataType> types);
+
+    /**
+     * @brief 是否按需分页打开
+     */
+    bool paged() const { return cache != nullptr; }
+
+    /**
+     * @brief 供 PageCache 淘汰时调用：第 seg 段最近被访问过则清除访问标记并返回 false，否则换出
+     */
+    bool tryEvict(size_t seg);
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> begin{kBootstrapTs};
+        std::atomic<uint64_t> end{kInfinityTs};
+    };
+    struct Payload
+    {
+        PackedRow rows[kSegmentRows];
+        StringArena arena;                                     ///< 本段各行的单元格与列位图
+        std::atomic<ColumnBitmap *> bitmaps[kBitmapColumns] = {}; ///< 各物理列位置的位图，第一行写入该位置时分配
+        std::atomic<uint32_t> version{0};                      ///< 第一行的 schema 版本
+        std::atomic<bool> mixed{false};                        ///< 段内各行的 schema 版本是否不一致
+
+        /**
+         * @brief 在第 slot 行写入单元格并更新列位图（仅写者调用，在发布该行之前）
+         */
+        template <class It, class TypeAt>
+        void place(size_t slot, It cells, size_t n, uint32_t rowVersion, TypeAt typeAt)
+        {
+            PackedRow &row = rows[slot];
+            row.values = CellSpan::build(cells, n, arena, typeAt);
+            row.version = rowVersion;
+            if (slot == 0)
+                version.store(rowVersion, std::memory_order_relaxed);
+            else if (rowVersion != version.load(std::memory_order_relaxed))
+                mixed.store(true, std::memory_order_relaxed);
+            size_t word = slot / 64;
+            uint64_t bit = uint64_t(1) << (slot % 64);
+            for (size_t c = 0; c < std::min(n, kBitmapColumns); c++)
+            {
+                ColumnBitmap *b = bitmaps[c].load(std::memory_order_relaxed);
+                if (!b)
+                {
+                    b = new (arena.allocate(sizeof(ColumnBitmap), alignof(ColumnBitmap))) ColumnBitmap();
+                    bitmaps[c].store(b, std::memory_order_relaxed);
+                }
+                const Cell &cell = row.values.data[c];
+                if (!cell.isNull())
+                    b->valid[word].store(b->valid[word].load(std::memory_order_relaxed) | bit, std::memory_order_relaxed);
+                if (typeAt(c) == DataType::BOOL && cell.view() == "true")
+                    b->truth[word].store(b->truth[word].load(std::memory_order_relaxed) | bit, std::memory_order_relaxed);
+            }
+        }
+    };
+    struct Segment
+    {
+        std::atomic<Slot *> meta{nullptr};      ///< 各行的时间戳，为空表示都是表文件中未修改过的行
+        std::unique_ptr<Slot[]> metaOwner;
+        Payload *resident = nullptr;            ///< 常驻段的内容，创建后不变；为空表示可换出
+        std::unique_ptr<Payload> residentOwner;
+        std::shared_ptr<Payload> paged;         ///< 可换出段的内容，只通过 atomic_load/atomic_store 访问，为空表示未载入
+        std::atomic<bool> referenced{false};    ///< CLOCK 访问标记
+        uint64_t fileBegin = 0;                 ///< 可换出段在表文件中的起始偏移
+        uint64_t fileEnd = 0;                   ///< 可换出段在表文件中的结束偏移
+        uint32_t fileRows = 0;                  ///< 段中来自表文件的行数
+    };
+
+    /**
+     * @brief 返回第 i 行所在的段，必要时分配新的常驻段并扩容段目录（仅写者调用）
+     */
+    Segment &segmentFor(size_t i);
+
+    /**
+     * @brief 在段目录末尾加入一个空段（仅写者调用）
+     */
+    Segment &addSegment();
+
+    Segment &segment(size_t i) const
+    {
+        return *dir.load(std::memory_order_acquire)[i >> kSegmentBits];
+    }
+
+    /**
+     * @brief 返回段的时间戳数组，第一次修改表文件中的段时才分配（仅写者调用）
+     */
+    Slot *slots(Segment &seg)
+    {
+        Slot *m = seg.meta.load(std::memory_order_relaxed);
+        return m ? m : allocateSlots(seg);
+    }
+    Slot *allocateSlots(Segment &seg);
+
+    /**
+     * @brief 取得可换出段第 idx 段的内容，未载入时从表文件读取
+     */
+    std::shared_ptr<const Payload> load(size_t idx) const;
+
+    /**
+     * @brief 从表文件解析 seg 的各行
+     */
+    void readSegment(const Segment &seg, Payload &out) const;
+
+    std::atomic<Segment **> dir{nullptr};              ///< 当前段目录
+    std::vector<std::unique_ptr<Segment *[]>> dirs;    ///< 所有分配过的段目录，最后一个为当前目录
+    std::vector<std::unique_ptr<Segment>> segments;    ///< 已分配的段
+    size_t dirCapacity = 0;                            ///< 当前段目录的容量（仅写者访问）
+    std::atomic<size_t> count{0};                      ///< 已发布的行数
+    PageCache *cache = nullptr;                        ///< 按需分页打开时可换出的段登记到的缓存
+    mutable std::mutex fileMutex;                      ///< 串行化从表文件载入段
+    mutable std::ifstream file;                        ///< 按需分页打开的表文件（被检查点替换后仍读取原文件）
+    std::vector<DataType> fileTypes;                   ///< 表文件中各列的类型
+    bool fileColumnar = false;                         ///< 表文件的各段是否为列式压缩块
+};
+
+/**
+ * @brief PRIMARY KEY / UNIQUE 列上的哈希索引：规范化的值 -> 含有该值的行版本下标
+ *
+ * 收录表中所有的行版本（包括已结束的和未提交的），是否可见、是否构成冲突由调用方按版本的时间戳判断；
+ * 值为 NULL 的版本不收录。行号改变（compact、remap）或加载表之后整体重建。
+ * 写者追加版本时加入，读者同时探测，由内部的读写锁保护。
+ */
+class KeyIndex
+{
+public:
+    void add(std::string key, size_t row)
+    {
+        std::unique_lock<std::shared_mutex> lock(mtx);
+        rows.emplace(std::move(key), row);
+    }
+
+    /**
+     * @brief 值为 key 的行版本，按下标升序
+     */
+    std::vector<size_t> find(const std::string &key) const
+    {
+        std::vector<size_t> out;
+        {
+            std::shared_lock<std::shared_mutex> lock(mtx);
+            auto range = rows.equal_range(key);
+            for (auto it = range.first; it != range.second; ++it)
+                out.push_back(it->second);
+        }
+        std::sort(out.begin(), out.end());
+        return out;
+    }
+
+private:
+    mutable std::shared_mutex mtx;                      ///< 写者加入与读者探测互斥
+    std::unordered_multimap<std::string, size_t> rows; ///< 规范化的值 -> 行版本下标
 };
 
 /**
@@ -35,13 +430,282 @@ struct Row
  *
  * Table 用于表示一个简单的表格数据结构：
  * - 包含列(Column)定义（列名、数据类型）
- * - 包含行(Row)数据（存储为字符串向量）
+ * - 包含行数据（单元格存放在按段分配的 arena 中，短值内联）
  * - 提供列索引查询、文件保存与加载功能
+ *
+ * 行采用多版本存储：插入追加新版本，删除只设置版本的 end 时间戳，
+ * 更新等于“结束旧版本 + 追加新版本”。读者按快照判断版本是否可见，
+ * 因此长时间的扫描与写操作可以同时进行；compact() 回收不再被任何快照看到的版本。
+ * 行号（版本下标）在两次 compact() 之间保持稳定。
+ *
+ * ALTER TABLE 只修改元数据：每次增删列 schemaVersion 加一，
+ * 旧版本的行保持原样，通过 layouts 映射到当前列；compact() 时才统一重写为当前版本。
+ *
+ * 按需分页的表（openPaged）可以远大于内存。它们不做 compact()，
+ * 检查点写出新表文件后由 remap() 重新分页打开，同样回收旧版本并统一 schema 版本。
+ *
+ * 带 PRIMARY KEY / UNIQUE 约束的列各有一个 KeyIndex：appendRow() 时加入新版本，
+ * 加载、compact()、remap() 之后重建（按需分页的表重建时会读一遍整个表文件）。
+ * 唯一性与 WHERE 的等值比较一致，按去掉首尾空白、不区分大小写的值判断，
+ * DATE/TIMESTAMP 按原生整数，BOOL 按真假。
+ *
+ * CREATE INDEX 建立的列各有一个 TextIndex，维护方式与 KeyIndex 相同，供 LIKE 条件查找候选行。
  */
 struct Table
 {
-    std::vector<Column> columns; ///< 表的列集合
-    std::vector<Row> rows;       ///< 表的行集合
+    std::vector<Column> columns;       ///< 表的列集合
+    RowStore rows;                     ///< 所有行版本（含已结束的版本）
+    std::atomic<size_t> deadCount{0};  ///< 已结束（删除或被覆盖）但尚未回收的版本数
+    uint32_t schemaVersion = 0;        ///< 当前 schema 版本，新写入的行使用该版本
+    /// layouts[v][i] 为版本 v 的行中当前第 i 列的物理位置，-1 表示取列默认值；当前版本为恒等映射不存储
+    std::vector<std::vector<int>> layouts;
+    std::atomic<int> openTxns{0};      ///< 在本表上有未提交写入的显式事务数，非 0 时不能压缩（会改变行号）
+    uint64_t checkpointTs = 0;         ///< 加载的表文件已包含的最后一个提交时间戳，之后的提交需从重做日志重放
+    PageCache *pageCache = nullptr;    ///< 非空时按需分页：检查点写出表文件后，行存储改为分页打开新文件
+    uint64_t rowsEpoch = 0;            ///< 行号或列布局改变（加载、压缩、重新分页、增删列）的次数，按行号缓存的结果据此作废
+    /// keys[c] 为第 c 列的唯一索引，没有约束的列为空；没有任何约束列时整个向量为空
+    std::vector<std::unique_ptr<KeyIndex>> keys;
+    /// texts[c] 为第 c 列的 LIKE 索引，没有的列为空；没有任何 LIKE 索引时整个向量为空
+    std::vector<std::unique_ptr<TextIndex>> texts;
+
+    /**
+     * @brief 按当前列顺序读取某行的第 col 列
+     * @return 指向行存储的视图，在 row 被释放、行被压缩或表被释放前有效
+     */
+    std::string_view cell(const RowRef &row, size_t col) const
+    {
+        int pos = row.version == schemaVersion ? int(col) : layouts[row.version][col];
+        if (pos < 0 || size_t(pos) >= row.values.size())
+            return columns[col].defaultValue;
+        return row.values[pos];
+    }
+
+    /**
+     * @brief 同 cell()，但返回单元格句柄（可读取 DATE/TIMESTAMP 的原生值）；取列默认值时返回 nullptr
+     */
+    const Cell *cellAt(const RowRef &row, size_t col) const
+    {
+        int pos = row.version == schemaVersion ? int(col) : layouts[row.version][col];
+        if (pos < 0 || size_t(pos) >= row.values.size())
+            return nullptr;
+        return &row.values.data[pos];
+    }
+
+    /**
+     * @brief 列类型的列取 DATE/TIMESTAMP 原生值：cell 为原生单元格时直接读取，否则（列默认值等）解析文本
+     * @return 值为 NULL 或无法解析时返回 false
+     */
+    bool temporalValue(const RowRef &row, size_t col, int64_t &value) const
+    {
+        const Cell *c = cellAt(row, col);
+        if (c && c->native())
+        {
+            value = c->nativeValue();
+            return true;
+        }
+        return parseTemporal(columns[col].type, c ? c->view() : std::string_view(columns[col].defaultValue), value);
+    }
+
+    /**
+     * @brief 某行的第 col 列是否为 NULL
+     */
+    bool isNull(const RowRef &row, size_t col) const
+    {
+        const Cell *c = cellAt(row, col);
+        return c ? c->isNull() : columns[col].defaultValue == "NULL";
+    }
+
+    /**
+     * @brief 第 seg 段中第 col 列的位图
+     * @return 段内各行的 schema 版本不一致或没有位图时返回 false（调用方逐行读取）；
+     *         段内的行都取列默认值时返回 true，out.bits 为空
+     */
+    bool columnBitmap(size_t seg, size_t col, SegmentBitmap &out) const
+    {
+        return rows.columnBitmap(seg, [&](uint32_t v)
+                                 { return v == schemaVersion ? int(col) : layouts[v][col]; }, out);
+    }
+
+    /**
+     * @brief 第 seg 段中下标小于 n 且对 snap 可见的行，每行一位
+     * @param out ColumnBitmap::kWords 个字
+     */
+    void visibleBits(size_t seg, size_t n, const Snapshot &snap, uint64_t *out) const;
+
+    /**
+     * @brief 把 mask 中第 col 列为 NULL 的行清零：有位图时按字做与运算，否则逐行读取
+     */
+    void clearNulls(size_t seg, size_t col, uint64_t *mask) const;
+
+    /**
+     * @brief 按段扫描前 n 个行版本，以 (段内第一行的下标, mask) 调用 fn，
+     *        mask 为段内对 snap 可见且第 col 列不为 NULL 的行
+     */
+    template <class Fn>
+    void scanNonNull(size_t col, size_t n, const Snapshot &snap, Fn fn) const
+    {
+        uint64_t mask[ColumnBitmap::kWords];
+        for (size_t base = 0; base < n; base += RowStore::kSegmentRows)
+        {
+            size_t seg = base >> RowStore::kSegmentBits;
+            visibleBits(seg, n, snap, mask);
+            clearNulls(seg, col, mask);
+            fn(base, static_cast<const uint64_t *>(mask));
+        }
+    }
+
+    /**
+     * @brief 按当前 schema 复制一行（用于生成更新后的新版本）
+     */
+    Row materialize(const RowRef &row) const;
+
+    /**
+     * @brief 追加一列（只修改元数据，不触碰已有行）
+     */
+    void addColumn(const Column &col);
+
+    /**
+     * @brief 删除第 idx 列（只修改元数据，不触碰已有行）
+     */
+    void dropColumn(size_t idx);
+
+    /**
+     * @brief 应用一条文本形式的增删列记录（重放 .schema 文件或重做日志时使用）
+     * @param change 形如 "ADD <列名> <类型> [DEFAULT <值>]"、"DROP <列名>"
+     *               或 "INDEX <列名> [SORTED] [TRIGRAM]"（设置 LIKE 索引，都不带时删除）
+     * @return 记录无法识别或列不存在时返回 false
+     */
+    bool applySchemaChange(const std::string &change);
+
+    /**
+     * @brief 追加一个行版本
+     * @param row 行数据（按当前 schema 排列）
+     * @param begin 版本的 begin 时间戳，默认视为已提交
+     * @return 新版本的下标
+     */
+    size_t appendRow(const Row &row, uint64_t begin = kBootstrapTs)
+    {
+        size_t i = rows.append(row.values.begin(), row.values.size(), schemaVersion, begin, kInfinityTs, &columns);
+        if (!keys.empty() || !texts.empty())
+            indexRow(row, i);
+        return i;
+    }
+
+    /**
+     * @brief 第 col 列是否有唯一索引
+     */
+    bool hasKeyIndex(size_t col) const { return col < keys.size() && keys[col]; }
+
+    /**
+     * @brief 按列约束与 Column::textIndex 重建各列的唯一索引与 LIKE 索引
+     *        （设置 columns 之后、行号改变之后调用；调用方须保证没有并发读者）
+     */
+    void buildIndexes();
+
+    /**
+     * @brief 设置第 col 列的 LIKE 索引种类并重建该列的索引，kinds 为 0 时删除（调用方须保证没有并发读者）
+     */
+    void setTextIndex(size_t col, uint8_t kinds);
+
+    /**
+     * @brief 第 col 列的 LIKE 索引能否用于模式 pattern
+     */
+    bool likeIndexed(size_t col, const LikePattern &pattern) const
+    {
+        return col < texts.size() && texts[col] && texts[col]->usable(pattern);
+    }
+
+    /**
+     * @brief 由第 col 列的 LIKE 索引查找可能匹配 pattern 的行版本，按下标升序；调用方再按快照与模式筛选
+     * @return 索引不可用时返回 false
+     */
+    bool likeCandidates(size_t col, const LikePattern &pattern, std::vector<size_t> &out) const
+    {
+        return col < texts.size() && texts[col] && texts[col]->candidates(pattern, out);
+    }
+
+    /**
+     * @brief 第 col 列（须有唯一索引）的值在等值比较下可能等于 value 的行版本，按下标升序；
+     *        只探测一次索引，调用方再按快照与条件筛选
+     */
+    std::vector<size_t> lookupKey(size_t col, std::string_view value) const;
+
+    /**
+     * @brief 写入 value 会违反第 col 列唯一约束的版本：未结束的版本，或被其他未提交的写者结束的版本
+     * @param marker 当前写者的版本标记，被它自己结束的版本不算冲突
+     * @return 版本下标，没有冲突（或 value 为 NULL、该列没有唯一索引）时返回 SIZE_MAX
+     */
+    size_t findConflict(size_t col, std::string_view value, uint64_t marker) const;
+
+    /**
+     * @brief 提交时把写集合中的事务标记替换为提交时间戳
+     */
+    void publish(const WriteSet &ws, uint64_t ts)
+    {
+        for (size_t i : ws.inserted)
+            rows.setBegin(i, ts);
+        for (size_t i : ws.ended)
+            rows.setEnd(i, ts);
+        deadCount += ws.ended.size();
+    }
+
+    /**
+     * @brief 回滚时撤销写集合：恢复被结束的旧版本，新版本永久不可见并计入待回收
+     */
+    void rollback(const WriteSet &ws)
+    {
+        for (size_t i : ws.ended)
+            rows.setEnd(i, kInfinityTs);
+        for (size_t i : ws.inserted)
+        {
+            rows.setBegin(i, kInfinityTs);
+            rows.setEnd(i, kBootstrapTs);
+        }
+        deadCount += ws.inserted.size();
+    }
+
+    /**
+     * @brief 第 i 个行版本对快照 snap 是否可见
+     */
+    bool visible(size_t i, const Snapshot &snap) const
+    {
+        return snap.sees(rows.beginTs(i), rows.endTs(i));
+    }
+
+    /**
+     * @brief 未结束的版本数（代价估计用，可能包含未提交的版本）
+     */
+    size_t liveCount() const
+    {
+        size_t n = rows.size(), dead = deadCount.load(std::memory_order_relaxed);
+        return n > dead ? n - dead : 0;
+    }
+
+    /**
+     * @brief 已结束版本占总版本数的比例
+     */
+    double deadRatio() const { return rows.empty() ? 0 : double(deadCount) / double(rows.size()); }
+
+    /**
+     * @brief 回收 end <= horizon 的版本，并把剩余的行重写为当前 schema 版本
+     * @param horizon 回收上界，默认回收所有已结束的版本
+     * @note 调用方须保证没有并发读者和写者，完成后行号会改变
+     */
+    void compact(uint64_t horizon = kLatestTs);
+
+    /**
+     * @brief 是否需要压缩：已结束版本比例达到 ratio，或积累的 schema 版本过多；
+     *        有显式事务持有本表的写集合时不压缩
+     */
+    bool needsCompaction(double ratio) const;
+
+    /**
+     * @brief 行存储改为按需分页打开刚写出的表文件，丢弃内存中的所有行版本
+     * @param filename 表名
+     * @param index 表文件的分段索引
+     * @note 表文件须包含所有可见的行；调用方须保证没有并发读者、写者和更早的快照，完成后行号会改变
+     */
+    void remap(const std::string &filename, const TableFileIndex &index);
 
     /**
      * @brief 根据列名获取列索引
@@ -52,15 +716,103 @@ struct Table
 
     /**
      * @brief 将表格数据保存到文件
+     *
+     * 对最新快照可见的行按当前 schema 写入 <表名>.table：先写临时文件并 fsync，
+     * 再 rename 覆盖，崩溃时旧文件保持完整。
+     * 表头仍是一行文本，数据部分每 RowStore::kSegmentRows 行一个列式压缩块（见 ChunkEncoder）。
+     * 同时移除旧格式的 <表名>.del 与 <表名>.schema，它们的内容已体现在新文件中。
      * @param filename 文件名
+     * @param checkpointTs 文件包含的最后一个提交时间戳，非 0 时写入表头，恢复时只重放之后的日志
+     */
+    void saveToFile(const std::string &filename, uint64_t checkpointTs = 0) const;
+
+    /**
+     * @brief 生成表文件内容：当前 schema 与 snap 可见的行
+     *
+     * 只读取行版本，调用方持有共享锁即可，与并发的写者互不阻塞。
+     * @param checkpointTs 写入表头的提交时间戳，非 0 时写入
+     * @param snap 读快照，其时间戳之前提交的修改都包含在内容中
+     */
+    std::string serialize(uint64_t checkpointTs, const Snapshot &snap) const;
+
+    /**
+     * @brief 把表文件内容写入 out，同时记录分段索引
+     * @param index 非空时记录每段第一行相对 out 起始位置的偏移与行数
+     */
+    void serialize(std::ostream &out, uint64_t checkpointTs, const Snapshot &snap, TableFileIndex *index = nullptr) const;
+
+    /**
+     * @brief 把表文件内容写入 <表名>.table.tmp 并 fsync，返回临时文件路径
+     *
+     * 与 installFile() 分开，检查点可以在不持有表锁时完成耗时的写盘。
+     */
+    static std::string writeTempFile(const std::string &filename, const std::string &content);
+
+    /**
+     * @brief 不经过内存中的字符串，直接把表文件内容写入 <表名>.table.tmp 并 fsync
+     *
+     * 用于按需分页的表：内容可能远大于内存，写盘期间须共享持有表锁。
+     * @param index 输出写出文件的分段索引
+     * @return 临时文件路径
+     */
+    std::string writeTempFile(const std::string &filename, uint64_t checkpointTs, const Snapshot &snap,
+                              TableFileIndex &index) const;
+
+    /**
+     * @brief 用 writeTempFile() 写好的临时文件 rename 覆盖表文件，并移除旧格式的附属文件
+     * @param index 非空时同时写出新文件的分段索引 <表名>.idx，否则删除过时的索引
      */
-    void saveToFile(const std::string &filename);
+    static void installFile(const std::string &filename, const std::string &tmp, const TableFileIndex *index = nullptr);
 
     /**
-     * @brief 从文件加载表格数据
+     * @brief 从文件加载表格数据（兼容读取逐行文本的旧表文件、旧格式的 <表名>.del 删除标记
+     *        与 <表名>.schema 增删列记录）
      * @param filename 文件名
      */
     void loadFromFile(const std::string &filename);
+
+    /**
+     * @brief 按需分页打开表文件：只读取表头与分段索引，行在第一次访问时才从文件载入
+     *
+     * 分段索引 <表名>.idx 缺失或与表文件不符时顺序扫描一遍表文件重建。
+     * 同样兼容旧格式的 .del 与 .schema。
+     * @param filename 文件名
+     * @param cache 各段载入后登记到的缓存
+     * @return 表文件不存在时返回 false
+     */
+    bool openPaged(const std::string &filename, PageCache &cache);
+
+private:
+    /**
+     * @brief 各列的类型（按需分页打开表文件时交给行存储）
+     */
+    std::vector<DataType> columnTypes() const;
+
+    /**
+     * @brief 第 col 列的值 value 在唯一索引中的键，NULL 时为空
+     */
+    std::optional<std::string> keyOf(size_t col, std::string_view value) const;
+
+    /**
+     * @brief 把刚追加的第 i 个行版本加入各唯一索引与 LIKE 索引
+     */
+    void indexRow(const Row &row, size_t i);
+
+    /**
+     * @brief 解析表头中的列定义与检查点
+     * @return 数据部分是否为列式压缩块
+     */
+    bool parseHeader(const std::string &line);
+
+    /**
+     * @brief 应用旧格式的 <表名>.del 删除标记与 <表名>.schema 增删列记录
+     */
+    void applyLegacyFiles(const std::string &filename);
 };
 
-std::string getDbPath(const std::string &name);
\ No newline at end of file
+/**
+ * @brief 获取数据目录下某个表相关文件的路径（目录不存在时会自动创建）
+ * @param name 表名
+ * @param ext 文件扩展名，默认 ".table"；统计信息等附属文件使用其他扩展名
+ */
+std::string getDbPath(const std::string &name, const std::string &ext = ".table");
\ No newline at end of file
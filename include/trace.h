@@ -0,0 +1,98 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstdint>
+
+/**
+ * @brief 查询各阶段的耗时追踪，输出 Chrome trace-event JSON（chrome://tracing 或 Perfetto 打开）
+ *
+ * 代码中用 TRACE_SPAN("名称") 标记一段作用域，运行时 Tracer::enable() 后，
+ * 每个 span 结束时把名称、开始时间与持续时间（纳秒）写入当前线程的环形缓冲区，
+ * 缓冲区写满后覆盖最旧的记录；Tracer::dump() 把所有线程的记录写成 JSON。
+ *
+ * 只有以 -DMINIDB_TRACE 编译时 TRACE_SPAN 才生成代码，否则展开为空语句，
+ * 热路径上没有任何额外开销；此时 enable() 只提示追踪未编译进来。
+ */
+class Tracer
+{
+public:
+    /**
+     * @brief 是否以 -DMINIDB_TRACE 编译
+     */
+    static constexpr bool compiledIn()
+    {
+#ifdef MINIDB_TRACE
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @brief 开始或停止记录（停止后已记录的内容保留，可以继续 dump）
+     * @return 未编译进追踪时返回 false
+     */
+    static bool enable(bool on);
+
+    static bool enabled() { return active.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 把所有线程缓冲区中的记录写成 Chrome trace-event JSON
+     * @return 是否写入成功
+     */
+    static bool dump(const std::string &path);
+
+    /**
+     * @brief 清空所有线程的记录
+     */
+    static void clear();
+
+    /**
+     * @brief 追踪时钟的当前时间（纳秒）
+     */
+    static uint64_t now()
+    {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now().time_since_epoch())
+                            .count());
+    }
+
+    /**
+     * @brief 把一个已结束的 span 写入当前线程的缓冲区
+     */
+    static void record(const char *name, uint64_t start, uint64_t end);
+
+private:
+    static std::atomic<bool> active;
+};
+
+/**
+ * @brief 作用域 span：构造时记下开始时间，析构时写入缓冲区；未启用追踪时什么也不做
+ */
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char *spanName)
+        : name(Tracer::enabled() ? spanName : nullptr), start(name ? Tracer::now() : 0) {}
+    ~TraceSpan()
+    {
+        if (name)
+            Tracer::record(name, start, Tracer::now());
+    }
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+    const char *name; ///< 名称（字符串字面量），nullptr 表示不记录
+    uint64_t start;   ///< 开始时间
+};
+
+#define MINIDB_TRACE_CONCAT_(a, b) a##b
+#define MINIDB_TRACE_CONCAT(a, b) MINIDB_TRACE_CONCAT_(a, b)
+
+#ifdef MINIDB_TRACE
+#define TRACE_SPAN(name) TraceSpan MINIDB_TRACE_CONCAT(traceSpan_, __LINE__)(name)
+#else
+#define TRACE_SPAN(name) ((void)0)
+#endif
@@ -1,5 +1,8 @@
 #pragma once
 #include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
 #include <algorithm>
 #include <stdexcept>
 /**
@@ -15,7 +18,51 @@ enum class DataType
     DOUBLE,   // 双精度浮点型
     DATE,     // 日期类型
     BOOL,     // 布尔类型
-    VARCHAR   // 可变长度字符串类型
+    VARCHAR,  // 可变长度字符串类型
+    TIMESTAMP // 时间戳类型（微秒精度）
 };
 
-DataType parseType(const std::string &typeStr);
\ No newline at end of file
+DataType parseType(const std::string &typeStr);
+std::string typeToString(DataType type);
+
+/**
+ * @brief 解析 BOOL 值：true / false / 1 / 0（不区分大小写）
+ * @return 无法识别时返回 false
+ */
+bool parseBool(std::string_view s, bool &value);
+
+/**
+ * @brief 是否为以原生整数存储的时间类型（DATE 存天数，TIMESTAMP 存微秒）
+ */
+inline bool isTemporal(DataType type) { return type == DataType::DATE || type == DataType::TIMESTAMP; }
+
+/**
+ * @brief 解析时间值
+ *
+ * DATE 接受 "YYYY-MM-DD"（月、日可以是一位数），得到自 1970-01-01 起的天数；
+ * TIMESTAMP 接受 "YYYY-MM-DD[ 或 T]HH:MM[:SS[.小数秒]]" 或只有日期，得到自 1970-01-01 00:00:00 起的微秒数。
+ * @return 格式错误或日期不存在（如 2023-02-29）时返回 false
+ */
+bool parseTemporal(DataType type, std::string_view s, int64_t &value);
+
+/**
+ * @brief 把原生整数格式化为规范文本，写入 buf（至少 kTemporalTextMax 字节）
+ *
+ * DATE 为 "YYYY-MM-DD"；TIMESTAMP 为 "YYYY-MM-DD HH:MM:SS"，有小数秒时再加 ".ffffff"。
+ * 规范文本与整数同序，按字典序比较的结果与按时间比较相同（年份在 0000 到 9999 之间时）。
+ * @return 文本长度
+ */
+size_t formatTemporal(DataType type, int64_t value, char *buf);
+
+constexpr size_t kTemporalTextMax = 32;
+
+/**
+ * @brief 区间条件：low <= 值 <= high（边界可以不含等号，为空表示该侧无界）
+ */
+struct ValueRange
+{
+    std::string low;           ///< 下界，为空表示无下界
+    std::string high;          ///< 上界，为空表示无上界
+    bool lowInclusive = true;  ///< 下界是否包含等号
+    bool highInclusive = true; ///< 上界是否包含等号
+};
@@ -0,0 +1,160 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+/**
+ * @brief 重做日志中的一条记录
+ *
+ * 每个事务提交时写入若干条数据记录，最后跟一条 COMMIT 记录；
+ * 恢复时只重放以 COMMIT 结尾的完整事务。
+ */
+struct LogRecord
+{
+    enum Op : char
+    {
+        INSERT = 'I', // 插入一行（values 为按当前 schema 排列的整行）
+        REMOVE = 'D', // 删除一行与 values 完全相同的可见行
+        ALTER = 'A',  // 增删列（values[0] 为 "ADD <列定义>" 或 "DROP <列名>"）
+        COMMIT = 'C'  // 事务提交
+    };
+
+    Op op = COMMIT;
+    uint64_t ts = 0;                 ///< 所属事务的提交时间戳
+    std::string table;               ///< 表名（COMMIT 记录为空）
+    std::vector<std::string> values; ///< 记录内容
+
+    /**
+     * @brief 编码为一行文本：<op> <ts> <len>:<table> <n> <len>:<value>...
+     *
+     * 表名和值都按长度前缀写出，值中可以包含逗号、空格和换行。
+     */
+    std::string encode() const;
+
+    /**
+     * @brief 从 buf 的 pos 处解码一条记录，成功时 pos 移到下一条记录开头
+     * @return 格式错误或记录不完整（例如崩溃时只写了一半）返回 false
+     */
+    bool decode(const std::string &buf, size_t &pos);
+};
+
+/**
+ * @brief 将文件内容刷到磁盘(fsync)，目录也可以传入以持久化其中的 rename
+ */
+void syncFile(const std::string &path);
+
+/**
+ * @brief 追加写入的重做日志，支持组提交
+ *
+ * append() 只把记录放进内存缓冲区并返回日志序号(LSN)；
+ * waitDurable() 等待该 LSN 落盘：第一个到达的线程成为 leader，
+ * 一次 write + fsync 把缓冲区中所有事务的记录刷盘，其他线程只需等待。
+ * 这样并发提交的多个事务共享一次 fsync，写吞吐不受 fsync 延迟限制。
+ */
+class RedoLog
+{
+public:
+    /**
+     * @brief 打开（不存在时创建）日志文件，截掉末尾未提交完整的记录
+     * @param path 日志文件路径
+     */
+    explicit RedoLog(const std::string &path);
+    ~RedoLog();
+    RedoLog(const RedoLog &) = delete;
+    RedoLog &operator=(const RedoLog &) = delete;
+
+    /**
+     * @brief 追加已编码的记录（可以是多行）
+     * @return 这些记录结束处的 LSN
+     */
+    uint64_t append(const std::string &records);
+
+    /**
+     * @brief 阻塞直到 lsn 之前的所有记录都已 fsync
+     * @param error 失败时输出原因
+     * @return 写入或 fsync 失败时返回 false，此时 durable LSN 不前进：
+     *         写入失败时未写出的记录留在缓冲区，由之后的刷盘重试；
+     *         fsync 失败后日志不再可信，之后的调用都返回 false
+     */
+    bool waitDurable(uint64_t lsn, std::string &error);
+
+    /**
+     * @brief 读出所有已提交事务的记录（恢复用，按提交顺序）
+     */
+    std::vector<LogRecord> readAll();
+
+    /**
+     * @brief 检查点之后截断日志：只保留 keep 返回 true 的数据记录及其 COMMIT 记录
+     *
+     * 筛选和写临时文件时不持有日志锁，并发的提交照常追加、刷盘到旧文件；
+     * 最后暂停刷盘，把这期间旧文件新增的尾部原样拷到临时文件，再 rename 覆盖。
+     * 提交只在拷贝尾部的短暂时间内等待。keep 可以保守地保留不需要的记录。
+     */
+    template <class Keep>
+    void rewrite(Keep &&keep)
+    {
+        std::lock_guard<std::mutex> guard(rewriteMutex);
+        size_t upto = 0;
+        std::vector<LogRecord> records = readFile(&upto);
+        std::string out, group;
+        bool kept = false;
+        for (const auto &r : records)
+        {
+            if (r.op != LogRecord::COMMIT)
+            {
+                if (keep(r))
+                {
+                    group += r.encode();
+                    kept = true;
+                }
+                continue;
+            }
+            if (kept)
+                out += group + r.encode();
+            group.clear();
+            kept = false;
+        }
+        finishRewrite(out, upto);
+    }
+
+private:
+    /**
+     * @brief 读出文件中已提交事务的记录（文件只会被追加，不持有 mtx 也能读到一致的前缀）
+     * @param validBytes 若非空，返回最后一个完整事务结束处的字节数
+     */
+    std::vector<LogRecord> readFile(size_t *validBytes = nullptr);
+
+    /**
+     * @brief 解析 buf 中以 COMMIT 结尾的完整事务，追加到 out
+     * @return 最后一个完整事务结束处的偏移
+     */
+    static size_t parse(const std::string &buf, std::vector<LogRecord> &out);
+
+    /**
+     * @brief 以 content 原子替换日志文件并重新打开（调用方持有 mtx）
+     */
+    void replaceFile(const std::string &content);
+
+    /**
+     * @brief rewrite() 的后半部分：写入筛选结果，拷贝旧文件 upto 之后的尾部，替换旧文件
+     */
+    void finishRewrite(const std::string &content, size_t upto);
+
+    /**
+     * @brief 把已 fsync 的临时文件 rename 为日志文件并重新打开（调用方保证没有并发刷盘）
+     */
+    void swapIn(const std::string &tmp);
+
+    std::string path;
+    int fd = -1;
+    std::mutex mtx;
+    std::condition_variable flushed;
+    std::string buffer;       ///< 已追加但尚未写入文件的记录
+    uint64_t appendedLsn = 0; ///< 已追加的字节总数（单调递增，截断日志后也不回退）
+    uint64_t durableLsn = 0;  ///< 已落盘的 LSN
+    bool flushing = false;    ///< 是否有 leader 正在刷盘（截断日志拷贝尾部时也置位以暂停刷盘）
+    std::string failure;      ///< fsync 失败的原因，非空时不再确认任何 LSN
+    std::mutex rewriteMutex;  ///< 串行化 rewrite()
+};
@@ -0,0 +1,20 @@
+#include "arena.h"
+
+void *StringArena::allocateSlow(size_t n, size_t align)
+{
+    if (n + align > kBlockSize / 4)
+    {
+        // 大值单独成块，插在当前块之前，当前块继续用于小值
+        std::unique_ptr<char[]> big(new char[n + align]);
+        char *p = big.get();
+        p += (align - reinterpret_cast<uintptr_t>(p) % align) % align;
+        reserved += n + align;
+        blocks.insert(blocks.end() - (blocks.empty() ? 0 : 1), std::move(big));
+        return p;
+    }
+    blocks.push_back(std::unique_ptr<char[]>(new char[kBlockSize]));
+    cur = blocks.back().get();
+    left = kBlockSize;
+    reserved += kBlockSize;
+    return allocate(n, align);
+}
@@ -0,0 +1,321 @@
+#include "db.h"
+#include "output.h"
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+/*
+ * minidb_bench：可重复的性能基准
+ *
+ * 用确定性的数据生成器（同一种子在任何机器上生成相同的表）建表，依次运行固定的负载：
+ * 批量插入、按主键点查、ORDER BY ... LIMIT、整表聚合、按主键更新与删除、保存与加载。
+ * 每种负载记录每个操作的耗时，结果以 JSON 输出（吞吐量与 p50/p90/p99/max 延迟），
+ * 便于把一次修改前后的结果逐项对比。
+ *
+ * 数据写在独立的临时目录中（通过 HOME 指定），不会影响用户的数据目录；
+ * 后台检查点被推迟到测量保存时，避免它在其他负载中途运行造成抖动。
+ */
+
+/**
+ * @brief 确定性的伪随机数发生器（splitmix64），只依赖整数运算，各平台结果相同
+ */
+class SplitMix64
+{
+public:
+    explicit SplitMix64(uint64_t seed) : state(seed) {}
+
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    /**
+     * @brief [0, n) 中的一个数
+     */
+    uint64_t below(uint64_t n) { return next() % n; }
+
+private:
+    uint64_t state;
+};
+
+/**
+ * @brief 丢弃所有输出的缓冲区：语句结果照常格式化，但不写到终端，测量的是引擎本身
+ */
+class NullBuf : public std::streambuf
+{
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char *, std::streamsize n) override { return n; }
+};
+
+/**
+ * @brief 一种负载在一种数据规模下的结果
+ */
+struct BenchResult
+{
+    BenchResult(std::string w, size_t n) : workload(std::move(w)), rows(n) {}
+
+    std::string workload;
+    size_t rows = 0;                ///< 表的行数
+    double seconds = 0;             ///< 总耗时（含批量提交等不计入单个操作的时间）
+    std::vector<double> latencies;  ///< 每个操作的耗时（微秒）
+};
+
+static const char *kCities[] = {"Beijing", "Shanghai", "Guangzhou", "Shenzhen", "Hangzhou", "Chengdu",
+                                "Wuhan", "Xian", "Nanjing", "Tianjin", "Suzhou", "Chongqing",
+                                "Qingdao", "Xiamen", "Dalian", "Kunming"};
+static const size_t kInsertBatch = 10000; ///< 批量插入时每个事务的行数
+
+/**
+ * @brief 第 i 行的内容：id 连续，其余列由种子与 i 决定
+ */
+static std::vector<std::string> makeRow(uint64_t seed, size_t i)
+{
+    SplitMix64 rng(seed ^ (uint64_t(i) * 0x2545f4914f6cdd1dULL));
+    uint64_t r = rng.next();
+    return {std::to_string(i),
+            "user_" + std::to_string(r % 1000000),
+            std::to_string(18 + (r >> 20) % 60),
+            kCities[(r >> 32) % 16],
+            std::to_string((r >> 40) % 100000)};
+}
+
+/**
+ * @brief 点查、更新等逐个执行的负载的操作次数：表越大单次越慢，次数越少
+ */
+static size_t scaledOps(size_t rows, size_t override)
+{
+    if (override)
+        return override;
+    return std::clamp<size_t>(20000000 / std::max<size_t>(rows, 1), 10, 1000);
+}
+
+/**
+ * @brief 执行 fn 并返回耗时（微秒）
+ */
+template <class Fn>
+static double timed(Fn &&fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief 依次执行 ops 个操作，记录每个的耗时
+ */
+template <class Fn>
+static BenchResult runOps(const std::string &workload, size_t rows, size_t ops, Fn &&op)
+{
+    BenchResult r(workload, rows);
+    r.latencies.reserve(ops);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t k = 0; k < ops; k++)
+        r.latencies.push_back(timed([&]
+                                    { op(k); }));
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return r;
+}
+
+/**
+ * @brief 在 rows 行的表上运行全部负载
+ */
+static void runScale(size_t rows, uint64_t seed, size_t opsOverride, std::vector<BenchResult> &out)
+{
+    sqlDB db;
+    db.setCheckpointInterval(1 << 30);
+    db.setCheckpointThreshold(uint64_t(1) << 62);
+    std::string table = "bench_" + std::to_string(rows);
+    std::vector<Column> cols = {{"id", DataType::INT}, {"name", DataType::TEXT}, {"age", DataType::INT},
+                                {"city", DataType::TEXT}, {"score", DataType::INT}};
+    db.createTableWithTypes(table, cols);
+    size_t ops = scaledOps(rows, opsOverride);
+    SplitMix64 keys(seed + rows);
+
+    // 批量插入：每 kInsertBatch 行一个事务，提交时间计入总耗时
+    {
+        BenchResult r("bulk_insert", rows);
+        r.latencies.reserve(rows);
+        std::vector<std::string> none;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < rows; i++)
+        {
+            if (i % kInsertBatch == 0)
+                db.begin();
+            std::vector<std::string> values = makeRow(seed, i);
+            r.latencies.push_back(timed([&]
+                                        { db.insertInto(table, values, none); }));
+            if (i % kInsertBatch == kInsertBatch - 1 || i + 1 == rows)
+                db.commit();
+        }
+        r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        out.push_back(std::move(r));
+    }
+
+    out.push_back(runOps("point_select", rows, ops, [&](size_t)
+                         { db.selectAll(table, "id", std::to_string(keys.below(rows))); }));
+    out.push_back(runOps("order_by_limit", rows, ops, [&](size_t)
+                         { db.selectAll(table, "", "", "score", true, 10); }));
+
+    const char *funcs[] = {"COUNT", "SUM", "AVG", "MIN", "MAX"};
+    std::string scoreCol = "score";
+    out.push_back(runOps("aggregate", rows, ops, [&](size_t k)
+                         { db.aggregate(table, funcs[k % 5], scoreCol); }));
+
+    out.push_back(runOps("update_by_key", rows, ops, [&](size_t)
+                         { db.update(table, "score", std::to_string(keys.below(100000)), "id",
+                                     std::to_string(keys.below(rows))); }));
+    // 删除的键互不相同，每次都真正删除一行
+    size_t stride = std::max<size_t>(rows / ops, 1);
+    out.push_back(runOps("delete_by_key", rows, ops, [&](size_t k)
+                         { db.deleteRows(table, "id", std::to_string((k * stride) % rows)); }));
+
+    out.push_back(runOps("save", rows, 1, [&](size_t)
+                         { db.saveAll(); }));
+    out.push_back(runOps("load", rows, 1, [&](size_t)
+                         { db.loadAll({table}); }));
+    db.dropTable(table);
+}
+
+/**
+ * @brief 第 q 分位的延迟（最近秩法），latencies 须已排序
+ */
+static double percentile(const std::vector<double> &latencies, double q)
+{
+    if (latencies.empty())
+        return 0;
+    size_t rank = size_t(std::ceil(q * double(latencies.size())));
+    return latencies[std::min(latencies.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+static void writeJson(std::ostream &os, uint64_t seed, std::vector<BenchResult> &results)
+{
+    char buf[512];
+    os << "{\n  \"benchmark\": \"minidb_bench\",\n  \"version\": 1,\n  \"seed\": " << seed << ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        BenchResult &r = results[i];
+        std::sort(r.latencies.begin(), r.latencies.end());
+        size_t ops = r.latencies.size();
+        std::snprintf(buf, sizeof(buf),
+                      "%s\n    {\"workload\": \"%s\", \"rows\": %zu, \"ops\": %zu, \"seconds\": %.6f, "
+                      "\"ops_per_sec\": %.1f, \"latency_us\": {\"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"max\": %.1f}}",
+                      i ? "," : "", r.workload.c_str(), r.rows, ops, r.seconds,
+                      r.seconds > 0 ? double(ops) / r.seconds : 0.0, percentile(r.latencies, 0.5),
+                      percentile(r.latencies, 0.9), percentile(r.latencies, 0.99), ops ? r.latencies.back() : 0.0);
+        os << buf;
+    }
+    os << "\n  ]\n}\n";
+}
+
+/**
+ * @brief 解析逗号分隔的行数列表，如 "10000,1000000"
+ */
+static std::vector<size_t> parseSizes(const std::string &list)
+{
+    std::vector<size_t> sizes;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        if (!item.empty())
+            sizes.push_back(std::stoull(item));
+    return sizes;
+}
+
+static int usage(const char *prog)
+{
+    std::cerr << "Usage: " << prog << " [--rows n,n,...] [--seed n] [--ops n] [--out file] [--dir path]\n";
+    return 1;
+}
+
+/**
+ * @brief minidb_bench 入口
+ *
+ * 用法：minidb_bench [--rows 10000,1000000,10000000] [--seed 种子] [--ops 次数] [--out 文件] [--dir 数据目录]
+ * --ops 指定点查、更新等负载的操作次数，默认随表的大小在 10 到 1000 之间调整；
+ * 不指定 --out 时 JSON 写到标准输出；不指定 --dir 时使用临时目录并在结束后删除。
+ */
+int main(int argc, char **argv)
+{
+    std::vector<size_t> sizes = {10000, 1000000, 10000000};
+    uint64_t seed = 42;
+    size_t ops = 0;
+    std::string outPath, dir;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opt = argv[i];
+        if (opt == "--rows")
+            sizes = parseSizes(argv[i + 1]);
+        else if (opt == "--seed")
+            seed = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (opt == "--ops")
+            ops = size_t(std::atoll(argv[i + 1]));
+        else if (opt == "--out")
+            outPath = argv[i + 1];
+        else if (opt == "--dir")
+            dir = argv[i + 1];
+        else
+            return usage(argv[0]);
+    }
+    if (argc % 2 == 0 || sizes.empty())
+        return usage(argv[0]);
+
+    bool tempDir = dir.empty();
+    if (tempDir)
+    {
+        char tmpl[] = "/tmp/minidb_bench.XXXXXX";
+        if (!mkdtemp(tmpl))
+        {
+            std::cerr << "Cannot create temporary directory\n";
+            return 1;
+        }
+        dir = tmpl;
+    }
+    // 数据文件都在 $HOME/miniDB/mydb_data 下
+    std::filesystem::create_directories(std::filesystem::path(dir) / "miniDB/mydb_data");
+    setenv("HOME", dir.c_str(), 1);
+
+    std::vector<BenchResult> results;
+    {
+        NullBuf nullBuf;
+        std::ostream sink(&nullBuf);
+        OutputCapture capture(sink);
+        // 表文件的调试信息直接写 std::cout，同样丢弃
+        std::streambuf *saved = std::cout.rdbuf(&nullBuf);
+        for (size_t rows : sizes)
+        {
+            std::cerr << "Running " << rows << " rows...\n";
+            runScale(rows, seed, ops, results);
+        }
+        std::cout.rdbuf(saved);
+    }
+    if (tempDir)
+        std::filesystem::remove_all(dir);
+
+    if (outPath.empty())
+    {
+        writeJson(std::cout, seed, results);
+        return 0;
+    }
+    std::ofstream out(outPath);
+    writeJson(out, seed, results);
+    if (!out)
+    {
+        std::cerr << "Cannot write " << outPath << "\n";
+        return 1;
+    }
+    std::cerr << "Results written to " << outPath << "\n";
+    return 0;
+}
@@ -0,0 +1,476 @@
+#include "codec.h"
+#include "table.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+
+static const char kNullText[] = "NULL";
+
+/**
+ * @brief 追加无符号变长整数（每字节 7 位，最高位表示后面还有字节）
+ */
+static void putVarint(std::string &out, uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        out += char((v & 0x7f) | 0x80);
+        v >>= 7;
+    }
+    out += char(v);
+}
+
+static bool getVarint(std::string_view in, size_t &pos, uint64_t &v)
+{
+    v = 0;
+    for (unsigned shift = 0; shift < 64 && pos < in.size(); shift += 7)
+    {
+        uint8_t b = uint8_t(in[pos++]);
+        v |= uint64_t(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+static uint64_t zigzag(int64_t v) { return (uint64_t(v) << 1) ^ uint64_t(v >> 63); }
+static int64_t unzigzag(uint64_t v) { return int64_t(v >> 1) ^ -int64_t(v & 1); }
+
+static void putU32(std::string &out, uint32_t v)
+{
+    char b[4];
+    std::memcpy(b, &v, 4);
+    out.append(b, 4);
+}
+
+/**
+ * @brief 把 vals 的低 width 位依次打包，低位在前
+ */
+static void packBits(const std::vector<uint64_t> &vals, unsigned width, std::string &out)
+{
+    if (width == 0)
+        return;
+    std::string bits((vals.size() * width + 7) / 8, '\0');
+    size_t pos = 0;
+    for (uint64_t v : vals)
+    {
+        for (unsigned b = 0; b < width;)
+        {
+            unsigned off = unsigned(pos % 8);
+            unsigned take = std::min(8 - off, width - b);
+            bits[pos / 8] = char(uint8_t(bits[pos / 8]) | (((v >> b) & ((1u << take) - 1)) << off));
+            pos += take;
+            b += take;
+        }
+    }
+    out += bits;
+}
+
+static bool unpackBits(std::string_view in, size_t count, unsigned width, std::vector<uint64_t> &vals)
+{
+    // 先按剩余字节数校验 count，损坏的块不能引发巨量分配
+    if (width != 0 && count > in.size() * 8 / width)
+        return false;
+    vals.assign(count, 0);
+    if (width == 0)
+        return true;
+    size_t pos = 0;
+    for (uint64_t &v : vals)
+    {
+        for (unsigned b = 0; b < width;)
+        {
+            unsigned off = unsigned(pos % 8);
+            unsigned take = std::min(8 - off, width - b);
+            v |= uint64_t((uint8_t(in[pos / 8]) >> off) & ((1u << take) - 1)) << b;
+            pos += take;
+            b += take;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief LZ77：序列为 变长字面量长度 | 字面量 | u16 距离 | 变长(匹配长度 - 4)，最后一个序列只有字面量
+ */
+static void lzCompress(std::string_view in, std::string &out)
+{
+    const size_t kMinMatch = 4, kWindow = 65535;
+    std::vector<int64_t> table(1 << 14, -1);
+    size_t anchor = 0, i = 0;
+    while (i + kMinMatch <= in.size())
+    {
+        uint32_t seq;
+        std::memcpy(&seq, in.data() + i, 4);
+        size_t h = (seq * 2654435761u) >> 18;
+        int64_t cand = table[h];
+        table[h] = int64_t(i);
+        if (cand < 0 || i - size_t(cand) > kWindow || std::memcmp(in.data() + cand, in.data() + i, 4) != 0)
+        {
+            i++;
+            continue;
+        }
+        size_t len = kMinMatch;
+        while (i + len < in.size() && in[size_t(cand) + len] == in[i + len])
+            len++;
+        putVarint(out, i - anchor);
+        out.append(in.data() + anchor, i - anchor);
+        size_t dist = i - size_t(cand);
+        out += char(dist & 0xff);
+        out += char(dist >> 8);
+        putVarint(out, len - kMinMatch);
+        i += len;
+        anchor = i;
+    }
+    putVarint(out, in.size() - anchor);
+    out.append(in.data() + anchor, in.size() - anchor);
+}
+
+static bool lzDecompress(std::string_view in, size_t rawLen, std::string &out)
+{
+    out.clear();
+    // rawLen 来自文件，不可信：只按输入大小预留，其余随解压增长，每个序列都不得超出 rawLen
+    out.reserve(std::min(rawLen, in.size() * 4));
+    size_t pos = 0;
+    while (true)
+    {
+        uint64_t lit;
+        if (!getVarint(in, pos, lit) || lit > in.size() - pos || out.size() + lit > rawLen)
+            return false;
+        out.append(in.data() + pos, size_t(lit));
+        pos += size_t(lit);
+        if (out.size() == rawLen)
+            return true;
+        uint64_t extra;
+        if (pos + 2 > in.size())
+            return false;
+        size_t dist = uint8_t(in[pos]) | (size_t(uint8_t(in[pos + 1])) << 8);
+        pos += 2;
+        if (!getVarint(in, pos, extra) || dist == 0 || dist > out.size() || extra > rawLen ||
+            extra + 4 > rawLen - out.size())
+            return false;
+        // 匹配可以与输出重叠（距离小于长度），逐字节复制
+        size_t from = out.size() - dist;
+        for (size_t k = 0; k < extra + 4; k++)
+            out += out[from + k];
+    }
+}
+
+/**
+ * @brief INT 列的值是否为规范的十进制整数（"007"、"+5" 等保持原样，只能按文本编码）
+ */
+static bool parseCanonical(DataType type, const std::string &s, int64_t &v)
+{
+    if (isTemporal(type))
+    {
+        char text[kTemporalTextMax];
+        return parseTemporal(type, s, v) && std::string_view(text, formatTemporal(type, v, text)) == s;
+    }
+    if (type != DataType::INT || s.empty() || s.size() > 20)
+        return false;
+    char *end;
+    errno = 0;
+    long long parsed = std::strtoll(s.c_str(), &end, 10);
+    if (*end != '\0' || errno != 0)
+        return false;
+    v = parsed;
+    return std::to_string(v) == s;
+}
+
+static void formatCanonical(DataType type, int64_t v, std::string &out)
+{
+    if (isTemporal(type))
+    {
+        char text[kTemporalTextMax];
+        out.append(text, formatTemporal(type, v, text));
+    }
+    else
+        out += std::to_string(v);
+}
+
+static std::string encodePlain(const std::vector<const std::string *> &vals)
+{
+    std::string body;
+    for (const std::string *v : vals)
+    {
+        putVarint(body, v->size());
+        body += *v;
+    }
+    return body;
+}
+
+/**
+ * @brief RLE；重复不多（游程数超过值个数的一半）时放弃，返回 false
+ */
+static bool encodeRle(const std::vector<const std::string *> &vals, std::string &body)
+{
+    size_t runs = 0;
+    for (size_t k = 0; k < vals.size(); k++)
+        if (k == 0 || *vals[k] != *vals[k - 1])
+            runs++;
+    if (runs * 2 > vals.size())
+        return false;
+    putVarint(body, runs);
+    for (size_t k = 0; k < vals.size();)
+    {
+        size_t j = k + 1;
+        while (j < vals.size() && *vals[j] == *vals[k])
+            j++;
+        putVarint(body, j - k);
+        putVarint(body, vals[k]->size());
+        body += *vals[k];
+        k = j;
+    }
+    return true;
+}
+
+/**
+ * @brief 差值 + 参考帧；有值不是规范形式或差值溢出时返回 false
+ */
+static bool encodeDelta(DataType type, const std::vector<const std::string *> &vals, std::string &body)
+{
+    if (vals.empty())
+        return false;
+    std::vector<int64_t> ints(vals.size());
+    for (size_t k = 0; k < vals.size(); k++)
+        if (!parseCanonical(type, *vals[k], ints[k]))
+            return false;
+    std::vector<int64_t> deltas(vals.size() - 1);
+    for (size_t k = 1; k < ints.size(); k++)
+        if (__builtin_sub_overflow(ints[k], ints[k - 1], &deltas[k - 1]))
+            return false;
+    int64_t minDelta = deltas.empty() ? 0 : *std::min_element(deltas.begin(), deltas.end());
+    std::vector<uint64_t> packed(deltas.size());
+    uint64_t maxPacked = 0;
+    for (size_t k = 0; k < deltas.size(); k++)
+    {
+        packed[k] = uint64_t(deltas[k]) - uint64_t(minDelta);
+        maxPacked = std::max(maxPacked, packed[k]);
+    }
+    unsigned width = maxPacked ? unsigned(64 - __builtin_clzll(maxPacked)) : 0;
+    putVarint(body, zigzag(ints[0]));
+    putVarint(body, zigzag(minDelta));
+    body += char(width);
+    packBits(packed, width, body);
+    return true;
+}
+
+ChunkEncoder::ChunkEncoder(std::vector<DataType> columnTypes)
+    : types(std::move(columnTypes)), values(types.size()), chosen(types.size(), ColumnEncoding::PLAIN) {}
+
+void ChunkEncoder::addRow(const std::vector<std::string_view> &cells)
+{
+    for (size_t c = 0; c < values.size(); c++)
+        values[c].emplace_back(c < cells.size() ? cells[c] : std::string_view(kNullText));
+    rowCount++;
+}
+
+size_t ChunkEncoder::finish(std::string &out)
+{
+    size_t start = out.size();
+    std::string block;
+    for (size_t c = 0; c < values.size(); c++)
+    {
+        const std::vector<std::string> &col = values[c];
+        std::string nulls((rowCount + 7) / 8, '\0');
+        std::vector<const std::string *> present;
+        present.reserve(col.size());
+        for (size_t k = 0; k < col.size(); k++)
+        {
+            if (col[k] == kNullText)
+                nulls[k / 8] = char(uint8_t(nulls[k / 8]) | (1u << (k % 8)));
+            else
+                present.push_back(&col[k]);
+        }
+
+        // 在可用的编码中选最小的
+        ColumnEncoding enc = ColumnEncoding::PLAIN;
+        std::string body = encodePlain(present), candidate;
+        if (encodeDelta(types[c], present, candidate) && candidate.size() < body.size())
+        {
+            enc = ColumnEncoding::DELTA;
+            body.swap(candidate);
+        }
+        candidate.clear();
+        if (encodeRle(present, candidate) && candidate.size() < body.size())
+        {
+            enc = ColumnEncoding::RLE;
+            body.swap(candidate);
+        }
+        if (enc == ColumnEncoding::PLAIN && body.size() >= 64)
+        {
+            candidate.clear();
+            putVarint(candidate, body.size());
+            lzCompress(body, candidate);
+            if (candidate.size() < body.size())
+            {
+                enc = ColumnEncoding::LZ;
+                body.swap(candidate);
+            }
+        }
+        chosen[c] = enc;
+
+        bool hasNulls = present.size() != col.size();
+        block += char(enc);
+        block += char(hasNulls);
+        if (hasNulls)
+            block += nulls;
+        putVarint(block, body.size());
+        block += body;
+    }
+    putU32(out, uint32_t(block.size()));
+    putU32(out, uint32_t(rowCount));
+    out += block;
+    for (auto &col : values)
+        col.clear();
+    rowCount = 0;
+    return out.size() - start;
+}
+
+bool readChunkHeader(std::string_view bytes, uint32_t &size, uint32_t &rows)
+{
+    if (bytes.size() < ChunkEncoder::kHeaderSize)
+        return false;
+    std::memcpy(&size, bytes.data(), 4);
+    std::memcpy(&rows, bytes.data() + 4, 4);
+    return rows <= RowStore::kSegmentRows;
+}
+
+/**
+ * @brief 解码一列中非 NULL 的 count 个值，依次交给 emit
+ */
+template <class Emit>
+static bool decodeValues(ColumnEncoding enc, DataType type, std::string_view body, size_t count, Emit emit)
+{
+    size_t pos = 0;
+    std::string raw;
+    switch (enc)
+    {
+    case ColumnEncoding::LZ:
+    {
+        uint64_t rawLen;
+        // 值的结束位置按 u32 存放，解压后不可能超过 4 GB
+        if (!getVarint(body, pos, rawLen) || rawLen > UINT32_MAX ||
+            !lzDecompress(body.substr(pos), size_t(rawLen), raw))
+            return false;
+        body = raw;
+        pos = 0;
+    }
+        // 解压后按 PLAIN 读取
+        [[fallthrough]];
+    case ColumnEncoding::PLAIN:
+        for (size_t k = 0; k < count; k++)
+        {
+            uint64_t len;
+            if (!getVarint(body, pos, len) || len > body.size() - pos)
+                return false;
+            emit(body.substr(pos, size_t(len)));
+            pos += size_t(len);
+        }
+        return true;
+    case ColumnEncoding::RLE:
+    {
+        uint64_t runs;
+        if (!getVarint(body, pos, runs))
+            return false;
+        size_t produced = 0;
+        for (uint64_t r = 0; r < runs; r++)
+        {
+            uint64_t repeat, len;
+            if (!getVarint(body, pos, repeat) || !getVarint(body, pos, len) || len > body.size() - pos ||
+                repeat > count - produced)
+                return false;
+            std::string_view v = body.substr(pos, size_t(len));
+            pos += size_t(len);
+            for (uint64_t k = 0; k < repeat; k++)
+                emit(v);
+            produced += size_t(repeat);
+        }
+        return produced == count;
+    }
+    case ColumnEncoding::DELTA:
+    {
+        if (count == 0)
+            return true;
+        uint64_t first, minDelta;
+        if (!getVarint(body, pos, first) || !getVarint(body, pos, minDelta) || pos >= body.size())
+            return false;
+        unsigned width = uint8_t(body[pos++]);
+        std::vector<uint64_t> packed;
+        if (width > 64 || !unpackBits(body.substr(pos), count - 1, width, packed))
+            return false;
+        uint64_t v = uint64_t(unzigzag(first));
+        uint64_t base = uint64_t(unzigzag(minDelta));
+        std::string text;
+        for (size_t k = 0; k < count; k++)
+        {
+            if (k)
+                v += base + packed[k - 1];
+            text.clear();
+            formatCanonical(type, int64_t(v), text);
+            emit(std::string_view(text));
+        }
+        return true;
+    }
+    }
+    return false;
+}
+
+bool decodeChunk(std::string_view block, const std::vector<DataType> &types, std::vector<DecodedColumn> &columns)
+{
+    uint32_t size, rows;
+    if (!readChunkHeader(block, size, rows) || block.size() < ChunkEncoder::kHeaderSize + size)
+        return false;
+    std::string_view in = block.substr(ChunkEncoder::kHeaderSize, size);
+    size_t pos = 0;
+    columns.assign(types.size(), DecodedColumn());
+    for (size_t c = 0; c < types.size(); c++)
+    {
+        if (pos + 2 > in.size())
+            return false;
+        ColumnEncoding enc = ColumnEncoding(uint8_t(in[pos]));
+        bool hasNulls = in[pos + 1] != 0;
+        pos += 2;
+        std::string_view nulls;
+        if (hasNulls)
+        {
+            size_t bytes = (rows + 7) / 8;
+            if (pos + bytes > in.size())
+                return false;
+            nulls = in.substr(pos, bytes);
+            pos += bytes;
+        }
+        auto isNull = [&](size_t k)
+        { return hasNulls && (uint8_t(nulls[k / 8]) >> (k % 8)) & 1; };
+        size_t present = 0;
+        for (size_t k = 0; k < rows; k++)
+            present += !isNull(k);
+        uint64_t len;
+        if (!getVarint(in, pos, len) || len > in.size() - pos)
+            return false;
+        std::string_view body = in.substr(pos, size_t(len));
+        pos += size_t(len);
+
+        // 非 NULL 的值按行顺序交错填入 NULL
+        DecodedColumn &out = columns[c];
+        out.ends.reserve(rows);
+        size_t row = 0;
+        auto fillNulls = [&]
+        {
+            for (; row < rows && isNull(row); row++)
+            {
+                out.bytes += kNullText;
+                out.ends.push_back(uint32_t(out.bytes.size()));
+            }
+        };
+        fillNulls();
+        bool ok = decodeValues(enc, types[c], body, present, [&](std::string_view v)
+                               {
+                                   out.bytes += v;
+                                   out.ends.push_back(uint32_t(out.bytes.size()));
+                                   row++;
+                                   fillNulls(); });
+        if (!ok || out.ends.size() != rows)
+            return false;
+    }
+    return true;
+}
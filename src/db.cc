@@ -1,688 +1,3795 @@
 #include "db.h"
+#include "output.h"
+#include "extsort.h"
+#include "trace.h"
+#include "scanops.h"
 #include <iostream>
 #include <cctype>
 #include <algorithm>
 #include <filesystem>
 #include <numeric>
+#include <chrono>
+#include <map>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <functional>
+#include <cmath>
 
 /**
  * @brief 去除字符串两端的空白字符，并将字符串转换为小写
- * @param s 输入的字符串常量引用
+ * @param s 输入的字符串
  * @return 处理后的字符串，已去除两端空白字符并转换为小写
  */
-static std::string trim(const std::string &s)
+static std::string trim(std::string_view s)
 {
-    std::string out = s;
+    std::string out(s);
     out.erase(0, out.find_first_not_of(" \t\n\r"));
     out.erase(out.find_last_not_of(" \t\n\r") + 1);
     std::transform(out.begin(), out.end(), out.begin(), ::tolower);
     return out;
 }
 
+/**
+ * @brief WHERE 条件：某一列等于给定值，落在给定区间内，或匹配 LIKE 模式
+ *
+ * 条件值在构造时只解析一次：DATE/TIMESTAMP 列按原生整数比较（开区间折算为闭区间），
+ * INT/FLOAT/DOUBLE 列的区间按数值比较，BOOL 列的等值直接使用列位图，
+ * 其余情况等值按去掉首尾空白、不区分大小写的文本比较，区间按字典序比较。
+ * 值为 NULL（或无法解析）的行不落在任何区间内，也不匹配任何 LIKE 模式。
+ *
+ * 扫描时按段过滤（refine）：比较方式只分派一次，时间列与数值区间先把整段的值解码为
+ * int64_t / double，再用按运算符实例化的无分支循环筛选（见 scanops.h）。
+ */
+class ColumnFilter
+{
+public:
+    /**
+     * @brief 等值条件；时间列上无法解析的值（如 NULL）按文本比较
+     */
+    ColumnFilter(const Table &table, size_t column, const std::string &value) : t(table), col(column)
+    {
+        int64_t v;
+        bool b;
+        if (isTemporal(t.columns[col].type) && parseTemporal(t.columns[col].type, trim(value), v))
+        {
+            mode = Mode::NATIVE;
+            low = high = v;
+        }
+        else if (t.columns[col].type == DataType::BOOL && parseBool(trim(value), b))
+        {
+            mode = Mode::BOOL_EQUAL;
+            text = b ? "true" : "false";
+        }
+        else
+        {
+            mode = Mode::TEXT_EQUAL;
+            text = trim(value);
+        }
+    }
+
+    /**
+     * @brief 区间条件；边界无法解析时 valid() 为 false，error() 给出原因
+     */
+    ColumnFilter(const Table &table, size_t column, const ValueRange &range) : t(table), col(column)
+    {
+        DataType type = t.columns[col].type;
+        if (isTemporal(type))
+        {
+            mode = Mode::NATIVE;
+            low = INT64_MIN;
+            high = INT64_MAX;
+            if (!range.low.empty())
+            {
+                if (!parseBound(type, range.low, low))
+                    return;
+                if (!range.lowInclusive)
+                    low = low == INT64_MAX ? low : low + 1;
+            }
+            if (!range.high.empty())
+            {
+                if (!parseBound(type, range.high, high))
+                    return;
+                if (!range.highInclusive)
+                    high = high == INT64_MIN ? high : high - 1;
+            }
+        }
+        else if (type == DataType::INT || type == DataType::FLOAT || type == DataType::DOUBLE)
+        {
+            mode = Mode::NUMBER;
+            if ((!range.low.empty() && !parseDouble(range.low, true, lowNumber)) ||
+                (!range.high.empty() && !parseDouble(range.high, true, highNumber)))
+            {
+                message = "Invalid " + typeToString(type) + " value in range";
+                return;
+            }
+        }
+        else
+            mode = Mode::TEXT_RANGE;
+        bounds = range;
+        bounds.low = trim(range.low);
+        bounds.high = trim(range.high);
+    }
+
+    /**
+     * @brief LIKE 条件，pattern 须在过滤期间有效
+     */
+    ColumnFilter(const Table &table, size_t column, const LikePattern &pattern)
+        : t(table), col(column), mode(Mode::LIKE), like(&pattern) {}
+
+    bool valid() const { return message.empty(); }
+    const std::string &error() const { return message; }
+
+    /**
+     * @brief 用第 seg 段的列位图缩小候选行 mask（按字做与运算）
+     * @return mask 是否已是精确结果（BOOL 等值），为 false 时候选行还须逐行 matches()
+     */
+    bool narrow(size_t seg, uint64_t *mask) const
+    {
+        // 文本 "null" 的等值条件要匹配 NULL，不能按有效位过滤
+        if (mode == Mode::TEXT_EQUAL && text == "null")
+            return false;
+        // 没有位图，或段内的行都取默认值时逐行判断
+        SegmentBitmap bm;
+        if (!t.columnBitmap(seg, col, bm) || !bm.bits)
+            return false;
+        bool truth = text == "true";
+        for (size_t w = 0; w < ColumnBitmap::kWords; w++)
+        {
+            mask[w] &= bm.bits->valid[w].load(std::memory_order_relaxed);
+            if (mode == Mode::BOOL_EQUAL)
+            {
+                uint64_t bits = bm.bits->truth[w].load(std::memory_order_relaxed);
+                mask[w] &= truth ? bits : ~bits;
+            }
+        }
+        return mode == Mode::BOOL_EQUAL;
+    }
+
+    /**
+     * @brief 把一段（第一行下标为 base）的候选行 mask 缩小为满足条件的行
+     */
+    void refine(size_t base, uint64_t *mask) const
+    {
+        if (mode == Mode::NATIVE)
+        {
+            int64_t values[RowStore::kSegmentRows] = {};
+            decodeSegment(t, base, mask, values, [this](const RowRef &row, int64_t &v)
+                          { return t.temporalValue(row, col, v); });
+            selectBetween(values, low, high, mask, AtLeast(), AtMost());
+        }
+        else if (mode == Mode::NUMBER)
+        {
+            double values[RowStore::kSegmentRows] = {};
+            decodeSegment(t, base, mask, values, [this](const RowRef &row, double &v)
+                          { return parseDouble(t.cell(row, col), true, v); });
+            withBoundOps(boundOf(bounds.low, bounds.lowInclusive), boundOf(bounds.high, bounds.highInclusive),
+                         [&](auto lowOp, auto highOp)
+                         { selectBetween(values, lowNumber, highNumber, mask, lowOp, highOp); });
+        }
+        else
+            withPredicate([&](auto pred)
+                          { selectRows(t, base, mask, pred); });
+    }
+
+    bool matches(const RowRef &row) const
+    {
+        bool result = false;
+        withPredicate([&](auto pred)
+                      { result = pred(row); });
+        return result;
+    }
+
+private:
+    enum class Mode
+    {
+        TEXT_EQUAL,
+        BOOL_EQUAL,
+        NATIVE,
+        NUMBER,
+        TEXT_RANGE,
+        LIKE
+    };
+
+    bool parseBound(DataType type, const std::string &s, int64_t &v)
+    {
+        if (parseTemporal(type, trim(s), v))
+            return true;
+        message = "Invalid " + typeToString(type) + " value: " + s;
+        return false;
+    }
+
+    static Bound boundOf(const std::string &value, bool inclusive)
+    {
+        return value.empty() ? Bound::NONE : inclusive ? Bound::INCLUSIVE
+                                                       : Bound::EXCLUSIVE;
+    }
+
+    /**
+     * @brief 单元格 cell 去掉首尾空白并转为小写后是否等于 text（text 已规范化），不分配内存
+     */
+    static bool equalsNormalized(std::string_view cell, const std::string &text)
+    {
+        size_t first = cell.find_first_not_of(" \t\n\r");
+        if (first == std::string_view::npos)
+            return text.empty();
+        cell = cell.substr(first, cell.find_last_not_of(" \t\n\r") + 1 - first);
+        return cell.size() == text.size() &&
+               std::equal(cell.begin(), cell.end(), text.begin(), [](char a, char b)
+                          { return char(std::tolower((unsigned char)a)) == b; });
+    }
+
+    /**
+     * @brief 按比较方式选出逐行判断的谓词，以 fn(谓词) 调用一次
+     */
+    template <class Fn>
+    void withPredicate(Fn &&fn) const
+    {
+        switch (mode)
+        {
+        case Mode::NATIVE:
+            fn([this](const RowRef &row)
+               {
+                   int64_t v;
+                   return t.temporalValue(row, col, v) && v >= low && v <= high; });
+            return;
+        case Mode::NUMBER:
+            fn([this](const RowRef &row)
+               {
+                   double v;
+                   return parseDouble(t.cell(row, col), true, v) && inRange(v, lowNumber, highNumber); });
+            return;
+        case Mode::TEXT_RANGE:
+            fn([this](const RowRef &row)
+               {
+                   std::string v = trim(t.cell(row, col));
+                   return v != "null" && inRange(v, bounds.low, bounds.high); });
+            return;
+        case Mode::BOOL_EQUAL:
+            fn([this](const RowRef &row)
+               { return t.cell(row, col) == text; });
+            return;
+        case Mode::LIKE:
+            fn([this](const RowRef &row)
+               { return !t.isNull(row, col) && like->matches(t.cell(row, col)); });
+            return;
+        default:
+            fn([this](const RowRef &row)
+               { return equalsNormalized(t.cell(row, col), text); });
+            return;
+        }
+    }
+
+    /**
+     * @brief v 是否满足 bounds 的上下界（lo/hi 为已解析的边界，对应边界为空时不比较）
+     */
+    template <class T>
+    bool inRange(const T &v, const T &lo, const T &hi) const
+    {
+        if (!bounds.low.empty() && (bounds.lowInclusive ? v < lo : !(lo < v)))
+            return false;
+        if (!bounds.high.empty() && (bounds.highInclusive ? hi < v : !(v < hi)))
+            return false;
+        return true;
+    }
+
+    const Table &t;                    ///< 所在表
+    size_t col;                        ///< 条件列
+    Mode mode;                         ///< 比较方式
+    std::string text;                  ///< TEXT_EQUAL：规范化后的条件值；BOOL_EQUAL："true" 或 "false"
+    int64_t low = 0;                   ///< NATIVE：闭区间下界
+    int64_t high = 0;                  ///< NATIVE：闭区间上界
+    double lowNumber = 0;              ///< NUMBER：下界
+    double highNumber = 0;             ///< NUMBER：上界
+    ValueRange bounds;                 ///< NUMBER / TEXT_RANGE：原始区间（边界已规范化）
+    const LikePattern *like = nullptr; ///< LIKE：模式
+    std::string message;               ///< 边界无法解析时的错误信息
+};
+
+/**
+ * @brief 检查写入 DATE/TIMESTAMP/BOOL 列的值能否解析（NULL 除外），不能时输出错误
+ */
+static bool checkValue(const Column &col, const std::string &value)
+{
+    int64_t v;
+    bool b;
+    if (value == "NULL" || (col.type == DataType::BOOL ? parseBool(value, b)
+                                                       : !isTemporal(col.type) || parseTemporal(col.type, value, v)))
+        return true;
+    dbOut() << "Invalid " << typeToString(col.type) << " value: " << value << "\n";
+    return false;
+}
+
+/**
+ * @brief 检查建表时的列约束：PRIMARY KEY 至多一个；分区表的唯一列只能是分区列
+ *        （每个分区各自检查唯一性，值相同的行总在同一个分区时才能保证整张表唯一）
+ * @param partitionCol 分区列，普通表为空
+ */
+static bool checkConstraints(const std::vector<Column> &cols, const std::string &partitionCol)
+{
+    size_t primary = 0;
+    for (const auto &c : cols)
+    {
+        if (c.constraint == ColumnConstraint::NONE)
+            continue;
+        if (c.constraint == ColumnConstraint::PRIMARY_KEY && ++primary > 1)
+        {
+            dbOut() << "Multiple primary keys are not allowed.\n";
+            return false;
+        }
+        if (!partitionCol.empty() && trim(c.name) != trim(partitionCol))
+        {
+            dbOut() << "Unique column must be the partition column: " << c.name << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 检查第 col 列写入 value 是否满足其约束（PRIMARY KEY 不为 NULL、唯一列不重复），不满足时输出错误
+ * @param marker 写者的版本标记
+ * @param probe 为 false 时不再探测唯一索引（调用方已探测过）
+ */
+static bool checkKey(const Table &t, size_t col, const std::string &value, uint64_t marker, bool probe = true)
+{
+    if (t.columns[col].constraint == ColumnConstraint::PRIMARY_KEY && trim(value) == "null")
+    {
+        dbOut() << "NULL value in PRIMARY KEY column: " << t.columns[col].name << "\n";
+        return false;
+    }
+    if (probe && t.findConflict(col, value, marker) != SIZE_MAX)
+    {
+        dbOut() << "Duplicate key value for " << t.columns[col].name << ": " << value << "\n";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 等值条件 col = value 能否通过唯一索引定位（NULL 不在索引中）
+ */
+static bool useKeyIndex(const Table &t, int col, const std::string &value)
+{
+    return col >= 0 && t.hasKeyIndex(size_t(col)) && trim(value) != "null";
+}
+
+/**
+ * @brief 对前 n 个行版本中对 snap 可见且第 col 列恰为 value 的下标依次调用 fn，fn 返回 false 时停止：
+ *        能用唯一索引时只探测一次索引，否则按段取可见位图后整段比较
+ * @param scanned 累加检查过的行版本数
+ */
+template <class Fn>
+static void forEachMatch(const Table &t, int col, const std::string &value, size_t n, const Snapshot &snap,
+                         uint64_t &scanned, Fn fn)
+{
+    if (useKeyIndex(t, col, value))
+    {
+        for (size_t i : t.lookupKey(size_t(col), value))
+        {
+            if (i >= n)
+                continue;
+            scanned++;
+            if (t.visible(i, snap) && t.cell(t.rows[i], size_t(col)) == value && !fn(i))
+                return;
+        }
+        return;
+    }
+    scanned += n;
+    uint64_t mask[ColumnBitmap::kWords];
+    for (size_t base = 0; base < n; base += RowStore::kSegmentRows)
+    {
+        t.visibleBits(base >> RowStore::kSegmentBits, n, snap, mask);
+        selectRows(t, base, mask, [&](const RowRef &row)
+                   { return t.cell(row, size_t(col)) == value; });
+        bool more = true;
+        forEachSetBit(mask, ColumnBitmap::kWords, base, [&](size_t i)
+                      {
+                          if (more)
+                              more = fn(i); });
+        if (!more)
+            return;
+    }
+}
+
+/**
+ * @brief DATE/TIMESTAMP 排序键：原生整数编码为 8 字节大端并翻转符号位，按字节比较与按整数比较同序；
+ *        NULL 或无法解析的值为空串，排在最前
+ */
+static std::string temporalSortKey(const Table &t, const RowRef &row, size_t col)
+{
+    int64_t v;
+    if (!t.temporalValue(row, col, v))
+        return std::string();
+    uint64_t u = uint64_t(v) ^ (uint64_t(1) << 63);
+    std::string key(8, '\0');
+    for (int b = 7; b >= 0; b--, u >>= 8)
+        key[size_t(b)] = char(u & 0xff);
+    return key;
+}
+
+/**
+ * @brief INSERT 中某一列得到的值：按位置插入时为对应位置的值，指定列名时为该列的值，未指定则为列默认值
+ *        （列数不匹配等错误留给插入时报告）
+ */
+static std::string insertedValue(const Table &t, int col, const std::vector<std::string> &values,
+                                 const std::vector<std::string> &cols)
+{
+    if (col < 0)
+        return "NULL";
+    if (cols.empty())
+        return size_t(col) < values.size() ? values[col] : t.columns[col].defaultValue;
+    for (size_t i = 0; i < cols.size() && i < values.size(); i++)
+        if (t.getColumnIndex(cols[i]) == col)
+            return values[i];
+    return t.columns[col].defaultValue;
+}
+
+/**
+ * @brief 分区只能通过所属的分区表修改：lname 是分区时输出提示并返回 true
+ */
+static bool rejectPartitionWrite(const TableEntry &entry, const std::string &lname)
+{
+    if (entry.partitionOf.empty())
+        return false;
+    dbOut() << "Table " << lname << " is a partition of " << entry.partitionOf
+            << ", modify it through " << entry.partitionOf << ".\n";
+    return true;
+}
+
+/**
+ * @brief 加锁后的表引用
+ *
+ * 构造时对表加锁（Lock 为 shared_lock 时共享、unique_lock 时独占；
+ * Writer 为 true 时再持有 writeMutex 以串行化同表的写者），
+ * 若表在加锁前已被 dropTable 移出目录则释放锁并置空，析构时自动解锁。
+ */
+template <class Lock, bool Writer = false>
+class LockedTable
+{
+public:
+    explicit LockedTable(std::shared_ptr<TableEntry> e) : entry(std::move(e))
+    {
+        if (!entry)
+            return;
+        lock = Lock(entry->latch);
+        if (entry->dropped)
+        {
+            lock.unlock();
+            entry.reset();
+            return;
+        }
+        if (Writer)
+            writeLock = std::unique_lock<std::mutex>(entry->writeMutex);
+    }
+    explicit operator bool() const { return entry != nullptr; }
+    TableEntry *operator->() const { return entry.get(); }
+    const std::shared_ptr<TableEntry> &get() const { return entry; }
+
+    /**
+     * @brief 提前释放锁（例如在等待日志落盘之前）
+     */
+    void unlock()
+    {
+        if (writeLock.owns_lock())
+            writeLock.unlock();
+        if (lock.owns_lock())
+            lock.unlock();
+        entry.reset();
+    }
+
+private:
+    std::shared_ptr<TableEntry> entry;
+    Lock lock;
+    std::unique_lock<std::mutex> writeLock;
+};
+
+using ReadTable = LockedTable<std::shared_lock<std::shared_mutex>>;             ///< 查询：共享
+using DmlTable = LockedTable<std::shared_lock<std::shared_mutex>, true>;        ///< 增删改与写文件：共享 + 写者互斥
+using DdlTable = LockedTable<std::unique_lock<std::shared_mutex>>;              ///< 改 schema、压缩：独占
+
+/**
+ * @brief 一条写语句要修改的表
+ */
+struct WriteTarget
+{
+    std::string lname;                 ///< 小写表名
+    std::shared_ptr<TableEntry> entry; ///< 表
+    bool scan;                         ///< 是否扫描其中的行，false 表示只写入从其他分区移来的行
+};
+
+/**
+ * @brief 一条写语句在一张或多张表（分区）上持有的写锁与写集合
+ *
+ * 构造时把 targets 按表名排序后依次加 DmlTable 锁，与 commit() 的加锁顺序相同，
+ * 多条语句、事务之间不会死锁；之后的下标都对应排序后的 targets。
+ */
+class WriteLocks
+{
+public:
+    explicit WriteLocks(std::vector<WriteTarget> &targets)
+    {
+        std::sort(targets.begin(), targets.end(), [](const WriteTarget &a, const WriteTarget &b)
+                  { return a.lname < b.lname; });
+        locks.reserve(targets.size());
+        for (const auto &t : targets)
+        {
+            locks.emplace_back(t.entry);
+            writes.push_back({t.lname, t.entry, WriteSet()});
+        }
+    }
+
+    /**
+     * @brief 第 k 张表，加锁前已被删除时为 nullptr
+     */
+    Table *table(size_t k) const { return locks[k] ? &locks[k]->table : nullptr; }
+
+    /**
+     * @brief 表名为 lname 的下标，不存在时返回 PartitionScheme::npos
+     */
+    size_t find(const std::string &lname) const
+    {
+        for (size_t k = 0; k < writes.size(); k++)
+            if (writes[k].lname == lname)
+                return k;
+        return PartitionScheme::npos;
+    }
+
+    /**
+     * @brief 撤销本语句在各表上的修改（写冲突时）
+     */
+    void rollback()
+    {
+        for (size_t k = 0; k < locks.size(); k++)
+            if (locks[k])
+                locks[k]->table.rollback(writes[k].ws);
+    }
+
+    /**
+     * @brief 释放所有表锁（等待落盘或回滚事务之前）
+     */
+    void unlock() { locks.clear(); }
+
+    std::vector<TableWrite> writes; ///< 各表上的修改，交给 sqlDB::finishWrite()
+
+private:
+    std::vector<DmlTable> locks; ///< 各表的写锁
+};
+
+/**
+ * @brief 显式事务
+ *
+ * 写集合按表记录事务产生的版本，既是撤销日志（回滚时据此恢复），
+ * 也是重做日志的来源（提交时据此生成记录）。
+ */
+struct Transaction
+{
+    struct Writes
+    {
+        std::shared_ptr<TableEntry> entry; ///< 写入的表
+        WriteSet ws;                       ///< 在该表上产生的版本
+    };
+
+    const sqlDB *owner = nullptr;         ///< 所属数据库
+    uint64_t marker = 0;                  ///< 版本标记 kTxnFlag | 事务号
+    Snapshot snap;                        ///< BEGIN 时登记的快照
+    std::map<std::string, Writes> writes; ///< 按表名排序，提交时按此顺序加锁以免死锁
+};
+
+static thread_local std::shared_ptr<Transaction> currentTxn; ///< 本线程进行中的事务
+
+/**
+ * @brief 一条语句的运行统计：构造时开始计时，析构时记入该类语句及所涉及的表，
+ * 总耗时达到慢查询阈值时再写一条慢查询记录
+ *
+ * 作用域内 current() 指向它，提交、写表文件等深层函数据此累加写盘字节与落盘耗时。
+ */
+class StatementScope
+{
+public:
+    StatementScope(sqlDB &db, StatementKind kind)
+        : db(db), kind(kind), start(std::chrono::steady_clock::now()), prev(current())
+    {
+        current() = this;
+    }
+    ~StatementScope()
+    {
+        current() = prev;
+        uint64_t total = elapsedSince(start);
+        db.statementMetrics[size_t(kind)].record(total, persistNanos, rowsScanned, rowsReturned, rowsWritten,
+                                                 bytesWritten);
+        if (table)
+            table->metrics.record(total, persistNanos, rowsScanned, rowsReturned, rowsWritten, bytesWritten);
+        if (db.slowLog.shouldLog(total))
+            logSlow(total);
+    }
+    StatementScope(const StatementScope &) = delete;
+    StatementScope &operator=(const StatementScope &) = delete;
+
+    /**
+     * @brief 当前线程正在执行的语句，没有时为 nullptr
+     */
+    static StatementScope *&current()
+    {
+        thread_local StatementScope *scope = nullptr;
+        return scope;
+    }
+
+    static uint64_t elapsedSince(std::chrono::steady_clock::time_point t)
+    {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - t)
+                            .count());
+    }
+
+    std::shared_ptr<TableEntry> table; ///< 语句作用的表，同时记入它的统计
+    uint64_t rowsScanned = 0;          ///< 扫描的行版本数
+    uint64_t rowsReturned = 0;         ///< 返回的行数
+    uint64_t rowsWritten = 0;          ///< 插入、更新、删除的行数
+    uint64_t bytesWritten = 0;         ///< 写入日志与表文件的字节数
+    uint64_t persistNanos = 0;         ///< 落盘耗时
+    uint64_t filterNanos = 0;          ///< 扫描并按 WHERE 过滤的耗时
+    uint64_t sortNanos = 0;            ///< 排序耗时
+    const char *accessPath = "-";      ///< 选择的访问路径
+
+private:
+    void logSlow(uint64_t total)
+    {
+        SlowQueryRecord r;
+        r.kind = statementKindName(kind);
+        if (const std::string *text = StatementText::current())
+            r.statement = *text;
+        r.accessPath = accessPath;
+        r.totalNanos = total;
+        r.filterNanos = filterNanos;
+        r.sortNanos = sortNanos;
+        r.persistNanos = persistNanos;
+        r.rowsScanned = rowsScanned;
+        r.rowsReturned = rowsReturned;
+        db.slowLog.write(r);
+    }
+
+    sqlDB &db;
+    StatementKind kind;
+    std::chrono::steady_clock::time_point start;
+    StatementScope *prev;
+};
+
+/**
+ * @brief 只读语句的结果缓存：构造时查找，命中时直接输出缓存的结果；
+ * 未命中时记录语句的输出，析构时把完整且没有出错的结果连同返回行数存入缓存
+ *
+ * 在语句作用的表上锁之后、取快照之前构造：之后发布的提交都会使表的版本递增，
+ * 存入的结果不会被当作更新后的结果返回。
+ */
+class CachedRead
+{
+public:
+    /**
+     * @param key 规范化的语句，为空时（如在事务中）不使用缓存
+     */
+    CachedRead(ResultCache &cache, StatementScope &stmt, const TableEntry &entry, std::string key)
+        : cache(cache), stmt(stmt), key(std::move(key)), version(entry.version.load())
+    {
+        if (this->key.empty() || !cache.enabled())
+            return;
+        uint64_t rows;
+        if (std::shared_ptr<const std::string> text = cache.get(this->key, version, rows))
+        {
+            dbOut() << *text;
+            stmt.rowsReturned = rows;
+            stmt.accessPath = accessPathName(AccessPath::RESULT_CACHE);
+            served = true;
+            return;
+        }
+        recorder.emplace(cache.maxResultBytes());
+    }
+    ~CachedRead()
+    {
+        if (recorder && recorder->complete())
+            cache.put(key, version, recorder->take(), stmt.rowsReturned);
+    }
+    CachedRead(const CachedRead &) = delete;
+    CachedRead &operator=(const CachedRead &) = delete;
+
+    /**
+     * @brief 是否已由缓存的结果应答
+     */
+    bool hit() const { return served; }
+
+private:
+    ResultCache &cache;
+    StatementScope &stmt;
+    std::string key;
+    uint64_t version;
+    bool served = false;
+    std::optional<ResultRecorder> recorder;
+};
+
+/**
+ * @brief 把语句的各部分连接为结果缓存的键（以 \x1f 分隔，各部分可以包含任意其它字符）
+ */
+template <class... Parts>
+static std::string cacheKey(const Parts &...parts)
+{
+    std::string key;
+    ((key += parts, key += '\x1f'), ...);
+    return key;
+}
+
+/**
+ * @brief 累加当前语句的写盘字节（不在语句中时忽略）
+ */
+static void noteBytesWritten(uint64_t bytes)
+{
+    if (StatementScope *stmt = StatementScope::current())
+        stmt->bytesWritten += bytes;
+}
+
+/**
+ * @brief 执行 fn 并把耗时计入当前语句的落盘耗时
+ */
+template <class Fn>
+static void timedPersist(Fn &&fn)
+{
+    StatementScope *stmt = StatementScope::current();
+    if (!stmt)
+    {
+        fn();
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    stmt->persistNanos += StatementScope::elapsedSince(start);
+}
+
+/**
+ * @brief 把一组写集合编码为重做记录：先插入后删除，重放时删除总能找到对应的行
+ */
+static void encodeWrites(std::string &out, const std::string &lname, const Table &t,
+                         const WriteSet &ws, uint64_t ts)
+{
+    LogRecord r;
+    r.ts = ts;
+    r.table = lname;
+    r.op = LogRecord::INSERT;
+    for (size_t i : ws.inserted)
+    {
+        r.values = t.materialize(t.rows[i]).values;
+        out += r.encode();
+    }
+    r.op = LogRecord::REMOVE;
+    for (size_t i : ws.ended)
+    {
+        r.values = t.materialize(t.rows[i]).values;
+        out += r.encode();
+    }
+}
+
+/**
+ * @brief 提交记录
+ */
+static std::string commitRecord(uint64_t ts)
+{
+    LogRecord c;
+    c.op = LogRecord::COMMIT;
+    c.ts = ts;
+    return c.encode();
+}
+
+/**
+ * @brief 按整行内容生成哈希键（长度前缀拼接，避免不同的行拼出相同的键）
+ */
+static std::string rowKey(const std::vector<std::string> &values)
+{
+    std::string key;
+    for (const auto &v : values)
+        key += std::to_string(v.size()) + ":" + v;
+    return key;
+}
+
+/**
+ * @brief 重放重做日志中 lname 在表文件之后提交的记录
+ * @return 重放的记录字节数，非 0 时表文件已过时
+ *
+ * 删除记录按整行内容匹配一个可见的行（内容相同的行可以互换），
+ * 第一次遇到删除时按内容建立索引，增删列之后重建。
+ * 索引只收录日志中要删除的内容，内存占用与删除记录数成正比而与表的大小无关。
+ */
+static uint64_t replayLog(const std::string &lname, Table &t, const std::vector<LogRecord> &records)
+{
+    uint64_t bytes = 0;
+    std::unordered_set<std::string> wanted;
+    for (const auto &r : records)
+        if (r.table == lname && r.ts > t.checkpointTs && r.op == LogRecord::REMOVE)
+            wanted.insert(rowKey(r.values));
+    std::unordered_multimap<std::string, size_t> byContent;
+    bool indexed = false;
+    auto index = [&](std::string key, size_t i)
+    {
+        if (wanted.count(key))
+            byContent.emplace(std::move(key), i);
+    };
+    Snapshot latest = Snapshot::latest();
+    for (const auto &r : records)
+    {
+        if (r.table != lname || r.ts <= t.checkpointTs)
+            continue;
+        bytes += r.encode().size();
+        if (r.op == LogRecord::INSERT)
+        {
+            Row row;
+            row.values = r.values;
+            size_t i = t.appendRow(std::move(row));
+            if (indexed)
+                index(rowKey(r.values), i);
+        }
+        else if (r.op == LogRecord::REMOVE)
+        {
+            if (!indexed)
+            {
+                for (size_t i = 0; i < t.rows.size(); i++)
+                    if (t.visible(i, latest))
+                        index(rowKey(t.materialize(t.rows[i]).values), i);
+                indexed = true;
+            }
+            auto it = byContent.find(rowKey(r.values));
+            if (it != byContent.end())
+            {
+                t.rows.setEnd(it->second, kBootstrapTs);
+                t.deadCount++;
+                byContent.erase(it);
+            }
+        }
+        else if (r.op == LogRecord::ALTER && !r.values.empty())
+        {
+            t.applySchemaChange(r.values[0]);
+            byContent.clear();
+            indexed = false;
+        }
+    }
+    return bytes;
+}
+
+/**
+ * @brief 构造数据库，打开重做日志并启动后台压缩线程与检查点线程
+ *
+ * 之后分配的提交时间戳都大于日志中已有的，保证重放时按时间戳判断记录是否已写入表文件。
+ */
+sqlDB::sqlDB()
+    : wal(getDbPath("minidb", ".wal")),
+      tables(std::make_shared<const Catalog>()),
+      compactor(&sqlDB::compactionLoop, this),
+      flusher(&sqlDB::flushLoop, this)
+{
+    uint64_t last = 0;
+    for (const auto &r : wal.readAll())
+        last = std::max(last, r.ts);
+    txns.advanceTo(last);
+}
+
+std::shared_ptr<Transaction> sqlDB::activeTxn() const
+{
+    return currentTxn && currentTxn->owner == this ? currentTxn : nullptr;
+}
+
+std::shared_ptr<TableEntry> sqlDB::findTable(const std::string &lname) const
+{
+    std::shared_ptr<const Catalog> snapshot = std::atomic_load(&tables);
+    auto it = snapshot->find(lname);
+    return it == snapshot->end() ? nullptr : it->second;
+}
+
+std::vector<std::pair<std::string, std::shared_ptr<TableEntry>>>
+sqlDB::partitionsFor(const std::string &lname, const TableEntry &parent, const std::string &whereCol,
+                     const std::string &whereVal, const ValueRange *range) const
+{
+    std::shared_ptr<const PartitionScheme> scheme = std::atomic_load(&parent.partitions);
+    std::vector<size_t> picked;
+    int col = whereCol.empty() ? -1 : parent.table.getColumnIndex(whereCol);
+    if (col != -1 && col == parent.table.getColumnIndex(scheme->column))
+        picked = range ? scheme->prune(*range) : scheme->prune(whereVal);
+    else
+    {
+        picked.resize(scheme->parts.size());
+        std::iota(picked.begin(), picked.end(), size_t(0));
+    }
+    std::vector<std::pair<std::string, std::shared_ptr<TableEntry>>> parts;
+    for (size_t k : picked)
+    {
+        std::string part = scheme->tableName(lname, k);
+        if (std::shared_ptr<TableEntry> e = findTable(part))
+            parts.emplace_back(std::move(part), std::move(e));
+    }
+    return parts;
+}
+
+bool sqlDB::removeTable(const std::string &lname)
+{
+    std::shared_ptr<const Catalog> current = std::atomic_load(&tables);
+    auto it = current->find(lname);
+    if (it != current->end())
+    {
+        // 等待正在使用该表的操作结束，之后拿到旧引用的调用者会看到 dropped
+        std::unique_lock<std::shared_mutex> tableLock(it->second->latch);
+        it->second->dropped = true;
+        dirtyBytes -= it->second->dirtyBytes.exchange(0);
+        auto next = std::make_shared<Catalog>(*current);
+        next->erase(lname);
+        std::atomic_store(&tables, std::shared_ptr<const Catalog>(std::move(next)));
+    }
+    std::remove(getDbPath(lname, ".stats").c_str());
+    std::remove(getDbPath(lname, ".del").c_str());
+    std::remove(getDbPath(lname, ".schema").c_str());
+    std::remove(getDbPath(lname, ".idx").c_str());
+    std::remove(getDbPath(lname, ".parts").c_str());
+    std::remove(getDbPath(lname, ".views").c_str());
+    return std::remove(getDbPath(lname).c_str()) == 0;
+}
+
+/**
+ * @brief 通知后台线程退出并等待其结束
+ *
+ * 不做最后一次检查点：未写入表文件的提交都在重做日志中，下次加载时重放。
+ */
+sqlDB::~sqlDB()
+{
+    {
+        std::lock_guard<std::mutex> lock(flushMutex);
+        flushStopping = true;
+    }
+    flushCv.notify_all();
+    if (flusher.joinable())
+        flusher.join();
+    {
+        std::lock_guard<std::mutex> lock(compactMutex);
+        stopping = true;
+    }
+    compactCv.notify_all();
+    if (compactor.joinable())
+        compactor.join();
+}
+
 /**
  * 创建一个具有指定列类型的数据库表
  * @param name 表名引用
  * @param cols 列定义向量引用
  */
-void sqlDB::createTableWithTypes(std::string &name, std::vector<Column> &cols)
+void sqlDB::createTableWithTypes(std::string &name, std::vector<Column> &cols)
+{
+    StatementScope stmt(*this, StatementKind::DDL);
+    std::string lname = name;
+    std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
+    if (!checkConstraints(cols, ""))
+        return;
+    std::lock_guard<std::mutex> lock(catalogMutex);
+    std::shared_ptr<const Catalog> current = std::atomic_load(&tables);
+    if (current->count(lname) || findView(lname))
+    {
+        dbOut() << "Table already exists. \n";
+        return;
+    }
+    auto entry = newTable(lname, cols);
+    stmt.table = entry;
+    auto next = std::make_shared<Catalog>(*current);
+    (*next)[lname] = entry;
+    std::atomic_store(&tables, std::shared_ptr<const Catalog>(std::move(next)));
+    dbOut() << "Table created with type. \n";
+}
+
+std::shared_ptr<TableEntry> sqlDB::newTable(const std::string &lname, const std::vector<Column> &cols)
+{
+    auto entry = std::make_shared<TableEntry>();
+    entry->table.columns = cols;
+    entry->table.buildIndexes();
+    if (pages.capacity() > 0)
+        entry->table.pageCache = &pages;
+    // 表头记录当前提交时间戳，日志中同名旧表的记录都不会重放到新表上
+    entry->table.checkpointTs = txns.snapshot().ts;
+    timedPersist([&]
+                 { entry->table.saveToFile(lname, entry->table.checkpointTs); });
+    touch(*entry);
+    return entry;
+}
+
+/**
+ * @brief 创建分区表
+ *
+ * 分区表本身只保存表结构（表文件中没有行），每个分区是目录中一张名为 `<表名>#<分区名>` 的普通表，
+ * 各自有表文件、检查点与统计信息；分区定义保存在 `<表名>.parts`。
+ * 之后对分区表的增删改查按分区列的值路由到分区：
+ * - 插入的行写入分区列的值所在的分区
+ * - 条件列是分区列时只访问可能包含满足条件的行的分区（RANGE 的等值与区间条件、HASH 的等值条件）
+ * - 查询的多个分区在多个线程中并行过滤
+ * - 一条语句修改的多个分区在同一次提交中生效；更新分区列时行移到新值所在的分区
+ *
+ * @param name 表名（不区分大小写，内部统一转换为小写）
+ * @param cols 列定义
+ * @param scheme 分区定义
+ *
+ * @note
+ * - 若表或某个分区的表已存在，会输出 `"Table already exists."`
+ * - 若分区列不存在，会输出 `"Column not found: <列名>"`
+ * - 分区定义不合法（RANGE 上界无法解析或不递增、分区名重复等）时输出原因
+ * - 分区只能通过分区表修改，直接对分区增删改或删除分区的表会被拒绝，但可以直接查询
+ * - PRIMARY KEY / UNIQUE 约束只能加在分区列上（每个分区各自检查），否则输出
+ *   `"Unique column must be the partition column: <列名>"`
+ *
+ * @example
+ * @code
+ * PartitionScheme byMonth;
+ * byMonth.kind = PartitionKind::RANGE;
+ * byMonth.column = "created";
+ * byMonth.parts = {{"p2024_01", "2024-02-01"}, {"p2024_02", "2024-03-01"}, {"pmax", ""}};
+ * db.createPartitionedTable(name, cols, byMonth);
+ * @endcode
+ */
+void sqlDB::createPartitionedTable(std::string &name, std::vector<Column> &cols, PartitionScheme scheme)
+{
+    StatementScope stmt(*this, StatementKind::DDL);
+    std::string lname = name;
+    std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
+    auto col = std::find_if(cols.begin(), cols.end(), [&](const Column &c)
+                            { return trim(c.name) == trim(scheme.column); });
+    if (col == cols.end())
+    {
+        dbOut() << "Column not found: " << scheme.column << "\n";
+        return;
+    }
+    if (!checkConstraints(cols, col->name))
+        return;
+    scheme.column = col->name;
+    scheme.type = col->type;
+    for (auto &p : scheme.parts)
+        p.name = trim(p.name);
+    std::string error;
+    if (!scheme.build(error))
+    {
+        dbOut() << error << "\n";
+        return;
+    }
+    std::lock_guard<std::mutex> lock(catalogMutex);
+    std::shared_ptr<const Catalog> current = std::atomic_load(&tables);
+    bool exists = current->count(lname);
+    for (size_t k = 0; k < scheme.parts.size(); k++)
+        exists = exists || current->count(scheme.tableName(lname, k));
+    if (exists)
+    {
+        dbOut() << "Table already exists. \n";
+        return;
+    }
+    auto next = std::make_shared<Catalog>(*current);
+    timedPersist([&]
+                 { scheme.saveToFile(getDbPath(lname, ".parts")); });
+    for (size_t k = 0; k < scheme.parts.size(); k++)
+    {
+        std::string part = scheme.tableName(lname, k);
+        auto entry = newTable(part, cols);
+        entry->partitionOf = lname;
+        (*next)[part] = entry;
+    }
+    auto entry = newTable(lname, cols);
+    size_t count = scheme.parts.size();
+    entry->partitions = std::make_shared<const PartitionScheme>(std::move(scheme));
+    stmt.table = entry;
+    (*next)[lname] = entry;
+    std::atomic_store(&tables, std::shared_ptr<const Catalog>(std::move(next)));
+    dbOut() << "Partitioned table created with " << count << " partitions. \n";
+}
+
+/**
+ * @brief 在 RANGE 分区表的最后添加一个分区
+ *
+ * 新分区存放 上一个分区的上界 <= 值 < upper 的行，只新建一张空表，不移动已有的行。
+ *
+ * @note
+ * - 若表不是 RANGE 分区表，会输出 `"Not a RANGE partitioned table: <表名>"`
+ * - upper 须大于已有的上界，且最后一个分区不能是 MAXVALUE，否则输出原因
+ * - 成功后输出 `"Partition added: <分区名>"`
+ */
+void sqlDB::addPartition(const std::string &tableName, const std::string &part, const std::string &upper)
+{
+    StatementScope stmt(*this, StatementKind::DDL);
+    std::string lname = tableName;
+    std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
+    std::lock_guard<std::mutex> lock(catalogMutex);
+    // 独占持有分区表：没有语句正在按旧的分区定义访问各分区
+    DdlTable entry(findTable(lname));
+    if (!entry)
+    {
+        dbOut() << "Table not found.\n";
+        return;
+    }
+    stmt.table = entry.get();
+    std::shared_ptr<const PartitionScheme> scheme = std::atomic_load(&entry->partitions);
+    if (!scheme || scheme->kind != PartitionKind::RANGE)
+    {
+        dbOut() << "Not a RANGE partitioned table: " << lname << "\n";
+        return;
+    }
+    auto next = std::make_shared<PartitionScheme>(*scheme);
+    next->parts.push_back({trim(part), upper});
+    std::string error;
+    if (!next->build(error))
+    {
+        dbOut() << error << "\n";
+        return;
+    }
+    std::string child = next->tableName(lname, next->parts.size() - 1);
+    std::shared_ptr<const Catalog> current = std::atomic_load(&tables);
+    if (current->count(child))
+    {
+        dbOut() << "Table already exists. \n";
+        return;
+    }
+    timedPersist([&]
+                 { next->saveToFile(getDbPath(lname, ".parts")); });
+    auto partEntry = newTable(child, entry->table.columns);
+    partEntry->partitionOf = lname;
+    auto catalog = std::make_shared<Catalog>(*current);
+    (*catalog)[child] = partEntry;
+    std::atomic_store(&tables, std::shared_ptr<const Catalog>(std::move(catalog)));
+    std::atomic_store(&entry->partitions, std::shared_ptr<const PartitionScheme>(std::move(next)));
+    dbOut() << "Partition added: " << trim(part) << "\n";
+}
+
+/**
+ * @brief 删除 RANGE 分区表的一个分区
+ *
+ * 只把分区的表移出目录并删除其文件，代价与分区中的行数无关，适合按时间定期清理旧数据。
+ * 之后落在该分区范围内的新行写入下一个分区。
+ *
+ * @note
+ * - 若表不是分区表，会输出 `"Not a partitioned table: <表名>"`
+ * - HASH 分区不能单独删除（其余的行需要按新的分区数重新分配），会输出提示
+ * - 不能删除唯一的分区
+ * - 分区表上有物化视图时需扫描一次该分区，从视图中减去其中的行
+ * - 成功后输出 `"Partition dropped: <分区名>"`
+ */
+void sqlDB::dropPartition(const std::string &tableName, const std::string &part)
+{
+    StatementScope stmt(*this, StatementKind::DDL);
+    std::string lname = tableName;
+    std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
+    std::lock_guard<std::mutex> lock(catalogMutex);
+    DdlTable entry(findTable(lname));
+    if (!entry)
+    {
+        dbOut() << "Table not found.\n";
+        return;
+    }
+    stmt.table = entry.get();
+    std::shared_ptr<const PartitionScheme> scheme = std::atomic_load(&entry->partitions);
+    if (!scheme)
+    {
+        dbOut() << "Not a partitioned table: " << lname << "\n";
+        return;
+    }
+    if (scheme->kind == PartitionKind::HASH)
+    {
+        dbOut() << "Cannot drop a HASH partition.\n";
+        return;
+    }
+    size_t k = scheme->find(part);
+    if (k == PartitionScheme::npos)
+    {
+        dbOut() << "Partition not found: " << part << "\n";
+        return;
+    }
+    if (scheme->parts.size() == 1)
+    {
+        dbOut() << "Cannot drop the only partition.\n";
+        return;
+    }
+    auto next = std::make_shared<PartitionScheme>(*scheme);
+    next->parts.erase(next->parts.begin() + k);
+    std::string error;
+    next->build(error);
+    // 先保存新的分区定义再删除分区的表：中途崩溃时最多留下一张不属于任何分区表的表
+    timedPersist([&]
+                 { next->saveToFile(getDbPath(lname, ".parts")); });
+    std::atomic_store(&entry->partitions, std::shared_ptr<const PartitionScheme>(std::move(next)));
+    std::shared_ptr<TableEntry> dropped = findTable(scheme->tableName(lname, k));
+    removeTable(scheme->tableName(lname, k));
+    // 移出目录后分区上不会再有提交，从物化视图中减去其中已提交的行
+    std::shared_ptr<const ViewList> views = std::atomic_load(&entry->views);
+    if (dropped && views && !views->empty())
+    {
+        const Table &t = dropped->table;
+        Snapshot snap = txns.snapshot();
+        for (size_t i = 0; i < t.rows.size(); i++)
+            if (t.visible(i, snap))
+                for (const auto &v : *views)
+                    v->applyRow(t, i, -1);
+        stmt.rowsScanned += t.rows.size();
+    }
+    touch(*entry.get());
+    dbOut() << "Partition dropped: " << scheme->parts[k].name << "\n";
+}
+
+/**
+ * @brief 向指定表插入一行数据
+ *
+ * 此方法会根据给定的表名、列和值，将新行插入到表中。
+ * - 如果未指定列名 (cols 为空)，则要求 values 的数量与表列数完全一致。
+ * - 如果指定了列名，则只更新这些列，未指定的列填充为列的默认值（未设置时为 "NULL"）。
+ * - 自动提交时，插入的行写入重做日志并落盘后才返回；在事务中则等到 commit() 时一起提交。
+ *
+ * @param name 表名（不区分大小写，内部统一转换为小写）
+ * @param values 插入的值列表，对应列的数据
+ * @param cols 指定插入的列名（可选）。如果为空，则按照表列顺序插入。
+ *
+ * @note
+ * - 若表不存在，会输出 "Table not found."
+ * - 若列数与值数不匹配，会输出 "Column count mismatch."
+ * - 若给定的列名在表中不存在，会输出 "Column not found: <列名>"
+ * - DATE/TIMESTAMP 列的值在插入时解析一次并以原生整数存储，无法解析时输出 "Invalid DATE value: <值>"，
+ *   不插入；值 NULL 原样保存
+ * - 分区表的行写入分区列的值所在的分区，没有这样的分区（RANGE 分区表中值不小于最后一个上界）时
+ *   输出 "No partition for value: <值>"，不插入
+ * - PRIMARY KEY 列的值为 NULL 时输出 "NULL value in PRIMARY KEY column: <列名>"；
+ *   PRIMARY KEY / UNIQUE 列的值已被其他行占用（包括其他事务未提交的插入与删除）时输出
+ *   "Duplicate key value for <列名>: <值>"，不插入。每个唯一列只探测一次其哈希索引
+ *
+ * @example
+ * @code
+ * sqlDB db;
+ * std::vector<std::string> cols = {"id", "name"};
+ * std::vector<std::string> vals = {"1", "Alice"};
+ * db.insertInto("users", vals, cols);
+ * @endcode
+ */
+void sqlDB::insertInto(std::string &name, const std::vector<std::string> &values, const std::vector<std::string> &cols)
+{
+    insertRow(name, values, cols, nullptr);
+}
+
+/**
+ * @brief 插入一行，与已有的行在唯一列上冲突时改为修改该行或跳过（upsert）
+ *
+ * 冲突列的值只探测一次唯一索引：没有冲突时按 insertInto() 插入（冲突列不再重复检查），
+ * 有冲突时在同一次探测得到的行上应用 SET，生成新版本并结束旧版本，与 update() 相同。
+ *
+ * @param name 表名（不区分大小写，内部统一转换为小写）
+ * @param values 插入的值列表
+ * @param cols 指定插入的列名（可选）
+ * @param onConflict 冲突列（为空时取主键）与冲突时的修改；SET 的值为 `EXCLUDED.<列名>` 时取本次要插入的该列的值，
+ *        SET 为空表示 DO NOTHING
+ *
+ * @note
+ * - 冲突列不存在或没有唯一约束时输出提示，不插入
+ * - 冲突的行在本语句（事务中为事务）的快照之后才提交、或正被其他未提交的写者修改时，按写-写冲突处理，
+ *   与 update() 相同
+ * - SET 改动的其他唯一列同样检查重复；分区表不能在 SET 中修改分区列
+ * - 插入时输出 `"Row inserted."`，修改时输出 `"Row updated."`，DO NOTHING 跳过时输出 `"Row skipped."`
+ *
+ * @example
+ * @code
+ * // INSERT INTO users (id, name) VALUES (1, 'Alice') ON CONFLICT (id) DO UPDATE SET name = EXCLUDED.name
+ * db.upsert(users, {"1", "Alice"}, {"id", "name"}, {"id", {{"name", "EXCLUDED.name"}}});
+ * @endcode
+ */
+void sqlDB::upsert(std::string &name, const std::vector<std::string> &values, const std::vector<std::string> &cols,
+                   const OnConflict &onConflict)
+{
+    insertRow(name, values, cols, &onConflict);
+}
+
+void sqlDB::insertRow(const std::string &name, const std::vector<std::string> &values,
+                      const std::vector<std::string> &cols, const OnConflict *onConflict)
+{
+    StatementScope stmt(*this, StatementKind::INSERT);
+    TRACE_SPAN("sqlDB::insertInto");
+    std::string lname = name;
+    std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
+    std::shared_ptr<Transaction> txn = activeTxn();
+    std::shared_ptr<TableEntry> found = findTable(lname);
+    // 分区表：持有其共享锁（期间分区与表结构不变），行写入分区列的值所在的分区
+    std::optional<ReadTable> parent;
+    std::string target = lname;
+    int partitionIdx = -1;
+    if (found && std::atomic_load(&found->partitions))
+    {
+        parent.emplace(found);
+        if (!*parent)
+        {
+            dbOut() << "Table not found.\n";
+            return;
+        }
+        stmt.table = found;
+        std::shared_ptr<const PartitionScheme> scheme = std::atomic_load(&found->partitions);
+        partitionIdx = found->table.getColumnIndex(scheme->column);
+        std::string value = insertedValue(found->table, partitionIdx, values, cols);
+        size_t k = scheme->route(value);
+        if (k == PartitionScheme::npos)
+        {
+            dbOut() << "No partition for value: " << value << "\n";
+            return;
+        }
+        target = scheme->tableName(lname, k);
+        found = findTable(target);
+    }
+    DmlTable entry(found);
+    if (!entry)
+    {
+        dbOut() << "Table not found.\n";
+        return;
+    }
+    if (!parent && rejectPartitionWrite(*entry.get(), lname))
+        return;
+    if (!parent)
+        stmt.table = entry.get();
+    Table &t = entry->table;
+    Row r;
+    for (const auto &c : t.columns)
+        r.values.push_back(c.defaultValue);
+    if (cols.empty())
+    {
+        if (t.columns.size() != values.size())
+        {
+            dbOut() << "Column count mismatch.\n";
+            return;
+        }
+        r.values = values; // copy values to row
+    }
+    else
+    {
+        if (cols.size() != values.size())
+        {
+            dbOut() << "Column count mismatch.\n";
+            return;
+        }
+        for (size_t i = 0; i < cols.size(); i++)
+        {
+            int idx = t.getColumnIndex(cols[i]);
+            if (idx == -1)
+            {
+                dbOut() << "Column not found:; " << cols[i] << std::endl;
+                return;
+            }
+            r.values[idx] = values[i];
+        }
+        // 未指定的列保持列默认值
+    }
+    for (size_t i = 0; i < t.columns.size(); i++)
+        if (!checkValue(t.columns[i], r.values[i]))
+            return;
+
+    // ON CONFLICT 的冲突列：指定的列，或主键
+    int conflictIdx = -1;
+    if (onConflict)
+    {
+        if (!onConflict->column.empty())
+            conflictIdx = t.getColumnIndex(onConflict->column);
+        else
+            for (size_t c = 0; c < t.columns.size() && conflictIdx == -1; c++)
+                if (t.columns[c].constraint == ColumnConstraint::PRIMARY_KEY)
+                    conflictIdx = int(c);
+        if (conflictIdx == -1 || !t.hasKeyIndex(size_t(conflictIdx)))
+        {
+            dbOut() << "ON CONFLICT requires a PRIMARY KEY or UNIQUE column"
+                    << (onConflict->column.empty() ? "" : ": " + onConflict->column) << "\n";
+            return;
+        }
+    }
+    uint64_t marker = txn ? txn->marker : txns.beginTxn();
+    size_t hit = conflictIdx == -1 ? SIZE_MAX : t.findConflict(size_t(conflictIdx), r.values[conflictIdx], marker);
+    WriteSet ws;
+    const char *done = "Row inserted. ";
+    if (hit != SIZE_MAX)
+    {
+        // 冲突的行须对本语句可见且未被结束，否则是写-写冲突
+        Snapshot snap = txn ? txn->snap : txns.snapshot(marker);
+        if (!t.visible(hit, snap) || t.rows.endTs(hit) != kInfinityTs)
+        {
+            entry.unlock();
+            parent.reset();
+            abortWrite(lname, txn.get());
+            return;
+        }
+        if (onConflict->set.empty())
+        {
+            dbOut() << "Row skipped. " << std::endl;
+            return;
+        }
+        Row next = t.materialize(t.rows[hit]);
+        std::vector<size_t> changed;
+        for (const auto &assign : onConflict->set)
+        {
+            int idx = t.getColumnIndex(assign.first);
+            std::string value = assign.second;
+            // EXCLUDED.<列> 为本次要插入的该列的值
+            if (trim(value).compare(0, 9, "excluded.") == 0)
+            {
+                int src = t.getColumnIndex(trim(value).substr(9));
+                if (src == -1)
+                {
+                    dbOut() << "Column not found: " << value << "\n";
+                    return;
+                }
+                value = r.values[src];
+            }
+            if (idx == -1)
+            {
+                dbOut() << "Column not found: " << assign.first << "\n";
+                return;
+            }
+            if (idx == partitionIdx)
+            {
+                dbOut() << "Cannot update partition column in ON CONFLICT: " << t.columns[idx].name << "\n";
+                return;
+            }
+            if (!checkValue(t.columns[idx], value))
+                return;
+            next.values[idx] = value;
+            changed.push_back(size_t(idx));
+        }
+        t.rows.setEnd(hit, marker);
+        ws.ended.push_back(hit);
+        // 只有 SET 改动的唯一列需要再次探测；旧版本已被本语句结束，不会与新版本冲突
+        for (size_t c : changed)
+        {
+            if (t.columns[c].constraint != ColumnConstraint::NONE && !checkKey(t, c, next.values[c], marker))
+            {
+                t.rollback(ws);
+                return;
+            }
+        }
+        ws.inserted.push_back(t.appendRow(std::move(next), marker));
+        done = "Row updated. ";
+    }
+    else
+    {
+        for (size_t c = 0; c < t.columns.size(); c++)
+            if (t.columns[c].constraint != ColumnConstraint::NONE &&
+                !checkKey(t, c, r.values[c], marker, int(c) != conflictIdx))
+                return;
+        ws.inserted.push_back(t.appendRow(std::move(r), marker));
+    }
+    stmt.rowsWritten = 1;
+    uint64_t lsn = finishWrite({{target, entry.get(), ws}}, txn.get());
+    // 等待落盘时不再持有表锁，同表的其他写者可以继续并加入同一次 fsync
+    entry.unlock();
+    parent.reset();
+    if (!awaitDurable(lsn))
+        return;
+    dbOut() << done << std::endl;
+}
+
+/**
+ * @brief 查询表中的数据并输出到标准输出
+ *
+ * 此方法实现了一个简易版的 SQL `SELECT` 功能，支持：
+ * - 按条件筛选 (`WHERE`)
+ * - 排序 (`ORDER BY`)
+ * - 限制返回行数 (`LIMIT`)
+ * - 升序 / 降序排列
+ *
+ * @param name 表名（不区分大小写，内部统一转换为小写）
+ * @param whereCol 条件列名（可选，若为空则不使用筛选条件）
+ * @param whereVal 条件值（与 whereCol 搭配使用，仅返回该列值等于 whereVal 的行）
+ * @param orderBy 排序列名（可选，若为空则不排序）
+ * @param desc 是否降序排列（true 表示降序，false 表示升序，默认升序）
+ * @param limit 限制返回的最大行数（默认 -1 表示不限制）
+ *
+ * @note
+ * - 若表不存在，会输出 `"Table not found."`
+ * - 若条件列名或排序列名不存在，会输出 `"Column not found."`
+ * - 返回结果直接打印到 `dbOut()`，不存储在函数返回值中
+ * - 排序时，比较是基于字符串字典序完成的，而非数值大小；DATE/TIMESTAMP 列按时间先后比较
+ * - 分区表只扫描可能包含满足条件的行的分区，多个分区在多个线程中并行过滤，
+ *   结果按分区顺序合并后再排序，与逐个分区扫描的结果相同
+ * - 等值条件的列有 PRIMARY KEY / UNIQUE 约束时，由代价模型选择探测该列的唯一索引（按键的点查询）
+ * - name 是物化视图时按键升序输出其分组，只读取分组而不扫描基表；只支持键上的等值条件与 LIMIT
+ *
+ * @example
+ * @code
+ * sqlDB db;
+ * // 查询所有数据
+ * db.selectAll("users");
+ *
+ * // 查询 age=30 的用户，并按 name 升序排列，最多返回 10 行
+ * db.selectAll("users", "age", "30", "name", false, 10);
+ *
+ * // 查询并按 salary 降序排列
+ * db.selectAll("employees", "", "", "salary", true);
+ * @endcode
+ */
+void sqlDB::selectAll(const std::string &name,
+                      const std::string &whereCol,
+                      const std::string &whereVal,
+                      const std::string &orderBy,
+                      bool desc,
+                      int limit)
+{
+    selectWhere(name, whereCol, whereVal, nullptr, nullptr, orderBy, desc, limit);
+}
+
+/**
+ * @brief 按区间条件查询，其余与 selectAll() 相同
+ *
+ * DATE/TIMESTAMP 列的边界只解析一次，与每行的原生整数比较；INT/FLOAT/DOUBLE 列按数值比较，
+ * 其余列按字典序比较。值为 NULL 的行不会返回。
+ *
+ * @example
+ * @code
+ * // 2024 年 1 月的订单：created >= '2024-01-01' AND created < '2024-02-01'
+ * db.selectRange("orders", "created", {"2024-01-01", "2024-02-01", true, false}, "created");
+ * @endcode
+ */
+void sqlDB::selectRange(const std::string &name, const std::string &col, const ValueRange &range,
+                        const std::string &orderBy, bool desc, int limit)
+{
+    selectWhere(name, col, "", &range, nullptr, orderBy, desc, limit);
+}
+
+/**
+ * @brief 按 LIKE 条件查询，其余与 selectAll() 相同
+ *
+ * % 匹配任意个字符，_ 匹配一个字节，不区分大小写；值为 NULL 的行不会返回。
+ * 列上有 LIKE 索引（CREATE INDEX）时先由索引得到候选行：有序索引服务有字面前缀的模式（'abc%'），
+ * 三元组索引服务含有不短于 3 字节字面片段的模式（'%abc%'）；否则全表扫描，逐行做子串查找。
+ *
+ * @example
+ * @code
+ * // 名字以 al 开头的用户
+ * db.selectLike("users", "name", "al%");
+ * @endcode
+ */
+void sqlDB::selectLike(const std::string &name, const std::string &col, const std::string &pattern,
+                       const std::string &orderBy, bool desc, int limit)
+{
+    LikePattern like(pattern);
+    selectWhere(name, col, pattern, nullptr, &like, orderBy, desc, limit);
+}
+
+void sqlDB::selectWhere(const std::string &name, const std::string &whereCol, const std::string &whereVal,
+                        const ValueRange *range, const LikePattern *like, const std::string &orderBy,
+                        bool desc, int limit)
+{
+    StatementScope stmt(*this, StatementKind::SELECT);
+    TRACE_SPAN("sqlDB::selectAll");
+    std::string lname = name;
+    std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
+    ReadTable entry(findTable(lname));
+    if (!entry)
+    {
+        std::shared_ptr<TableEntry> base;
+        if (std::shared_ptr<AggregateView> view = findView(lname, &base))
+        {
+            stmt.table = base;
+            stmt.accessPath = accessPathName(AccessPath::VIEW_READ);
+            stmt.rowsScanned = selectView(*view, whereCol, whereVal, range || like, orderBy, desc, limit);
+            stmt.rowsReturned = stmt.rowsScanned;
+            return;
+        }
+        dbErr() << "Table not found: " << lname << "\n";
+        return;
+    }
+    stmt.table = entry.get();
+
+    // 不在事务中时，表没有新的提交就直接返回上次的结果（事务能看到自己未提交的修改，不使用缓存）
+    CachedRead cached(results, stmt, *entry.get(),
+                      activeTxn() ? ""
+                                  : cacheKey(like ? "LIKE" : range ? "RANGE" : "SELECT", lname, whereCol, whereVal,
+                                             range ? range->low : "", range ? range->high : "",
+                                             range && range->lowInclusive ? "[" : "(",
+                                             range && range->highInclusive ? "]" : ")", orderBy, desc ? "DESC" : "ASC",
+                                             std::to_string(limit)));
+    if (cached.hit())
+        return;
+
+    const Table &t = entry->table;
+
+    // 打印列名
+    for (const auto &col : t.columns)
+        dbOut() << col.name << "\t";
+    dbOut() << "\n";
+
+    // WHERE 条件处理
+    int colIdx = -1;
+    std::optional<ColumnFilter> filter;
+    if (!whereCol.empty())
+    {
+        colIdx = t.getColumnIndex(whereCol);
+        if (colIdx == -1)
+        {
+            dbErr() << "Column not found in WHERE: " << whereCol << "\n";
+            return;
+        }
+        if (like)
+            filter.emplace(t, colIdx, *like);
+        else if (range)
+            filter.emplace(t, colIdx, *range);
+        else
+            filter.emplace(t, colIdx, whereVal);
+        if (!filter->valid())
+        {
+            dbErr() << filter->error() << "\n";
+            return;
+        }
+    }
+
+    // ORDER BY 列检查
+    int orderIdx = -1;
+    if (!orderBy.empty())
+    {
+        orderIdx = t.getColumnIndex(orderBy);
+        if (orderIdx == -1)
+        {
+            dbErr() << "Column not found in ORDER BY: " << orderBy << "\n";
+            return;
+        }
+    }
+
+    // 要扫描的表：普通表为它自己；分区表为按 WHERE 裁剪后的各分区，各自共享持有
+    std::vector<ReadTable> partLocks;
+    std::vector<const Table *> sources;
+    if (std::atomic_load(&entry->partitions))
+    {
+        for (const auto &part : partitionsFor(lname, *entry.get(), like ? "" : whereCol, whereVal, range))
+        {
+            partLocks.emplace_back(part.second);
+            if (partLocks.back())
+                sources.push_back(&partLocks.back()->table);
+        }
+    }
+    else
+        sources.push_back(&t);
+    std::vector<ColumnFilter> filters;
+    size_t live = 0;
+    for (const Table *s : sources)
+    {
+        live += s->liveCount();
+        if (colIdx != -1)
+            filters.push_back(like    ? ColumnFilter(*s, colIdx, *like)
+                              : range ? ColumnFilter(*s, colIdx, *range)
+                                      : ColumnFilter(*s, colIdx, whereVal));
+    }
+
+    // 由代价模型选择访问路径并估计结果行数：等值条件列有唯一索引（PRIMARY KEY / UNIQUE）时可以探测索引，
+    // 否则全表扫描；区间与 LIKE 条件按全表估计，LIKE 索引能用于该模式时总是查索引
+    bool keyed = !range && !like && useKeyIndex(t, colIdx, whereVal);
+    ScanPlan plan = chooseAccessPath(entry->stats, live, range || like ? "" : whereCol, whereVal, keyed, keyed);
+    if (like && t.likeIndexed(colIdx, *like))
+        plan.path = AccessPath::INDEX_LOOKUP;
+    bool indexed = plan.path == AccessPath::INDEX_LOOKUP;
+    stmt.accessPath = accessPathName(plan.path);
+    std::atomic<size_t> probed{0};
+
+    // 在语句开始时（事务中为事务开始时）的快照上读取，并发写入的新版本不可见
+    std::shared_ptr<Transaction> txn = activeTxn();
+    Snapshot snap = txn ? txn->snap : txns.snapshot();
+
+    // 结果中的一行：sources 中的下标与该表中的行索引
+    struct RowId
+    {
+        size_t src;
+        size_t row;
+    };
+    auto formatRow = [&](RowId id)
+    {
+        std::string line;
+        const Table &s = *sources[id.src];
+        RowRef row = s.rows[id.row];
+        for (size_t c = 0; c < s.columns.size(); c++)
+        {
+            line += s.cell(row, c);
+            line += '\t';
+        }
+        line += '\n';
+        return line;
+    };
+
+    // 先按 WHERE 过滤得到行索引，排序只作用于满足条件的行。
+    // ORDER BY 时每行按 行索引 + 排序键 计入查询内存预算，超出后改为外部排序：
+    // 已收集的行与之后满足条件的行都交给 ExternalSorter，由它把有序段写到临时文件
+    // DATE/TIMESTAMP 列按原生整数排序，外部排序时使用同序的 8 字节键
+    MemoryReservation mem(memory);
+    std::unique_ptr<ExternalSorter> sorter;
+    std::vector<RowId> rowIndices;
+    bool temporalOrder = orderIdx != -1 && isTemporal(t.columns[orderIdx].type);
+    auto spill = [&](RowId id)
+    {
+        const Table &s = *sources[id.src];
+        RowRef row = s.rows[id.row];
+        if (temporalOrder)
+            sorter->add(temporalSortKey(s, row, orderIdx), formatRow(id));
+        else
+            sorter->add(s.cell(row, orderIdx), formatRow(id));
+    };
+    auto keep = [&](RowId id)
+    {
+        if (orderIdx == -1)
+        {
+            rowIndices.push_back(id);
+            return;
+        }
+        const Table &s = *sources[id.src];
+        size_t keyBytes = temporalOrder ? sizeof(int64_t) : s.cell(s.rows[id.row], orderIdx).size();
+        if (!sorter && mem.grow(sizeof(RowId) + keyBytes))
+        {
+            rowIndices.push_back(id);
+            return;
+        }
+        if (!sorter)
+        {
+            std::vector<RowId> collected;
+            collected.swap(rowIndices);
+            mem.reset();
+            sorter = std::make_unique<ExternalSorter>(mem, desc);
+            for (RowId j : collected)
+                spill(j);
+        }
+        spill(id);
+    };
+    // 过滤一张表：按段先得到可见行的位图，再用列位图排除 NULL（BOOL 等值直接得到结果），
+    // 剩下的行由 ColumnFilter::refine() 按列类型整段筛选；走索引时只检查索引给出的版本。
+    // emit 返回 false 后不再扫描之后的行
+    auto scan = [&](size_t src, auto &&emit)
+    {
+        const Table &s = *sources[src];
+        size_t n = s.rows.size();
+        std::vector<size_t> candidates;
+        bool probe = indexed;
+        if (probe && like)
+            probe = s.likeCandidates(colIdx, *like, candidates);
+        else if (probe)
+            candidates = s.lookupKey(colIdx, whereVal);
+        if (probe)
+        {
+            probed += candidates.size();
+            for (size_t i : candidates)
+                if (i < n && s.visible(i, snap) && filters[src].matches(s.rows[i]) && !emit(i))
+                    return;
+            return;
+        }
+        probed += n;
+        uint64_t mask[ColumnBitmap::kWords];
+        bool more = true;
+        for (size_t base = 0; base < n && more; base += RowStore::kSegmentRows)
+        {
+            size_t seg = base >> RowStore::kSegmentBits;
+            s.visibleBits(seg, n, snap, mask);
+            if (colIdx != -1 && !filters[src].narrow(seg, mask))
+                filters[src].refine(base, mask);
+            forEachSetBit(mask, ColumnBitmap::kWords, base, [&](size_t i)
+                          {
+                              if (more)
+                                  more = emit(i); });
+        }
+    };
+    // 没有 ORDER BY 时 LIMIT 行之后的行不会输出，可以提前结束扫描
+    size_t cap = orderIdx == -1 && limit > 0 ? size_t(limit) : SIZE_MAX;
+    auto phase = std::chrono::steady_clock::now();
+    {
+        TRACE_SPAN("selectAll.filter");
+        if (orderIdx == -1)
+            rowIndices.reserve(std::min(colIdx == -1 ? live : static_cast<size_t>(plan.estimatedRows) + 1, cap));
+        if (sources.size() == 1)
+            scan(0, [&](size_t i)
+                 {
+                     keep({0, i});
+                     return rowIndices.size() < cap; });
+        else if (!sources.empty())
+        {
+            // 各分区在各自的线程中过滤，再按分区顺序交给 keep，结果与逐个分区扫描相同。
+            // 线程数不超过 CPU 核数，空闲的线程领取下一个分区
+            std::vector<std::vector<size_t>> matched(sources.size());
+            std::atomic<size_t> nextPart{0};
+            auto worker = [&]
+            {
+                for (size_t p; (p = nextPart.fetch_add(1)) < sources.size();)
+                {
+                    TRACE_SPAN("selectAll.partition");
+                    scan(p, [&](size_t i)
+                         {
+                             matched[p].push_back(i);
+                             return matched[p].size() < cap; });
+                }
+            };
+            size_t threads = std::min<size_t>(sources.size(), std::max(1u, std::thread::hardware_concurrency()));
+            std::vector<std::thread> pool;
+            for (size_t w = 1; w < threads; w++)
+                pool.emplace_back(worker);
+            worker();
+            for (auto &th : pool)
+                th.join();
+            for (size_t p = 0; p < sources.size(); p++)
+                for (size_t i : matched[p])
+                    keep({p, i});
+        }
+    }
+    stmt.filterNanos = StatementScope::elapsedSince(phase);
+    stmt.rowsScanned = probed;
+
+    int count = 0;
+    if (sorter)
+    {
+        // 归并与输出交织在一起，整体计为排序耗时
+        phase = std::chrono::steady_clock::now();
+        TRACE_SPAN("selectAll.merge");
+        bool merged = sorter->merge([&](const std::string &line)
+                                    {
+                                        dbOut() << line;
+                                        stmt.rowsReturned++;
+                                        return !(limit > 0 && ++count >= limit); });
+        stmt.sortNanos = StatementScope::elapsedSince(phase);
+        if (!merged)
+            dbErr() << "External sort failed: " << sorter->error() << "\n";
+        return;
+    }
+
+    // ORDER BY 处理
+    if (orderIdx != -1)
+    {
+        // 每行的排序键只取一次（内存预算已按键的大小计入）；
+        // 复制出来而不是保留视图，按需分页的表在排序期间段可能被换出
+        phase = std::chrono::steady_clock::now();
+        TRACE_SPAN("selectAll.sort");
+        auto sortKeyed = [&](auto key)
+        {
+            using Key = decltype(key(*sources[0], t.rows[0]));
+            std::vector<std::pair<Key, RowId>> keyed;
+            keyed.reserve(rowIndices.size());
+            for (RowId id : rowIndices)
+                keyed.emplace_back(key(*sources[id.src], sources[id.src]->rows[id.row]), id);
+            // 排序方向在排序前选定一次，比较函数按键的类型与方向实例化
+            auto byKey = [](auto less)
+            {
+                return [less](const std::pair<Key, RowId> &a, const std::pair<Key, RowId> &b)
+                { return less(a.first, b.first); };
+            };
+            if (desc)
+                std::sort(keyed.begin(), keyed.end(), byKey(std::greater<Key>()));
+            else
+                std::sort(keyed.begin(), keyed.end(), byKey(std::less<Key>()));
+            for (size_t k = 0; k < keyed.size(); k++)
+                rowIndices[k] = keyed[k].second;
+        };
+        if (temporalOrder)
+            sortKeyed([&](const Table &s, const RowRef &row)
+                      {
+                          int64_t v;
+                          return s.temporalValue(row, orderIdx, v) ? v : INT64_MIN; });
+        else
+            sortKeyed([&](const Table &s, const RowRef &row)
+                      { return std::string(s.cell(row, orderIdx)); });
+        stmt.sortNanos = StatementScope::elapsedSince(phase);
+    }
+
+    // 遍历并输出
+    TRACE_SPAN("selectAll.output");
+    for (RowId id : rowIndices)
+    {
+        const Table &s = *sources[id.src];
+        RowRef row = s.rows[id.row];
+
+        // 打印行
+        for (size_t c = 0; c < s.columns.size(); c++)
+            dbOut() << s.cell(row, c) << "\t";
+        dbOut() << "\n";
+        stmt.rowsReturned++;
+
+        if (limit > 0 && ++count >= limit)
+            break;
+    }
+}
+
+/**
+ * @brief 更新表中满足条件的行
+ *
+ * 此方法会遍历指定表的所有行，对满足条件的记录，将目标列的值更新为新值。
+ *
+ * @param name 表名（不区分大小写，内部统一转换为小写）
+ * @param targetCol 需要更新的列名
+ * @param newVal 更新后的新值
+ * @param whereCol 条件列名（仅更新该列值等于 whereVal 的行）
+ * @param whereVal 条件值
+ *
+ * @note
+ * - 若表不存在，则直接返回（无提示）
+ * - 若目标列或条件列不存在，则输出 `"Column not found."`
+ * - 目标列为 DATE/TIMESTAMP 而新值无法解析时，输出 `"Invalid DATE value: <值>"`，不做任何修改
+ * - 每个匹配行追加一个新版本并结束旧版本，提交前并发的读者看到的仍是旧值
+ * - 若匹配行已被其他未提交的事务修改，或在本事务的快照之后被修改（写-写冲突），
+ *   输出 `"Write conflict on table <表名>"` 并撤销本语句；在事务中则回滚整个事务
+ * - 自动提交时修改写入重做日志并落盘后才返回
+ * - 若没有行满足条件，则不会有任何更改，但仍会输出 `"Rows updated."`
+ * - 分区表只修改可能包含满足条件的行的分区，各分区的修改在同一次提交中生效；
+ *   更新分区列时新版本写入新值所在的分区，没有这样的分区时输出 `"No partition for value: <值>"`
+ * - 条件列有 PRIMARY KEY / UNIQUE 约束时只探测其唯一索引，不扫描全表
+ * - 目标列有唯一约束时，新值已被其他行占用（或多行被改为同一个值）输出
+ *   `"Duplicate key value for <列名>: <值>"` 并撤销本语句（事务中不影响之前的语句）
+ *
+ * @example
+ * @code
+ * sqlDB db;
+ * // 将 users 表中 age=30 的记录，其 name 更新为 "Alice"
+ * db.update("users", "name", "Alice", "age", "30");
+ * @endcode
+ */
+void sqlDB::update(const std::string &name, const std::string &targetCol, const std::string &newVal,
+                   const std::string &whereCol, const std::string &whereVal)
+{
+    StatementScope stmt(*this, StatementKind::UPDATE);
+    TRACE_SPAN("sqlDB::update");
+    std::string lname = name;
+    std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
+    std::shared_ptr<Transaction> txn = activeTxn();
+    std::shared_ptr<TableEntry> found = findTable(lname);
+    if (!found)
+        return;
+    // 要修改的表：普通表为它自己；分区表为裁剪后的分区，更新分区列时再加上新值所在的分区（只写入不扫描）
+    std::optional<ReadTable> parent;
+    std::vector<WriteTarget> targets;
+    std::string moveTo;
+    if (std::atomic_load(&found->partitions))
+    {
+        parent.emplace(found);
+        if (!*parent)
+            return;
+        std::shared_ptr<const PartitionScheme> scheme = std::atomic_load(&found->partitions);
+        int targetIdx = found->table.getColumnIndex(targetCol);
+        if (targetIdx != -1 && targetIdx == found->table.getColumnIndex(scheme->column))
+        {
+            size_t k = scheme->route(newVal);
+            if (k == PartitionScheme::npos)
+            {
+                dbOut() << "No partition for value: " << newVal << "\n";
+                return;
+            }
+            moveTo = scheme->tableName(lname, k);
+        }
+        for (auto &part : partitionsFor(lname, *found, whereCol, whereVal, nullptr))
+            targets.push_back({part.first, part.second, true});
+        auto dest = std::find_if(targets.begin(), targets.end(), [&](const WriteTarget &w)
+                                 { return w.lname == moveTo; });
+        if (!moveTo.empty() && dest == targets.end())
+            if (std::shared_ptr<TableEntry> e = findTable(moveTo))
+                targets.push_back({moveTo, e, false});
+    }
+    else
+        targets.push_back({lname, found, true});
+    WriteLocks locked(targets);
+    if (!parent && (!locked.table(0) || rejectPartitionWrite(*found, lname)))
+        return;
+    stmt.table = found;
+    const Table &schema = found->table;
+
+    int targetIdx = schema.getColumnIndex(targetCol);
+    int whereIdx = schema.getColumnIndex(whereCol);
+    if (targetIdx == -1 || whereIdx == -1)
+    {
+        dbOut() << "Column not found. \n";
+        return;
+    }
+    if (!checkValue(schema.columns[targetIdx], newVal))
+        return;
+    size_t dest = locked.find(moveTo);
+    bool keyed = schema.columns[targetIdx].constraint != ColumnConstraint::NONE;
+    // 更新 = 结束旧版本 + 追加新版本，旧版本对正在进行的读者仍然可见
+    uint64_t marker = txn ? txn->marker : txns.beginTxn();
+    Snapshot snap = txn ? txn->snap : txns.snapshot(marker);
+    // 先记下各表的行数：移入其他分区的新版本在本语句中可见，不能再被扫描到
+    std::vector<size_t> sizes(targets.size(), 0);
+    for (size_t k = 0; k < targets.size(); k++)
+        if (locked.table(k) && targets[k].scan)
+            sizes[k] = locked.table(k)->rows.size();
+    stmt.accessPath = accessPathName(useKeyIndex(schema, whereIdx, whereVal) ? AccessPath::INDEX_LOOKUP
+                                                                              : AccessPath::FULL_SCAN);
+    enum class Abort
+    {
+        NONE,
+        CONFLICT, // 写-写冲突
+        DUPLICATE // 违反唯一约束（已输出错误）
+    } abort = Abort::NONE;
+    auto phase = std::chrono::steady_clock::now();
+    for (size_t k = 0; k < targets.size() && abort == Abort::NONE; k++)
+    {
+        if (sizes[k] == 0)
+            continue;
+        Table &t = *locked.table(k);
+        forEachMatch(t, whereIdx, whereVal, sizes[k], snap, stmt.rowsScanned, [&](size_t i)
+                     {
+                             RowRef row = t.rows[i];
+                             // 可见却已有 end：被其他事务结束（未提交，或在本快照之后提交）
+                             if (t.rows.endTs(i) != kInfinityTs)
+                             {
+                                 abort = Abort::CONFLICT;
+                                 return false;
+                             }
+                             Row next = t.materialize(row);
+                             next.values[targetIdx] = newVal;
+                             t.rows.setEnd(i, marker);
+                             locked.writes[k].ws.ended.push_back(i);
+                             // 唯一列：已被本语句结束的旧版本不算冲突，但本语句前面写入的新版本算
+                             size_t d = dest == PartitionScheme::npos ? k : dest;
+                             if (keyed && !checkKey(*locked.table(d), targetIdx, newVal, marker))
+                             {
+                                 abort = Abort::DUPLICATE;
+                                 return false;
+                             }
+                             locked.writes[d].ws.inserted.push_back(locked.table(d)->appendRow(std::move(next), marker));
+                             return true; });
+    }
+    if (abort != Abort::NONE)
+    {
+        locked.rollback();
+        if (abort == Abort::CONFLICT)
+        {
+            locked.unlock();
+            parent.reset();
+            abortWrite(lname, txn.get());
+        }
+        return;
+    }
+    stmt.filterNanos = StatementScope::elapsedSince(phase);
+    for (const auto &w : locked.writes)
+        stmt.rowsWritten += w.ws.ended.size();
+    uint64_t lsn = finishWrite(locked.writes, txn.get());
+    locked.unlock();
+    parent.reset();
+    if (!awaitDurable(lsn))
+        return;
+    dbOut() << "Rows updated. \n";
+}
+
+/**
+ * @brief 删除表中满足条件的行
+ *
+ * 此方法会遍历指定表的所有行，并删除满足条件的记录：
+ * - 条件列名为 @p whereCol
+ * - 条件值为 @p whereVal
+ *
+ * @param name 表名（不区分大小写，内部统一转换为小写）
+ * @param whereCol 条件列名
+ * @param whereVal 条件值（仅删除该列值等于 whereVal 的行）
+ *
+ * @note
+ * - 若表不存在，则直接返回（无提示）
+ * - 若条件列不存在，则输出 `"Column not found."`
+ * - 满足条件的行只设置版本的 end 时间戳（墓碑），不移动其他行，
+ *   提交前开始的读者仍能看到它们；删除以日志记录追加到重做日志，不重写整个表文件
+ * - 写-写冲突的处理与 update() 相同
+ * - 分区表只访问可能包含满足条件的行的分区；删除整个分区用 dropPartition()
+ * - 条件列有 PRIMARY KEY / UNIQUE 约束时只探测其唯一索引，不扫描全表
+ * - 已删除行比例达到 setCompactionRatio() 设置的阈值时，
+ *   交给后台压缩线程物理移除并重写表文件
+ *
+ * @example
+ * @code
+ * sqlDB db;
+ * // 删除 users 表中 age=30 的所有记录
+ * db.deleteRows("users", "age", "30");
+ * @endcode
+ */
+
+void sqlDB::deleteRows(const std::string &name, const std::string &whereCol, const std::string &whereVal)
 {
+    StatementScope stmt(*this, StatementKind::DELETE);
+    TRACE_SPAN("sqlDB::deleteRows");
     std::string lname = name;
     std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
-    if (tables.count(lname))
+    std::shared_ptr<Transaction> txn = activeTxn();
+    std::shared_ptr<TableEntry> found = findTable(lname);
+    if (!found)
+        return;
+    std::optional<ReadTable> parent;
+    std::vector<WriteTarget> targets;
+    if (std::atomic_load(&found->partitions))
+    {
+        parent.emplace(found);
+        if (!*parent)
+            return;
+        for (auto &part : partitionsFor(lname, *found, whereCol, whereVal, nullptr))
+            targets.push_back({part.first, part.second, true});
+    }
+    else
+        targets.push_back({lname, found, true});
+    WriteLocks locked(targets);
+    if (!parent && (!locked.table(0) || rejectPartitionWrite(*found, lname)))
+        return;
+    stmt.table = found;
+
+    int whereIdx = found->table.getColumnIndex(whereCol);
+    if (whereIdx == -1)
+    {
+        dbOut() << "Column not found. \n";
+        return;
+    }
+    uint64_t marker = txn ? txn->marker : txns.beginTxn();
+    Snapshot snap = txn ? txn->snap : txns.snapshot(marker);
+    stmt.accessPath = accessPathName(useKeyIndex(found->table, whereIdx, whereVal) ? AccessPath::INDEX_LOOKUP
+                                                                                    : AccessPath::FULL_SCAN);
+    bool conflict = false;
+    auto phase = std::chrono::steady_clock::now();
+    for (size_t k = 0; k < targets.size() && !conflict; k++)
+    {
+        Table *t = locked.table(k);
+        if (!t)
+            continue;
+        forEachMatch(*t, whereIdx, whereVal, t->rows.size(), snap, stmt.rowsScanned, [&](size_t i)
+                     {
+                             if (t->rows.endTs(i) != kInfinityTs)
+                             {
+                                 conflict = true;
+                                 return false;
+                             }
+                             t->rows.setEnd(i, marker);
+                             locked.writes[k].ws.ended.push_back(i);
+                             return true; });
+        stmt.rowsWritten += locked.writes[k].ws.ended.size();
+    }
+    if (conflict)
     {
-        std::cout << "Table already exists. \n";
+        locked.rollback();
+        locked.unlock();
+        parent.reset();
+        abortWrite(lname, txn.get());
         return;
     }
-    Table t;
-    t.columns = cols;
-    tables[lname] = t;
-    tables[lname].saveToFile(lname);
-    std::cout << "Table created with type. \n";
+    stmt.filterNanos = StatementScope::elapsedSince(phase);
+    uint64_t lsn = finishWrite(locked.writes, txn.get());
+    locked.unlock();
+    parent.reset();
+    if (!awaitDurable(lsn))
+        return;
+    dbOut() << "Rows deleted. \n";
 }
 
 /**
- * @brief 向指定表插入一行数据
+ * @brief 保存数据库中有修改的表到文件（检查点）
  *
- * 此方法会根据给定的表名、列和值，将新行插入到表中。
- * - 如果未指定列名 (cols 为空)，则要求 values 的数量与表列数完全一致。
- * - 如果指定了列名，则只更新这些列，未指定的列默认填充为 "NULL"。
- * - 插入完成后会调用 Table::saveToFile() 将表数据持久化。
+ * 此方法会遍历当前数据库中的所有表，跳过自上次检查点以来没有提交过修改的表，
+ * 其余的表按一个快照生成文件内容并写入 `<表名>.table`，
+ * 表头记录快照的提交时间戳；随后重写重做日志，去掉已包含在表文件中的记录。
+ * 后台检查点线程定期调用本方法，退出前也应调用一次以缩短下次启动的重放。
  *
- * @param name 表名（不区分大小写，内部统一转换为小写）
- * @param values 插入的值列表，对应列的数据
- * @param cols 指定插入的列名（可选）。如果为空，则按照表列顺序插入。
+ * @note
+ * - 生成内容时只共享持有表锁，写盘与 fsync 时不持有，增删改查不会等待检查点。
+ * - 每张表的快照各自独立，恢复时每张表只重放其快照之后的日志，因此跨表的事务仍然完整。
+ * - 本方法不会返回成功/失败状态。
+ * - 未提交事务的修改不会写入表文件，它们提交时写入检查点之后的日志。
+ * - 有修改的物化视图在所有表文件之后写入 `<基表>.views`，记下分组已包含的最后一个提交时间戳。
+ *
+ * @example
+ * @code
+ * sqlDB db;
+ * // 创建并插入数据 ...
+ * db.saveAll(); // 将所有表写入文件
+ * @endcode
+ */
+void sqlDB::saveAll()
+{
+    StatementScope stmt(*this, StatementKind::CHECKPOINT);
+    TRACE_SPAN("sqlDB::saveAll");
+    std::lock_guard<std::mutex> guard(checkpointMutex);
+    std::shared_ptr<const Catalog> snapshot = std::atomic_load(&tables);
+    for (auto it = snapshot->begin(); it != snapshot->end(); ++it)
+    {
+        if (it->second->dirtyBytes.load() == 0)
+            continue;
+        uint64_t ts;
+        std::string content, tmp;
+        TableFileIndex index;
+        bool paged;
+        {
+            ReadTable entry(it->second);
+            if (!entry)
+                continue;
+            // 先清零再取快照：此后提交的修改会重新标脏，不会被漏掉
+            dirtyBytes -= entry->dirtyBytes.exchange(0);
+            Snapshot snap = txns.snapshot();
+            ts = snap.ts;
+            // 按需分页的表可能远大于内存，持有共享锁直接写临时文件
+            paged = entry->table.pageCache != nullptr;
+            if (paged)
+                timedPersist([&]
+                             { tmp = entry->table.writeTempFile(it->first, ts, snap, index); });
+            else
+                content = entry->table.serialize(ts, snap);
+        }
+        // 写盘和 fsync 时不持有表锁
+        if (!paged)
+            timedPersist([&]
+                         { tmp = Table::writeTempFile(it->first, content); });
+        noteBytesWritten(paged ? index.fileSize : content.size());
+        {
+            ReadTable entry(it->second);
+            if (!entry)
+            {
+                // 期间表被删除，不能让文件复活
+                std::remove(tmp.c_str());
+                continue;
+            }
+            timedPersist([&]
+                         { Table::installFile(it->first, tmp, paged ? &index : nullptr); });
+            entry->table.checkpointTs = ts;
+        }
+        if (paged)
+            remapTable(*it->second, it->first, index, ts);
+    }
+    // 物化视图在表文件之后保存：此前的提交都已包含在分组中，加载时据此判断分组是否仍然有效
+    uint64_t now = txns.snapshot().ts;
+    for (const auto &kv : *snapshot)
+    {
+        std::shared_ptr<const ViewList> views = std::atomic_load(&kv.second->views);
+        if (!views || std::none_of(views->begin(), views->end(), [](const auto &v)
+                                   { return v->dirty(); }))
+            continue;
+        ReadTable entry(kv.second);
+        if (entry)
+            saveViews(kv.first, *entry.get(), now);
+    }
+    // 已写入表文件的记录不再需要；不在目录中的表只要表文件还在就保留（可能尚未加载）
+    std::unordered_map<std::string, uint64_t> saved;
+    for (const auto &kv : *snapshot)
+        saved[kv.first] = kv.second->table.checkpointTs;
+    std::unordered_map<std::string, bool> onDisk;
+    auto keep = [&](const LogRecord &r)
+    {
+        auto it = saved.find(r.table);
+        if (it != saved.end())
+            return r.ts > it->second;
+        auto disk = onDisk.find(r.table);
+        if (disk == onDisk.end())
+            disk = onDisk.emplace(r.table, std::filesystem::exists(getDbPath(r.table))).first;
+        return disk->second;
+    };
+    timedPersist([&]
+                 { wal.rewrite(keep); });
+}
+
+/**
+ * @brief 从文件加载多个表到数据库
+ *
+ * 此方法会遍历给定的表名列表，逐个尝试从文件中加载表数据：
+ * - 表名会统一转换为小写存储
+ * - 每个表会调用 `Table::loadFromFile()` 读取持久化的数据；
+ *   设置了页缓存（setPageCacheSize）时改为 `Table::openPaged()`，只读取表头与分段索引，行在访问时才载入
+ * - 若加载的表包含有效列（`columns` 非空），则会被加入数据库，替换同名的已有表
+ * - 若存在 `<表名>.stats`，同时加载 ANALYZE 得到的统计信息
+ * - 若存在 `<表名>.parts`（分区表），其各分区即使不在列表中也一并加载
+ * - 若存在 `<表名>.views`，加载其中的物化视图；保存之后基表又有提交（表文件或重放的日志更新）时重新计算分组
+ * - 重放重做日志中该表在表文件之后提交的修改，恢复到崩溃或退出前的状态
+ *
+ * @param tableNames 需要加载的表名列表
  *
  * @note
- * - 若表不存在，会输出 "Table not found."
- * - 若列数与值数不匹配，会输出 "Column count mismatch."
- * - 若给定的列名在表中不存在，会输出 "Column not found: <列名>"
+ * - 文件名的解析与加载逻辑依赖于 `Table::loadFromFile()` 的实现，
+ *   通常与表名绑定。
+ * - 若某个表文件不存在或内容为空（即 `columns` 为空），则不会加入数据库。
+ * - 成功加载的表会输出 `"Loaded table: <表名>"`。
  *
  * @example
  * @code
  * sqlDB db;
- * std::vector<std::string> cols = {"id", "name"};
- * std::vector<std::string> vals = {"1", "Alice"};
- * db.insertInto("users", vals, cols);
+ * std::vector<std::string> names = {"users", "orders"};
+ * db.loadAll(names);  // 从文件加载 users 和 orders 表
  * @endcode
  */
-void sqlDB::insertInto(std::string &name, const std::vector<std::string> &values, const std::vector<std::string> &cols)
+
+void sqlDB::loadAll(const std::vector<std::string> &tableNames)
 {
-    std::string lname = name;
-    std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
-    if (!tables.count(lname))
+    std::lock_guard<std::mutex> lock(catalogMutex);
+    auto next = std::make_shared<Catalog>(*std::atomic_load(&tables));
+    std::vector<LogRecord> records = wal.readAll();
+    // 分区表的各分区随分区表一起加载
+    std::vector<std::string> names;
+    std::unordered_set<std::string> seen;
+    std::map<std::string, PartitionScheme> schemes;
+    for (const auto &name : tableNames)
     {
-        std::cout << "Table not found.\n";
-        return;
+        std::string lname = name;
+        std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
+        if (seen.insert(lname).second)
+            names.push_back(lname);
+        PartitionScheme scheme;
+        if (!scheme.loadFromFile(getDbPath(lname, ".parts")))
+            continue;
+        for (size_t k = 0; k < scheme.parts.size(); k++)
+            if (seen.insert(scheme.tableName(lname, k)).second)
+                names.push_back(scheme.tableName(lname, k));
+        schemes[lname] = std::move(scheme);
     }
-    Table &t = tables[lname];
-    Row r;
-    r.values.resize(t.columns.size(), "NULL");
-    if (cols.empty())
+    std::unordered_set<std::string> loaded;
+    std::unordered_map<std::string, uint64_t> lastCommit; ///< 各表加载后包含的最后一个提交时间戳（上界）
+    for (const auto &lname : names)
     {
-        if (t.columns.size() != values.size())
+        auto entry = std::make_shared<TableEntry>();
+        if (pages.capacity() > 0)
+            entry->table.openPaged(lname, pages);
+        else
+            entry->table.loadFromFile(lname);
+        if (!entry->table.columns.empty())
         {
-            std::cout << "Column count mismatch.\n";
-            return;
+            txns.advanceTo(entry->table.checkpointTs);
+            uint64_t replayed = replayLog(lname, entry->table, records);
+            if (replayed)
+                markDirty(*entry, replayed);
+            uint64_t &last = lastCommit[lname] = entry->table.checkpointTs;
+            for (const auto &r : records)
+                if (r.table == lname)
+                    last = std::max(last, r.ts);
+            entry->stats.loadFromFile(lname);
+            auto old = next->find(lname);
+            if (old != next->end())
+            {
+                std::unique_lock<std::shared_mutex> oldLock(old->second->latch);
+                old->second->dropped = true;
+                dirtyBytes -= old->second->dirtyBytes.exchange(0);
+            }
+            touch(*entry);
+            (*next)[lname] = entry;
+            loaded.insert(lname);
+            dbOut() << "Loaded table: " << lname << "\n";
         }
-        r.values = values; // copy values to row
     }
-    else
+    // 分区定义中的列类型取自表结构；新加载的分区记下所属的分区表
+    for (auto &kv : schemes)
     {
-        if (cols.size() != values.size())
+        if (!loaded.count(kv.first))
+            continue;
+        auto it = next->find(kv.first);
+        PartitionScheme &scheme = kv.second;
+        int col = it->second->table.getColumnIndex(scheme.column);
+        std::string error = "Column not found: " + scheme.column;
+        if (col != -1)
+            scheme.type = it->second->table.columns[col].type;
+        if (col == -1 || !scheme.build(error))
         {
-            std::cout << "Column count mismatch.\n";
-            return;
+            dbErr() << "Invalid partitions of table " << kv.first << ": " << error << "\n";
+            continue;
         }
-        for (size_t i = 0; i < cols.size(); i++)
+        for (size_t k = 0; k < scheme.parts.size(); k++)
+            if (loaded.count(scheme.tableName(kv.first, k)))
+                (*next)[scheme.tableName(kv.first, k)]->partitionOf = kv.first;
+        it->second->partitions = std::make_shared<const PartitionScheme>(std::move(scheme));
+    }
+    // 物化视图：保存的分组包含了各表（分区）此后加载的全部提交时直接使用，否则按加载后的行重新计算
+    for (const auto &lname : loaded)
+    {
+        std::ifstream in(getDbPath(lname, ".views"), std::ios::binary);
+        if (!in)
+            continue;
+        std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        TableEntry &entry = *(*next)[lname];
+        std::vector<const Table *> sources{&entry.table};
+        uint64_t last = lastCommit[lname];
+        if (std::shared_ptr<const PartitionScheme> scheme = entry.partitions)
         {
-            int idx = t.getColumnIndex(cols[i]);
-            if (idx == -1)
+            sources.clear();
+            for (size_t k = 0; k < scheme->parts.size(); k++)
+                if (loaded.count(scheme->tableName(lname, k)))
+                {
+                    sources.push_back(&(*next)[scheme->tableName(lname, k)]->table);
+                    last = std::max(last, lastCommit[scheme->tableName(lname, k)]);
+                }
+        }
+        auto views = std::make_shared<ViewList>();
+        size_t pos = 0;
+        uint64_t ts;
+        while (std::shared_ptr<AggregateView> view = AggregateView::parse(text, pos, ts))
+        {
+            std::string error;
+            if (!view->bind(entry.table, error))
             {
-                std::cout << "Column not found:; " << cols[i] << std::endl;
-                return;
+                dbErr() << "Invalid materialized view " << view->name() << ": " << error << "\n";
+                continue;
             }
-            r.values[idx] = values[i];
+            if (ts < last)
+                view->rebuild(sources, Snapshot::latest(), last);
+            views->push_back(std::move(view));
         }
-        // 未指定的列保持默认值 "NULL"
+        entry.views = std::move(views);
     }
-    t.rows.push_back(r);
-    t.saveToFile(lname);
-    std::cout << "Row inserted. " << std::endl;
+    std::atomic_store(&tables, std::shared_ptr<const Catalog>(std::move(next)));
 }
 
 /**
- * @brief 查询表中的数据并输出到标准输出
+ * @brief 删除指定的表
  *
- * 此方法实现了一个简易版的 SQL `SELECT` 功能，支持：
- * - 按条件筛选 (`WHERE`)
- * - 排序 (`ORDER BY`)
- * - 限制返回行数 (`LIMIT`)
- * - 升序 / 降序排列
+ * 此方法会执行以下操作：
+ * - 从表目录中移除指定表（复制目录快照后替换）
+ * - 删除磁盘上对应的表文件（通过 `getDbPath(name)` 获取路径，再调用 `std::remove` 删除）
  *
  * @param name 表名（不区分大小写，内部统一转换为小写）
- * @param whereCol 条件列名（可选，若为空则不使用筛选条件）
- * @param whereVal 条件值（与 whereCol 搭配使用，仅返回该列值等于 whereVal 的行）
- * @param orderBy 排序列名（可选，若为空则不排序）
- * @param desc 是否降序排列（true 表示降序，false 表示升序，默认升序）
- * @param limit 限制返回的最大行数（默认 -1 表示不限制）
  *
  * @note
- * - 若表不存在，会输出 `"Table not found."`
- * - 若条件列名或排序列名不存在，会输出 `"Column not found."`
- * - 返回结果直接打印到 `std::cout`，不存储在函数返回值中
- * - 排序时，比较是基于字符串字典序完成的，而非数值大小
+ * - 若表存在于内存，则会从 `tables` 目录中移除；正在使用该表的操作完成后才会移除
+ * - 分区表的各分区一并删除；分区本身只能通过 dropPartition() 删除
+ * - 表上有物化视图时不删除，输出 `"Table <表名> has materialized view <视图名>, drop it first."`
+ * - 若对应的文件存在，删除成功后会输出 `"Table dropped and file deleted: <表名>"`
+ * - 若文件不存在或删除失败，会输出 `"Table dropped (file not found or cannot delete): <表名>"`
+ * - 使用 `std::remove` 删除文件，跨平台兼容
  *
  * @example
  * @code
  * sqlDB db;
- * // 查询所有数据
- * db.selectAll("users");
- *
- * // 查询 age=30 的用户，并按 name 升序排列，最多返回 10 行
- * db.selectAll("users", "age", "30", "name", false, 10);
- *
- * // 查询并按 salary 降序排列
- * db.selectAll("employees", "", "", "salary", true);
+ * db.dropTable("users");  // 删除名为 users 的表及其文件
  * @endcode
  */
-void sqlDB::selectAll(const std::string &name,
-                      const std::string &whereCol,
-                      const std::string &whereVal,
-                      const std::string &orderBy,
-                      bool desc,
-                      int limit)
+void sqlDB::dropTable(const std::string &name)
 {
+    StatementScope stmt(*this, StatementKind::DDL);
     std::string lname = name;
     std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
-
-    if (!tables.count(lname))
-    {
-        std::cerr << "Table not found: " << lname << "\n";
-        return;
-    }
-
-    Table &t = tables[lname];
-
-    // 打印列名
-    for (const auto &col : t.columns)
-        std::cout << col.name << "\t";
-    std::cout << "\n";
-
-    // WHERE 条件处理
-    int colIdx = -1;
-    if (!whereCol.empty())
+    std::lock_guard<std::mutex> lock(catalogMutex);
+    if (std::shared_ptr<TableEntry> found = findTable(lname))
     {
-        colIdx = t.getColumnIndex(whereCol);
-        if (colIdx == -1)
+        if (!found->partitionOf.empty())
         {
-            std::cerr << "Column not found in WHERE: " << whereCol << "\n";
+            dbOut() << "Table " << lname << " is a partition of " << found->partitionOf
+                    << ", use ALTER TABLE " << found->partitionOf << " DROP PARTITION.\n";
             return;
         }
-    }
-
-    // 初始化行索引
-    std::vector<std::size_t> rowIndices(t.rows.size());
-    std::iota(rowIndices.begin(), rowIndices.end(), 0);
-
-    // ORDER BY 处理
-    int orderIdx = -1;
-    if (!orderBy.empty())
-    {
-        orderIdx = t.getColumnIndex(orderBy);
-        if (orderIdx == -1)
+        std::shared_ptr<const ViewList> views = std::atomic_load(&found->views);
+        if (views && !views->empty())
         {
-            std::cerr << "Column not found in ORDER BY: " << orderBy << "\n";
+            dbOut() << "Table " << lname << " has materialized view " << views->front()->name()
+                    << ", drop it first.\n";
             return;
         }
-
-        // 排序，只在 orderIdx 有效时进行
-        std::sort(rowIndices.begin(), rowIndices.end(),
-                  [&](size_t a, size_t b)
-                  {
-                      // 安全检查，防止越界
-                      if (orderIdx >= (int)t.rows[a].values.size() ||
-                          orderIdx >= (int)t.rows[b].values.size())
-                      {
-                          return false; // 保持顺序
-                      }
-
-                      if (desc)
-                          return t.rows[a].values[orderIdx] > t.rows[b].values[orderIdx];
-                      else
-                          return t.rows[a].values[orderIdx] < t.rows[b].values[orderIdx];
-                  });
+        // 分区表连同各分区一起删除
+        if (std::shared_ptr<const PartitionScheme> scheme = std::atomic_load(&found->partitions))
+            for (size_t k = 0; k < scheme->parts.size(); k++)
+                removeTable(scheme->tableName(lname, k));
+    }
+    if (removeTable(lname))
+    {
+        dbOut() << "Table dropped and file deleted: " << lname << "\n";
+    }
+    else
+    {
+        dbOut() << "Table dropped (file not found or cannot delete): " << lname << "\n";
     }
+}
 
-    // 遍历并输出
-    int count = 0;
-    for (size_t i : rowIndices)
+/**
+ * @brief 向指定表中添加新列
+ *
+ * 此方法会在目标表中追加一个新列，新列的定义（含默认值）由参数 @p col 指定。
+ * 只修改表的 schema 元数据，不改写已有行：旧行通过 schema 版本映射读取新列时得到默认值。
+ *
+ * @param tableName 表名（不区分大小写，内部统一转换为小写）
+ * @param col 新增的列定义（包含列名和数据类型）
+ *
+ * @note
+ * - 若表不存在，会输出 `"Table not found."` 并返回
+ * - 新列会被追加到表的最后一列
+ * - 分区表的各分区同样增加该列；分区本身不能单独增删列
+ * - 若同名列已存在，会输出 `"Column already exists: <列名>"`
+ * - 新列不能带 PRIMARY KEY / UNIQUE 约束
+ * - 已有行在新列上读到 `col.defaultValue`（未设置时为 `"NULL"`）
+ * - 变更作为一次提交写入重做日志，不重写表文件；旧行在后台压缩时才被重写
+ * - 不受事务控制：在事务中执行也立即生效
+ * - 成功执行后，会输出 `"Column added: <列名>"`
+ *
+ * @example
+ * @code
+ * sqlDB db;
+ * Column c{"email", DataType::TEXT, "unknown"};
+ * db.addColumn("users", c);
+ * // users 表中会新增 email 列，已有行对应的值初始化为空
+ * @endcode
+ */
+void sqlDB::addColumn(const std::string &tableName, const Column &col)
+{
+    StatementScope stmt(*this, StatementKind::DDL);
+    std::string lname = tableName;
+    std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
+    DdlTable entry(findTable(lname));
+    if (!entry)
+    {
+        dbOut() << "Table not found.\n";
+        return;
+    }
+    if (rejectPartitionWrite(*entry.get(), lname))
+        return;
+    stmt.table = entry.get();
+    Table &t = entry->table;
+    if (t.getColumnIndex(col.name) != -1)
     {
-        const auto &row = t.rows[i];
+        dbOut() << "Column already exists: " << col.name << "\n";
+        return;
+    }
+    // 已有的行都取默认值，新列上的唯一约束无法成立
+    if (col.constraint != ColumnConstraint::NONE)
+    {
+        dbOut() << "Cannot add a PRIMARY KEY or UNIQUE column: " << col.name << "\n";
+        return;
+    }
+    t.addColumn(col);
+    std::string change = "ADD " + col.name + " " + typeToString(col.type);
+    if (col.textIndex & TextIndex::kSorted)
+        change += " INDEX";
+    if (col.textIndex & TextIndex::kTrigram)
+        change += " TRIGRAM";
+    if (col.defaultValue != "NULL")
+        change += " DEFAULT " + col.defaultValue;
+    uint64_t lsn = logSchemaChange(lname, *entry.get(), change);
+    scheduleCompaction(lname, t);
+    lsn = std::max(lsn, alterPartitions(lname, *entry.get(), [&](Table &part)
+                                        {
+                                            part.addColumn(col);
+                                            return change; }));
+    entry.unlock();
+    if (!awaitDurable(lsn))
+        return;
+    dbOut() << "Column added: " << col.name << "\n";
+}
 
-        // WHERE 条件检查
-        if (colIdx != -1)
-        {
-            if (colIdx >= (int)row.values.size())
+/**
+ * @brief 从指定表中删除一个列
+ *
+ * 此方法会在目标表中移除指定的列。只修改表的 schema 元数据，
+ * 已有行中该列的值在后台压缩时才被真正移除。
+ *
+ * @param tableName 表名（不区分大小写，内部统一转换为小写）
+ * @param colName   需要删除的列名
+ *
+ * @note
+ * - 若表不存在，会输出 `"Table not found."` 并返回
+ * - 若列不存在，会输出 `"Column not found."` 并返回
+ * - 变更作为一次提交写入重做日志，不重写表文件
+ * - 分区表的各分区同样删除该列；分区列不能删除，会输出 `"Cannot drop partition column: <列名>"`
+ * - 物化视图用到的列不能删除，会输出 `"Column <列名> is used by materialized view <视图名>"`
+ * - 成功执行后，会输出 `"Column dropped: <列名>"`
+ *
+ * @example
+ * @code
+ * sqlDB db;
+ * // 删除 users 表中的 email 列
+ * db.dropColumn("users", "email");
+ * @endcode
+ */
+void sqlDB::dropColumn(const std::string &tableName, const std::string &colName)
+{
+    StatementScope stmt(*this, StatementKind::DDL);
+    std::string lname = tableName;
+    std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
+    DdlTable entry(findTable(lname));
+    if (!entry)
+    {
+        dbOut() << "Table not found.\n";
+        return;
+    }
+    if (rejectPartitionWrite(*entry.get(), lname))
+        return;
+    stmt.table = entry.get();
+    Table &t = entry->table;
+    int idx = t.getColumnIndex(colName);
+    if (idx == -1)
+    {
+        dbOut() << "Column not found.\n";
+        return;
+    }
+    std::shared_ptr<const PartitionScheme> scheme = std::atomic_load(&entry->partitions);
+    if (scheme && idx == t.getColumnIndex(scheme->column))
+    {
+        dbOut() << "Cannot drop partition column: " << t.columns[idx].name << "\n";
+        return;
+    }
+    if (std::shared_ptr<const ViewList> views = std::atomic_load(&entry->views))
+        for (const auto &v : *views)
+            if (v->uses(t.columns[idx].name))
             {
-                std::cerr << "Row missing column for WHERE check.\n";
-                continue;
+                dbOut() << "Column " << t.columns[idx].name << " is used by materialized view " << v->name() << "\n";
+                return;
             }
-
-            if (trim(row.values[colIdx]) != trim(whereVal))
-                continue;
-        }
-
-        // 打印行
-        for (const auto &val : row.values)
-            std::cout << val << "\t";
-        std::cout << "\n";
-
-        if (limit > 0 && ++count >= limit)
-            break;
-    }
+    std::string change = "DROP " + t.columns[idx].name;
+    uint64_t lsn = logSchemaChange(lname, *entry.get(), change);
+    t.dropColumn(idx);
+    scheduleCompaction(lname, t);
+    lsn = std::max(lsn, alterPartitions(lname, *entry.get(), [&](Table &part)
+                                        {
+                                            part.dropColumn(idx);
+                                            return change; }));
+    entry.unlock();
+    if (!awaitDurable(lsn))
+        return;
+    dbOut() << "Column dropped: " << colName << "\n";
 }
 
 /**
- * @brief 更新表中满足条件的行
+ * @brief 在文本列上建立 LIKE 索引
  *
- * 此方法会遍历指定表的所有行，对满足条件的记录，将目标列的值更新为新值。
+ * 有序索引服务有字面前缀的模式（'abc%'），三元组索引服务含有不短于 3 字节字面片段的模式（'%abc%'），
+ * 后者占用的内存约为列数据的数倍，需显式要求。同一列可以同时有两种索引，查询时优先使用有序索引。
+ * 索引只保存在内存中：变更作为一条增删列记录写入重做日志，表文件的列定义记录索引种类，
+ * 加载时重建。
  *
- * @param name 表名（不区分大小写，内部统一转换为小写）
- * @param targetCol 需要更新的列名
- * @param newVal 更新后的新值
- * @param whereCol 条件列名（仅更新该列值等于 whereVal 的行）
- * @param whereVal 条件值
+ * @param tableName 表名（不区分大小写）
+ * @param colName 列名
+ * @param trigram true 建立三元组索引，false 建立有序索引
  *
  * @note
- * - 若表不存在，则直接返回（无提示）
- * - 若目标列或条件列不存在，则输出 `"Column not found."`
- * - 更新完成后会调用 `Table::saveToFile()` 将修改后的表数据保存到文件
- * - 若没有行满足条件，则不会有任何更改，但仍会输出 `"Rows updated."`
+ * - 若表或列不存在，输出 `"Table not found."` / `"Column not found."`
+ * - 若该列已有这种索引，输出 `"Index already exists: <列名>"`
+ * - 分区表的各分区同样建立索引
+ * - 成功执行后，输出 `"Index created: <列名>"`
  *
  * @example
  * @code
- * sqlDB db;
- * // 将 users 表中 age=30 的记录，其 name 更新为 "Alice"
- * db.update("users", "name", "Alice", "age", "30");
+ * db.createIndex("users", "name", false); // WHERE name LIKE 'al%'
+ * db.createIndex("users", "email", true); // WHERE email LIKE '%@example%'
  * @endcode
  */
-void sqlDB::update(const std::string &name, const std::string &targetCol, const std::string &newVal,
-                   const std::string &whereCol, const std::string &whereVal)
+void sqlDB::createIndex(const std::string &tableName, const std::string &colName, bool trigram)
 {
-    std::string lname = name;
+    alterTextIndex(tableName, colName, trigram ? TextIndex::kTrigram : TextIndex::kSorted, true);
+}
+
+/**
+ * @brief 删除列上的 LIKE 索引（两种索引都删除）
+ *
+ * @note 若该列没有 LIKE 索引，输出 `"No index on column: <列名>"`；成功后输出 `"Index dropped: <列名>"`
+ */
+void sqlDB::dropIndex(const std::string &tableName, const std::string &colName)
+{
+    alterTextIndex(tableName, colName, TextIndex::kSorted | TextIndex::kTrigram, false);
+}
+
+void sqlDB::alterTextIndex(const std::string &tableName, const std::string &colName, uint8_t kinds, bool add)
+{
+    StatementScope stmt(*this, StatementKind::DDL);
+    std::string lname = tableName;
     std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
-    if (!tables.count(lname))
+    DdlTable entry(findTable(lname));
+    if (!entry)
+    {
+        dbOut() << "Table not found.\n";
         return;
-    Table &t = tables[lname];
-
-    int targetIdx = t.getColumnIndex(targetCol);
-    int whereIdx = t.getColumnIndex(whereCol);
-    if (targetIdx == -1 || whereIdx == -1)
+    }
+    if (rejectPartitionWrite(*entry.get(), lname))
+        return;
+    stmt.table = entry.get();
+    Table &t = entry->table;
+    int idx = t.getColumnIndex(colName);
+    if (idx == -1)
     {
-        std::cout << "Column not found. \n";
+        dbOut() << "Column not found.\n";
         return;
     }
-    for (auto &row : t.rows)
+    uint8_t current = t.columns[idx].textIndex;
+    if (add ? (current & kinds) == kinds : !(current & kinds))
     {
-        if (row.values[whereIdx] == whereVal)
-        {
-            row.values[targetIdx] = newVal;
-        }
+        dbOut() << (add ? "Index already exists: " : "No index on column: ") << t.columns[idx].name << "\n";
+        return;
     }
-    t.saveToFile(lname);
-    std::cout << "Rows updated. \n";
+    uint8_t next = add ? current | kinds : current & ~kinds;
+    std::string column = t.columns[idx].name;
+    std::string change = "INDEX " + column;
+    if (next & TextIndex::kSorted)
+        change += " SORTED";
+    if (next & TextIndex::kTrigram)
+        change += " TRIGRAM";
+    uint64_t lsn = logSchemaChange(lname, *entry.get(), change);
+    t.setTextIndex(idx, next);
+    lsn = std::max(lsn, alterPartitions(lname, *entry.get(), [&](Table &part)
+                                        {
+                                            part.setTextIndex(idx, next);
+                                            return change; }));
+    entry.unlock();
+    if (!awaitDurable(lsn))
+        return;
+    dbOut() << (add ? "Index created: " : "Index dropped: ") << column << "\n";
 }
 
 /**
- * @brief 删除表中满足条件的行
+ * @brief 创建物化视图 SELECT <key>, <cols>... FROM <table> GROUP BY <key>
  *
- * 此方法会遍历指定表的所有行，并删除满足条件的记录：
- * - 条件列名为 @p whereCol
- * - 条件值为 @p whereVal
+ * 独占锁住基表（分区表还有各分区）后按最新快照扫描一次，得到各分组的初值；
+ * 之后基表（分区）的每次提交在提交锁内把写集合应用到分组上，查询视图只读取分组，与基表的行数无关。
+ * 定义与分组写入 <基表>.views，检查点时重写有修改的视图。
  *
- * @param name 表名（不区分大小写，内部统一转换为小写）
- * @param whereCol 条件列名
- * @param whereVal 条件值（仅删除该列值等于 whereVal 的行）
+ * @param name 视图名（不区分大小写），不能与已有的表或视图重名
+ * @param table 基表名，可以是分区表，不能是分区
+ * @param key 分组键列名
+ * @param cols 聚合列：COUNT(*)、COUNT(列)、SUM(列)、AVG(列)
  *
  * @note
- * - 若表不存在，则直接返回（无提示）
- * - 若条件列不存在，则输出 `"Column not found."`
- * - 删除完成后会调用 `Table::saveToFile()` 将修改后的表数据保存到文件
- * - 删除逻辑基于 `std::remove_if` 实现
+ * - 若名称已被占用，输出 `"Table or view already exists: <名称>"`
+ * - 若没有聚合列或含有其他函数，输出 `"Materialized views support COUNT, SUM and AVG only."`
+ * - 若表或列不存在，输出 `"Table not found."` / `"Column not found: <列名>"`
+ * - 不受事务控制：在事务中执行也立即生效，事务中未提交的修改在提交时计入
+ * - 成功后输出 `"Materialized view created: <视图名> (<分组数> groups)"`
  *
  * @example
  * @code
- * sqlDB db;
- * // 删除 users 表中 age=30 的所有记录
- * db.deleteRows("users", "age", "30");
+ * db.createMaterializedView("sales_by_region", "orders", "region", {{"SUM", "amount"}, {"COUNT", "*"}});
+ * db.selectAll("sales_by_region");
  * @endcode
  */
+void sqlDB::createMaterializedView(const std::string &name, const std::string &table, const std::string &key,
+                                   const std::vector<ViewColumn> &cols)
+{
+    StatementScope stmt(*this, StatementKind::DDL);
+    std::string lname = name, ltable = table;
+    std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
+    std::transform(ltable.begin(), ltable.end(), ltable.begin(), ::tolower);
+    std::lock_guard<std::mutex> lock(catalogMutex);
+    if (findTable(lname) || findView(lname))
+    {
+        dbOut() << "Table or view already exists: " << lname << "\n";
+        return;
+    }
+    bool supported = !cols.empty();
+    for (const ViewColumn &c : cols)
+        supported = supported && (c.func == "COUNT" || ((c.func == "SUM" || c.func == "AVG") && c.column != "*"));
+    if (!supported)
+    {
+        dbOut() << "Materialized views support COUNT, SUM and AVG only.\n";
+        return;
+    }
+    DdlTable entry(findTable(ltable));
+    if (!entry)
+    {
+        dbOut() << "Table not found.\n";
+        return;
+    }
+    if (rejectPartitionWrite(*entry.get(), ltable))
+        return;
+    stmt.table = entry.get();
+    auto view = std::make_shared<AggregateView>(lname, ltable, key, cols);
+    std::string error;
+    if (!view->bind(entry->table, error))
+    {
+        dbOut() << error << "\n";
+        return;
+    }
+    // 分区表的行都在各分区中；按表名顺序加锁，与 commit() 相同
+    std::vector<DdlTable> partLocks;
+    std::vector<const Table *> sources;
+    if (std::atomic_load(&entry->partitions))
+    {
+        auto parts = partitionsFor(ltable, *entry.get(), "", "", nullptr);
+        std::sort(parts.begin(), parts.end(), [](const auto &a, const auto &b)
+                  { return a.first < b.first; });
+        for (const auto &part : parts)
+        {
+            partLocks.emplace_back(part.second);
+            if (partLocks.back())
+                sources.push_back(&partLocks.back()->table);
+        }
+    }
+    else
+        sources.push_back(&entry->table);
+    // 持有独占锁期间没有进行中的提交：快照包含此前的所有提交，之后的提交都会应用到视图上
+    Snapshot snap = txns.snapshot();
+    view->rebuild(sources, snap, snap.ts);
+    for (const Table *s : sources)
+        stmt.rowsScanned += s->rows.size();
+    std::shared_ptr<const ViewList> old = std::atomic_load(&entry->views);
+    auto next = old ? std::make_shared<ViewList>(*old) : std::make_shared<ViewList>();
+    next->push_back(view);
+    std::atomic_store(&entry->views, std::shared_ptr<const ViewList>(std::move(next)));
+    saveViews(ltable, *entry.get(), snap.ts);
+    dbOut() << "Materialized view created: " << lname << " (" << view->groupCount() << " groups)\n";
+}
 
-void sqlDB::deleteRows(const std::string &name, const std::string &whereCol, const std::string &whereVal)
+/**
+ * @brief 删除物化视图
+ *
+ * @note 若视图不存在，输出 `"View not found: <视图名>"`；成功后输出 `"Materialized view dropped: <视图名>"`
+ */
+void sqlDB::dropMaterializedView(const std::string &name)
 {
+    StatementScope stmt(*this, StatementKind::DDL);
     std::string lname = name;
     std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
-    if (!tables.count(lname))
+    std::lock_guard<std::mutex> lock(catalogMutex);
+    std::shared_ptr<TableEntry> base;
+    std::shared_ptr<AggregateView> view = findView(lname, &base);
+    if (!view)
+    {
+        dbOut() << "View not found: " << lname << "\n";
         return;
-    Table &t = tables[lname];
+    }
+    stmt.table = base;
+    auto next = std::make_shared<ViewList>(*std::atomic_load(&base->views));
+    next->erase(std::find(next->begin(), next->end(), view));
+    std::atomic_store(&base->views, std::shared_ptr<const ViewList>(std::move(next)));
+    std::lock_guard<std::mutex> guard(checkpointMutex);
+    saveViews(view->table(), *base, txns.snapshot().ts);
+    dbOut() << "Materialized view dropped: " << lname << "\n";
+}
 
-    int whereIdx = t.getColumnIndex(whereCol);
-    if (whereIdx == -1)
+std::shared_ptr<AggregateView> sqlDB::findView(const std::string &lname, std::shared_ptr<TableEntry> *base) const
+{
+    std::shared_ptr<const Catalog> snapshot = std::atomic_load(&tables);
+    for (const auto &kv : *snapshot)
+        if (std::shared_ptr<const ViewList> views = std::atomic_load(&kv.second->views))
+            for (const auto &v : *views)
+                if (v->name() == lname)
+                {
+                    if (base)
+                        *base = kv.second;
+                    return v;
+                }
+    return nullptr;
+}
+
+size_t sqlDB::selectView(const AggregateView &view, const std::string &whereCol, const std::string &whereVal,
+                         bool filtered, const std::string &orderBy, bool desc, int limit)
+{
+    auto lower = [](std::string s)
+    {
+        std::transform(s.begin(), s.end(), s.begin(), ::tolower);
+        return s;
+    };
+    std::string key = lower(view.key());
+    if (filtered || (!whereCol.empty() && lower(whereCol) != key) || (!orderBy.empty() && (lower(orderBy) != key || desc)))
+    {
+        dbOut() << "Materialized views support WHERE " << view.key() << " = <value>, ORDER BY "
+                << view.key() << " and LIMIT only.\n";
+        return 0;
+    }
+    for (const std::string &col : view.header())
+        dbOut() << col << "\t";
+    dbOut() << "\n";
+    return view.forEachGroup(whereCol.empty() ? nullptr : &whereVal, limit, [](const std::vector<std::string> &row)
+                             {
+                                 for (const std::string &v : row)
+                                     dbOut() << v << "\t";
+                                 dbOut() << "\n"; });
+}
+
+void sqlDB::applyViews(const TableEntry &entry, const WriteSet &ws, uint64_t ts) const
+{
+    std::shared_ptr<const ViewList> views;
+    if (entry.partitionOf.empty())
+        views = std::atomic_load(&entry.views);
+    else if (std::shared_ptr<TableEntry> parent = findTable(entry.partitionOf))
+        views = std::atomic_load(&parent->views);
+    if (views)
+        for (const auto &v : *views)
+            v->apply(entry.table, ws, ts);
+}
+
+void sqlDB::saveViews(const std::string &lname, const TableEntry &entry, uint64_t now)
+{
+    std::shared_ptr<const ViewList> views = std::atomic_load(&entry.views);
+    std::string path = getDbPath(lname, ".views");
+    if (!views || views->empty())
     {
-        std::cout << "Column not found. \n";
+        std::remove(path.c_str());
         return;
     }
-    auto &rows = t.rows;
-    rows.erase(std::remove_if(rows.begin(), rows.end(),
-                              [&](const Row &r)
-                              {
-                                  return r.values[whereIdx] == whereVal;
-                              }),
-               rows.end());
-    t.saveToFile(lname);
-    std::cout << "Rows deleted. \n";
+    std::string content;
+    for (const auto &v : *views)
+        content += v->serialize(now);
+    noteBytesWritten(content.size());
+    timedPersist([&]
+                 {
+                     std::string tmp = path + ".tmp";
+                     {
+                         std::ofstream out(tmp, std::ios::trunc | std::ios::binary);
+                         out << content;
+                         if (!out.flush())
+                             return;
+                     }
+                     std::error_code ec;
+                     std::filesystem::rename(tmp, path, ec); });
 }
 
 /**
- * @brief 保存数据库中所有表的数据到文件
+ * @brief 对指定表的某一列执行聚合函数
+ *
+ * 支持的聚合函数包括：
+ * - COUNT : 统计非 NULL 值的行数
+ * - SUM   : 计算数值型列的总和
+ * - AVG   : 计算数值型列的平均值（忽略 NULL 与空值）
+ * - MIN   : 获取数值型列的最小值
+ * - MAX   : 获取数值型列的最大值
+ * - APPROX_COUNT_DISTINCT : 用 HyperLogLog 估计不同值（不含 NULL）的个数，标准误差约 1.6%
  *
- * 此方法会遍历当前数据库中的所有表，
- * 并依次调用每个表的 `Table::saveToFile()` 方法进行持久化存储。
+ * @param name 表名（不区分大小写，内部统一转换为小写）
+ * @param func 聚合函数名称（COUNT, SUM, AVG, MIN, MAX, APPROX_COUNT_DISTINCT，大小写敏感）
+ * @param col 目标列名
  *
  * @note
- * - 文件名的生成方式依赖于 `Table::saveToFile()` 的实现，
- *   通常会与表名 (`it->first`) 关联。
- * - 若表数据较大，保存过程可能会耗时。
- * - 本方法不会返回成功/失败状态，所有结果直接由 `Table::saveToFile()` 负责。
+ * - 若表不存在，会输出 `"Table not found."`
+ * - 若列不存在，会输出 `"Column not found."`
+ * - 对非数值型数据执行 SUM/AVG/MIN/MAX 时，无法转换的值会被忽略并打印异常信息
+ * - NULL 由每段的列位图判断：COUNT 对 可见位 & 有效位 做 popcount，不读取单元格
+ * - APPROX_COUNT_DISTINCT 按块（SketchCache::kChunkRows 个行版本）合并 sketch：
+ *   写满且全部可见的块的 sketch 缓存在表上，之后的查询只需逐行读取其余的块
+ * - 返回结果直接通过 `dbOut()` 输出
  *
  * @example
  * @code
  * sqlDB db;
- * // 创建并插入数据 ...
- * db.saveAll(); // 将所有表写入文件
+ * std::string col = "salary";
+ * db.aggregate("employees", "SUM", col);   // 输出 SUM(salary)
+ * db.aggregate("employees", "AVG", col);   // 输出 AVG(salary)
+ * db.aggregate("employees", "COUNT", col); // 输出 COUNT(salary)
  * @endcode
  */
-void sqlDB::saveAll()
+/**
+ * @brief TABLESAMPLE：以概率 p 独立抽取每个行版本（按几何分布跳过未抽中的行，只读取抽中的行），
+ *        在抽中且可见、不为 NULL 的行上估计 COUNT / SUM / AVG，输出估计值与 95% 置信区间的半宽
+ *
+ * COUNT 与 SUM 的估计量为 样本值 / p，方差估计为 (1-p)/p² · Σx²（COUNT 时 x = 1）；
+ * AVG 取样本均值，标准误差为 样本标准差 · sqrt((1-p) / n)。区间按正态近似（z = 1.96）。
+ */
+static void sampledAggregate(const std::vector<const Table *> &sources, size_t idx, const Snapshot &snap,
+                             const std::string &func, const std::string &col, const TableSample &sample,
+                             uint64_t &rowsScanned)
 {
-    for (auto it = tables.begin(); it != tables.end(); ++it)
+    double p = sample.percent / 100;
+    std::mt19937_64 rng(sample.repeatable ? sample.seed : std::random_device{}());
+    std::geometric_distribution<size_t> geometric(p < 1 ? p : 0.5);
+    auto gap = [&]()
+    { return p < 1 ? geometric(rng) : size_t(0); };
+    size_t count = 0;
+    double sum = 0, sumSq = 0;
+    for (const Table *s : sources)
+        for (size_t i = gap(), n = s->rows.size(); i < n; i += 1 + gap())
+        {
+            rowsScanned++;
+            if (!s->visible(i, snap))
+                continue;
+            RowRef row = s->rows[i];
+            if (s->isNull(row, idx))
+                continue;
+            if (func == "COUNT")
+            {
+                count++;
+                continue;
+            }
+            std::string_view val = s->cell(row, idx);
+            if (val.empty())
+                continue;
+            try
+            {
+                double v = std::stod(std::string(val));
+                sum += v;
+                sumSq += v * v;
+                count++;
+            }
+            catch (const std::exception &e)
+            {
+                dbErr() << e.what() << '\n';
+            }
+        }
+    const double z = 1.96;
+    double estimate, error;
+    if (func == "COUNT")
+    {
+        estimate = double(count) / p;
+        error = z * std::sqrt((1 - p) * double(count)) / p;
+    }
+    else if (func == "SUM")
+    {
+        estimate = sum / p;
+        error = z * std::sqrt((1 - p) * sumSq) / p;
+    }
+    else if (count == 0)
+    {
+        dbOut() << "AVG(" << col << ") = NULL\n";
+        return;
+    }
+    else
     {
-        it->second.saveToFile(it->first);
+        estimate = sum / double(count);
+        double variance = count > 1 ? (sumSq - double(count) * estimate * estimate) / double(count - 1) : 0;
+        error = z * std::sqrt(std::max(variance, 0.0) * (1 - p) / double(count));
     }
+    dbOut() << func << "(" << col << ") ~ " << estimate << " +/- " << error
+            << " (95% confidence, " << sample.percent << "% sample)\n";
+}
+
+void sqlDB::aggregate(const std::string &name, const std::string &func, std::string &col)
+{
+    aggregateRows(name, func, col, nullptr);
 }
 
 /**
- * @brief 从文件加载多个表到数据库
- *
- * 此方法会遍历给定的表名列表，逐个尝试从文件中加载表数据：
- * - 表名会统一转换为小写存储
- * - 每个表会调用 `Table::loadFromFile()` 读取持久化的数据
- * - 若加载的表包含有效列（`columns` 非空），则会被加入数据库
+ * @brief 在 TABLESAMPLE 抽样的行上近似计算 COUNT / SUM / AVG
  *
- * @param tableNames 需要加载的表名列表
+ * 每个行版本以 sample.percent% 的概率被抽中，只读取抽中的行，耗时与抽样比例成正比；
+ * 输出形如 `SUM(col) ~ <估计值> +/- <95% 置信区间半宽> (95% confidence, <比例>% sample)`。
+ * sample.repeatable 时同一数据上的抽样结果可重复。
  *
- * @note
- * - 文件名的解析与加载逻辑依赖于 `Table::loadFromFile()` 的实现，
- *   通常与表名绑定。
- * - 若某个表文件不存在或内容为空（即 `columns` 为空），则不会加入数据库。
- * - 成功加载的表会输出 `"Loaded table: <表名>"`。
+ * @note 其他聚合函数输出 `"TABLESAMPLE supports COUNT, SUM and AVG only."`；
+ *       比例不在 (0, 100] 内时输出 `"Invalid TABLESAMPLE percentage: <比例>"`
  *
  * @example
  * @code
- * sqlDB db;
- * std::vector<std::string> names = {"users", "orders"};
- * db.loadAll(names);  // 从文件加载 users 和 orders 表
+ * std::string col = "salary";
+ * db.aggregate("employees", "AVG", col, {1, true, 42}); // 1% 的行，种子 42
  * @endcode
  */
+void sqlDB::aggregate(const std::string &name, const std::string &func, std::string &col, const TableSample &sample)
+{
+    aggregateRows(name, func, col, &sample);
+}
+
+void sqlDB::aggregateRows(const std::string &name, const std::string &func, const std::string &col,
+                          const TableSample *sample)
+{
+    StatementScope stmt(*this, StatementKind::AGGREGATE);
+    TRACE_SPAN("sqlDB::aggregate");
+    std::string lname = name;
+    std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
+    ReadTable entry(findTable(lname));
+    if (!entry)
+    {
+        dbOut() << "Table not found. \n";
+        return;
+    }
+    stmt.table = entry.get();
+    // 不重复的抽样每次结果不同，不缓存
+    std::string key;
+    if (!activeTxn() && (!sample || sample->repeatable))
+        key = sample ? cacheKey("SAMPLE", lname, func, col, std::to_string(sample->percent), std::to_string(sample->seed))
+                     : cacheKey("AGGREGATE", lname, func, col);
+    CachedRead cached(results, stmt, *entry.get(), std::move(key));
+    if (cached.hit())
+        return;
+    const Table &t = entry->table;
+    int idx = t.getColumnIndex(col);
+    if (idx == -1)
+    {
+        dbOut() << "Column not found. \n";
+        return;
+    }
+    // 分区表依次聚合各分区（表结构相同，列下标一致）
+    std::vector<ReadTable> partLocks;
+    std::vector<const Table *> sources;
+    std::vector<SketchCache *> caches;
+    if (std::atomic_load(&entry->partitions))
+    {
+        for (const auto &part : partitionsFor(lname, *entry.get(), "", "", nullptr))
+        {
+            partLocks.emplace_back(part.second);
+            if (partLocks.back())
+            {
+                sources.push_back(&partLocks.back()->table);
+                caches.push_back(&partLocks.back()->sketches);
+            }
+        }
+    }
+    else
+    {
+        sources.push_back(&t);
+        caches.push_back(&entry->sketches);
+    }
+    std::shared_ptr<Transaction> txn = activeTxn();
+    Snapshot snap = txn ? txn->snap : txns.snapshot();
+    stmt.rowsReturned = 1;
+    auto phase = std::chrono::steady_clock::now();
+    if (sample)
+    {
+        if (func != "COUNT" && func != "SUM" && func != "AVG")
+            dbOut() << "TABLESAMPLE supports COUNT, SUM and AVG only.\n";
+        else if (!(sample->percent > 0 && sample->percent <= 100))
+            dbOut() << "Invalid TABLESAMPLE percentage: " << sample->percent << "\n";
+        else
+        {
+            stmt.accessPath = accessPathName(AccessPath::SAMPLE_SCAN);
+            sampledAggregate(sources, idx, snap, func, col, *sample, stmt.rowsScanned);
+        }
+        stmt.filterNanos = StatementScope::elapsedSince(phase);
+        return;
+    }
+    stmt.accessPath = accessPathName(AccessPath::FULL_SCAN);
+    if (func == "APPROX_COUNT_DISTINCT")
+    {
+        // 各表（分区）的 sketch 合并后估计；写满且全部可见的块直接合并缓存的 sketch，不读取行
+        HyperLogLog hll;
+        for (size_t k = 0; k < sources.size(); k++)
+        {
+            size_t read;
+            hll.merge(sketchColumn(*sources[k], idx, snap, caches[k], read));
+            stmt.rowsScanned += read;
+        }
+        dbOut() << "APPROX_COUNT_DISTINCT(" << col << ") = " << std::llround(hll.estimate()) << std::endl;
+        stmt.filterNanos = StatementScope::elapsedSince(phase);
+        return;
+    }
+    for (const Table *s : sources)
+        stmt.rowsScanned += s->rows.size();
+    // 按段取得可见且不为 NULL 的行的位图：COUNT 只需 popcount，其余函数只读取置位的行
+    auto scanNonNull = [&](auto fn)
+    {
+        for (const Table *s : sources)
+            s->scanNonNull(idx, s->rows.size(), snap, [&](size_t base, const uint64_t *mask)
+                           { fn(*s, base, mask); });
+    };
+    // SUM / AVG / MIN / MAX：按段把可见且不为 NULL 的值解码为 double（按行的顺序紧凑排列），
+    // 再交给按函数实例化的循环。值的解析同 std::stod，无法解析时输出与它抛出的异常相同的信息（MAX 忽略）
+    bool report = func != "MAX";
+    auto forEachBatch = [&](auto fn)
+    {
+        std::vector<double> values;
+        values.reserve(RowStore::kSegmentRows);
+        scanNonNull([&](const Table &s, size_t base, const uint64_t *mask)
+                    {
+                        values.clear();
+                        gatherSegment(s, base, mask, values, [&](const RowRef &row, double &v)
+                                      {
+                                          std::string_view val = s.cell(row, idx);
+                                          if (val.empty())
+                                              return false;
+                                          if (parseDouble(val, false, v))
+                                              return true;
+                                          if (report)
+                                              dbErr() << "stod\n";
+                                          return false; });
+                        fn(values.data(), values.size()); });
+    };
+    if (func == "COUNT")
+    {
+        int count = 0;
+        scanNonNull([&](const Table &, size_t, const uint64_t *mask)
+                    {
+                        for (size_t w = 0; w < ColumnBitmap::kWords; w++)
+                            count += __builtin_popcountll(mask[w]); });
+        dbOut() << "COUNT(" << col << ") = " << count << std::endl;
+    }
+    else if (func == "SUM" || func == "AVG")
+    {
+        double sum = 0;
+        int count = 0;
+        forEachBatch([&](const double *values, size_t n)
+                     {
+                         sum = sumValues(values, n, sum);
+                         count += int(n); });
+        if (func == "SUM")
+            dbOut() << "SUM(" << col << ") = " << sum << std::endl;
+        else if (count > 0)
+            dbOut() << "AVG(" << col << ") = " << (sum / count) << std::endl;
+        else
+            dbOut() << "AVG(" << col << ") = NULL\n";
+    }
+    else if (func == "MIN")
+    {
+        double minVal = 0;
+        bool found = false;
+        forEachBatch([&](const double *values, size_t n)
+                     { foldExtreme(values, n, minVal, found, std::less<double>()); });
+        if (found)
+            dbOut() << "MIN(" << col << ") = " << minVal << std::endl;
+        else
+            dbOut() << "MIN(" << col << ") = NULL\n";
+    }
+    else if (func == "MAX")
+    {
+        double maxVal = 0;
+        bool found = false;
+        forEachBatch([&](const double *values, size_t n)
+                     { foldExtreme(values, n, maxVal, found, std::greater<double>()); });
+        if (found)
+            dbOut() << "MAX(" << col << ") = " << maxVal << "\n";
+        else
+            dbOut() << "MAX(" << col << ") = NULL\n";
+    }
+    else
+    {
+        dbOut() << "Unknown aggregate function.\n";
+    }
+    stmt.filterNanos = StatementScope::elapsedSince(phase);
+}
+
+/**
+ * @brief 获取数据库中所有表的名称列表
+ * @return std::vector<std::string> 包含所有表名称的向量
+ */
+std::vector<std::string> sqlDB::listTables() const
+{
+    std::vector<std::string> names;
+    // 先持有目录快照，range-for 不会延长临时 shared_ptr 的生命周期
+    std::shared_ptr<const Catalog> snapshot = std::atomic_load(&tables);
+    for (const auto &pair : *snapshot)
+        names.push_back(pair.first);
+    return names;
+}
+
+/**
+ * @brief 获取运行统计的快照
+ *
+ * 语句按类型汇总；表只包含当前目录中的表，按表名排序。
+ * 每个计数器由各线程分片相加得到，与正在执行的语句之间没有同步，是近似一致的快照。
+ */
+MetricsSnapshot sqlDB::metrics() const
+{
+    MetricsSnapshot snap;
+    for (size_t k = 0; k < size_t(StatementKind::COUNT); k++)
+        snap.statements.emplace_back(statementKindName(StatementKind(k)), statementMetrics[k].summary());
+    std::shared_ptr<const Catalog> catalog = std::atomic_load(&tables);
+    for (const auto &kv : *catalog)
+        snap.tables.emplace_back(kv.first, kv.second->metrics.summary());
+    std::sort(snap.tables.begin(), snap.tables.end(),
+              [](const auto &a, const auto &b)
+              { return a.first < b.first; });
+    snap.resultCache = results.stats();
+    return snap;
+}
+
+/**
+ * @brief 输出运行统计（SHOW STATS）
+ *
+ * 每类语句、每张表一行：语句数、扫描/返回/写入的行数、写盘字节、
+ * 执行与落盘的累计耗时（毫秒），以及总耗时的 p50/p95/p99/最大值（微秒）。
+ */
+void sqlDB::showStats() const
+{
+    dbOut() << metrics().format();
+}
 
-void sqlDB::loadAll(const std::vector<std::string> &tableNames)
+/**
+ * @brief 把运行统计的文本快照写入文件
+ *
+ * 内容与 showStats() 相同。先写 `<path>.tmp` 再重命名，
+ * 定期导出供外部采集时，读者总是看到完整的一份快照。
+ *
+ * @param path 文件路径
+ * @return 是否写入成功；失败时输出 `"Cannot write stats file: <路径>"`
+ */
+bool sqlDB::exportStats(const std::string &path) const
 {
-    for (const auto &name : tableNames)
+    std::string tmp = path + ".tmp";
     {
-        std::string lname = name;
-        std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
-        Table t;
-        t.loadFromFile(lname);
-        if (!t.columns.empty())
+        std::ofstream out(tmp, std::ios::trunc);
+        out << metrics().format();
+        if (!out.flush())
         {
-            tables[lname] = t;
-            std::cout << "Loaded table: " << lname << "\n";
+            dbErr() << "Cannot write stats file: " << path << "\n";
+            std::remove(tmp.c_str());
+            return false;
         }
     }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0)
+    {
+        dbErr() << "Cannot write stats file: " << path << "\n";
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
 }
 
 /**
- * @brief 删除指定的表
+ * @brief 收集指定表的列统计信息
  *
- * 此方法会执行以下操作：
- * - 从内存中移除指定表（`tables.erase`）
- * - 删除磁盘上对应的表文件（通过 `getDbPath(name)` 获取路径，再调用 `std::remove` 删除）
+ * 对每一列计算行数、空值数、不同值个数（HyperLogLog 估计）、最小/最大值
+ * 以及等深直方图，结果保存在内存中并写入 `<表名>.stats`，
+ * 之后 selectAll 的代价模型会据此估计选择率、选择访问路径。
  *
  * @param name 表名（不区分大小写，内部统一转换为小写）
  *
  * @note
- * - 若表存在于内存，则会从 `tables` 容器中移除
- * - 若对应的文件存在，删除成功后会输出 `"Table dropped and file deleted: <表名>"`
- * - 若文件不存在或删除失败，会输出 `"Table dropped (file not found or cannot delete): <表名>"`
- * - 使用 `std::remove` 删除文件，跨平台兼容
+ * - 若表不存在，会输出 `"Table not found."`
+ * - 统计信息不会随写操作自动更新，数据变化较大后需要重新 ANALYZE
  *
  * @example
  * @code
  * sqlDB db;
- * db.dropTable("users");  // 删除名为 users 的表及其文件
+ * db.analyze("users");
  * @endcode
  */
-void sqlDB::dropTable(const std::string &name)
+void sqlDB::analyze(const std::string &name)
 {
+    StatementScope stmt(*this, StatementKind::ANALYZE);
     std::string lname = name;
     std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
-    tables.erase(lname);
-    // Remove file from disk
-    std::string dropFile = getDbPath(name);
-    if (std::remove(dropFile.c_str()) == 0)
+    TableStats ts;
     {
-        std::cout << "Table dropped and file deleted: " << lname << "\n";
+        ReadTable entry(findTable(lname));
+        if (!entry)
+        {
+            dbOut() << "Table not found.\n";
+            return;
+        }
+        stmt.table = entry.get();
+        stmt.rowsScanned = entry->table.rows.size();
+        ts = analyzeTable(entry->table, txns.snapshot());
     }
-    else
+    // 扫描只需共享锁，替换统计信息与写文件再独占持有
+    DdlTable entry(findTable(lname));
+    if (!entry)
     {
-        std::cout << "Table dropped (file not found or cannot delete): " << lname << "\n";
+        dbOut() << "Table not found.\n";
+        return;
     }
+    timedPersist([&]
+                 { ts.saveToFile(lname); });
+    dbOut() << "Table analyzed: " << lname << " (" << ts.rowCount << " rows)\n";
+    entry->stats = std::move(ts);
 }
 
 /**
- * @brief 向指定表中添加新列
+ * @brief 设置触发后台压缩的已删除行比例
  *
- * 此方法会在目标表中追加一个新列，并为所有已有行增加对应的空值。
- * 新列的定义由参数 @p col 指定。
+ * @param ratio 已删除行占总行数的比例阈值，取值 (0, 1]
  *
- * @param tableName 表名（不区分大小写，内部统一转换为小写）
- * @param col 新增的列定义（包含列名和数据类型）
+ * @note 超出范围的值会被忽略并输出提示
+ */
+void sqlDB::setCompactionRatio(double ratio)
+{
+    if (!(ratio > 0 && ratio <= 1))
+    {
+        dbOut() << "Invalid compaction ratio: " << ratio << "\n";
+        return;
+    }
+    compactionRatio = ratio;
+}
+
+/**
+ * @brief 设置查询内存预算
  *
- * @note
- * - 若表不存在，会输出 `"Table not found."` 并返回
- * - 新列会被追加到表的最后一列
- * - 已有行在新列上的默认值为空字符串 `""`
- * - 修改完成后会调用 `Table::saveToFile()` 将表持久化到磁盘
- * - 成功执行后，会输出 `"Column added: <列名>"`
+ * @param perQuery 单个查询的工作内存上限（字节）
+ * @param global 所有并发查询合计的上限（字节），不能小于 perQuery
  *
- * @example
- * @code
- * sqlDB db;
- * Column c{"email", DataType::STRING};
- * db.addColumn("users", c);
- * // users 表中会新增 email 列，已有行对应的值初始化为空
- * @endcode
+ * @note 超出预算的 ORDER BY 改为外部归并排序，有序段写到数据目录下的临时文件；
+ *       临时文件写不下或打不开时输出 `"External sort failed: <原因>"`，不返回部分结果
  */
-void sqlDB::addColumn(const std::string &tableName, const Column &col)
+void sqlDB::setMemoryBudget(size_t perQuery, size_t global)
 {
-    std::string lname = tableName;
-    std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
-    if (!tables.count(lname))
+    if (perQuery == 0 || global < perQuery)
     {
-        std::cout << "Table not found.\n";
+        dbOut() << "Invalid memory budget: " << perQuery << " / " << global << "\n";
         return;
     }
-    Table &t = tables[lname];
-    t.columns.push_back(col);
-    // Add empty value for new column to all existing rows
-    for (auto &row : t.rows)
-        row.values.push_back("");
-    t.saveToFile(lname);
-    std::cout << "Column added: " << col.name << "\n";
+    memory.perQueryLimit = perQuery;
+    memory.globalLimit = global;
 }
 
 /**
- * @brief 从指定表中删除一个列
+ * @brief 设置按需分页的页缓存容量
  *
- * 此方法会在目标表中移除指定的列，并同步删除所有行中该列对应的值。
+ * 非 0 时，之后加载的表按需分页打开，之后创建的表在第一次检查点后改为分页；
+ * 已经整表加载的表不受影响。缩小容量后在下次载入段时淘汰到新容量以内。
  *
- * @param tableName 表名（不区分大小写，内部统一转换为小写）
- * @param colName   需要删除的列名
+ * @param bytes 字节数，0 表示整表加载（默认）
+ */
+void sqlDB::setPageCacheSize(size_t bytes)
+{
+    pages.setCapacity(bytes);
+}
+
+/**
+ * @brief 设置慢查询日志
  *
- * @note
- * - 若表不存在，会输出 `"Table not found."` 并返回
- * - 若列不存在，会输出 `"Column not found."` 并返回
- * - 删除列后，所有行的数据会同步删除该列对应的值
- * - 修改完成后会调用 `Table::saveToFile()` 将表持久化到磁盘
- * - 成功执行后，会输出 `"Column dropped: <列名>"`
+ * 启用后，总耗时不小于阈值的语句追加一行记录：时间、语句类型、总耗时以及扫描过滤、排序、
+ * 落盘各自的耗时、扫描/返回的行数、访问路径和 SQL 原文（经 executeSQL 执行时）。
+ * 未启用或未达到阈值时，每条语句只多一次原子读取。
  *
- * @example
- * @code
- * sqlDB db;
- * // 删除 users 表中的 email 列
- * db.dropColumn("users", "email");
- * @endcode
+ * @param thresholdMs 阈值（毫秒），小于 0 表示关闭
+ * @param path 日志文件，为空时为 `<数据目录>/slow_query.log`
+ * @param maxBytes 单个文件的上限，超过后轮转为 `<path>.1`、`<path>.2` ...
+ * @param keepFiles 保留的旧文件个数
+ *
+ * @note 文件无法打开时输出 `"Cannot open slow query log: <路径>"`，日志保持关闭
  */
-void sqlDB::dropColumn(const std::string &tableName, const std::string &colName)
+void sqlDB::setSlowQueryLog(double thresholdMs, const std::string &path, uint64_t maxBytes, int keepFiles)
 {
-    std::string lname = tableName;
-    std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
-    if (!tables.count(lname))
+    if (thresholdMs < 0)
     {
-        std::cout << "Table not found.\n";
+        slowLog.close();
         return;
     }
-    Table &t = tables[lname];
-    int idx = t.getColumnIndex(colName);
-    if (idx == -1)
+    std::string file = path.empty() ? getDbPath("slow_query", ".log") : path;
+    if (!slowLog.open(file, uint64_t(thresholdMs * 1e6), maxBytes, keepFiles))
+        dbErr() << "Cannot open slow query log: " << file << "\n";
+}
+
+/**
+ * @brief 设置后台检查点的时间间隔
+ *
+ * @param ms 毫秒数，必须为正；立即唤醒检查点线程，之后按新的间隔等待
+ */
+void sqlDB::setCheckpointInterval(int ms)
+{
+    if (ms <= 0)
     {
-        std::cout << "Column not found.\n";
+        dbOut() << "Invalid checkpoint interval: " << ms << "\n";
         return;
     }
-    t.columns.erase(t.columns.begin() + idx);
-    for (auto &row : t.rows)
-        row.values.erase(row.values.begin() + idx);
-    t.saveToFile(lname);
-    std::cout << "Column dropped: " << colName << "\n";
+    checkpointIntervalMs = ms;
+    std::lock_guard<std::mutex> lock(flushMutex);
+    flushRequested = true;
+    flushCv.notify_one();
 }
 
 /**
- * @brief 对指定表的某一列执行聚合函数
+ * @brief 设置提前触发检查点的脏数据量
  *
- * 支持的聚合函数包括：
- * - COUNT : 统计非 "NULL" 值的行数
- * - SUM   : 计算数值型列的总和
- * - AVG   : 计算数值型列的平均值（忽略 "NULL" 与空值）
- * - MIN   : 获取数值型列的最小值
- * - MAX   : 获取数值型列的最大值
+ * @param bytes 自上次检查点以来提交的重做日志字节数，必须为正
+ */
+void sqlDB::setCheckpointThreshold(uint64_t bytes)
+{
+    if (bytes == 0)
+    {
+        dbOut() << "Invalid checkpoint threshold: " << bytes << "\n";
+        return;
+    }
+    checkpointBytes = bytes;
+    std::lock_guard<std::mutex> lock(flushMutex);
+    flushRequested = true;
+    flushCv.notify_one();
+}
+
+/**
+ * @brief 设置查询结果缓存的容量
  *
- * @param name 表名（不区分大小写，内部统一转换为小写）
- * @param func 聚合函数名称（COUNT, SUM, AVG, MIN, MAX，大小写敏感）
- * @param col 目标列名
+ * 开启后，不在事务中的 SELECT（含区间、LIKE 条件）与聚合按 表名 + 条件 + 排序 + LIMIT 缓存输出的文本；
+ * 表每次提交、增删列后版本递增，之后的查找发现版本不同即丢弃旧结果，写路径不需要清理缓存。
+ * 单个结果超过容量的 1/4 时不缓存；缩小容量时立即淘汰到新容量以内。
+ *
+ * @param bytes 字节数，0 表示关闭并清空缓存（默认）
+ */
+void sqlDB::setResultCacheSize(size_t bytes)
+{
+    results.setCapacity(bytes);
+}
+
+/**
+ * @brief 在当前线程开启显式事务
+ *
+ * 事务开始时取快照并登记（回收旧版本时不会越过它），之后本线程的查询都在该快照上进行，
+ * 增删改产生的版本带事务标记，提交前对其他线程不可见。
  *
  * @note
- * - 若表不存在，会输出 `"Table not found."`
- * - 若列不存在，会输出 `"Column not found."`
- * - 对非数值型数据执行 SUM/AVG/MIN/MAX 时，无法转换的值会被忽略并打印异常信息
- * - 返回结果直接通过 `std::cout` 输出
+ * - 已有进行中的事务时，输出 `"Transaction already in progress."`
+ * - 成功后输出 `"Transaction started."`
+ */
+void sqlDB::begin()
+{
+    StatementScope stmt(*this, StatementKind::TXN);
+    if (activeTxn())
+    {
+        dbOut() << "Transaction already in progress.\n";
+        return;
+    }
+    auto txn = std::make_shared<Transaction>();
+    txn->owner = this;
+    txn->marker = txns.beginTxn();
+    txn->snap = txns.beginSnapshot(txn->marker);
+    currentTxn = std::move(txn);
+    dbOut() << "Transaction started.\n";
+}
+
+/**
+ * @brief 提交当前线程的事务
  *
- * @example
- * @code
- * sqlDB db;
- * std::string col = "salary";
- * db.aggregate("employees", "SUM", col);   // 输出 SUM(salary)
- * db.aggregate("employees", "AVG", col);   // 输出 AVG(salary)
- * db.aggregate("employees", "COUNT", col); // 输出 COUNT(salary)
- * @endcode
+ * 按表名顺序锁住写过的表，在一次提交中把所有版本的事务标记替换为提交时间戳，
+ * 同时把重做记录追加到日志缓冲区；释放表锁后等待日志落盘（组提交），
+ * 并发提交的事务由第一个到达的线程一次 fsync 全部刷盘。
+ *
+ * @note
+ * - 没有进行中的事务时，输出 `"No transaction in progress."`
+ * - 事务期间被删除的表上的修改被丢弃
+ * - 成功后输出 `"Transaction committed."`
  */
-void sqlDB::aggregate(const std::string &name, const std::string &func, std::string &col)
+void sqlDB::commit()
 {
-    std::string lname = name;
-    std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
-    if (!tables.count(lname))
+    StatementScope stmt(*this, StatementKind::TXN);
+    std::shared_ptr<Transaction> txn = activeTxn();
+    if (!txn)
     {
-        std::cout << "Table not found. \n";
+        dbOut() << "No transaction in progress.\n";
         return;
     }
-    Table &t = tables[lname];
-    int idx = t.getColumnIndex(col);
-    if (idx == -1)
+    currentTxn.reset();
+    std::vector<DmlTable> locked;
+    locked.reserve(txn->writes.size());
+    for (auto &w : txn->writes)
+        locked.emplace_back(w.second.entry);
+
+    uint64_t lsn = 0;
+    std::vector<size_t> bytes(txn->writes.size());
+    if (!txn->writes.empty())
+    {
+        txns.commit([&](uint64_t ts)
+                    {
+                        std::string redo;
+                        size_t k = 0;
+                        for (auto &w : txn->writes)
+                        {
+                            if (!locked[k++])
+                                continue;
+                            Table &t = w.second.entry->table;
+                            t.publish(w.second.ws, ts);
+                            applyViews(*w.second.entry, w.second.ws, ts);
+                            size_t before = redo.size();
+                            encodeWrites(redo, w.first, t, w.second.ws, ts);
+                            bytes[k - 1] = redo.size() - before;
+                        }
+                        redo += commitRecord(ts);
+                        noteBytesWritten(redo.size());
+                        lsn = wal.append(redo); });
+    }
+    size_t k = 0;
+    for (auto &w : txn->writes)
+    {
+        if (!locked[k++])
+            continue;
+        touch(*w.second.entry);
+        markDirty(*w.second.entry, bytes[k - 1]);
+        w.second.entry->table.openTxns--;
+        scheduleCompaction(w.first, w.second.entry->table);
+    }
+    locked.clear();
+    txns.endSnapshot(txn->snap);
+    if (!awaitDurable(lsn))
+        return;
+    dbOut() << "Transaction committed.\n";
+}
+
+/**
+ * @brief 回滚当前线程的事务
+ *
+ * @note
+ * - 没有进行中的事务时，输出 `"No transaction in progress."`
+ * - 成功后输出 `"Transaction rolled back."`
+ */
+void sqlDB::rollback()
+{
+    StatementScope stmt(*this, StatementKind::TXN);
+    std::shared_ptr<Transaction> txn = activeTxn();
+    if (!txn)
     {
-        std::cout << "Column not found. \n";
+        dbOut() << "No transaction in progress.\n";
         return;
     }
-    if (func == "COUNT")
+    currentTxn.reset();
+    rollbackTxn(*txn);
+    dbOut() << "Transaction rolled back.\n";
+}
+
+bool sqlDB::inTransaction() const
+{
+    return activeTxn() != nullptr;
+}
+
+std::shared_ptr<Transaction> sqlDB::detachTransaction()
+{
+    std::shared_ptr<Transaction> txn = activeTxn();
+    if (txn)
+        currentTxn.reset();
+    return txn;
+}
+
+void sqlDB::attachTransaction(std::shared_ptr<Transaction> txn)
+{
+    currentTxn = txn && txn->owner == this ? std::move(txn) : nullptr;
+}
+
+void sqlDB::rollbackTxn(Transaction &txn)
+{
+    for (auto &w : txn.writes)
     {
-        int count = 0;
-        for (auto &row : t.rows)
-            if (row.values[idx] != "NULL")
-                count++;
-        std::cout << "COUNT(" << col << ") = " << count << std::endl;
+        DmlTable entry(w.second.entry);
+        if (!entry)
+            continue;
+        entry->table.rollback(w.second.ws);
+        entry->table.openTxns--;
+        scheduleCompaction(w.first, entry->table);
     }
-    else if (func == "SUM" || func == "AVG")
+    txn.writes.clear();
+    txns.endSnapshot(txn.snap);
+}
+
+uint64_t sqlDB::finishWrite(const std::vector<TableWrite> &writes, Transaction *txn)
+{
+    std::vector<const TableWrite *> changed;
+    for (const auto &w : writes)
+        if (!w.ws.empty())
+            changed.push_back(&w);
+    if (changed.empty())
+        return 0;
+    if (txn)
     {
-        double sum = 0;
-        int count = 0;
-        for (const auto &row : t.rows)
+        for (const TableWrite *w : changed)
         {
-            if (!row.values[idx].empty() && row.values[idx] != "NULL")
+            auto &tw = txn->writes[w->lname];
+            if (tw.entry != w->entry)
             {
-                try
-                {
-                    sum += std::stod(row.values[idx]);
-                    ++count;
-                }
-                catch (const std::exception &e)
-                {
-                    std::cerr << e.what() << '\n';
-                }
+                // 首次写该表，或同名表在事务期间被删除后重建（旧表上的修改随之作废）
+                if (tw.entry)
+                    tw.entry->table.openTxns--;
+                tw.entry = w->entry;
+                tw.ws = WriteSet();
+                w->entry->table.openTxns++;
             }
+            tw.ws.inserted.insert(tw.ws.inserted.end(), w->ws.inserted.begin(), w->ws.inserted.end());
+            tw.ws.ended.insert(tw.ws.ended.end(), w->ws.ended.begin(), w->ws.ended.end());
         }
-        if (func == "SUM")
-            std::cout << "SUM(" << col << ") = " << sum << std::endl;
-        else if (count > 0)
-            std::cout << "AVG(" << col << ") = " << (sum / count) << std::endl;
-        else
-            std::cout << "AVG(" << col << ") = NULL\n";
+        return 0;
     }
-    else if (func == "MIN")
-    {
-        double minVal = std::numeric_limits<double>::max();
-        bool found = false;
-        for (auto &row : t.rows)
-        {
-            if (!row.values[idx].empty() && row.values[idx] != "NULL")
-            {
-                try
+    // 一条语句修改的各表（分区）在同一次提交中生效
+    uint64_t lsn = 0;
+    std::vector<size_t> bytes(changed.size());
+    txns.commit([&](uint64_t ts)
                 {
-                    double v = std::stod(row.values[idx]);
-                    if (!found || v < minVal)
+                    std::string redo;
+                    for (size_t k = 0; k < changed.size(); k++)
                     {
-                        minVal = v;
-                        found = true;
+                        Table &t = changed[k]->entry->table;
+                        t.publish(changed[k]->ws, ts);
+                        applyViews(*changed[k]->entry, changed[k]->ws, ts);
+                        size_t before = redo.size();
+                        encodeWrites(redo, changed[k]->lname, t, changed[k]->ws, ts);
+                        bytes[k] = redo.size() - before;
                     }
-                }
-                catch (const std::exception &e)
-                {
-                    std::cerr << e.what() << '\n';
-                }
-            }
-        }
-        if (found)
-            std::cout << "MIN(" << col << ") = " << minVal << std::endl;
-        else
-            std::cout << "MIN(" << col << ") = NULL\n";
+                    redo += commitRecord(ts);
+                    noteBytesWritten(redo.size());
+                    lsn = wal.append(redo); });
+    for (size_t k = 0; k < changed.size(); k++)
+    {
+        touch(*changed[k]->entry);
+        markDirty(*changed[k]->entry, bytes[k]);
+        scheduleCompaction(changed[k]->lname, changed[k]->entry->table);
     }
-    else if (func == "MAX")
+    return lsn;
+}
+
+void sqlDB::abortWrite(const std::string &lname, Transaction *txn)
+{
+    if (!txn)
     {
-        double maxVal = std::numeric_limits<double>::lowest();
-        bool found = false;
-        for (const auto &row : t.rows)
-        {
-            if (row.values[idx] != "NULL" && !row.values[idx].empty())
-            {
-                try
-                {
-                    double v = std::stod(row.values[idx]);
-                    if (!found || v > maxVal)
-                    {
-                        maxVal = v;
-                        found = true;
-                    }
-                }
-                catch (...)
+        dbOut() << "Write conflict on table " << lname << ", statement aborted.\n";
+        return;
+    }
+    currentTxn.reset();
+    rollbackTxn(*txn);
+    dbOut() << "Write conflict on table " << lname << ", transaction rolled back.\n";
+}
+
+uint64_t sqlDB::logSchemaChange(const std::string &lname, TableEntry &entry, const std::string &change)
+{
+    LogRecord r;
+    r.op = LogRecord::ALTER;
+    r.table = lname;
+    r.values = {change};
+    uint64_t lsn = 0;
+    txns.commit([&](uint64_t ts)
                 {
-                }
-            }
-        }
-        if (found)
-            std::cout << "MAX(" << col << ") = " << maxVal << "\n";
-        else
-            std::cout << "MAX(" << col << ") = NULL\n";
+                    r.ts = ts;
+                    std::string redo = r.encode() + commitRecord(ts);
+                    noteBytesWritten(redo.size());
+                    lsn = wal.append(redo); });
+    touch(entry);
+    markDirty(entry, r.encode().size());
+    return lsn;
+}
+
+template <class Fn>
+uint64_t sqlDB::alterPartitions(const std::string &lname, const TableEntry &parent, Fn &&change)
+{
+    std::shared_ptr<const PartitionScheme> scheme = std::atomic_load(&parent.partitions);
+    if (!scheme)
+        return 0;
+    uint64_t lsn = 0;
+    for (size_t k = 0; k < scheme->parts.size(); k++)
+    {
+        std::string part = scheme->tableName(lname, k);
+        DdlTable entry(findTable(part));
+        if (!entry)
+            continue;
+        std::string record = change(entry->table);
+        lsn = std::max(lsn, logSchemaChange(part, *entry.get(), record));
+        scheduleCompaction(part, entry->table);
     }
-    else
+    return lsn;
+}
+
+void sqlDB::touch(TableEntry &entry)
+{
+    entry.version.store(++versionClock);
+    if (entry.partitionOf.empty())
+        return;
+    if (std::shared_ptr<TableEntry> parent = findTable(entry.partitionOf))
+        parent->version.store(++versionClock);
+}
+
+bool sqlDB::awaitDurable(uint64_t lsn)
+{
+    if (!lsn)
+        return true;
+    TRACE_SPAN("RedoLog::waitDurable");
+    bool durable;
+    std::string error;
+    timedPersist([&]
+                 { durable = wal.waitDurable(lsn, error); });
+    if (!durable)
+        dbErr() << "Redo log " << error << ", changes are not durable.\n";
+    return durable;
+}
+
+void sqlDB::markDirty(TableEntry &entry, uint64_t bytes)
+{
+    // 先加总量再加表：检查点从总量中减去的永远不超过已加上的
+    uint64_t before = dirtyBytes.fetch_add(bytes);
+    entry.dirtyBytes += bytes;
+    uint64_t limit = checkpointBytes.load();
+    if (before < limit && before + bytes >= limit)
     {
-        std::cout << "Unknown aggregate function.\n";
+        std::lock_guard<std::mutex> lock(flushMutex);
+        flushRequested = true;
+        flushCv.notify_one();
     }
 }
 
 /**
- * @brief 获取数据库中所有表的名称列表
- * @return std::vector<std::string> 包含所有表名称的向量
+ * @brief 检查点写出按需分页的表之后，把它的行存储改为分页打开新文件
+ *
+ * 新文件只包含 ts 时可见的行，因此要求期间没有新的提交、没有未提交的写入、
+ * 也没有 ts 之前的事务快照；之后内存中只剩各段的元数据，已结束的版本与追加的行都被释放。
+ * 拿不到独占锁或条件不满足时留到下一次检查点，前台语句不会等待它。
  */
-std::vector<std::string> sqlDB::listTables() const
+void sqlDB::remapTable(TableEntry &entry, const std::string &lname, const TableFileIndex &index, uint64_t ts)
 {
-    std::vector<std::string> names;
-    for (const auto &pair : tables)
-        names.push_back(pair.first);
-    return names;
-}
\ No newline at end of file
+    std::unique_lock<std::shared_mutex> lock(entry.latch, std::try_to_lock);
+    if (!lock.owns_lock() || entry.dropped || entry.dirtyBytes.load() != 0 || entry.table.openTxns > 0 ||
+        txns.gcHorizon() < ts)
+        return;
+    entry.table.remap(lname, index);
+}
+
+/**
+ * @brief 后台检查点线程主循环
+ *
+ * 每隔 checkpointIntervalMs，或脏数据超过 checkpointBytes、修改了这两项设置时被提前唤醒，
+ * 调用 saveAll() 把有修改的表写入表文件并截断重做日志。
+ * 检查点只共享持有表锁生成文件内容，写盘时不持有锁，前台语句不会等待它。
+ */
+void sqlDB::flushLoop()
+{
+    std::unique_lock<std::mutex> lock(flushMutex);
+    while (!flushStopping)
+    {
+        flushCv.wait_for(lock, std::chrono::milliseconds(checkpointIntervalMs.load()), [this]
+                         { return flushStopping || flushRequested; });
+        flushRequested = false;
+        if (flushStopping || dirtyBytes.load() == 0)
+            continue;
+        lock.unlock();
+        saveAll();
+        lock.lock();
+    }
+}
+
+/**
+ * @brief 后台压缩线程主循环
+ *
+ * 等待 deleteRows 提交的待压缩表，逐个调用 `Table::compact()`
+ * 回收不再被任何快照（包括进行中事务的快照）看到的行版本。
+ * 压缩只改变内存中的行号，不影响表文件与重做日志，二者都按行内容记录。
+ * 压缩期间独占持有该表的锁，不影响其他表的读写。
+ * 析构时 `stopping` 置位后退出，未处理的表留待下次删除或 saveAll 时处理。
+ */
+void sqlDB::compactionLoop()
+{
+    while (true)
+    {
+        std::string lname;
+        {
+            std::unique_lock<std::mutex> lock(compactMutex);
+            compactCv.wait(lock, [this]
+                           { return stopping || !pendingCompaction.empty(); });
+            if (stopping)
+                return;
+            lname = *pendingCompaction.begin();
+            pendingCompaction.erase(pendingCompaction.begin());
+        }
+        DdlTable entry(findTable(lname));
+        if (!entry || !entry->table.needsCompaction(compactionRatio))
+            continue;
+        entry->table.compact(txns.gcHorizon());
+    }
+}
+
+void sqlDB::scheduleCompaction(const std::string &lname, const Table &t)
+{
+    if (!t.needsCompaction(compactionRatio))
+        return;
+    {
+        std::lock_guard<std::mutex> lock(compactMutex);
+        pendingCompaction.insert(lname);
+    }
+    compactCv.notify_one();
+}
@@ -0,0 +1,218 @@
+#include "extsort.h"
+#include "table.h"
+#include <fstream>
+#include <queue>
+#include <atomic>
+#include <algorithm>
+#include <cstdio>
+
+static std::atomic<uint64_t> nextSortId{0}; ///< 进程内的排序编号，保证并发查询的临时文件不重名
+
+/**
+ * @brief 写出一条记录：键长、内容长度（各 4 字节）后跟键与内容
+ */
+static void writeRecord(std::ofstream &out, const std::string &key, const std::string &payload)
+{
+    uint32_t lens[2] = {uint32_t(key.size()), uint32_t(payload.size())};
+    out.write(reinterpret_cast<const char *>(lens), sizeof(lens));
+    out.write(key.data(), std::streamsize(key.size()));
+    out.write(payload.data(), std::streamsize(payload.size()));
+}
+
+/**
+ * @brief 读取下一条记录
+ * @param broken 输出文件是否在记录中间结束或读取出错（正常读到文件末尾时为 false）
+ * @return 读到一条完整记录时返回 true
+ */
+static bool readRecord(std::ifstream &in, std::string &key, std::string &payload, bool &broken)
+{
+    uint32_t lens[2];
+    if (!in.read(reinterpret_cast<char *>(lens), sizeof(lens)))
+    {
+        broken = in.gcount() != 0 || in.bad();
+        return false;
+    }
+    key.resize(lens[0]);
+    payload.resize(lens[1]);
+    in.read(&key[0], lens[0]);
+    in.read(&payload[0], lens[1]);
+    broken = !in;
+    return !broken;
+}
+
+ExternalSorter::ExternalSorter(MemoryReservation &m, bool d)
+    : mem(m), desc(d), id(nextSortId.fetch_add(1))
+{
+}
+
+ExternalSorter::~ExternalSorter()
+{
+    for (const auto &path : runs)
+        std::remove(path.c_str());
+}
+
+void ExternalSorter::add(std::string_view key, std::string payload)
+{
+    if (!valid())
+        return;
+    size_t bytes = sizeof(Record) + key.size() + payload.size();
+    if (!mem.grow(bytes) && !buffer.empty())
+    {
+        spill();
+        if (!valid())
+            return;
+        // 单条记录总要放进缓冲区；预算仍不够时不计入，下次写出时一并清空
+        mem.grow(bytes);
+    }
+    buffer.push_back({std::string(key), std::move(payload)});
+}
+
+void ExternalSorter::sortBuffer()
+{
+    // 稳定排序：键相同的记录保持加入顺序，与各有序段按编号归并的顺序一致
+    std::stable_sort(buffer.begin(), buffer.end(), [this](const Record &a, const Record &b)
+                     { return desc ? a.key > b.key : a.key < b.key; });
+}
+
+std::string ExternalSorter::runPath()
+{
+    return getDbPath("sort_" + std::to_string(id) + "_" + std::to_string(nextRun++), ".sortrun");
+}
+
+void ExternalSorter::spill()
+{
+    sortBuffer();
+    std::string path = runPath();
+    bool written;
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+        {
+            err = "Cannot create sort run file: " + path;
+            return;
+        }
+        for (const auto &r : buffer)
+            writeRecord(out, r.key, r.payload);
+        out.close();
+        written = !out.fail();
+    }
+    if (!written)
+    {
+        // 例如磁盘已满：丢弃写了一半的文件，排序作废
+        std::remove(path.c_str());
+        err = "Cannot write sort run file: " + path;
+        std::vector<Record>().swap(buffer);
+        mem.reset();
+        return;
+    }
+    runs.push_back(path);
+    std::vector<Record>().swap(buffer);
+    mem.reset();
+}
+
+bool ExternalSorter::mergeRuns(size_t first, size_t last, bool withBuffer, const std::function<bool(Record &)> &emit)
+{
+    // 数据源 0..k-1 为有序段文件，withBuffer 时最后一个为内存中的缓冲区；先打开全部文件，打不开时不输出任何记录
+    size_t k = last - first;
+    std::vector<std::ifstream> files;
+    files.reserve(k);
+    for (size_t i = first; i < last; i++)
+    {
+        files.emplace_back(runs[i], std::ios::binary);
+        if (!files.back().is_open())
+        {
+            err = "Cannot open sort run file: " + runs[i];
+            return false;
+        }
+    }
+    std::vector<Record> head(k + 1);
+    size_t memPos = 0;
+    bool broken = false;
+    auto advance = [&](size_t src)
+    {
+        if (src < k)
+        {
+            if (readRecord(files[src], head[src].key, head[src].payload, broken))
+                return true;
+            if (broken)
+                err = "Corrupted sort run file: " + runs[first + src];
+            return false;
+        }
+        if (memPos == buffer.size())
+            return false;
+        head[src] = std::move(buffer[memPos++]);
+        return true;
+    };
+    // 堆顶为下一条要输出的记录；键相同时编号小（先写出）的数据源优先
+    auto after = [&](size_t a, size_t b)
+    {
+        if (head[a].key != head[b].key)
+            return desc ? head[a].key < head[b].key : head[a].key > head[b].key;
+        return a > b;
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(after)> heap(after);
+    for (size_t i = 0; i < k + (withBuffer ? 1 : 0); i++)
+        if (advance(i))
+            heap.push(i);
+    while (valid() && !heap.empty())
+    {
+        size_t src = heap.top();
+        heap.pop();
+        if (!emit(head[src]))
+            break;
+        if (advance(src))
+            heap.push(src);
+    }
+    return valid();
+}
+
+bool ExternalSorter::reduceRuns()
+{
+    while (runs.size() > kMaxFanIn)
+    {
+        // 相邻的段归并后仍在原来的位置，键相同的记录保持写出顺序
+        std::vector<std::string> merged;
+        for (size_t first = 0; first < runs.size(); first += kMaxFanIn)
+        {
+            size_t last = std::min(runs.size(), first + kMaxFanIn);
+            if (last - first == 1)
+            {
+                merged.push_back(runs[first]);
+                continue;
+            }
+            std::string path = runPath();
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            bool ok = out.is_open();
+            if (ok)
+                ok = mergeRuns(first, last, false, [&](Record &r)
+                               {
+                                   writeRecord(out, r.key, r.payload);
+                                   return bool(out); });
+            out.close();
+            if (!valid() || !ok || out.fail())
+            {
+                std::remove(path.c_str());
+                if (valid())
+                    err = "Cannot write sort run file: " + path;
+                // 已归并的段与尚未处理的段都交给析构函数删除
+                merged.insert(merged.end(), runs.begin() + long(first), runs.end());
+                runs.swap(merged);
+                return false;
+            }
+            for (size_t i = first; i < last; i++)
+                std::remove(runs[i].c_str());
+            merged.push_back(path);
+        }
+        runs.swap(merged);
+    }
+    return true;
+}
+
+bool ExternalSorter::merge(const std::function<bool(const std::string &)> &emit)
+{
+    if (!valid() || !reduceRuns())
+        return false;
+    sortBuffer();
+    return mergeRuns(0, runs.size(), true, [&](Record &r)
+                     { return emit(r.payload); });
+}
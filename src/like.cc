@@ -0,0 +1,231 @@
+#include "like.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static inline unsigned char lowerAscii(unsigned char c)
+{
+    return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+static inline unsigned char upperAscii(unsigned char c)
+{
+    return c >= 'a' && c <= 'z' ? c - ('a' - 'A') : c;
+}
+
+static std::string lowered(std::string_view s)
+{
+    std::string out(s);
+    for (char &c : out)
+        c = char(lowerAscii((unsigned char)c));
+    return out;
+}
+
+/**
+ * @brief a 的前 n 个字节转为小写后是否等于 b（b 已是小写）
+ */
+static bool equalCaseless(const char *a, const char *b, size_t n)
+{
+    for (size_t k = 0; k < n; k++)
+        if (lowerAscii((unsigned char)a[k]) != (unsigned char)b[k])
+            return false;
+    return true;
+}
+
+size_t findCaseless(std::string_view haystack, std::string_view needle)
+{
+    size_t m = needle.size(), n = haystack.size();
+    if (m == 0)
+        return 0;
+    if (n < m)
+        return std::string_view::npos;
+    const char *h = haystack.data();
+    unsigned char first = (unsigned char)needle[0], last = (unsigned char)needle[m - 1];
+    // 首尾字节已比较过，只需比较中间部分
+    const char *middle = needle.data() + 1;
+    size_t middleLen = m > 2 ? m - 2 : 0;
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i firstLo = _mm_set1_epi8(char(first)), firstUp = _mm_set1_epi8(char(upperAscii(first)));
+    const __m128i lastLo = _mm_set1_epi8(char(last)), lastUp = _mm_set1_epi8(char(upperAscii(last)));
+    // 第 i..i+15 个位置：一次载入各自的首字节，一次载入各自的末字节
+    for (; i + m - 1 + 16 <= n; i += 16)
+    {
+        __m128i heads = _mm_loadu_si128(reinterpret_cast<const __m128i *>(h + i));
+        __m128i tails = _mm_loadu_si128(reinterpret_cast<const __m128i *>(h + i + m - 1));
+        __m128i eqFirst = _mm_or_si128(_mm_cmpeq_epi8(heads, firstLo), _mm_cmpeq_epi8(heads, firstUp));
+        __m128i eqLast = _mm_or_si128(_mm_cmpeq_epi8(tails, lastLo), _mm_cmpeq_epi8(tails, lastUp));
+        unsigned mask = unsigned(_mm_movemask_epi8(_mm_and_si128(eqFirst, eqLast)));
+        while (mask)
+        {
+            size_t k = i + size_t(__builtin_ctz(mask));
+            if (equalCaseless(h + k + 1, middle, middleLen))
+                return k;
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i + m <= n; i++)
+        if (lowerAscii((unsigned char)h[i]) == first && lowerAscii((unsigned char)h[i + m - 1]) == last &&
+            equalCaseless(h + i + 1, middle, middleLen))
+            return i;
+    return std::string_view::npos;
+}
+
+LikePattern::LikePattern(std::string_view pattern)
+{
+    std::string p = lowered(pattern);
+    size_t start = 0;
+    for (size_t pct; (pct = p.find('%', start)) != std::string::npos; start = pct + 1)
+        segments.push_back(p.substr(start, pct - start));
+    segments.push_back(p.substr(start));
+    lead = segments.front().substr(0, segments.front().find('_'));
+    for (const std::string &seg : segments)
+    {
+        size_t from = 0;
+        for (size_t u; from <= seg.size(); from = u + 1)
+        {
+            u = std::min(seg.find('_', from), seg.size());
+            if (u > from)
+                runs.push_back(seg.substr(from, u - from));
+        }
+    }
+}
+
+bool LikePattern::matchAt(std::string_view s, size_t pos, const std::string &seg)
+{
+    if (pos > s.size() || s.size() - pos < seg.size())
+        return false;
+    for (size_t k = 0; k < seg.size(); k++)
+        if (seg[k] != '_' && lowerAscii((unsigned char)s[pos + k]) != (unsigned char)seg[k])
+            return false;
+    return true;
+}
+
+size_t LikePattern::find(std::string_view s, size_t from, const std::string &seg)
+{
+    if (from > s.size())
+        return std::string_view::npos;
+    if (seg.find('_') == std::string::npos)
+    {
+        size_t k = findCaseless(s.substr(from), seg);
+        return k == std::string_view::npos ? k : from + k;
+    }
+    for (size_t pos = from; pos + seg.size() <= s.size(); pos++)
+        if (matchAt(s, pos, seg))
+            return pos;
+    return std::string_view::npos;
+}
+
+bool LikePattern::matches(std::string_view s) const
+{
+    const std::string &head = segments.front();
+    if (segments.size() == 1)
+        return s.size() == head.size() && matchAt(s, 0, head);
+    const std::string &tail = segments.back();
+    if (s.size() < head.size() + tail.size() || !matchAt(s, 0, head) || !matchAt(s, s.size() - tail.size(), tail))
+        return false;
+    // 中间片段只能出现在开头与结尾片段之间
+    std::string_view body = s.substr(0, s.size() - tail.size());
+    size_t pos = head.size();
+    for (size_t k = 1; k + 1 < segments.size(); k++)
+    {
+        if (segments[k].empty())
+            continue;
+        size_t at = find(body, pos, segments[k]);
+        if (at == std::string_view::npos)
+            return false;
+        pos = at + segments[k].size();
+    }
+    return true;
+}
+
+/**
+ * @brief 小写字节串 s 在 k 处的三元组
+ */
+static inline uint32_t trigramAt(std::string_view s, size_t k)
+{
+    return uint32_t((unsigned char)s[k]) << 16 | uint32_t((unsigned char)s[k + 1]) << 8 | (unsigned char)s[k + 2];
+}
+
+void TextIndex::add(std::string_view value, size_t row)
+{
+    std::string v = lowered(value);
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    if (kinds & kTrigram)
+        for (size_t k = 0; k + 3 <= v.size(); k++)
+        {
+            // 并发的写者可能不按下标顺序加入，插入到有序位置
+            std::vector<size_t> &posting = trigrams[trigramAt(v, k)];
+            auto at = std::lower_bound(posting.begin(), posting.end(), row);
+            if (at == posting.end() || *at != row)
+                posting.insert(at, row);
+        }
+    if (kinds & kSorted)
+        byValue.emplace(std::move(v), row);
+}
+
+bool TextIndex::usable(const LikePattern &pattern) const
+{
+    if ((kinds & kSorted) && !pattern.prefix().empty())
+        return true;
+    if (kinds & kTrigram)
+        for (const std::string &run : pattern.literals())
+            if (run.size() >= 3)
+                return true;
+    return false;
+}
+
+bool TextIndex::candidates(const LikePattern &pattern, std::vector<size_t> &out) const
+{
+    out.clear();
+    if (!usable(pattern))
+        return false;
+    std::vector<uint32_t> grams;
+    if (kinds & kTrigram)
+        for (const std::string &run : pattern.literals())
+            for (size_t k = 0; k + 3 <= run.size(); k++)
+                grams.push_back(trigramAt(run, k));
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    std::vector<const std::vector<size_t> *> postings;
+    for (uint32_t g : grams)
+    {
+        auto it = trigrams.find(g);
+        if (it == trigrams.end())
+            return true; // 某个三元组没有出现过，没有候选
+        postings.push_back(&it->second);
+    }
+    // 从最短的列表开始求交，中间结果只会变小
+    std::sort(postings.begin(), postings.end(), [](const std::vector<size_t> *a, const std::vector<size_t> *b)
+              { return a->size() < b->size(); });
+    const std::string &prefix = pattern.prefix();
+    if ((kinds & kSorted) && !prefix.empty())
+    {
+        // 前缀很短（如 'user_1234%' 的前缀只到 _ 为止）时范围可能很大，
+        // 超过最短的三元组列表后改用三元组索引
+        size_t bound = postings.empty() ? SIZE_MAX : postings.front()->size();
+        for (auto it = byValue.lower_bound(prefix); it != byValue.end() && it->first.compare(0, prefix.size(), prefix) == 0 && out.size() <= bound; ++it)
+            out.push_back(it->second);
+        if (out.size() <= bound)
+        {
+            std::sort(out.begin(), out.end());
+            return true;
+        }
+    }
+    out = *postings.front();
+    std::vector<size_t> next;
+    for (size_t k = 1; k < postings.size() && !out.empty(); k++)
+    {
+        next.clear();
+        std::set_intersection(out.begin(), out.end(), postings[k]->begin(), postings[k]->end(), std::back_inserter(next));
+        out.swap(next);
+    }
+    return true;
+}
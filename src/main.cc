@@ -1,12 +1,32 @@
 #include "db.h"
 #include "parser.h"
+#include "trace.h"
+#include <iostream>
 #include <filesystem>
+#include <cstdlib>
 #include <vector>
 #include <string>
 
-int main()
+int main(int argc, char **argv)
 {
     sqlDB db;
+    // minidb [--slow-ms 毫秒] [--result-cache-mb 兆字节] [--trace 文件]
+    // --slow-ms：耗时超过阈值的语句记录到数据目录下的 slow_query.log
+    // --result-cache-mb：开启查询结果缓存，重复的只读查询在表没有新提交时直接返回上次的结果
+    // --trace：记录各阶段的耗时，退出时写成 Chrome trace JSON（需以 -DMINIDB_TRACE 编译）
+    std::string tracePath;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opt = argv[i];
+        if (opt == "--slow-ms")
+            db.setSlowQueryLog(std::atof(argv[i + 1]));
+        else if (opt == "--result-cache-mb")
+            db.setResultCacheSize(size_t(std::atoll(argv[i + 1])) << 20);
+        else if (opt == "--trace")
+            tracePath = argv[i + 1];
+    }
+    if (!tracePath.empty() && !Tracer::enable(true))
+        std::cerr << "Tracing is not compiled in, rebuild with -DMINIDB_TRACE\n";
     std::filesystem::path dbDir = std::filesystem::path(std::getenv("HOME")) /  "miniDB/mydb_data";
     std::vector<std::string> tableNames;
     if (std::filesystem::exists(dbDir))
@@ -23,5 +43,7 @@ int main()
     db.loadAll(tableNames);
     runSQLConsole(db);
     db.saveAll();
+    if (Tracer::enabled() && !Tracer::dump(tracePath))
+        std::cerr << "Cannot write trace file: " << tracePath << "\n";
     return 0;
 }
\ No newline at end of file
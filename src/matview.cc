@@ -0,0 +1,275 @@
+#include "matview.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+static bool equalsIgnoreCase(const std::string &a, const std::string &b)
+{
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y)
+                                              { return std::tolower((unsigned char)x) == std::tolower((unsigned char)y); });
+}
+
+AggregateView::AggregateView(std::string name, std::string table, std::string key, std::vector<ViewColumn> cols)
+    : viewName(std::move(name)), baseTable(std::move(table)), keyColumn(std::move(key)), outputs(std::move(cols))
+{
+    for (const ViewColumn &c : outputs)
+    {
+        if (c.column == "*")
+        {
+            measureOf.push_back(-1);
+            continue;
+        }
+        auto it = std::find_if(measures.begin(), measures.end(), [&](const std::string &m)
+                               { return equalsIgnoreCase(m, c.column); });
+        measureOf.push_back(int(it - measures.begin()));
+        if (it == measures.end())
+            measures.push_back(c.column);
+    }
+}
+
+bool AggregateView::uses(const std::string &col) const
+{
+    if (equalsIgnoreCase(keyColumn, col))
+        return true;
+    for (const std::string &m : measures)
+        if (equalsIgnoreCase(m, col))
+            return true;
+    return false;
+}
+
+bool AggregateView::bind(const Table &t, std::string &error) const
+{
+    if (t.getColumnIndex(keyColumn) == -1)
+    {
+        error = "Column not found: " + keyColumn;
+        return false;
+    }
+    for (const std::string &m : measures)
+        if (t.getColumnIndex(m) == -1)
+        {
+            error = "Column not found: " + m;
+            return false;
+        }
+    return true;
+}
+
+int AggregateView::resolve(const Table &t, std::vector<int> &args) const
+{
+    args.clear();
+    for (const std::string &m : measures)
+        args.push_back(t.getColumnIndex(m));
+    return t.getColumnIndex(keyColumn);
+}
+
+void AggregateView::addRow(const Table &t, const RowRef &row, size_t keyCol, const std::vector<int> &args, int sign)
+{
+    auto it = groups.find(std::string(t.cell(row, keyCol)));
+    if (it == groups.end())
+    {
+        if (sign < 0)
+            return; // 视图与基表一致时不会发生
+        it = groups.emplace(std::string(t.cell(row, keyCol)), Group()).first;
+        it->second.sums.assign(measures.size(), 0);
+        it->second.counts.assign(measures.size(), 0);
+    }
+    Group &g = it->second;
+    g.rows += sign;
+    if (g.rows <= 0)
+    {
+        groups.erase(it);
+        return;
+    }
+    for (size_t m = 0; m < args.size(); m++)
+    {
+        if (args[m] < 0 || t.isNull(row, size_t(args[m])))
+            continue;
+        std::string value(t.cell(row, size_t(args[m])));
+        char *end;
+        double v = std::strtod(value.c_str(), &end);
+        if (end == value.c_str())
+            continue;
+        g.counts[m] += sign;
+        g.sums[m] += sign * v;
+        // 值全部减去后归零，不留下浮点误差
+        if (g.counts[m] == 0)
+            g.sums[m] = 0;
+    }
+}
+
+void AggregateView::rebuild(const std::vector<const Table *> &sources, const Snapshot &snap, uint64_t ts)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    groups.clear();
+    std::vector<int> args;
+    for (const Table *t : sources)
+    {
+        int keyCol = resolve(*t, args);
+        if (keyCol < 0)
+            continue;
+        for (size_t i = 0; i < t->rows.size(); i++)
+            if (t->visible(i, snap))
+                addRow(*t, t->rows[i], size_t(keyCol), args, 1);
+    }
+    appliedTs = ts;
+    changed = true;
+}
+
+void AggregateView::apply(const Table &t, const WriteSet &ws, uint64_t ts)
+{
+    std::vector<int> args;
+    int keyCol = resolve(t, args);
+    std::lock_guard<std::mutex> lock(mtx);
+    appliedTs = ts;
+    changed = true;
+    if (keyCol < 0)
+        return;
+    // 先加后减：同一分组的 UPDATE 不会因行数暂时为 0 而丢掉分组
+    for (size_t i : ws.inserted)
+        addRow(t, t.rows[i], size_t(keyCol), args, 1);
+    for (size_t i : ws.ended)
+        addRow(t, t.rows[i], size_t(keyCol), args, -1);
+}
+
+void AggregateView::applyRow(const Table &t, size_t i, int sign)
+{
+    std::vector<int> args;
+    int keyCol = resolve(t, args);
+    std::lock_guard<std::mutex> lock(mtx);
+    changed = true;
+    if (keyCol >= 0)
+        addRow(t, t.rows[i], size_t(keyCol), args, sign);
+}
+
+std::vector<std::string> AggregateView::header() const
+{
+    std::vector<std::string> names{keyColumn};
+    for (const ViewColumn &c : outputs)
+        names.push_back(c.func + "(" + c.column + ")");
+    return names;
+}
+
+size_t AggregateView::forEachGroup(const std::string *key, int limit,
+                                   const std::function<void(const std::vector<std::string> &)> &fn) const
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    auto first = key ? groups.find(*key) : groups.begin();
+    auto last = key && first != groups.end() ? std::next(first) : groups.end();
+    size_t n = 0;
+    std::vector<std::string> row;
+    for (auto it = first; it != last && (limit < 0 || n < size_t(limit)); ++it, ++n)
+    {
+        const Group &g = it->second;
+        row.assign(1, it->first);
+        for (size_t k = 0; k < outputs.size(); k++)
+        {
+            int m = measureOf[k];
+            std::ostringstream v;
+            if (outputs[k].func == "COUNT")
+                v << (m < 0 ? g.rows : g.counts[m]);
+            else if (g.counts[m] == 0)
+                v << "NULL";
+            else if (outputs[k].func == "SUM")
+                v << g.sums[m];
+            else
+                v << g.sums[m] / double(g.counts[m]);
+            row.push_back(v.str());
+        }
+        fn(row);
+    }
+    return n;
+}
+
+size_t AggregateView::groupCount() const
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return groups.size();
+}
+
+bool AggregateView::dirty() const
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return changed;
+}
+
+/*
+ * 格式：首行 VIEW\t<视图名>\t<基表>\t<键列>\t<时间戳>\t<分组数>\t<FUNC>\t<列>...，
+ * 之后每个分组一行：<行数>\t<和>\t<个数>...\t<键>，键放在最后，可以包含制表符
+ */
+std::string AggregateView::serialize(uint64_t now)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    std::string out = "VIEW\t" + viewName + "\t" + baseTable + "\t" + keyColumn + "\t" +
+                      std::to_string(std::max(now, appliedTs)) + "\t" + std::to_string(groups.size());
+    for (const ViewColumn &c : outputs)
+        out += "\t" + c.func + "\t" + c.column;
+    out += "\n";
+    char buf[32];
+    for (const auto &kv : groups)
+    {
+        out += std::to_string(kv.second.rows);
+        for (size_t m = 0; m < measures.size(); m++)
+        {
+            std::snprintf(buf, sizeof(buf), "%.17g", kv.second.sums[m]);
+            out += "\t" + std::string(buf) + "\t" + std::to_string(kv.second.counts[m]);
+        }
+        out += "\t" + kv.first + "\n";
+    }
+    changed = false;
+    return out;
+}
+
+/**
+ * @brief 读取 text 中 pos 处的一行并按制表符切分，最多切出 maxFields 个字段（最后一个字段包含其余部分）
+ */
+static bool readFields(const std::string &text, size_t &pos, size_t maxFields, std::vector<std::string> &fields)
+{
+    if (pos >= text.size())
+        return false;
+    size_t eol = text.find('\n', pos);
+    if (eol == std::string::npos)
+        eol = text.size();
+    fields.clear();
+    while (fields.size() + 1 < maxFields)
+    {
+        size_t tab = text.find('\t', pos);
+        if (tab == std::string::npos || tab > eol)
+            break;
+        fields.push_back(text.substr(pos, tab - pos));
+        pos = tab + 1;
+    }
+    fields.push_back(text.substr(pos, eol - pos));
+    pos = eol + 1;
+    return true;
+}
+
+std::shared_ptr<AggregateView> AggregateView::parse(const std::string &text, size_t &pos, uint64_t &ts)
+{
+    std::vector<std::string> f;
+    if (!readFields(text, pos, SIZE_MAX, f) || f.size() < 6 || f[0] != "VIEW" || f.size() % 2 != 0)
+        return nullptr;
+    std::vector<ViewColumn> cols;
+    for (size_t k = 6; k < f.size(); k += 2)
+        cols.push_back({f[k], f[k + 1]});
+    auto view = std::make_shared<AggregateView>(f[1], f[2], f[3], std::move(cols));
+    ts = std::strtoull(f[4].c_str(), nullptr, 10);
+    size_t count = std::strtoull(f[5].c_str(), nullptr, 10);
+    size_t fields = 2 + 2 * view->measures.size();
+    for (size_t n = 0; n < count; n++)
+    {
+        if (!readFields(text, pos, fields, f) || f.size() != fields)
+            return nullptr;
+        Group g;
+        g.rows = std::strtoll(f[0].c_str(), nullptr, 10);
+        for (size_t m = 0; m < view->measures.size(); m++)
+        {
+            g.sums.push_back(std::strtod(f[1 + 2 * m].c_str(), nullptr));
+            g.counts.push_back(std::strtoll(f[2 + 2 * m].c_str(), nullptr, 10));
+        }
+        view->groups.emplace(f.back(), std::move(g));
+    }
+    view->appliedTs = ts;
+    view->changed = false;
+    return view;
+}
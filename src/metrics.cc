@@ -0,0 +1,144 @@
+#include "metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+const char *statementKindName(StatementKind kind)
+{
+    static const char *names[] = {"SELECT", "INSERT", "UPDATE", "DELETE", "AGGREGATE",
+                                  "ANALYZE", "DDL", "TXN", "CHECKPOINT"};
+    return kind < StatementKind::COUNT ? names[size_t(kind)] : "UNKNOWN";
+}
+
+size_t LatencyBuckets::index(uint64_t ns)
+{
+    if (ns < kSubBuckets)
+        return size_t(ns);
+    // 最高位之后的 kSubBits 位决定区间内的子桶
+    int shift = 63 - __builtin_clzll(ns) - kSubBits;
+    if (shift > kMaxShift)
+        return kCount - 1;
+    return size_t(shift + 1) * kSubBuckets + size_t((ns >> shift) - kSubBuckets);
+}
+
+uint64_t LatencyBuckets::upperBound(size_t idx)
+{
+    if (idx < kSubBuckets)
+        return idx;
+    int shift = int(idx / kSubBuckets) - 1;
+    uint64_t lower = (kSubBuckets + idx % kSubBuckets) << shift;
+    return lower + (uint64_t(1) << shift) - 1;
+}
+
+uint64_t StatementSummary::percentile(double q) const
+{
+    if (count == 0)
+        return 0;
+    uint64_t rank = std::max<uint64_t>(uint64_t(std::ceil(q * double(count))), 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); i++)
+    {
+        seen += buckets[i];
+        if (seen >= rank)
+            return std::min(LatencyBuckets::upperBound(i), maxNanos);
+    }
+    return maxNanos;
+}
+
+/**
+ * @brief 当前线程使用的分片：线程第一次记录时轮流分配
+ */
+static size_t shardOfThisThread()
+{
+    static std::atomic<size_t> next{0};
+    thread_local size_t shard = next.fetch_add(1, std::memory_order_relaxed);
+    return shard;
+}
+
+void StatementMetrics::record(uint64_t totalNanos, uint64_t persistNanos, uint64_t rowsScanned,
+                              uint64_t rowsReturned, uint64_t rowsWritten, uint64_t bytesWritten)
+{
+    Shard &s = shards[shardOfThisThread() % kShards];
+    auto relaxed = std::memory_order_relaxed;
+    s.count.fetch_add(1, relaxed);
+    s.rowsScanned.fetch_add(rowsScanned, relaxed);
+    s.rowsReturned.fetch_add(rowsReturned, relaxed);
+    s.rowsWritten.fetch_add(rowsWritten, relaxed);
+    s.bytesWritten.fetch_add(bytesWritten, relaxed);
+    persistNanos = std::min(persistNanos, totalNanos);
+    s.execNanos.fetch_add(totalNanos - persistNanos, relaxed);
+    s.persistNanos.fetch_add(persistNanos, relaxed);
+    s.buckets[LatencyBuckets::index(totalNanos)].fetch_add(1, relaxed);
+    uint64_t max = s.maxNanos.load(relaxed);
+    while (totalNanos > max && !s.maxNanos.compare_exchange_weak(max, totalNanos, relaxed))
+    {
+    }
+}
+
+StatementSummary StatementMetrics::summary() const
+{
+    StatementSummary sum;
+    auto relaxed = std::memory_order_relaxed;
+    for (const Shard &s : shards)
+    {
+        sum.count += s.count.load(relaxed);
+        sum.rowsScanned += s.rowsScanned.load(relaxed);
+        sum.rowsReturned += s.rowsReturned.load(relaxed);
+        sum.rowsWritten += s.rowsWritten.load(relaxed);
+        sum.bytesWritten += s.bytesWritten.load(relaxed);
+        sum.execNanos += s.execNanos.load(relaxed);
+        sum.persistNanos += s.persistNanos.load(relaxed);
+        sum.maxNanos = std::max(sum.maxNanos, s.maxNanos.load(relaxed));
+        for (size_t i = 0; i < LatencyBuckets::kCount; i++)
+            sum.buckets[i] += s.buckets[i].load(relaxed);
+    }
+    return sum;
+}
+
+/**
+ * @brief 一行统计：名称、计数与耗时（毫秒 / 微秒）
+ */
+static void formatLine(std::string &out, const std::string &name, const StatementSummary &s)
+{
+    char buf[512];
+    std::snprintf(buf, sizeof(buf),
+                  "%-20s %10llu %14llu %14llu %12llu %14llu %12.3f %12.3f %10.1f %10.1f %10.1f %10.1f\n",
+                  name.c_str(), (unsigned long long)s.count, (unsigned long long)s.rowsScanned,
+                  (unsigned long long)s.rowsReturned, (unsigned long long)s.rowsWritten,
+                  (unsigned long long)s.bytesWritten, s.execNanos / 1e6, s.persistNanos / 1e6,
+                  s.percentile(0.5) / 1e3, s.percentile(0.95) / 1e3, s.percentile(0.99) / 1e3,
+                  s.maxNanos / 1e3);
+    out += buf;
+}
+
+std::string MetricsSnapshot::format() const
+{
+    char header[512];
+    std::snprintf(header, sizeof(header),
+                  "%-20s %10s %14s %14s %12s %14s %12s %12s %10s %10s %10s %10s\n",
+                  "name", "count", "rows_scanned", "rows_returned", "rows_written", "bytes_written",
+                  "exec_ms", "persist_ms", "p50_us", "p95_us", "p99_us", "max_us");
+    std::string out = "[statements]\n";
+    out += header;
+    for (const auto &kv : statements)
+        formatLine(out, kv.first, kv.second);
+    out += "[tables]\n";
+    out += header;
+    for (const auto &kv : tables)
+        formatLine(out, kv.first, kv.second);
+    if (resultCache.capacity > 0)
+    {
+        const ResultCacheStats &c = resultCache;
+        uint64_t lookups = c.hits + c.misses;
+        char buf[512];
+        std::snprintf(buf, sizeof(buf),
+                      "[result_cache]\n%-14s %12s %10s %10s %10s %14s %10s %9s\n"
+                      "%-14zu %12zu %10zu %10llu %10llu %14llu %10llu %8.1f%%\n",
+                      "capacity_bytes", "bytes", "entries", "hits", "misses", "invalidations", "evictions",
+                      "hit_rate", c.capacity, c.bytes, c.entries, (unsigned long long)c.hits,
+                      (unsigned long long)c.misses, (unsigned long long)c.invalidations,
+                      (unsigned long long)c.evictions, lookups ? 100.0 * c.hits / lookups : 0.0);
+        out += buf;
+    }
+    return out;
+}
@@ -0,0 +1,49 @@
+#include "pagecache.h"
+#include "table.h"
+
+void PageCache::admit(RowStore *store, size_t seg, size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    faultCount.fetch_add(1, std::memory_order_relaxed);
+    ring.push_back({store, seg, bytes});
+    usedBytes += bytes;
+    size_t cap = limit.load(std::memory_order_relaxed);
+    // 每段最多看两遍：第一遍清除访问标记，第二遍一定能换出；刚载入的段正在被读取，不换出
+    for (size_t steps = 2 * ring.size(); usedBytes > cap && ring.size() > 1 && steps > 0; steps--)
+    {
+        if (hand >= ring.size())
+            hand = 0;
+        Entry &e = ring[hand];
+        if ((e.store == store && e.seg == seg) || !e.store->tryEvict(e.seg))
+        {
+            hand++;
+            continue;
+        }
+        // 用最后一项填补空位，下一轮检查的就是它
+        usedBytes -= e.bytes;
+        e = ring.back();
+        ring.pop_back();
+    }
+}
+
+void PageCache::forget(const RowStore *store)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    size_t kept = 0;
+    for (size_t i = 0; i < ring.size(); i++)
+    {
+        if (ring[i].store == store)
+            usedBytes -= ring[i].bytes;
+        else
+            ring[kept++] = ring[i];
+    }
+    ring.resize(kept);
+    if (hand >= ring.size())
+        hand = 0;
+}
+
+size_t PageCache::used() const
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return usedBytes;
+}
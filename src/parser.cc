@@ -1,8 +1,12 @@
 #include "parser.h"
 #include "types.h"
+#include "output.h"
+#include "trace.h"
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <cctype>
+#include <cstdlib>
 
 /**
  * @brief 运行一个交互式 SQL 控制台
@@ -10,14 +14,20 @@
  * 该函数会进入一个循环，从标准输入中读取用户输入的 SQL 命令，
  * 然后解析命令并调用对应的 @ref sqlDB 成员函数来执行。
  * 支持的命令包括：
- * - CREATE TABLE
- * - INSERT INTO
- * - SELECT
+ * - CREATE TABLE（列可带 PRIMARY KEY / UNIQUE；可选 PARTITION BY HASH(列) PARTITIONS n / RANGE(列) (PARTITION 名 VALUES LESS THAN (值), ...)）
+ * - INSERT INTO（可选 ON CONFLICT [(列)] DO UPDATE SET 列 = 值 [, ...] / DO NOTHING）
+ * - SELECT（WHERE 支持 = / > / >= / < / <= / BETWEEN a AND b / LIKE 'pattern'）
+ * - SELECT 聚合(列) FROM 表 [TABLESAMPLE n PERCENT [REPEATABLE (种子)]]（含 APPROX_COUNT_DISTINCT）
  * - UPDATE
  * - DELETE
  * - DROP TABLE
- * - SHOW TABLES
- * - ALTER TABLE (ADD / DROP 列)
+ * - CREATE INDEX ON <表> (<列>) [USING TRIGRAM] / DROP INDEX ON <表> (<列>)（LIKE 索引）
+ * - CREATE MATERIALIZED VIEW <视图> AS SELECT <键>, SUM(列) / AVG(列) / COUNT(*), ... FROM <表> GROUP BY <键>
+ *   / DROP MATERIALIZED VIEW <视图>；SELECT * FROM <视图> [WHERE <键> = 值] 读取分组
+ * - SHOW TABLES / SHOW STATS（运行统计）
+ * - ALTER TABLE (ADD [DEFAULT 值] / DROP 列，ADD / DROP PARTITION)
+ * - ANALYZE <表名>
+ * - BEGIN / COMMIT / ROLLBACK（显式事务，未提交的事务在退出时回滚）
  * - 退出：输入 `exit`
  *
  * @param db 数据库对象的引用，所有操作都会作用在该数据库上。
@@ -28,18 +38,314 @@
  * 该函数会进入一个循环，从标准输入中读取用户输入的 SQL 命令，
  * 然后解析命令并调用对应的 @ref sqlDB 成员函数来执行。
  * 支持的命令包括：
- * - CREATE TABLE
- * - INSERT INTO
- * - SELECT
+ * - CREATE TABLE（列可带 PRIMARY KEY / UNIQUE；可选 PARTITION BY HASH(列) PARTITIONS n / RANGE(列) (PARTITION 名 VALUES LESS THAN (值), ...)）
+ * - INSERT INTO（可选 ON CONFLICT [(列)] DO UPDATE SET 列 = 值 [, ...] / DO NOTHING）
+ * - SELECT（WHERE 支持 = / > / >= / < / <= / BETWEEN a AND b / LIKE 'pattern'）
+ * - SELECT 聚合(列) FROM 表 [TABLESAMPLE n PERCENT [REPEATABLE (种子)]]（含 APPROX_COUNT_DISTINCT）
  * - UPDATE
  * - DELETE
  * - DROP TABLE
- * - SHOW TABLES
- * - ALTER TABLE (ADD / DROP 列)
+ * - CREATE INDEX ON <表> (<列>) [USING TRIGRAM] / DROP INDEX ON <表> (<列>)（LIKE 索引）
+ * - CREATE MATERIALIZED VIEW <视图> AS SELECT <键>, SUM(列) / AVG(列) / COUNT(*), ... FROM <表> GROUP BY <键>
+ *   / DROP MATERIALIZED VIEW <视图>；SELECT * FROM <视图> [WHERE <键> = 值] 读取分组
+ * - SHOW TABLES / SHOW STATS（运行统计）
+ * - ALTER TABLE (ADD [DEFAULT 值] / DROP 列，ADD / DROP PARTITION)
+ * - ANALYZE <表名>
+ * - BEGIN / COMMIT / ROLLBACK（显式事务，未提交的事务在退出时回滚）
  * - 退出：输入 `exit`
  *
  * @param db 数据库对象的引用，所有操作都会作用在该数据库上。
  */
+/**
+ * @brief 读取一个条件值：以单引号开头时读到配对的引号为止（可以包含空格，如 '2024-01-01 10:00:00'），
+ *        否则读取一个以空白分隔的词；去掉引号与末尾分号
+ * @return 没有可读的值时返回 false
+ */
+static bool readValue(std::istream &in, std::string &val)
+{
+    in >> std::ws;
+    if (in.peek() == '\'')
+    {
+        in.get();
+        std::getline(in, val, '\'');
+        while (in.peek() == ';')
+            in.get();
+        return true;
+    }
+    if (!(in >> val))
+        return false;
+    val.erase(std::remove(val.begin(), val.end(), '\''), val.end());
+    if (!val.empty() && val.back() == ';')
+        val.pop_back();
+    return true;
+}
+
+/**
+ * @brief 把分区子句切分为词：单引号中的内容（可以包含空格）、括号、逗号与其余以空白分隔的词，末尾的分号忽略
+ */
+static std::vector<std::string> splitWords(const std::string &s)
+{
+    std::vector<std::string> words;
+    for (size_t i = 0; i < s.size();)
+    {
+        char c = s[i];
+        if (std::isspace((unsigned char)c) || c == ';')
+            i++;
+        else if (c == '(' || c == ')' || c == ',')
+            words.emplace_back(1, s[i++]);
+        else if (c == '\'')
+        {
+            size_t end = s.find('\'', i + 1);
+            if (end == std::string::npos)
+                end = s.size();
+            words.push_back(s.substr(i + 1, end - i - 1));
+            i = end + 1;
+        }
+        else
+        {
+            size_t end = i;
+            while (end < s.size() && !std::isspace((unsigned char)s[end]) && std::string("(),;'").find(s[end]) == std::string::npos)
+                end++;
+            words.push_back(s.substr(i, end - i));
+            i = end;
+        }
+    }
+    return words;
+}
+
+/**
+ * @brief 依次匹配不区分大小写的关键字
+ */
+static bool expectWords(const std::vector<std::string> &words, size_t &pos, std::initializer_list<const char *> expected)
+{
+    for (const char *e : expected)
+    {
+        if (pos >= words.size())
+            return false;
+        std::string w = words[pos];
+        std::transform(w.begin(), w.end(), w.begin(), ::toupper);
+        if (w != e)
+            return false;
+        pos++;
+    }
+    return true;
+}
+
+/**
+ * @brief 解析 RANGE 分区的上界：VALUES LESS THAN (<值>) 或 VALUES LESS THAN MAXVALUE（上界为空）
+ */
+static bool parseUpperBound(const std::vector<std::string> &words, size_t &pos, std::string &upper)
+{
+    if (!expectWords(words, pos, {"VALUES", "LESS", "THAN"}))
+        return false;
+    size_t start = pos;
+    if (expectWords(words, pos, {"MAXVALUE"}))
+    {
+        upper.clear();
+        return true;
+    }
+    pos = start;
+    if (pos + 2 < words.size() && words[pos] == "(" && words[pos + 2] == ")")
+    {
+        upper = words[pos + 1];
+        pos += 3;
+        return true;
+    }
+    if (expectWords(words, pos, {"(", "MAXVALUE", ")"}))
+    {
+        upper.clear();
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief 解析 CREATE TABLE 列定义之后的分区子句：
+ *        PARTITION BY HASH(<列>) PARTITIONS <n>，或
+ *        PARTITION BY RANGE(<列>) (PARTITION <名> VALUES LESS THAN (<值>), ..., PARTITION <名> VALUES LESS THAN MAXVALUE)
+ * @return 语法错误时返回 false
+ */
+static bool parsePartitionClause(const std::vector<std::string> &words, PartitionScheme &scheme)
+{
+    size_t pos = 0;
+    if (!expectWords(words, pos, {"PARTITION", "BY"}) || pos >= words.size())
+        return false;
+    std::string kind = words[pos++];
+    std::transform(kind.begin(), kind.end(), kind.begin(), ::toupper);
+    if ((kind != "HASH" && kind != "RANGE") || pos + 2 >= words.size() || words[pos] != "(" || words[pos + 2] != ")")
+        return false;
+    scheme.column = words[pos + 1];
+    pos += 3;
+    if (kind == "HASH")
+    {
+        scheme.kind = PartitionKind::HASH;
+        if (!expectWords(words, pos, {"PARTITIONS"}) || pos + 1 != words.size())
+            return false;
+        int n = std::atoi(words[pos].c_str());
+        if (n <= 0)
+            return false;
+        for (int k = 0; k < n; k++)
+            scheme.parts.push_back({"p" + std::to_string(k), ""});
+        return true;
+    }
+    scheme.kind = PartitionKind::RANGE;
+    if (!expectWords(words, pos, {"("}))
+        return false;
+    while (true)
+    {
+        PartitionDef part;
+        if (!expectWords(words, pos, {"PARTITION"}) || pos >= words.size())
+            return false;
+        part.name = words[pos++];
+        if (!parseUpperBound(words, pos, part.upper))
+            return false;
+        scheme.parts.push_back(std::move(part));
+        if (expectWords(words, pos, {")"}))
+            return pos == words.size();
+        if (!expectWords(words, pos, {","}))
+            return false;
+    }
+}
+
+/**
+ * @brief 解析聚合查询表名之后的抽样子句：TABLESAMPLE [BERNOULLI] <n> PERCENT [REPEATABLE (<seed>)]
+ * @return 语法错误时返回 false
+ */
+static bool parseTableSample(const std::vector<std::string> &words, TableSample &out)
+{
+    size_t pos = 0;
+    if (!expectWords(words, pos, {"TABLESAMPLE"}))
+        return false;
+    size_t kind = pos;
+    if (!expectWords(words, pos, {"BERNOULLI"}))
+        pos = kind;
+    if (pos >= words.size())
+        return false;
+    char *end;
+    out.percent = std::strtod(words[pos++].c_str(), &end);
+    if (*end != '\0' || !expectWords(words, pos, {"PERCENT"}))
+        return false;
+    if (pos == words.size())
+        return true;
+    if (!expectWords(words, pos, {"REPEATABLE", "("}) || pos + 2 != words.size() || words[pos + 1] != ")")
+        return false;
+    out.repeatable = true;
+    out.seed = std::strtoull(words[pos].c_str(), &end, 10);
+    return *end == '\0';
+}
+
+/**
+ * @brief 解析 CREATE INDEX / DROP INDEX 之后的部分：[<索引名>] ON <表> (<列>) [USING SORTED | TRIGRAM]
+ * @param trigram 输出是否为 USING TRIGRAM
+ * @return 语法错误时返回 false
+ */
+static bool parseIndexTarget(const std::vector<std::string> &words, std::string &table, std::string &col, bool &trigram)
+{
+    size_t pos = 0;
+    if (!expectWords(words, pos, {"ON"}))
+    {
+        pos = 1; // 索引名只用于兼容常见写法，索引按列区分
+        if (!expectWords(words, pos, {"ON"}))
+            return false;
+    }
+    if (pos + 3 >= words.size() || words[pos + 1] != "(" || words[pos + 3] != ")")
+        return false;
+    table = words[pos];
+    col = words[pos + 2];
+    pos += 4;
+    trigram = false;
+    if (pos == words.size())
+        return true;
+    if (!expectWords(words, pos, {"USING"}) || pos + 1 != words.size())
+        return false;
+    size_t kind = pos;
+    trigram = expectWords(words, pos, {"TRIGRAM"});
+    pos = kind;
+    return trigram || expectWords(words, pos, {"SORTED"});
+}
+
+/**
+ * @brief 解析 CREATE MATERIALIZED VIEW 之后的部分：
+ *        <视图> AS SELECT <键>, <函数>(<列> | *), ... FROM <表> GROUP BY <键>
+ *        （键列须出现在选择列表中且只出现一次，函数名转为大写，是否支持由 sqlDB 判断）
+ * @return 语法错误时返回 false
+ */
+static bool parseViewQuery(const std::vector<std::string> &words, std::string &view, std::string &table,
+                           std::string &key, std::vector<ViewColumn> &cols)
+{
+    size_t pos = 1;
+    if (words.empty() || !expectWords(words, pos, {"AS", "SELECT"}))
+        return false;
+    view = words[0];
+    std::vector<std::string> plain;
+    while (true)
+    {
+        if (pos + 3 < words.size() && words[pos + 1] == "(" && words[pos + 3] == ")")
+        {
+            std::string func = words[pos];
+            std::transform(func.begin(), func.end(), func.begin(), ::toupper);
+            cols.push_back({func, words[pos + 2]});
+            pos += 4;
+        }
+        else if (pos < words.size())
+            plain.push_back(words[pos++]);
+        else
+            return false;
+        if (!expectWords(words, pos, {","}))
+            break;
+    }
+    if (!expectWords(words, pos, {"FROM"}) || pos >= words.size())
+        return false;
+    table = words[pos++];
+    if (!expectWords(words, pos, {"GROUP", "BY"}) || pos + 1 != words.size())
+        return false;
+    key = words[pos];
+    std::string lkey = key;
+    std::transform(lkey.begin(), lkey.end(), lkey.begin(), ::tolower);
+    for (std::string &p : plain)
+        std::transform(p.begin(), p.end(), p.begin(), ::tolower);
+    return plain.size() == 1 && plain[0] == lkey;
+}
+
+/**
+ * @brief 解析 INSERT 的 VALUES 之后的冲突子句：
+ *        ON CONFLICT [(<列>)] DO UPDATE SET <列> = <值>, ...，或 ON CONFLICT [(<列>)] DO NOTHING
+ * @return 语法错误时返回 false
+ */
+static bool parseOnConflict(const std::vector<std::string> &words, OnConflict &out)
+{
+    size_t pos = 0;
+    if (!expectWords(words, pos, {"ON", "CONFLICT"}))
+        return false;
+    if (pos + 2 < words.size() && words[pos] == "(" && words[pos + 2] == ")")
+    {
+        out.column = words[pos + 1];
+        pos += 3;
+    }
+    if (!expectWords(words, pos, {"DO"}))
+        return false;
+    size_t start = pos;
+    if (expectWords(words, pos, {"NOTHING"}))
+        return pos == words.size();
+    pos = start;
+    if (!expectWords(words, pos, {"UPDATE", "SET"}))
+        return false;
+    // 逗号之间的词拼接后在第一个 '=' 处分开，"a = b"、"a=b"、"a ='x y'" 都可以
+    while (pos < words.size())
+    {
+        std::string assign;
+        for (; pos < words.size() && words[pos] != ","; pos++)
+            assign += words[pos];
+        size_t eq = assign.find('=');
+        if (eq == 0 || eq == std::string::npos)
+            return false;
+        out.set.emplace_back(assign.substr(0, eq), assign.substr(eq + 1));
+        if (pos < words.size())
+            pos++;
+    }
+    return !out.set.empty();
+}
+
 void runSQLConsole(sqlDB &db)
 {
     std::string line;
@@ -50,275 +356,506 @@ void runSQLConsole(sqlDB &db)
         std::cout << ">> ";
         std::getline(std::cin, line); ///< 从标准输入读取一行命令
         if (line == "exit")
+        {
+            if (db.inTransaction())
+                db.rollback();
             break;
+        }
 
-        std::stringstream ss(line); ///< 用 stringstream 解析命令
-        std::string cmd;
-        ss >> cmd;
+        executeSQL(db, line);
+    }
+}
 
-        // 将命令转为大写（方便大小写无关的 SQL 解析）
-        std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::toupper);
+/**
+ * @brief 解析并执行一条 SQL 命令
+ *
+ * 结果与提示信息写到当前线程的 dbOut()，控制台与服务器共用。
+ *
+ * @param db 数据库对象
+ * @param line 一条完整的 SQL 命令（不含 `exit`）
+ */
+void executeSQL(sqlDB &db, const std::string &line)
+{
+    StatementText text(line); ///< 慢查询日志记录语句原文
+    TRACE_SPAN("executeSQL");  ///< 去掉 sqlDB 各方法的子 span 后即为解析耗时
+    std::stringstream ss(line); ///< 用 stringstream 解析命令
+    std::string cmd;
+    ss >> cmd;
+
+    // 将命令转为大写（方便大小写无关的 SQL 解析）
+    std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::toupper);
 
-        /** ========== CREATE TABLE 处理 ========== */
-        if (cmd == "CREATE")
+    /** ========== CREATE TABLE 处理 ========== */
+    if (cmd == "CREATE")
+    {
+        std::string tbl, name;
+        ss >> tbl;
+        std::transform(tbl.begin(), tbl.end(), tbl.begin(), ::toupper);
+        if (tbl == "INDEX")
         {
-            std::string tbl, name;
-            ss >> tbl >> name;
-            if (tbl != "TABLE")
+            std::string rest, table, col;
+            std::getline(ss, rest);
+            bool trigram;
+            if (!parseIndexTarget(splitWords(rest), table, col, trigram))
             {
-                std::cout << "Invalid CREATE syntax. Use: CREATE TABLE <table_name> (<col1> <type1>, ...)\n";
-                continue;
+                dbOut() << "Invalid CREATE INDEX syntax. Use: CREATE INDEX ON <table> (<col>) [USING TRIGRAM]\n";
+                return;
+            }
+            db.createIndex(table, col, trigram);
+            return;
+        }
+        if (tbl == "MATERIALIZED")
+        {
+            std::string rest, view, table, key;
+            std::getline(ss, rest);
+            std::vector<std::string> words = splitWords(rest);
+            std::vector<ViewColumn> cols;
+            size_t pos = 0;
+            if (!expectWords(words, pos, {"VIEW"}) ||
+                !parseViewQuery(std::vector<std::string>(words.begin() + 1, words.end()), view, table, key, cols))
+            {
+                dbOut() << "Invalid CREATE MATERIALIZED VIEW syntax. Use: CREATE MATERIALIZED VIEW <view> AS "
+                           "SELECT <key>, SUM(<col>), COUNT(*) FROM <table> GROUP BY <key>\n";
+                return;
             }
+            db.createMaterializedView(view, table, key, cols);
+            return;
+        }
+        ss >> name;
+        if (tbl != "TABLE")
+        {
+            dbOut() << "Invalid CREATE syntax. Use: CREATE TABLE <table_name> (<col1> <type1>, ...)\n";
+            return;
+        }
 
-            // 移除可能的多余字符
-            if (!name.empty() && name.back() == '(')
-                name.pop_back();
-            name.erase(std::remove_if(name.begin(), name.end(), ::isspace), name.end());
+        // 移除可能的多余字符
+        if (!name.empty() && name.back() == '(')
+            name.pop_back();
+        name.erase(std::remove_if(name.begin(), name.end(), ::isspace), name.end());
 
-            // 提取列定义
-            std::string res;
-            std::getline(ss, res, '(');
-            std::getline(ss, res, ')');
-            std::stringstream def(res);
-            std::string col;
-            std::vector<Column> cols;
+        // 提取列定义
+        std::string res;
+        std::getline(ss, res, '(');
+        std::getline(ss, res, ')');
+        std::stringstream def(res);
+        std::string col;
+        std::vector<Column> cols;
 
-            // 解析每个列定义（列名 + 类型）
-            while (std::getline(def, col, ','))
+        // 解析每个列定义（列名 + 类型）
+        while (std::getline(def, col, ','))
+        {
+            std::stringstream cs(col);
+            std::string cname, ctype;
+            cs >> cname >> ctype;
+            if (ctype.empty() && !(cs >> ctype))
             {
-                std::stringstream cs(col);
-                std::string cname, ctype;
-                cs >> cname >> ctype;
-                if (ctype.empty() && !(cs >> ctype))
-                {
-                    std::cerr << "Invalid column definition: " << col << "\n";
-                    continue;
-                }
+                dbErr() << "Invalid column definition: " << col << "\n";
+                continue;
+            }
 
-                // 去掉类型中的括号，例如 varchar(20) -> varchar
-                size_t paren = ctype.find('(');
-                if (paren != std::string::npos)
-                    ctype = ctype.substr(0, paren);
-                ctype.erase(std::remove_if(ctype.begin(), ctype.end(), ::isspace), ctype.end());
+            // 去掉类型中的括号，例如 varchar(20) -> varchar
+            size_t paren = ctype.find('(');
+            if (paren != std::string::npos)
+                ctype = ctype.substr(0, paren);
+            ctype.erase(std::remove_if(ctype.begin(), ctype.end(), ::isspace), ctype.end());
 
-                cols.push_back({cname, parseType(ctype)});
+            Column column{cname, parseType(ctype)};
+            // 列约束：PRIMARY KEY / UNIQUE
+            for (std::string kw; cs >> kw;)
+            {
+                std::transform(kw.begin(), kw.end(), kw.begin(), ::toupper);
+                if (kw == "PRIMARY")
+                    column.constraint = ColumnConstraint::PRIMARY_KEY;
+                else if (kw == "UNIQUE")
+                    column.constraint = ColumnConstraint::UNIQUE;
             }
+            cols.push_back(column);
+        }
+
+        // 可选的分区子句
+        std::string rest;
+        std::getline(ss, rest);
+        std::vector<std::string> words = splitWords(rest);
+        if (words.empty())
+        {
             db.createTableWithTypes(name, cols);
+            return;
         }
-        /** ========== INSERT INTO 处理 ========== */
-        else if (cmd == "INSERT")
+        PartitionScheme scheme;
+        if (!parsePartitionClause(words, scheme))
         {
-            std::string into, table, colPart, values;
-            ss >> into >> table;
-            std::vector<std::string> columns;
+            dbOut() << "Invalid PARTITION syntax. Use: PARTITION BY HASH(<col>) PARTITIONS <n> or "
+                       "PARTITION BY RANGE(<col>) (PARTITION <name> VALUES LESS THAN (<value>|MAXVALUE), ...)\n";
+            return;
+        }
+        db.createPartitionedTable(name, cols, std::move(scheme));
+    }
+    /** ========== INSERT INTO 处理 ========== */
+    else if (cmd == "INSERT")
+    {
+        std::string into, table, colPart, values;
+        ss >> into >> table;
+        std::vector<std::string> columns;
 
-            // 如果有指定列名 (INSERT INTO t (col1, col2) VALUES ...)
-            char c = ss.peek();
-            if (c == '(')
-            {
-                ss.get();
-                std::getline(ss, colPart, ')');
-                std::stringstream cs(colPart);
-                std::string col;
-                while (std::getline(cs, col, ','))
-                {
-                    col.erase(std::remove_if(col.begin(), col.end(), ::isspace), col.end());
-                    columns.push_back(col);
-                }
-                ss >> values;
-            }
-            else
+        // 如果有指定列名 (INSERT INTO t (col1, col2) VALUES ...)
+        char c = ss.peek();
+        if (c == '(')
+        {
+            ss.get();
+            std::getline(ss, colPart, ')');
+            std::stringstream cs(colPart);
+            std::string col;
+            while (std::getline(cs, col, ','))
             {
-                ss >> values;
+                col.erase(std::remove_if(col.begin(), col.end(), ::isspace), col.end());
+                columns.push_back(col);
             }
+            ss >> values;
+        }
+        else
+        {
+            ss >> values;
+        }
 
-            // 提取 VALUES
-            std::getline(ss, values, '(');
-            std::getline(ss, values, ')');
-            std::stringstream vs(values);
-            std::string val;
-            std::vector<std::string> vals;
-            while (std::getline(vs, val, ','))
-            {
-                // 去掉多余引号和空格
-                val.erase(std::remove(val.begin(), val.end(), '\''), val.end());
-                val.erase(0, val.find_first_not_of(" \t\n\r"));
-                val.erase(val.find_last_not_of(" \t\n\r") + 1);
-                vals.push_back(val);
-            }
+        // 提取 VALUES
+        std::getline(ss, values, '(');
+        std::getline(ss, values, ')');
+        std::stringstream vs(values);
+        std::string val;
+        std::vector<std::string> vals;
+        while (std::getline(vs, val, ','))
+        {
+            // 去掉多余引号和空格
+            val.erase(std::remove(val.begin(), val.end(), '\''), val.end());
+            val.erase(0, val.find_first_not_of(" \t\n\r"));
+            val.erase(val.find_last_not_of(" \t\n\r") + 1);
+            vals.push_back(val);
+        }
+
+        // 可选的 ON CONFLICT 子句
+        std::string rest;
+        std::getline(ss, rest);
+        std::vector<std::string> words = splitWords(rest);
+        if (words.empty())
+        {
             db.insertInto(table, vals, columns);
+            return;
         }
-        /** ========== SELECT 处理 ========== */
-        else if (cmd == "SELECT")
+        OnConflict onConflict;
+        if (!parseOnConflict(words, onConflict))
         {
-            std::string star, from, table;
-            ss >> star >> from >> table;
+            dbOut() << "Invalid ON CONFLICT syntax. Use: ON CONFLICT [(<col>)] DO UPDATE SET <col> = <value|EXCLUDED.col>, ... "
+                       "or ON CONFLICT [(<col>)] DO NOTHING\n";
+            return;
+        }
+        db.upsert(table, vals, columns, onConflict);
+    }
+    /** ========== SELECT 处理 ========== */
+    else if (cmd == "SELECT")
+    {
+        std::string star, from, table;
+        ss >> star >> from >> table;
 
-            // 判断是否为聚合函数 (SUM/AVG/MIN/MAX/COUNT)
-            if (star.find("(") != std::string::npos && star.find(")") != std::string::npos)
-            {
-                size_t l = star.find("(");
-                size_t r = star.find(")");
-                std::string func = star.substr(0, l);
-                std::string col = star.substr(l + 1, r - l + 1);
+        // 判断是否为聚合函数 (SUM/AVG/MIN/MAX/COUNT)
+        if (star.find("(") != std::string::npos && star.find(")") != std::string::npos)
+        {
+            size_t l = star.find("(");
+            size_t r = star.find(")");
+            std::string func = star.substr(0, l);
+            std::string col = star.substr(l + 1, r - l - 1);
+            std::transform(func.begin(), func.end(), func.begin(), ::toupper);
 
-                std::string tbl;
-                if (from == "FROM" && !table.empty())
-                {
-                    tbl = table;
-                    while (!tbl.empty() && (tbl.back() == ';' || std::isspace(tbl.back())))
-                        tbl.pop_back();
-                }
+            std::string tbl;
+            if (from == "FROM" && !table.empty())
+            {
+                tbl = table;
+                while (!tbl.empty() && (tbl.back() == ';' || std::isspace(tbl.back())))
+                    tbl.pop_back();
+            }
+            // 可选的 TABLESAMPLE n PERCENT [REPEATABLE (seed)]
+            std::string rest;
+            std::getline(ss, rest);
+            std::vector<std::string> words = splitWords(rest);
+            if (words.empty())
+            {
                 db.aggregate(tbl, func, col);
-                continue;
+                return;
             }
+            TableSample sample;
+            if (!parseTableSample(words, sample))
+            {
+                dbOut() << "Invalid TABLESAMPLE syntax. Use: TABLESAMPLE <n> PERCENT [REPEATABLE (<seed>)]\n";
+                return;
+            }
+            db.aggregate(tbl, func, col, sample);
+            return;
+        }
 
-            // 去掉末尾多余符号
-            while (!table.empty() && (table.back() == ';' || std::isspace(table.back())))
-                table.pop_back();
+        // 去掉末尾多余符号
+        while (!table.empty() && (table.back() == ';' || std::isspace(table.back())))
+            table.pop_back();
 
-            std::string whereCol, whereVal, orderBy;
-            bool desc = false;
-            int limit = -1;
+        std::string whereCol, whereVal, orderBy;
+        ValueRange range;
+        bool isRange = false, isLike = false;
+        bool desc = false;
+        int limit = -1;
 
-            // 解析 WHERE 子句
-            std::string where, col, eq, val;
-            std::streampos pos = ss.tellg();
-            if (ss >> where >> col >> eq >> val)
+        // 解析 WHERE 子句：col = v，col > / >= / < / <= v，col BETWEEN a AND b，col LIKE 'pattern'
+        std::string where, col, op, val;
+        std::streampos pos = ss.tellg();
+        if (ss >> where >> col >> op)
+        {
+            std::transform(where.begin(), where.end(), where.begin(), ::toupper);
+            std::transform(op.begin(), op.end(), op.begin(), ::toupper);
+            if (where != "WHERE")
             {
-                std::transform(where.begin(), where.end(), where.begin(), ::toupper);
-                if (where == "WHERE")
-                {
-                    val.erase(std::remove(val.begin(), val.end(), '\''), val.end());
-                    // 去掉末尾分号
-                    if (!val.empty() && val.back() == ';')
-                        val.pop_back();
-                    whereCol = col;
-                    whereVal = val;
-                }
-                else
-                {
-                    ss.clear();
-                    ss.seekg(pos);
-                }
+                ss.clear();
+                ss.seekg(pos);
             }
-
-            // 解析 ORDER BY 子句
-            std::string order, by, orderCol, orderDir;
-            if (ss >> order >> by >> orderCol)
+            else if (op == "BETWEEN")
             {
-                std::transform(order.begin(), order.end(), order.begin(), ::toupper);
-                std::transform(by.begin(), by.end(), by.begin(), ::toupper);
-                if (ss >> orderDir)
+                std::string andWord;
+                isRange = readValue(ss, range.low) && (ss >> andWord) && readValue(ss, range.high);
+                if (!isRange)
                 {
-                    std::transform(orderDir.begin(), orderDir.end(), orderDir.begin(), ::toupper);
-                    desc = (orderDir == "DESC");
+                    dbOut() << "Invalid BETWEEN syntax. Use: WHERE <col> BETWEEN <low> AND <high>\n";
+                    return;
                 }
-                orderBy = orderCol;
+                whereCol = col;
             }
-
-            // 解析 LIMIT
-            std::string limitStr;
-            if (ss >> limitStr)
+            else if (readValue(ss, val))
             {
-                std::transform(limitStr.begin(), limitStr.end(), limitStr.begin(), ::toupper);
-                if (limitStr == "LIMIT")
+                whereCol = col;
+                isLike = op == "LIKE";
+                isRange = op == ">" || op == ">=" || op == "<" || op == "<=";
+                if (op[0] == '>')
                 {
-                    ss >> limit;
+                    range.low = val;
+                    range.lowInclusive = op == ">=";
                 }
+                else if (op[0] == '<')
+                {
+                    range.high = val;
+                    range.highInclusive = op == "<=";
+                }
+                whereVal = val;
             }
+        }
 
-            db.selectAll(table, whereCol, whereVal, orderBy, desc, limit);
+        // 解析 ORDER BY 子句
+        std::string order, by, orderCol, orderDir;
+        if (ss >> order >> by >> orderCol)
+        {
+            std::transform(order.begin(), order.end(), order.begin(), ::toupper);
+            std::transform(by.begin(), by.end(), by.begin(), ::toupper);
+            if (ss >> orderDir)
+            {
+                std::transform(orderDir.begin(), orderDir.end(), orderDir.begin(), ::toupper);
+                desc = (orderDir == "DESC");
+            }
+            orderBy = orderCol;
         }
-        /** ========== UPDATE 处理 ========== */
-        else if (cmd == "UPDATE")
+
+        // 解析 LIMIT
+        std::string limitStr;
+        if (ss >> limitStr)
         {
-            std::string table, set, col, eq, val, where, wcol, weq, wval;
-            ss >> table >> set >> col >> eq >> val >> where >> wcol >> weq >> wval;
+            std::transform(limitStr.begin(), limitStr.end(), limitStr.begin(), ::toupper);
+            if (limitStr == "LIMIT")
+            {
+                ss >> limit;
+            }
+        }
 
-            while (!table.empty() && (table.back() == ';' || std::isspace(table.back())))
-                table.pop_back();
+        if (isLike)
+            db.selectLike(table, whereCol, whereVal, orderBy, desc, limit);
+        else if (isRange)
+            db.selectRange(table, whereCol, range, orderBy, desc, limit);
+        else
+            db.selectAll(table, whereCol, whereVal, orderBy, desc, limit);
+    }
+    /** ========== UPDATE 处理 ========== */
+    else if (cmd == "UPDATE")
+    {
+        std::string table, set, col, eq, val, where, wcol, weq, wval;
+        ss >> table >> set >> col >> eq >> val >> where >> wcol >> weq >> wval;
 
-            val.erase(std::remove(val.begin(), val.end(), '\''), val.end());
-            wval.erase(std::remove(wval.begin(), wval.end(), '\''), wval.end());
-            db.update(table, col, val, wcol, wval);
-        }
-        /** ========== DELETE 处理 ========== */
-        else if (cmd == "DELETE")
-        {
-            std::string from, table, where, col, eq, val;
-            ss >> from >> table >> where >> col >> eq >> val;
+        while (!table.empty() && (table.back() == ';' || std::isspace(table.back())))
+            table.pop_back();
 
-            while (!table.empty() && (table.back() == ';' || std::isspace(table.back())))
-                table.pop_back();
+        val.erase(std::remove(val.begin(), val.end(), '\''), val.end());
+        wval.erase(std::remove(wval.begin(), wval.end(), '\''), wval.end());
+        db.update(table, col, val, wcol, wval);
+    }
+    /** ========== DELETE 处理 ========== */
+    else if (cmd == "DELETE")
+    {
+        std::string from, table, where, col, eq, val;
+        ss >> from >> table >> where >> col >> eq >> val;
 
-            val.erase(std::remove(val.begin(), val.end(), '\''), val.end());
-            db.deleteRows(table, col, val);
-        }
-        /** ========== DROP TABLE 处理 ========== */
-        else if (cmd == "DROP" || cmd == "DROP;")
-        {
-            std::string tbl, name;
-            ss >> tbl >> name;
-            while (!name.empty() && (name.back() == ';' || std::isspace(name.back())))
-                name.pop_back();
+        while (!table.empty() && (table.back() == ';' || std::isspace(table.back())))
+            table.pop_back();
 
-            db.dropTable(name);
-        }
-        /** ========== SHOW TABLES 处理 ========== */
-        else if (cmd == "SHOW" || cmd == "SHOW;")
+        val.erase(std::remove(val.begin(), val.end(), '\''), val.end());
+        db.deleteRows(table, col, val);
+    }
+    /** ========== DROP TABLE 处理 ========== */
+    else if (cmd == "DROP" || cmd == "DROP;")
+    {
+        std::string tbl, name;
+        ss >> tbl;
+        std::transform(tbl.begin(), tbl.end(), tbl.begin(), ::toupper);
+        if (tbl == "INDEX")
         {
-            std::string what;
-            ss >> what;
-            std::transform(what.begin(), what.end(), what.begin(), ::toupper);
-            if (what == "TABLES" || what == "TABLES;")
+            std::string rest, table, col;
+            std::getline(ss, rest);
+            bool trigram;
+            if (!parseIndexTarget(splitWords(rest), table, col, trigram))
             {
-                auto tables = db.listTables();
-                std::cout << "Tables:\n";
-                for (const auto &t : tables)
-                    std::cout << t << std::endl;
+                dbOut() << "Invalid DROP INDEX syntax. Use: DROP INDEX ON <table> (<col>)\n";
+                return;
             }
-            else
+            db.dropIndex(table, col);
+            return;
+        }
+        if (tbl == "MATERIALIZED")
+        {
+            std::string rest;
+            std::getline(ss, rest);
+            std::vector<std::string> words = splitWords(rest);
+            size_t pos = 0;
+            if (!expectWords(words, pos, {"VIEW"}) || pos + 1 != words.size())
             {
-                std::cout << "Invalid SHOW command.\n";
+                dbOut() << "Invalid DROP MATERIALIZED VIEW syntax. Use: DROP MATERIALIZED VIEW <view>\n";
+                return;
             }
+            db.dropMaterializedView(words[pos]);
+            return;
         }
-        /** ========== ALTER TABLE 处理 ========== */
-        else if (cmd == "ALTER" || cmd == "ALTER;")
+        ss >> name;
+        while (!name.empty() && (name.back() == ';' || std::isspace(name.back())))
+            name.pop_back();
+
+        db.dropTable(name);
+    }
+    /** ========== SHOW TABLES 处理 ========== */
+    else if (cmd == "SHOW" || cmd == "SHOW;")
+    {
+        std::string what;
+        ss >> what;
+        std::transform(what.begin(), what.end(), what.begin(), ::toupper);
+        if (what == "TABLES" || what == "TABLES;")
+        {
+            auto tables = db.listTables();
+            dbOut() << "Tables:\n";
+            for (const auto &t : tables)
+                dbOut() << t << std::endl;
+        }
+        else if (what == "STATS" || what == "STATS;")
+        {
+            db.showStats();
+        }
+        else
         {
-            std::string tbl, name, op, col, ctype;
-            ss >> tbl >> name >> op >> col >> ctype;
+            dbOut() << "Invalid SHOW command.\n";
+        }
+    }
+    /** ========== ALTER TABLE 处理 ========== */
+    else if (cmd == "ALTER" || cmd == "ALTER;")
+    {
+        std::string tbl, name, op, col, ctype;
+        ss >> tbl >> name >> op >> col >> ctype;
 
-            while (!name.empty() && (name.back() == ';' || std::isspace(name.back())))
-                name.pop_back();
-            while (!col.empty() && (col.back() == ';' || std::isspace(col.back())))
-                col.pop_back();
+        while (!name.empty() && (name.back() == ';' || std::isspace(name.back())))
+            name.pop_back();
+        while (!col.empty() && (col.back() == ';' || std::isspace(col.back())))
+            col.pop_back();
+        std::string target = col;
+        std::transform(target.begin(), target.end(), target.begin(), ::toupper);
 
-            if (op == "ADD")
-            {
-                // 去掉类型括号，例如 varchar(20) -> varchar
-                size_t paren = ctype.find('(');
-                if (paren != std::string::npos)
-                    ctype = ctype.substr(0, paren);
-                while (!ctype.empty() && (ctype.back() == ';' || ::isspace(ctype.back())))
-                    ctype.pop_back();
-                while (!ctype.empty() && ::isspace(ctype.front()))
-                    ctype.erase(ctype.begin());
-
-                db.addColumn(name, {col, parseType(ctype)});
-            }
-            else if (op == "DROP")
-            {
-                db.dropColumn(name, col);
-            }
+        if ((op == "ADD" || op == "DROP") && target == "PARTITION")
+        {
+            // ALTER TABLE t ADD PARTITION <名> VALUES LESS THAN (<值>) / ALTER TABLE t DROP PARTITION <名>
+            while (!ctype.empty() && (ctype.back() == ';' || std::isspace(ctype.back())))
+                ctype.pop_back();
+            std::string rest, upper;
+            std::getline(ss, rest);
+            std::vector<std::string> words = splitWords(rest);
+            size_t pos = 0;
+            if (ctype.empty() || (op == "ADD" ? !parseUpperBound(words, pos, upper) || pos != words.size() : !words.empty()))
+                dbOut() << "Invalid ALTER TABLE PARTITION syntax. Use: ALTER TABLE <table> ADD PARTITION <name> "
+                           "VALUES LESS THAN (<value>|MAXVALUE) or ALTER TABLE <table> DROP PARTITION <name>\n";
+            else if (op == "ADD")
+                db.addPartition(name, ctype, upper);
             else
+                db.dropPartition(name, ctype);
+        }
+        else if (op == "ADD")
+        {
+            // 去掉类型括号，例如 varchar(20) -> varchar
+            size_t paren = ctype.find('(');
+            if (paren != std::string::npos)
+                ctype = ctype.substr(0, paren);
+            while (!ctype.empty() && (ctype.back() == ';' || ::isspace(ctype.back())))
+                ctype.pop_back();
+            while (!ctype.empty() && ::isspace(ctype.front()))
+                ctype.erase(ctype.begin());
+
+            Column newCol{col, parseType(ctype)};
+
+            // 可选的 DEFAULT <值>
+            std::string kw;
+            if (ss >> kw)
             {
-                std::cout << "Invalid ALTER TABLE command.\n";
+                std::transform(kw.begin(), kw.end(), kw.begin(), ::toupper);
+                if (kw == "DEFAULT")
+                {
+                    std::string def;
+                    std::getline(ss, def);
+                    def.erase(std::remove(def.begin(), def.end(), '\''), def.end());
+                    def.erase(0, def.find_first_not_of(" \t"));
+                    while (!def.empty() && (def.back() == ';' || ::isspace(def.back())))
+                        def.pop_back();
+                    if (!def.empty())
+                        newCol.defaultValue = def;
+                }
             }
+            db.addColumn(name, newCol);
+        }
+        else if (op == "DROP")
+        {
+            db.dropColumn(name, col);
         }
         else
         {
-            std::cout << "Invalid SQL command.\n";
+            dbOut() << "Invalid ALTER TABLE command.\n";
         }
     }
+    /** ========== ANALYZE 处理 ========== */
+    else if (cmd == "ANALYZE" || cmd == "ANALYZE;")
+    {
+        std::string name;
+        ss >> name;
+        while (!name.empty() && (name.back() == ';' || std::isspace(name.back())))
+            name.pop_back();
+        db.analyze(name);
+    }
+    /** ========== 事务处理 ========== */
+    else if (cmd == "BEGIN" || cmd == "BEGIN;")
+    {
+        db.begin();
+    }
+    else if (cmd == "COMMIT" || cmd == "COMMIT;")
+    {
+        db.commit();
+    }
+    else if (cmd == "ROLLBACK" || cmd == "ROLLBACK;")
+    {
+        db.rollback();
+    }
+    else
+    {
+        dbOut() << "Invalid SQL command.\n";
+    }
 }
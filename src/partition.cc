@@ -0,0 +1,266 @@
+#include "partition.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <unordered_set>
+
+/**
+ * @brief 去掉首尾空白并转为小写（与 WHERE 条件的文本比较一致）
+ */
+static std::string normalize(std::string_view s)
+{
+    size_t b = s.find_first_not_of(" \t\n\r");
+    if (b == std::string_view::npos)
+        return std::string();
+    size_t e = s.find_last_not_of(" \t\n\r");
+    std::string out(s.substr(b, e - b + 1));
+    std::transform(out.begin(), out.end(), out.begin(), ::tolower);
+    return out;
+}
+
+/**
+ * @brief 把 u 按大端写成 8 字节
+ */
+static std::string bigEndian(uint64_t u)
+{
+    std::string key(8, '\0');
+    for (int b = 7; b >= 0; b--, u >>= 8)
+        key[size_t(b)] = char(u & 0xff);
+    return key;
+}
+
+/**
+ * @brief FNV-1a 64 位哈希
+ */
+static uint64_t fnv1a(std::string_view s)
+{
+    uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : s)
+    {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+std::optional<std::string> PartitionScheme::rangeKey(std::string_view value) const
+{
+    std::string v = normalize(value);
+    if (v == "null")
+        return std::nullopt;
+    if (isTemporal(type))
+    {
+        int64_t t;
+        if (!parseTemporal(type, v, t))
+            return std::nullopt;
+        // 翻转符号位后按字节比较与按整数比较同序
+        return bigEndian(uint64_t(t) ^ (uint64_t(1) << 63));
+    }
+    if (type == DataType::INT || type == DataType::FLOAT || type == DataType::DOUBLE)
+    {
+        char *end;
+        double d = std::strtod(v.c_str(), &end);
+        if (v.empty() || *end != '\0' || d != d)
+            return std::nullopt;
+        if (d == 0)
+            d = 0; // -0 与 0 相同
+        uint64_t u;
+        std::memcpy(&u, &d, sizeof(u));
+        // 负数翻转所有位，正数只翻转符号位
+        u = (u >> 63) ? ~u : u ^ (uint64_t(1) << 63);
+        return bigEndian(u);
+    }
+    if (type == DataType::BOOL)
+    {
+        bool b;
+        if (!parseBool(v, b))
+            return std::nullopt;
+        return std::string(b ? "1" : "0");
+    }
+    return v;
+}
+
+std::string PartitionScheme::hashKey(std::string_view value) const
+{
+    std::string v = normalize(value);
+    int64_t t;
+    bool b;
+    if (isTemporal(type) && parseTemporal(type, v, t))
+        return bigEndian(uint64_t(t));
+    if (type == DataType::BOOL && parseBool(v, b))
+        return b ? "true" : "false";
+    return v;
+}
+
+bool PartitionScheme::build(std::string &error)
+{
+    upperKeys.clear();
+    if (parts.empty())
+    {
+        error = "Partitioned table needs at least one partition";
+        return false;
+    }
+    std::unordered_set<std::string> names;
+    for (size_t k = 0; k < parts.size(); k++)
+    {
+        const PartitionDef &p = parts[k];
+        bool ok = !p.name.empty() && std::all_of(p.name.begin(), p.name.end(), [](char c)
+                                                 { return std::isalnum((unsigned char)c) || c == '_'; });
+        if (!ok || !names.insert(p.name).second)
+        {
+            error = "Invalid or duplicate partition name: " + p.name;
+            return false;
+        }
+        if (kind != PartitionKind::RANGE)
+            continue;
+        if (p.upper.empty())
+        {
+            if (k + 1 != parts.size())
+            {
+                error = "MAXVALUE must be the last partition";
+                return false;
+            }
+            continue;
+        }
+        std::optional<std::string> key = rangeKey(p.upper);
+        if (!key)
+        {
+            error = "Invalid partition bound: " + p.upper;
+            return false;
+        }
+        if (!upperKeys.empty() && !(upperKeys.back() < *key))
+        {
+            error = "Partition bounds must be increasing: " + p.upper;
+            return false;
+        }
+        upperKeys.push_back(std::move(*key));
+    }
+    return true;
+}
+
+size_t PartitionScheme::routeKey(const std::string &key) const
+{
+    size_t k = size_t(std::upper_bound(upperKeys.begin(), upperKeys.end(), key) - upperKeys.begin());
+    if (k < upperKeys.size() || parts.size() > upperKeys.size())
+        return k;
+    return npos;
+}
+
+size_t PartitionScheme::route(std::string_view value) const
+{
+    if (parts.empty())
+        return npos;
+    if (kind == PartitionKind::HASH)
+        return size_t(fnv1a(hashKey(value)) % parts.size());
+    std::optional<std::string> key = rangeKey(value);
+    return key ? routeKey(*key) : 0;
+}
+
+std::vector<size_t> PartitionScheme::prune(std::string_view value) const
+{
+    size_t k = route(value);
+    if (k == npos)
+        return {};
+    return {k};
+}
+
+std::vector<size_t> PartitionScheme::prune(const ValueRange &range) const
+{
+    std::vector<size_t> all(parts.size());
+    for (size_t k = 0; k < all.size(); k++)
+        all[k] = k;
+    if (kind == PartitionKind::HASH || parts.empty())
+        return all;
+    size_t first = 0, last = parts.size() - 1;
+    if (!range.low.empty())
+    {
+        std::optional<std::string> key = rangeKey(range.low);
+        if (!key)
+            return all;
+        first = routeKey(*key);
+        if (first == npos)
+            return {};
+    }
+    if (!range.high.empty())
+    {
+        std::optional<std::string> key = rangeKey(range.high);
+        if (!key)
+            return all;
+        size_t k = routeKey(*key);
+        if (k == npos)
+            k = parts.size() - 1;
+        // 上界恰好是分区的下界且不含等号时，该分区不会有满足条件的行
+        else if (!range.highInclusive && k > 0 && *key == upperKeys[k - 1])
+            k--;
+        last = k;
+    }
+    if (first > last)
+        return {};
+    return std::vector<size_t>(all.begin() + first, all.begin() + last + 1);
+}
+
+size_t PartitionScheme::find(const std::string &part) const
+{
+    std::string name = normalize(part);
+    for (size_t k = 0; k < parts.size(); k++)
+        if (parts[k].name == name)
+            return k;
+    return npos;
+}
+
+/**
+ * 文件格式：第一行为 HASH 或 RANGE 与分区列名（以制表符分隔），之后每行一个分区：
+ * 分区名，RANGE 再加制表符与上界（MAXVALUE 分区没有上界）。
+ */
+bool PartitionScheme::saveToFile(const std::string &path) const
+{
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << (kind == PartitionKind::HASH ? "HASH" : "RANGE") << '\t' << column << '\n';
+        for (const auto &p : parts)
+        {
+            out << p.name;
+            if (kind == PartitionKind::RANGE && !p.upper.empty())
+                out << '\t' << p.upper;
+            out << '\n';
+        }
+        if (!out.flush())
+            return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    return !ec;
+}
+
+bool PartitionScheme::loadFromFile(const std::string &path)
+{
+    std::ifstream in(path);
+    std::string line;
+    if (!std::getline(in, line))
+        return false;
+    size_t tab = line.find('\t');
+    if (tab == std::string::npos)
+        return false;
+    std::string k = line.substr(0, tab);
+    if (k != "HASH" && k != "RANGE")
+        return false;
+    kind = k == "HASH" ? PartitionKind::HASH : PartitionKind::RANGE;
+    column = line.substr(tab + 1);
+    parts.clear();
+    while (std::getline(in, line))
+    {
+        if (line.empty())
+            continue;
+        PartitionDef p;
+        tab = line.find('\t');
+        p.name = line.substr(0, tab);
+        if (tab != std::string::npos)
+            p.upper = line.substr(tab + 1);
+        parts.push_back(std::move(p));
+    }
+    return true;
+}
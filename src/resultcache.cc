@@ -0,0 +1,137 @@
+#include "resultcache.h"
+#include "output.h"
+#include <exception>
+
+void ResultCache::setCapacity(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    cap.store(bytes, std::memory_order_relaxed);
+    shrink();
+}
+
+std::shared_ptr<const std::string> ResultCache::get(const std::string &key, uint64_t version, uint64_t &rows)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = byKey.find(key);
+    if (it == byKey.end())
+    {
+        misses++;
+        return nullptr;
+    }
+    if (it->second->version != version)
+    {
+        // 表在结果生成之后被修改过
+        erase(it->second);
+        invalidations++;
+        misses++;
+        return nullptr;
+    }
+    lru.splice(lru.begin(), lru, it->second);
+    hits++;
+    rows = it->second->rows;
+    return it->second->text;
+}
+
+void ResultCache::put(const std::string &key, uint64_t version, std::string text, uint64_t rows)
+{
+    // 键、文本与链表、哈希表节点的大致开销
+    size_t bytes = key.size() * 2 + text.size() + sizeof(Entry) + 64;
+    std::lock_guard<std::mutex> lock(mtx);
+    if (bytes > cap.load(std::memory_order_relaxed) / 4)
+        return;
+    auto it = byKey.find(key);
+    if (it != byKey.end())
+        erase(it->second);
+    lru.push_front({key, version, std::make_shared<const std::string>(std::move(text)), rows, bytes});
+    byKey.emplace(key, lru.begin());
+    used += bytes;
+    shrink();
+}
+
+void ResultCache::erase(std::list<Entry>::iterator it)
+{
+    used -= it->bytes;
+    byKey.erase(it->key);
+    lru.erase(it);
+}
+
+void ResultCache::shrink()
+{
+    while (!lru.empty() && used > cap.load(std::memory_order_relaxed))
+    {
+        erase(std::prev(lru.end()));
+        evictions++;
+    }
+}
+
+ResultCacheStats ResultCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    ResultCacheStats s;
+    s.capacity = cap.load(std::memory_order_relaxed);
+    s.bytes = used;
+    s.entries = lru.size();
+    s.hits = hits;
+    s.misses = misses;
+    s.invalidations = invalidations;
+    s.evictions = evictions;
+    return s;
+}
+
+ResultRecorder::ResultRecorder(size_t limit)
+    : out(dbOut(), limit), err(dbErr(), 0), outStream(&out), errStream(&err),
+      prevOut(outSink()), prevErr(errSink()), uncaught(std::uncaught_exceptions())
+{
+    outSink() = &outStream;
+    errSink() = &errStream;
+}
+
+ResultRecorder::~ResultRecorder()
+{
+    outStream.flush();
+    errStream.flush();
+    outSink() = prevOut;
+    errSink() = prevErr;
+}
+
+bool ResultRecorder::complete() const
+{
+    return !out.truncated && !err.written && std::uncaught_exceptions() == uncaught;
+}
+
+void ResultRecorder::Tee::keep(const char *s, size_t n)
+{
+    written = true;
+    if (truncated)
+        return;
+    if (copy.size() + n > limit)
+    {
+        truncated = true;
+        std::string().swap(copy);
+        return;
+    }
+    copy.append(s, n);
+}
+
+ResultRecorder::Tee::int_type ResultRecorder::Tee::overflow(int_type c)
+{
+    if (traits_type::eq_int_type(c, traits_type::eof()))
+        return traits_type::not_eof(c);
+    char ch = traits_type::to_char_type(c);
+    keep(&ch, 1);
+    target.put(ch);
+    return c;
+}
+
+std::streamsize ResultRecorder::Tee::xsputn(const char *s, std::streamsize n)
+{
+    keep(s, size_t(n));
+    target.write(s, n);
+    return n;
+}
+
+int ResultRecorder::Tee::sync()
+{
+    target.flush();
+    return 0;
+}
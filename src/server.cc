@@ -0,0 +1,432 @@
+#include "server.h"
+#include "parser.h"
+#include "output.h"
+#include <algorithm>
+#include <sstream>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const uint32_t kMaxFrame = 16u << 20; ///< 单个请求的最大字节数，超过则断开连接
+static const int kBatch = 16;                ///< 工作线程一次最多连续执行同一连接的请求数，之后让出给其他连接
+
+void appendFrame(std::string &out, const std::string &payload)
+{
+    uint32_t len = htonl(uint32_t(payload.size()));
+    out.append(reinterpret_cast<const char *>(&len), 4);
+    out += payload;
+}
+
+Server::~Server()
+{
+    // stop() 可能在 run() 返回后仍在写 wakeFd，不能在 shutdown() 中关闭
+    if (wakeFd >= 0)
+        ::close(wakeFd);
+}
+
+bool Server::listenTcp(const std::string &host, int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return fail("socket");
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(uint16_t(port));
+    if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1)
+    {
+        std::cerr << "Invalid address: " << host << "\n";
+        ::close(fd);
+        return false;
+    }
+    if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0)
+    {
+        ::close(fd);
+        return fail("bind/listen");
+    }
+    listeners.push_back(fd);
+    std::cout << "Listening on " << host << ":" << port << "\n";
+    return true;
+}
+
+bool Server::listenUnix(const std::string &path)
+{
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path))
+    {
+        std::cerr << "Socket path too long: " << path << "\n";
+        return false;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return fail("socket");
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path, path.c_str());
+    ::unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0)
+    {
+        ::close(fd);
+        return fail("bind/listen");
+    }
+    listeners.push_back(fd);
+    unixPath = path;
+    std::cout << "Listening on " << path << "\n";
+    return true;
+}
+
+void Server::run()
+{
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    watch(wakeFd, EPOLLIN, EPOLL_CTL_ADD);
+    for (int fd : listeners)
+        watch(fd, EPOLLIN, EPOLL_CTL_ADD);
+    for (size_t i = 0; i < workerCount; i++)
+        workers.emplace_back(&Server::workerLoop, this);
+
+    std::vector<epoll_event> events(256);
+    while (!stopping)
+    {
+        int n = epoll_wait(epfd, events.data(), int(events.size()), -1);
+        if (n < 0 && errno != EINTR)
+            break;
+        for (int i = 0; i < n; i++)
+        {
+            int fd = events[i].data.fd;
+            if (fd == wakeFd)
+            {
+                uint64_t v;
+                while (::read(wakeFd, &v, sizeof(v)) > 0)
+                {
+                }
+                flushPending();
+                continue;
+            }
+            if (std::find(listeners.begin(), listeners.end(), fd) != listeners.end())
+            {
+                acceptAll(fd);
+                continue;
+            }
+            auto it = conns.find(fd);
+            if (it == conns.end())
+                continue;
+            std::shared_ptr<Connection> c = it->second;
+            if (events[i].events & (EPOLLERR | EPOLLHUP))
+            {
+                closeConn(c);
+                continue;
+            }
+            if (events[i].events & EPOLLIN)
+                onReadable(c);
+            if (!c->closed && (events[i].events & EPOLLOUT))
+                writeOut(c);
+        }
+    }
+    shutdown();
+}
+
+void Server::stop()
+{
+    stopping = true;
+    uint64_t one = 1;
+    int fd = wakeFd;
+    if (fd >= 0)
+    {
+        ssize_t r = ::write(fd, &one, sizeof(one));
+        (void)r;
+    }
+}
+
+bool Server::fail(const char *what)
+{
+    std::cerr << what << " failed: " << strerror(errno) << "\n";
+    return false;
+}
+
+void Server::watch(int fd, uint32_t events, int op)
+{
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = fd;
+    epoll_ctl(epfd, op, fd, &ev);
+}
+
+uint32_t Server::interest(const Connection &c)
+{
+    return (c.inputClosed ? 0u : uint32_t(EPOLLIN | EPOLLRDHUP)) | (c.wantWrite ? uint32_t(EPOLLOUT) : 0u);
+}
+
+void Server::acceptAll(int lfd)
+{
+    while (true)
+    {
+        int fd = accept4(lfd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return; // EAGAIN：已取完；其他错误（如 fd 耗尽）下次再试
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // Unix 套接字上失败无妨
+        auto c = std::make_shared<Connection>();
+        c->fd = fd;
+        conns[fd] = c;
+        watch(fd, EPOLLIN | EPOLLRDHUP, EPOLL_CTL_ADD);
+    }
+}
+
+void Server::onReadable(const std::shared_ptr<Connection> &c)
+{
+    char buf[64 * 1024];
+    bool eof = false, broken = false;
+    while (true)
+    {
+        ssize_t n = ::read(c->fd, buf, sizeof(buf));
+        if (n > 0)
+        {
+            c->inbuf.append(buf, size_t(n));
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        eof = n == 0;
+        broken = n < 0 && errno != EAGAIN && errno != EWOULDBLOCK;
+        break;
+    }
+    if (broken)
+    {
+        closeConn(c);
+        return;
+    }
+
+    std::vector<std::string> reqs;
+    size_t pos = 0;
+    while (c->inbuf.size() - pos >= 4)
+    {
+        uint32_t len;
+        std::memcpy(&len, c->inbuf.data() + pos, 4);
+        len = ntohl(len);
+        if (len > kMaxFrame)
+        {
+            closeConn(c);
+            return;
+        }
+        if (c->inbuf.size() - pos - 4 < len)
+            break;
+        reqs.emplace_back(c->inbuf, pos + 4, len);
+        pos += 4 + len;
+    }
+    c->inbuf.erase(0, pos);
+
+    if (!reqs.empty())
+    {
+        bool idle;
+        {
+            std::lock_guard<std::mutex> lock(c->mtx);
+            for (auto &r : reqs)
+                c->requests.push_back(std::move(r));
+            idle = !c->busy;
+            c->busy = true;
+        }
+        if (idle)
+            schedule(c);
+    }
+    if (eof)
+        stopReading(c);
+}
+
+void Server::stopReading(const std::shared_ptr<Connection> &c)
+{
+    {
+        std::lock_guard<std::mutex> lock(c->mtx);
+        c->inputClosed = true;
+        c->inbuf.clear(); // 不完整的最后一帧不会再补全
+        watch(c->fd, interest(*c), EPOLL_CTL_MOD);
+    }
+    writeOut(c);
+}
+
+void Server::writeOut(const std::shared_ptr<Connection> &c)
+{
+    bool finished;
+    {
+        std::lock_guard<std::mutex> lock(c->mtx);
+        size_t off = 0;
+        while (off < c->outbuf.size())
+        {
+            ssize_t n = ::send(c->fd, c->outbuf.data() + off, c->outbuf.size() - off, MSG_NOSIGNAL);
+            if (n > 0)
+            {
+                off += size_t(n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            break;
+        }
+        c->outbuf.erase(0, off);
+        bool pending = !c->outbuf.empty();
+        if (pending != c->wantWrite)
+        {
+            c->wantWrite = pending;
+            watch(c->fd, interest(*c), EPOLL_CTL_MOD);
+        }
+        finished = c->inputClosed && !pending && !c->busy && c->requests.empty();
+    }
+    if (finished)
+        closeConn(c);
+}
+
+void Server::flushPending()
+{
+    std::vector<std::shared_ptr<Connection>> ready;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        ready.swap(pendingWrites);
+    }
+    for (auto &c : ready)
+        if (!c->closed)
+            writeOut(c);
+}
+
+void Server::notifyLoop(const std::shared_ptr<Connection> &c)
+{
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        pendingWrites.push_back(c);
+    }
+    uint64_t one = 1;
+    ssize_t r = ::write(wakeFd, &one, sizeof(one));
+    (void)r;
+}
+
+void Server::closeConn(const std::shared_ptr<Connection> &c)
+{
+    if (c->closed)
+        return;
+    epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, nullptr);
+    ::close(c->fd);
+    conns.erase(c->fd);
+    bool idle;
+    {
+        std::lock_guard<std::mutex> lock(c->mtx);
+        c->closed = true;
+        c->requests.clear();
+        idle = !c->busy && c->txn;
+        if (idle)
+            c->busy = true;
+    }
+    if (idle)
+        schedule(c);
+}
+
+void Server::schedule(const std::shared_ptr<Connection> &c)
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        runQueue.push_back(c);
+    }
+    queueCv.notify_one();
+}
+
+void Server::workerLoop()
+{
+    while (true)
+    {
+        std::shared_ptr<Connection> c;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCv.wait(lock, [this]
+                         { return workersStop || !runQueue.empty(); });
+            if (runQueue.empty())
+                return;
+            c = std::move(runQueue.front());
+            runQueue.pop_front();
+        }
+        serve(c);
+    }
+}
+
+void Server::serve(const std::shared_ptr<Connection> &c)
+{
+    db.attachTransaction(c->txn);
+    for (int done = 0;; done++)
+    {
+        std::string sql;
+        {
+            std::lock_guard<std::mutex> lock(c->mtx);
+            if (c->closed || c->requests.empty() || done == kBatch)
+            {
+                if (c->closed && db.inTransaction())
+                {
+                    std::ostringstream discard;
+                    OutputCapture capture(discard);
+                    db.rollback();
+                }
+                c->txn = db.detachTransaction();
+                bool more = !c->closed && !c->requests.empty();
+                c->busy = more;
+                if (more)
+                    schedule(c);
+                else if (c->inputClosed && !c->closed)
+                    notifyLoop(c); // 最后一个响应可能已在 busy 清除前发出，让事件循环再检查一次是否可以关闭
+                return;
+            }
+            sql = std::move(c->requests.front());
+            c->requests.pop_front();
+        }
+
+        std::ostringstream result;
+        {
+            OutputCapture capture(result);
+            try
+            {
+                executeSQL(db, sql);
+            }
+            catch (const std::exception &e)
+            {
+                result << "Error: " << e.what() << "\n";
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(c->mtx);
+            if (c->closed)
+                continue;
+            appendFrame(c->outbuf, result.str());
+        }
+        notifyLoop(c);
+    }
+}
+
+void Server::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        workersStop = true;
+    }
+    queueCv.notify_all();
+    for (auto &w : workers)
+        w.join();
+    for (auto &kv : conns)
+    {
+        ::close(kv.first);
+        if (kv.second->txn)
+        {
+            db.attachTransaction(kv.second->txn);
+            std::ostringstream discard;
+            OutputCapture capture(discard);
+            db.rollback();
+        }
+    }
+    conns.clear();
+    for (int fd : listeners)
+        ::close(fd);
+    if (!unixPath.empty())
+        ::unlink(unixPath.c_str());
+    ::close(epfd);
+}
@@ -0,0 +1,98 @@
+#include "server.h"
+#include "trace.h"
+#include <filesystem>
+#include <cstdlib>
+#include <csignal>
+#include <iostream>
+
+static Server *gServer = nullptr;
+
+static void onSignal(int)
+{
+    if (gServer)
+        gServer->stop();
+}
+
+/**
+ * @brief minidb-server 入口
+ *
+ * 用法：minidb-server [--host 地址] [--port 端口] [--unix 路径] [--threads 工作线程数] [--cache-mb 页缓存]
+ *                      [--slow-ms 慢查询阈值] [--result-cache-mb 结果缓存] [--trace 文件]
+ * 默认监听 127.0.0.1:5433，工作线程数为 CPU 核数。
+ * 指定 --cache-mb 时表按需分页打开，内存中至多缓存这么多兆字节的行，数据量可以超过内存。
+ * 指定 --result-cache-mb 时缓存只读查询的结果，表没有新的提交时重复的查询直接返回缓存的结果。
+ * 指定 --slow-ms 时把耗时超过该毫秒数的语句记录到数据目录下的 slow_query.log。
+ * 指定 --trace 时记录各阶段的耗时，退出时写成 Chrome trace JSON（需以 -DMINIDB_TRACE 编译）。
+ * 启动时加载数据目录中的所有表，收到 SIGINT/SIGTERM 后保存所有表并退出。
+ */
+int main(int argc, char **argv)
+{
+    std::string host = "127.0.0.1", unixPath;
+    int port = 5433;
+    size_t threads = std::thread::hardware_concurrency();
+    size_t cacheMb = 0;
+    size_t resultCacheMb = 0;
+    double slowMs = -1;
+    std::string tracePath;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opt = argv[i];
+        if (opt == "--host")
+            host = argv[i + 1];
+        else if (opt == "--port")
+            port = std::atoi(argv[i + 1]);
+        else if (opt == "--unix")
+            unixPath = argv[i + 1];
+        else if (opt == "--threads")
+            threads = size_t(std::atoi(argv[i + 1]));
+        else if (opt == "--cache-mb")
+            cacheMb = size_t(std::atoll(argv[i + 1]));
+        else if (opt == "--slow-ms")
+            slowMs = std::atof(argv[i + 1]);
+        else if (opt == "--result-cache-mb")
+            resultCacheMb = size_t(std::atoll(argv[i + 1]));
+        else if (opt == "--trace")
+            tracePath = argv[i + 1];
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--host addr] [--port n] [--unix path] [--threads n] [--cache-mb n] [--slow-ms n] [--result-cache-mb n] [--trace file]\n";
+            return 1;
+        }
+    }
+
+    sqlDB db;
+    db.setPageCacheSize(cacheMb << 20);
+    db.setSlowQueryLog(slowMs);
+    db.setResultCacheSize(resultCacheMb << 20);
+    if (!tracePath.empty() && !Tracer::enable(true))
+        std::cerr << "Tracing is not compiled in, rebuild with -DMINIDB_TRACE\n";
+    std::filesystem::path dbDir = std::filesystem::path(std::getenv("HOME")) / "miniDB/mydb_data";
+    std::vector<std::string> tableNames;
+    if (std::filesystem::exists(dbDir))
+    {
+        for (const auto &entry : std::filesystem::directory_iterator(dbDir))
+        {
+            std::string fname = entry.path().filename().string();
+            if (fname.size() > 6 && fname.substr(fname.size() - 6) == ".table")
+                tableNames.push_back(fname.substr(0, fname.size() - 6));
+        }
+    }
+    db.loadAll(tableNames);
+
+    Server server(db, threads);
+    bool ok = unixPath.empty() ? server.listenTcp(host, port) : server.listenUnix(unixPath);
+    if (!ok)
+        return 1;
+
+    gServer = &server;
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    std::signal(SIGPIPE, SIG_IGN);
+    server.run();
+    gServer = nullptr;
+
+    db.saveAll();
+    if (Tracer::enabled() && !Tracer::dump(tracePath))
+        std::cerr << "Cannot write trace file: " << tracePath << "\n";
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include "slowlog.h"
+#include <filesystem>
+#include <cstdio>
+#include <ctime>
+
+bool SlowQueryLog::open(const std::string &logPath, uint64_t thresholdNanos, uint64_t limit, int keep)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    threshold.store(UINT64_MAX, std::memory_order_relaxed);
+    if (out.is_open())
+        out.close();
+    out.open(logPath, std::ios::app);
+    if (!out)
+        return false;
+    std::error_code ec;
+    uint64_t existing = std::filesystem::file_size(logPath, ec);
+    path = logPath;
+    size = ec ? 0 : existing;
+    maxBytes = limit;
+    keepFiles = keep;
+    threshold.store(thresholdNanos, std::memory_order_relaxed);
+    return true;
+}
+
+void SlowQueryLog::close()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    threshold.store(UINT64_MAX, std::memory_order_relaxed);
+    if (out.is_open())
+        out.close();
+}
+
+void SlowQueryLog::write(const SlowQueryRecord &r)
+{
+    char stamp[32];
+    std::time_t now = std::time(nullptr);
+    std::tm tm;
+    localtime_r(&now, &tm);
+    std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+    char buf[512];
+    std::snprintf(buf, sizeof(buf),
+                  "%s kind=%s total_ms=%.3f filter_ms=%.3f sort_ms=%.3f persist_ms=%.3f "
+                  "rows_scanned=%llu rows_returned=%llu access_path=%s statement=",
+                  stamp, r.kind, r.totalNanos / 1e6, r.filterNanos / 1e6, r.sortNanos / 1e6,
+                  r.persistNanos / 1e6, (unsigned long long)r.rowsScanned,
+                  (unsigned long long)r.rowsReturned, r.accessPath);
+    std::string line = buf;
+    // 每条记录一行：语句中的换行替换为空格
+    for (char c : r.statement)
+        line += (c == '\n' || c == '\r') ? ' ' : c;
+    line += '\n';
+
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!out.is_open())
+        return;
+    if (size > 0 && size + line.size() > maxBytes)
+        rotate();
+    out << line;
+    out.flush();
+    size += line.size();
+}
+
+void SlowQueryLog::rotate()
+{
+    out.close();
+    std::error_code ec;
+    if (keepFiles <= 0)
+        std::filesystem::remove(path, ec);
+    else
+    {
+        for (int k = keepFiles - 1; k >= 1; k--)
+            std::filesystem::rename(path + "." + std::to_string(k), path + "." + std::to_string(k + 1), ec);
+        std::filesystem::rename(path, path + ".1", ec);
+    }
+    out.open(path, std::ios::trunc);
+    size = 0;
+}
@@ -0,0 +1,407 @@
+#include "stats.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <cstring>
+#include <random>
+
+/**
+ * @brief 判断单元格是否为空值（"NULL" 或空字符串）
+ */
+static bool isNullValue(std::string_view v)
+{
+    return v.empty() || v == "NULL";
+}
+
+/**
+ * @brief 判断列类型是否按数值比较
+ */
+static bool isNumericType(DataType type)
+{
+    return type == DataType::INT || type == DataType::FLOAT || type == DataType::DOUBLE;
+}
+
+/**
+ * @brief 把整个字符串解析为数值（单元格视图不以 '\0' 结尾，先复制到栈上的缓冲区）
+ */
+static bool parseNumber(std::string_view s, double &out)
+{
+    char buf[64];
+    if (s.empty() || s.size() >= sizeof(buf))
+        return false;
+    std::memcpy(buf, s.data(), s.size());
+    buf[s.size()] = '\0';
+    char *end = nullptr;
+    out = std::strtod(buf, &end);
+    return *end == '\0';
+}
+
+/**
+ * @brief 按列类型比较两个值
+ *
+ * 数值列也可能存有无法解析的文本：可解析的值（不含 NaN）全部排在无法解析的值之前，
+ * 两组内部分别按数值、字典序比较，保证是严格弱序（可以交给 std::sort）。
+ * @return a < b
+ */
+static bool lessByType(DataType type, std::string_view a, std::string_view b)
+{
+    if (!isNumericType(type))
+        return a < b;
+    double da, db;
+    bool na = parseNumber(a, da) && !std::isnan(da);
+    bool nb = parseNumber(b, db) && !std::isnan(db);
+    if (na && nb)
+        return da < db;
+    if (na != nb)
+        return na;
+    return a < b;
+}
+
+uint64_t hashValue(std::string_view value)
+{
+    uint64_t x = std::hash<std::string_view>{}(value);
+    // splitmix64 finalizer，保证低位和高位都足够随机
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+HyperLogLog::HyperLogLog(uint8_t precision)
+    : p(precision), regs(size_t(1) << precision, 0)
+{
+    if (precision < 4 || precision > 18)
+        throw std::invalid_argument("HyperLogLog precision must be in [4, 18]");
+}
+
+void HyperLogLog::add(std::string_view value)
+{
+    addHash(hashValue(value));
+}
+
+void HyperLogLog::addHash(uint64_t hash)
+{
+    size_t idx = hash >> (64 - p);
+    uint64_t rest = (hash << p) | (uint64_t(1) << (p - 1)); // 哨兵位，避免全 0
+    uint8_t rank = uint8_t(__builtin_clzll(rest) + 1);
+    if (rank > regs[idx])
+        regs[idx] = rank;
+}
+
+void HyperLogLog::merge(const HyperLogLog &other)
+{
+    if (other.p != p)
+        throw std::invalid_argument("Cannot merge HyperLogLog sketches of different precision");
+    for (size_t i = 0; i < regs.size(); i++)
+        regs[i] = std::max(regs[i], other.regs[i]);
+}
+
+double HyperLogLog::estimate() const
+{
+    const double m = double(regs.size());
+    double alpha = 0.7213 / (1.0 + 1.079 / m);
+    double sum = 0;
+    size_t zeros = 0;
+    for (uint8_t r : regs)
+    {
+        sum += std::ldexp(1.0, -int(r));
+        if (r == 0)
+            zeros++;
+    }
+    double e = alpha * m * m / sum;
+    // 小基数时 linear counting 更准确
+    if (e <= 2.5 * m && zeros > 0)
+        e = m * std::log(m / double(zeros));
+    return e;
+}
+
+HyperLogLog sketchColumn(const Table &t, size_t col, const Snapshot &snap, SketchCache *cache, size_t &rowsRead)
+{
+    HyperLogLog hll;
+    rowsRead = 0;
+    size_t n = t.rows.size();
+    const size_t kWords = ColumnBitmap::kWords;
+    // 一块中各段的可见位图
+    std::vector<uint64_t> masks(SketchCache::kChunkSegments * kWords);
+    auto addSegments = [&](HyperLogLog &out, size_t chunkBase, size_t segs)
+    {
+        for (size_t k = 0; k < segs; k++)
+        {
+            size_t base = chunkBase + k * RowStore::kSegmentRows;
+            uint64_t *mask = &masks[k * kWords];
+            t.clearNulls(base >> RowStore::kSegmentBits, col, mask);
+            forEachSetBit(mask, kWords, base, [&](size_t i)
+                          {
+                              out.add(t.cell(t.rows[i], col));
+                              rowsRead++; });
+        }
+    };
+    for (size_t chunkBase = 0, chunk = 0; chunkBase < n; chunkBase += SketchCache::kChunkRows, chunk++)
+    {
+        size_t segs = std::min(SketchCache::kChunkSegments, (n - chunkBase + RowStore::kSegmentRows - 1) >> RowStore::kSegmentBits);
+        bool whole = cache && chunkBase + SketchCache::kChunkRows <= n;
+        for (size_t k = 0; k < segs; k++)
+        {
+            uint64_t *mask = &masks[k * kWords];
+            t.visibleBits((chunkBase >> RowStore::kSegmentBits) + k, n, snap, mask);
+            for (size_t w = 0; w < kWords && whole; w++)
+                whole = mask[w] == ~uint64_t(0);
+        }
+        if (!whole)
+        {
+            addSegments(hll, chunkBase, segs);
+            continue;
+        }
+        hll.merge(*cache->get(col, chunk, t.rowsEpoch, [&]()
+                              {
+                                  HyperLogLog built;
+                                  addSegments(built, chunkBase, segs);
+                                  return built; }));
+    }
+    return hll;
+}
+
+double ColumnStats::equalSelectivity(const std::string &value, uint64_t rowCount) const
+{
+    if (rowCount == 0)
+        return 0;
+    if (isNullValue(value))
+        return double(nullCount) / double(rowCount);
+    if (!minVal.empty() && (lessByType(type, value, minVal) || lessByType(type, maxVal, value)))
+        return 0;
+
+    double nonNull = double(rowCount - nullCount) / double(rowCount);
+    if (!bounds.empty())
+    {
+        size_t hits = 0;
+        for (const auto &b : bounds)
+            if (b == value)
+                hits++;
+        if (hits > 1)
+            return nonNull * double(hits) / double(bounds.size());
+    }
+    if (distinct < 1)
+        return nonNull;
+    return nonNull / distinct;
+}
+
+double ColumnStats::lessThanSelectivity(const std::string &value, uint64_t rowCount) const
+{
+    if (rowCount == 0 || bounds.empty())
+        return 1.0 / 3; // 没有直方图时的经验值
+    size_t below = 0;
+    while (below < bounds.size() && lessByType(type, bounds[below], value))
+        below++;
+    double nonNull = double(rowCount - nullCount) / double(rowCount);
+    // 落在当前桶内的部分按半个桶估计
+    double buckets = double(below) + (below < bounds.size() ? 0.5 : 0);
+    return nonNull * buckets / double(bounds.size());
+}
+
+const ColumnStats *TableStats::find(const std::string &colName) const
+{
+    std::string name = colName;
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    for (const auto &c : columns)
+    {
+        std::string cname = c.name;
+        std::transform(cname.begin(), cname.end(), cname.begin(), ::tolower);
+        if (cname == name)
+            return &c;
+    }
+    return nullptr;
+}
+
+/*
+ * .stats 文件格式（以制表符分隔，每列一行）：
+ *   rows\t<行数>
+ *   col\t<列名>\t<类型>\t<null 数>\t<distinct>\t<min>\t<max>\t<桶数>\t<上界1>\t...
+ */
+void TableStats::saveToFile(const std::string &name) const
+{
+    std::ofstream file(getDbPath(name, ".stats"));
+    file << "rows\t" << rowCount << "\n";
+    for (const auto &c : columns)
+    {
+        file << "col\t" << c.name << "\t" << typeToString(c.type) << "\t" << c.nullCount << "\t"
+             << c.distinct << "\t" << c.minVal << "\t" << c.maxVal << "\t" << c.bounds.size();
+        for (const auto &b : c.bounds)
+            file << "\t" << b;
+        file << "\n";
+    }
+}
+
+bool TableStats::loadFromFile(const std::string &name)
+{
+    std::ifstream file(getDbPath(name, ".stats"));
+    if (!file)
+        return false;
+    TableStats loaded;
+    std::string line;
+    try
+    {
+        while (std::getline(file, line))
+        {
+            std::vector<std::string> fields;
+            std::stringstream ss(line);
+            std::string f;
+            while (std::getline(ss, f, '\t'))
+                fields.push_back(f);
+            if (fields.empty())
+                continue;
+            if (fields[0] == "rows" && fields.size() == 2)
+            {
+                loaded.rowCount = std::stoull(fields[1]);
+            }
+            else if (fields[0] == "col" && fields.size() >= 8)
+            {
+                ColumnStats c;
+                c.name = fields[1];
+                c.type = parseType(fields[2]);
+                c.nullCount = std::stoull(fields[3]);
+                c.distinct = std::stod(fields[4]);
+                c.minVal = fields[5];
+                c.maxVal = fields[6];
+                size_t n = std::stoul(fields[7]);
+                for (size_t i = 0; i < n && 8 + i < fields.size(); i++)
+                    c.bounds.push_back(fields[8 + i]);
+                loaded.columns.push_back(std::move(c));
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Invalid stats file for " << name << ": " << e.what() << "\n";
+        return false;
+    }
+    *this = std::move(loaded);
+    return true;
+}
+
+TableStats analyzeTable(const Table &t, const Snapshot &snap, size_t buckets)
+{
+    TableStats stats;
+    size_t n = t.rows.size();
+    for (size_t ri = 0; ri < n; ri++)
+        if (t.visible(ri, snap))
+            stats.rowCount++;
+    for (size_t ci = 0; ci < t.columns.size(); ci++)
+    {
+        ColumnStats cs;
+        cs.name = t.columns[ci].name;
+        cs.type = t.columns[ci].type;
+
+        HyperLogLog hll;
+        DataType type = cs.type;
+        // 按需分页的表读完一段后视图就可能失效，改为复制至多 kSampleRows 个值的蓄水池样本；
+        // 最小值、最大值和 NULL 个数仍按全部行统计
+        const size_t kSampleRows = 300000;
+        const bool sample = t.rows.paged();
+        std::vector<std::string_view> values;
+        std::vector<std::string> sampled;
+        std::string minVal, maxVal;
+        size_t nonNull = 0;
+        std::mt19937_64 rng(ci);
+        if (!sample)
+            values.reserve(stats.rowCount);
+        for (size_t ri = 0; ri < n; ri++)
+        {
+            if (!t.visible(ri, snap))
+                continue;
+            RowRef row = t.rows[ri];
+            std::string_view val = t.cell(row, ci);
+            if (isNullValue(val))
+            {
+                cs.nullCount++;
+                continue;
+            }
+            hll.add(val);
+            if (!sample)
+            {
+                values.push_back(val);
+                continue;
+            }
+            if (nonNull == 0 || lessByType(type, val, minVal))
+                minVal = val;
+            if (nonNull == 0 || lessByType(type, maxVal, val))
+                maxVal = val;
+            if (sampled.size() < kSampleRows)
+                sampled.emplace_back(val);
+            else if (size_t j = rng() % (nonNull + 1); j < kSampleRows)
+                sampled[j] = val;
+            nonNull++;
+        }
+        if (sample)
+            values.assign(sampled.begin(), sampled.end());
+        else
+            nonNull = values.size();
+        cs.distinct = std::min(hll.estimate(), double(nonNull));
+
+        if (!values.empty())
+        {
+            std::sort(values.begin(), values.end(),
+                      [type](std::string_view a, std::string_view b)
+                      { return lessByType(type, a, b); });
+            cs.minVal = sample ? minVal : std::string(values.front());
+            cs.maxVal = sample ? maxVal : std::string(values.back());
+
+            // 等深直方图：第 i 个桶的上界取第 (i+1)*n/k - 1 个值
+            size_t k = std::min(buckets, values.size());
+            for (size_t i = 0; i < k; i++)
+                cs.bounds.emplace_back(values[(i + 1) * values.size() / k - 1]);
+        }
+        stats.columns.push_back(std::move(cs));
+    }
+    return stats;
+}
+
+const char *accessPathName(AccessPath path)
+{
+    switch (path)
+    {
+    case AccessPath::INDEX_LOOKUP:
+        return "INDEX_LOOKUP";
+    case AccessPath::SAMPLE_SCAN:
+        return "SAMPLE_SCAN";
+    case AccessPath::VIEW_READ:
+        return "VIEW_READ";
+    case AccessPath::RESULT_CACHE:
+        return "RESULT_CACHE";
+    default:
+        return "FULL_SCAN";
+    }
+}
+
+ScanPlan chooseAccessPath(const TableStats &stats, size_t tableRows, const std::string &whereCol,
+                          const std::string &whereVal, bool hasIndex, bool unique)
+{
+    // 代价单位：顺序读取一行 = 1；索引探测的固定开销与每行随机访问更贵
+    const double kIndexProbeCost = 4.0;
+    const double kIndexRowCost = 1.5;
+
+    ScanPlan plan;
+    double rows = double(tableRows);
+    plan.cost = rows;
+    plan.estimatedRows = rows;
+    if (whereCol.empty())
+        return plan;
+
+    double selectivity = 0.1; // 没有统计信息时的默认选择率
+    const ColumnStats *cs = stats.rowCount ? stats.find(whereCol) : nullptr;
+    if (cs)
+        selectivity = cs->equalSelectivity(whereVal, stats.rowCount);
+    plan.estimatedRows = rows * selectivity;
+    if (unique)
+        plan.estimatedRows = std::min(plan.estimatedRows, 1.0);
+
+    if (hasIndex)
+    {
+        double indexCost = kIndexProbeCost + plan.estimatedRows * kIndexRowCost;
+        if (indexCost < plan.cost)
+        {
+            plan.path = AccessPath::INDEX_LOOKUP;
+            plan.cost = indexCost;
+        }
+    }
+    return plan;
+}
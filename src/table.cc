@@ -1,4 +1,9 @@
 #include "table.h"
+#include "wal.h"
+#include "pagecache.h"
+#include "trace.h"
+#include "codec.h"
+#include <iterator>
 
 #ifdef _WIN32
 #include <direct.h> // _mkdir
@@ -8,7 +13,7 @@
 #define MKDIR(path) mkdir(path, 0755)
 #endif
 
-std::string getDbPath(const std::string &name)
+std::string getDbPath(const std::string &name, const std::string &ext)
 {
     // 1. 获取用户目录
     const char *homeDir = nullptr;
@@ -40,7 +45,7 @@ std::string getDbPath(const std::string &name)
 #endif
 
     // 4. 拼接文件路径
-    return dbDir + "/" + name + ".table";
+    return dbDir + "/" + name + ext;
 }
 /**
  * 获取表文件路径的函数
@@ -57,8 +62,191 @@ static std::string getTableFilePath(const std::string &name)
     return path;
 }
 
+/**
+ * @brief 解析单个列定义 "<列名> <类型> [PRIMARY KEY | UNIQUE] [INDEX] [TRIGRAM] [DEFAULT <值>]"
+ * @return 类型无法识别时返回 false
+ */
+static bool parseColumnDef(const std::string &def, Column &out)
+{
+    std::stringstream cs(def);
+    std::string cname, ctype, kw;
+    cs >> cname >> ctype;
+    try
+    {
+        out = {cname, parseType(ctype)};
+    }
+    catch (const std::invalid_argument &)
+    {
+        return false;
+    }
+    while (cs >> kw)
+    {
+        std::transform(kw.begin(), kw.end(), kw.begin(), ::toupper);
+        if (kw == "PRIMARY")
+            out.constraint = ColumnConstraint::PRIMARY_KEY; // 之后的 KEY 不需要单独处理
+        else if (kw == "UNIQUE")
+            out.constraint = ColumnConstraint::UNIQUE;
+        else if (kw == "INDEX")
+            out.textIndex |= TextIndex::kSorted;
+        else if (kw == "TRIGRAM")
+            out.textIndex |= TextIndex::kTrigram;
+        else if (kw == "DEFAULT")
+        {
+            std::getline(cs, out.defaultValue);
+            out.defaultValue.erase(0, out.defaultValue.find_first_not_of(" \t"));
+            break;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 生成列定义字符串，与 parseColumnDef 互逆
+ */
+static std::string formatColumnDef(const Column &col)
+{
+    std::string def = col.name + " " + typeToString(col.type);
+    if (col.constraint == ColumnConstraint::PRIMARY_KEY)
+        def += " PRIMARY KEY";
+    else if (col.constraint == ColumnConstraint::UNIQUE)
+        def += " UNIQUE";
+    if (col.textIndex & TextIndex::kSorted)
+        def += " INDEX";
+    if (col.textIndex & TextIndex::kTrigram)
+        def += " TRIGRAM";
+    if (col.defaultValue != "NULL")
+        def += " DEFAULT " + col.defaultValue;
+    return def;
+}
+
+/**
+ * @brief 把表文件中的一行切成单元格视图
+ *
+ * 空单元格也要保留，否则后面的列会错位；行尾的逗号之后不算一个单元格。
+ */
+static void splitLine(std::string_view line, std::vector<std::string_view> &cells)
+{
+    cells.clear();
+    for (size_t start = 0; start < line.size();)
+    {
+        size_t comma = std::min(line.find(',', start), line.size());
+        cells.push_back(line.substr(start, comma - start));
+        start = comma + 1;
+    }
+}
+
+/**
+ * @brief 读取表文件的分段索引 <表名>.idx
+ * @return 文件不存在或格式不对时返回 false
+ */
+static bool readIndex(const std::string &name, TableFileIndex &index)
+{
+    std::ifstream in(getDbPath(name, ".idx"));
+    if (!(in >> index.fileSize >> index.checkpointTs >> index.rowCount))
+        return false;
+    size_t n = (index.rowCount + RowStore::kSegmentRows - 1) / RowStore::kSegmentRows;
+    index.chunks.resize(n);
+    for (auto &off : index.chunks)
+        if (!(in >> off))
+            return false;
+    return true;
+}
+
+/**
+ * @brief 写出分段索引（先写临时文件再 rename，不需要 fsync：打开时会与表文件核对）
+ */
+static void writeIndex(const std::string &name, const TableFileIndex &index)
+{
+    std::string path = getDbPath(name, ".idx");
+    {
+        std::ofstream out(path + ".tmp", std::ios::trunc);
+        out << index.fileSize << " " << index.checkpointTs << " " << index.rowCount << "\n";
+        for (uint64_t off : index.chunks)
+            out << off << "\n";
+    }
+    std::rename((path + ".tmp").c_str(), path.c_str());
+}
+
+/**
+ * @brief 从 dataStart 起顺序扫描表文件，按非空行重建分段索引
+ */
+static void buildIndex(std::istream &in, uint64_t dataStart, TableFileIndex &index)
+{
+    index.rowCount = 0;
+    index.chunks.clear();
+    in.clear();
+    in.seekg(std::streamoff(dataStart));
+    std::vector<char> buf(1 << 20);
+    uint64_t pos = dataStart;
+    bool lineStart = true;
+    while (in.read(buf.data(), std::streamsize(buf.size())) || in.gcount() > 0)
+    {
+        size_t n = size_t(in.gcount());
+        for (size_t k = 0; k < n; k++, pos++)
+        {
+            if (lineStart && buf[k] != '\n')
+            {
+                if (index.rowCount % RowStore::kSegmentRows == 0)
+                    index.chunks.push_back(pos);
+                index.rowCount++;
+            }
+            lineStart = buf[k] == '\n';
+        }
+    }
+}
+
+/**
+ * @brief 从 dataStart 起按块头跳读列式压缩的表文件，重建分段索引（每块即一段）
+ */
+static void buildChunkIndex(std::istream &in, uint64_t dataStart, TableFileIndex &index)
+{
+    index.rowCount = 0;
+    index.chunks.clear();
+    in.clear();
+    uint64_t pos = dataStart;
+    char header[ChunkEncoder::kHeaderSize];
+    uint32_t size, rows;
+    while (pos + sizeof(header) <= index.fileSize && in.seekg(std::streamoff(pos)) &&
+           in.read(header, sizeof(header)) && readChunkHeader(std::string_view(header, sizeof(header)), size, rows))
+    {
+        index.chunks.push_back(pos);
+        index.rowCount += rows;
+        pos += sizeof(header) + size;
+    }
+}
+
+/**
+ * @brief 解码从 bytes 开始的一个压缩块，以每行的单元格视图依次调用 fn
+ * @return 解码出的字节数，块不完整时为 0
+ */
+template <class Fn>
+static size_t forEachChunkRow(std::string_view bytes, const std::vector<DataType> &types, Fn fn)
+{
+    uint32_t size, count;
+    std::vector<DecodedColumn> cols;
+    if (!readChunkHeader(bytes, size, count) || !decodeChunk(bytes, types, cols))
+        return 0;
+    std::vector<std::string_view> cells(cols.size());
+    for (size_t k = 0; k < count; k++)
+    {
+        for (size_t c = 0; c < cols.size(); c++)
+            cells[c] = cols[c][k];
+        fn(cells);
+    }
+    return ChunkEncoder::kHeaderSize + size;
+}
+
+std::vector<DataType> Table::columnTypes() const
+{
+    std::vector<DataType> types;
+    for (const auto &c : columns)
+        types.push_back(c.type);
+    return types;
+}
+
 int Table::getColumnIndex(const std::string &colName) const
 {
+    TRACE_SPAN("Table::getColumnIndex");
     std::string name = colName;
     std::transform(name.begin(), name.end(), name.begin(), ::tolower);
     for (size_t i = 0; i < columns.size(); i++)
@@ -71,100 +259,682 @@ int Table::getColumnIndex(const std::string &colName) const
     return -1;
 }
 
-void Table::saveToFile(const std::string &name)
+void Table::saveToFile(const std::string &name, uint64_t checkpointTs) const
+{
+    TRACE_SPAN("Table::saveToFile");
+    installFile(name, writeTempFile(name, serialize(checkpointTs, Snapshot::latest())));
+}
+
+std::string Table::serialize(uint64_t checkpointTs, const Snapshot &snap) const
+{
+    std::ostringstream file;
+    serialize(file, checkpointTs, snap);
+    return file.str();
+}
+
+void Table::serialize(std::ostream &out, uint64_t checkpointTs, const Snapshot &snap, TableFileIndex *index) const
 {
-    std::ofstream file(getTableFilePath(name));
+    std::string line;
     for (const auto &col : columns)
+        line += formatColumnDef(col) + ",";
+    // 旧版本的加载器会把它当作无法识别的列定义跳过
+    if (checkpointTs)
+        line += "@checkpoint " + std::to_string(checkpointTs) + ",";
+    line += "@format columnar,\n";
+    out << line;
+    uint64_t offset = line.size();
+    size_t written = 0;
+    // 只写出快照可见的版本，旧版本的行在写出时按当前 schema 展开；每 kSegmentRows 行编码为一块
+    ChunkEncoder encoder(columnTypes());
+    std::vector<std::string_view> cells;
+    std::string block;
+    auto flush = [&]
     {
-        std::string typeStr;
-        switch (col.type)
-        {
-        case DataType::INT:
-            typeStr = "INT";
-            break;
-        case DataType::TEXT:
-            typeStr = "TEXT";
-            break;
-        case DataType::FLOAT:
-            typeStr = "FLOAT";
-            break;
-        case DataType::DOUBLE:
-            typeStr = "DOUBLE";
-            break;
-        case DataType::DATE:
-            typeStr = "DATE";
-            break;
-        case DataType::BOOL:
-            typeStr = "BOOL";
-            break;
-        case DataType::VARCHAR:
-            typeStr = "VARCHAR";
-            break;
-        }
-        file << col.name << " " << typeStr << ",";
+        if (index)
+            index->chunks.push_back(offset);
+        block.clear();
+        offset += encoder.finish(block);
+        out.write(block.data(), std::streamsize(block.size()));
+    };
+    size_t n = rows.size();
+    for (size_t i = 0; i < n; i++)
+    {
+        if (!visible(i, snap))
+            continue;
+        RowRef row = rows[i];
+        cells.clear();
+        for (size_t c = 0; c < columns.size(); c++)
+            cells.push_back(cell(row, c));
+        encoder.addRow(cells);
+        written++;
+        if (encoder.rows() == RowStore::kSegmentRows)
+            flush();
     }
-    file << "\n";
-    for (const auto &row : rows)
+    if (encoder.rows())
+        flush();
+    if (index)
     {
-        for (const auto &val : row.values)
-            file << val << ",";
-        file << "\n";
+        index->fileSize = offset;
+        index->checkpointTs = checkpointTs;
+        index->rowCount = written;
+        index->columnar = true;
     }
-    file.close();
+}
+
+std::string Table::writeTempFile(const std::string &name, const std::string &content)
+{
+    TRACE_SPAN("Table::writeTempFile");
+    std::string tmp = getDbPath(name) + ".tmp";
+    {
+        std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+        file << content;
+    }
+    syncFile(tmp);
+    return tmp;
+}
+
+std::string Table::writeTempFile(const std::string &name, uint64_t checkpointTs, const Snapshot &snap,
+                                 TableFileIndex &index) const
+{
+    TRACE_SPAN("Table::writeTempFile");
+    std::string tmp = getDbPath(name) + ".tmp";
+    {
+        std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+        index = TableFileIndex();
+        serialize(file, checkpointTs, snap, &index);
+    }
+    syncFile(tmp);
+    return tmp;
+}
+
+void Table::installFile(const std::string &name, const std::string &tmp, const TableFileIndex *index)
+{
+    TRACE_SPAN("Table::installFile");
+    // 先删旧索引：崩溃后留下的只可能是没有索引的新文件，打开时重建
+    std::remove(getDbPath(name, ".idx").c_str());
+    std::rename(tmp.c_str(), getDbPath(name).c_str());
+    std::remove(getDbPath(name, ".schema").c_str());
+    std::remove(getDbPath(name, ".del").c_str());
+    if (index)
+        writeIndex(name, *index);
+}
+
+bool Table::parseHeader(const std::string &line)
+{
+    std::stringstream ss(line);
+    std::string col;
+    bool columnar = false;
+    while (std::getline(ss, col, ','))
+    {
+        Column c;
+        if (col.compare(0, 12, "@checkpoint ") == 0)
+            checkpointTs = std::strtoull(col.c_str() + 12, nullptr, 10);
+        else if (col == "@format columnar")
+            columnar = true;
+        else if (!col.empty() && parseColumnDef(col, c))
+            columns.push_back(c);
+    }
+    return columnar;
 }
 
 void Table::loadFromFile(const std::string &name)
 {
-    std::ifstream file(getTableFilePath(name));
+    std::ifstream file(getTableFilePath(name), std::ios::binary);
     if (!file)
         return;
     std::string line;
-    if (std::getline(file, line))
+    if (std::getline(file, line) && parseHeader(line))
     {
-        std::stringstream ss(line);
-        std::string col;
-        while (std::getline(ss, col, ','))
+        std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::vector<DataType> types = columnTypes();
+        for (std::string_view rest(data); !rest.empty();)
         {
-            if (!col.empty())
-            {
-                std::stringstream cs(col);
-                std::string cname, ctype;
-                cs >> cname >> ctype;
-                DataType dtype;
-                std::string ctypeUpper = ctype;
-                std::transform(ctypeUpper.begin(), ctypeUpper.end(), ctypeUpper.begin(), ::toupper);
-                if (ctypeUpper == "INT")
-                    dtype = DataType::INT;
-                else if (ctypeUpper == "TEXT")
-                    dtype = DataType::TEXT;
-                else if (ctypeUpper == "FLOAT")
-                    dtype = DataType::FLOAT;
-                else if (ctypeUpper == "DOUBLE")
-                    dtype = DataType::DOUBLE;
-                else if (ctypeUpper == "DATE")
-                    dtype = DataType::DATE;
-                else if (ctypeUpper == "BOOL")
-                    dtype = DataType::BOOL;
-                else if (ctypeUpper == "VARCHAR")
-                    dtype = DataType::VARCHAR;
-                else
-                    continue;
-                columns.push_back({cname, dtype});
-            }
+            size_t used = forEachChunkRow(rest, types, [&](const std::vector<std::string_view> &cells)
+                                          { rows.append(cells.begin(), cells.size(), schemaVersion, kBootstrapTs,
+                                                        kInfinityTs, &columns); });
+            if (used == 0)
+                break;
+            rest.remove_prefix(used);
         }
+        applyLegacyFiles(name);
+        rowsEpoch++;
+        buildIndexes();
+        return;
     }
+    // 逐行文本的旧表文件：单元格直接从行缓冲区切出视图写入 arena，不为每个单元格单独分配字符串
+    std::vector<std::string_view> cells;
     while (std::getline(file, line))
     {
-        std::stringstream ss(line);
-        std::string val;
-        Row row;
-        while (std::getline(ss, val, ','))
+        if (line.empty())
+            continue;
+        splitLine(line, cells);
+        rows.append(cells.begin(), cells.size(), schemaVersion, kBootstrapTs, kInfinityTs, &columns);
+    }
+    file.close();
+    applyLegacyFiles(name);
+    rowsEpoch++;
+    buildIndexes();
+}
+
+bool Table::openPaged(const std::string &name, PageCache &cache)
+{
+    std::string path = getTableFilePath(name);
+    std::ifstream file(path, std::ios::binary);
+    struct stat st;
+    if (!file || stat(path.c_str(), &st) != 0)
+        return false;
+    std::string line;
+    std::getline(file, line);
+    bool columnar = parseHeader(line);
+    std::streamoff dataStart = file.tellg();
+    uint64_t fileSize = uint64_t(st.st_size);
+    TableFileIndex index;
+    if (!readIndex(name, index) || index.fileSize != fileSize || index.checkpointTs != checkpointTs)
+    {
+        index = TableFileIndex();
+        index.fileSize = fileSize;
+        index.checkpointTs = checkpointTs;
+        if (dataStart >= 0 && columnar)
+            buildChunkIndex(file, uint64_t(dataStart), index);
+        else if (dataStart >= 0)
+            buildIndex(file, uint64_t(dataStart), index);
+        writeIndex(name, index);
+    }
+    index.columnar = columnar;
+    file.close();
+    if (!rows.openFile(path, index, cache, columnTypes()))
+        return false;
+    pageCache = &cache;
+    applyLegacyFiles(name);
+    rowsEpoch++;
+    buildIndexes();
+    return true;
+}
+
+void Table::applyLegacyFiles(const std::string &name)
+{
+    std::ifstream del(getDbPath(name, ".del"));
+    size_t rowId;
+    while (del >> rowId)
+    {
+        if (rowId < rows.size() && rows.endTs(rowId) == kInfinityTs)
         {
-            if (!val.empty())
-                row.values.push_back(val);
+            rows.setEnd(rowId, kBootstrapTs);
+            deadCount++;
         }
-        if (!row.values.empty())
-            rows.push_back(row);
     }
-    file.close();
-}
\ No newline at end of file
+
+    // 重放保存表文件之后的增删列
+    std::ifstream schema(getDbPath(name, ".schema"));
+    std::string line;
+    while (std::getline(schema, line))
+        applySchemaChange(line);
+}
+
+bool Table::applySchemaChange(const std::string &change)
+{
+    std::string op = change.substr(0, change.find(' '));
+    std::string rest = change.size() > op.size() ? change.substr(op.size() + 1) : "";
+    Column c;
+    if (op == "ADD" && parseColumnDef(rest, c) && getColumnIndex(c.name) == -1)
+        addColumn(c);
+    else if (op == "DROP" && getColumnIndex(rest) != -1)
+        dropColumn(getColumnIndex(rest));
+    else if (op == "INDEX")
+    {
+        std::stringstream ss(rest);
+        std::string name, kind;
+        ss >> name;
+        int idx = getColumnIndex(name);
+        if (idx == -1)
+            return false;
+        uint8_t kinds = 0;
+        while (ss >> kind)
+            kinds |= kind == "SORTED" ? TextIndex::kSorted : kind == "TRIGRAM" ? TextIndex::kTrigram : 0;
+        setTextIndex(size_t(idx), kinds);
+    }
+    else
+        return false;
+    return true;
+}
+
+void RowStore::visibleBits(size_t seg, size_t n, const Snapshot &snap, uint64_t *out) const
+{
+    std::fill(out, out + ColumnBitmap::kWords, 0);
+    size_t base = seg << kSegmentBits;
+    size_t count = std::min(n, base + kSegmentRows);
+    count = count > base ? count - base : 0;
+    if (count == 0)
+        return;
+    // 没有时间戳数组时段内都是表文件中未修改过的行。之后才分配的数组只会带来本快照之后的提交，
+    // 因此整段按开始时取到的数组判断，结果与逐行读取相同
+    const Slot *m = segment(base).meta.load(std::memory_order_acquire);
+    if (!m)
+    {
+        if (!snap.sees(kBootstrapTs, kInfinityTs))
+            return;
+        for (size_t w = 0; w < count / 64; w++)
+            out[w] = ~uint64_t(0);
+        if (count % 64)
+            out[count / 64] = (uint64_t(1) << (count % 64)) - 1;
+        return;
+    }
+    for (size_t k = 0; k < count; k++)
+        out[k / 64] |= uint64_t(snap.sees(m[k].begin.load(std::memory_order_acquire),
+                                          m[k].end.load(std::memory_order_acquire)))
+                       << (k % 64);
+}
+
+void Table::visibleBits(size_t seg, size_t n, const Snapshot &snap, uint64_t *out) const
+{
+    rows.visibleBits(seg, n, snap, out);
+}
+
+void Table::clearNulls(size_t seg, size_t col, uint64_t *mask) const
+{
+    SegmentBitmap bm;
+    if (columnBitmap(seg, col, bm))
+    {
+        // 段内的行都取默认值：默认值为 NULL 时全部清零
+        for (size_t w = 0; w < ColumnBitmap::kWords; w++)
+            mask[w] &= bm.bits ? bm.bits->valid[w].load(std::memory_order_relaxed)
+                               : (columns[col].defaultValue == "NULL" ? 0 : ~uint64_t(0));
+        return;
+    }
+    size_t base = seg << RowStore::kSegmentBits;
+    forEachSetBit(mask, ColumnBitmap::kWords, 0, [&](size_t k)
+                  {
+                      if (isNull(rows[base + k], col))
+                          mask[k / 64] &= ~(uint64_t(1) << (k % 64)); });
+}
+
+Row Table::materialize(const RowRef &row) const
+{
+    Row out;
+    out.version = schemaVersion;
+    out.values.reserve(columns.size());
+    for (size_t c = 0; c < columns.size(); c++)
+        out.values.emplace_back(cell(row, c));
+    return out;
+}
+
+void Table::addColumn(const Column &col)
+{
+    // 当前版本的行成为旧版本：原有列恒等映射，新列取默认值
+    std::vector<int> prev(columns.size());
+    for (size_t i = 0; i < prev.size(); i++)
+        prev[i] = int(i);
+    layouts.push_back(std::move(prev));
+    for (auto &layout : layouts)
+        layout.push_back(-1);
+    columns.push_back(col);
+    schemaVersion++;
+    rowsEpoch++;
+    if (col.constraint != ColumnConstraint::NONE || col.textIndex)
+        buildIndexes();
+    else
+    {
+        if (!keys.empty())
+            keys.emplace_back();
+        if (!texts.empty())
+            texts.emplace_back();
+    }
+}
+
+/**
+ * @brief 索引向量中不再有任何索引时清空（appendRow() 据此跳过建索引）
+ */
+template <class Index>
+static void clearIfEmpty(std::vector<std::unique_ptr<Index>> &slots)
+{
+    if (std::none_of(slots.begin(), slots.end(), [](const std::unique_ptr<Index> &k)
+                     { return k != nullptr; }))
+        slots.clear();
+}
+
+void Table::dropColumn(size_t idx)
+{
+    std::vector<int> prev(columns.size());
+    for (size_t i = 0; i < prev.size(); i++)
+        prev[i] = int(i);
+    layouts.push_back(std::move(prev));
+    for (auto &layout : layouts)
+        layout.erase(layout.begin() + idx);
+    columns.erase(columns.begin() + idx);
+    schemaVersion++;
+    rowsEpoch++;
+    if (idx < keys.size())
+        keys.erase(keys.begin() + idx);
+    if (idx < texts.size())
+        texts.erase(texts.begin() + idx);
+    clearIfEmpty(keys);
+    clearIfEmpty(texts);
+}
+
+bool Table::needsCompaction(double ratio) const
+{
+    const size_t kMaxSchemaVersions = 8;
+    if (openTxns > 0 || rows.paged())
+        return false;
+    return (deadCount > 0 && deadRatio() >= ratio) || layouts.size() >= kMaxSchemaVersions;
+}
+
+void Table::compact(uint64_t horizon)
+{
+    if (rows.paged() || (deadCount == 0 && layouts.empty()))
+        return;
+    // 保留的行按当前 schema 复制到新的行存储（连同新的 arena），旧的段与 arena 整体释放
+    RowStore kept;
+    std::vector<std::string_view> cells(columns.size());
+    size_t stillDead = 0;
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        uint64_t begin = rows.beginTs(i), end = rows.endTs(i);
+        bool ended = end != kInfinityTs && !(end & kTxnFlag);
+        if (ended && end <= horizon)
+            continue;
+        RowRef row = rows[i];
+        for (size_t c = 0; c < columns.size(); c++)
+            cells[c] = cell(row, c);
+        kept.append(cells.begin(), cells.size(), 0, begin, end, &columns);
+        if (ended)
+            stillDead++;
+    }
+    rows.swap(kept);
+    deadCount = stillDead;
+    layouts.clear();
+    schemaVersion = 0;
+    rowsEpoch++;
+    buildIndexes();
+}
+
+void Table::remap(const std::string &name, const TableFileIndex &index)
+{
+    rows.clear();
+    rows.openFile(getDbPath(name), index, *pageCache, columnTypes());
+    deadCount = 0;
+    layouts.clear();
+    schemaVersion = 0;
+    rowsEpoch++;
+    buildIndexes();
+}
+
+std::optional<std::string> Table::keyOf(size_t col, std::string_view value) const
+{
+    size_t b = value.find_first_not_of(" \t\n\r");
+    std::string v;
+    if (b != std::string_view::npos)
+        v = value.substr(b, value.find_last_not_of(" \t\n\r") - b + 1);
+    std::transform(v.begin(), v.end(), v.begin(), ::tolower);
+    if (v == "null")
+        return std::nullopt;
+    DataType type = columns[col].type;
+    int64_t t;
+    bool flag;
+    if (isTemporal(type) && parseTemporal(type, v, t))
+        return std::to_string(t);
+    if (type == DataType::BOOL && parseBool(v, flag))
+        return std::string(flag ? "true" : "false");
+    return v;
+}
+
+void Table::indexRow(const Row &row, size_t i)
+{
+    for (size_t c = 0; c < keys.size() && c < row.values.size(); c++)
+        if (keys[c])
+            if (std::optional<std::string> key = keyOf(c, row.values[c]))
+                keys[c]->add(std::move(*key), i);
+    for (size_t c = 0; c < texts.size() && c < row.values.size(); c++)
+        if (texts[c] && row.values[c] != "NULL")
+            texts[c]->add(row.values[c], i);
+}
+
+void Table::buildIndexes()
+{
+    keys.clear();
+    texts.clear();
+    for (size_t c = 0; c < columns.size(); c++)
+    {
+        if (columns[c].constraint != ColumnConstraint::NONE)
+        {
+            keys.resize(columns.size());
+            keys[c] = std::make_unique<KeyIndex>();
+        }
+        if (columns[c].textIndex)
+        {
+            texts.resize(columns.size());
+            texts[c] = std::make_unique<TextIndex>(columns[c].textIndex);
+        }
+    }
+    if (keys.empty() && texts.empty())
+        return;
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        RowRef row = rows[i];
+        for (size_t c = 0; c < keys.size(); c++)
+            if (keys[c])
+                if (std::optional<std::string> key = keyOf(c, cell(row, c)))
+                    keys[c]->add(std::move(*key), i);
+        for (size_t c = 0; c < texts.size(); c++)
+            if (texts[c] && !isNull(row, c))
+                texts[c]->add(cell(row, c), i);
+    }
+}
+
+void Table::setTextIndex(size_t col, uint8_t kinds)
+{
+    columns[col].textIndex = kinds;
+    if (!kinds)
+    {
+        if (col < texts.size())
+            texts[col].reset();
+        clearIfEmpty(texts);
+        return;
+    }
+    texts.resize(columns.size());
+    texts[col] = std::make_unique<TextIndex>(kinds);
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        RowRef row = rows[i];
+        if (!isNull(row, col))
+            texts[col]->add(cell(row, col), i);
+    }
+}
+
+std::vector<size_t> Table::lookupKey(size_t col, std::string_view value) const
+{
+    std::optional<std::string> key;
+    if (!hasKeyIndex(col) || !(key = keyOf(col, value)))
+        return {};
+    return keys[col]->find(*key);
+}
+
+size_t Table::findConflict(size_t col, std::string_view value, uint64_t marker) const
+{
+    for (size_t i : lookupKey(col, value))
+    {
+        // 已提交的结束（删除或被覆盖）不再占用该值；其他写者未提交的删除可能回滚，仍算冲突
+        uint64_t end = rows.endTs(i);
+        if (end == kInfinityTs || ((end & kTxnFlag) && end != marker))
+            return i;
+    }
+    return SIZE_MAX;
+}
+
+RowStore::~RowStore()
+{
+    if (cache)
+        cache->forget(this);
+}
+
+RowStore::Segment &RowStore::addSegment()
+{
+    size_t seg = segments.size();
+    if (seg == dirCapacity)
+    {
+        // 新目录复制旧目录的段指针；旧目录保留，正在读取的读者不受影响
+        size_t cap = dirCapacity ? dirCapacity * 2 : 4;
+        std::unique_ptr<Segment *[]> next(new Segment *[cap]());
+        for (size_t k = 0; k < segments.size(); k++)
+            next[k] = segments[k].get();
+        dir.store(next.get(), std::memory_order_release);
+        dirs.push_back(std::move(next));
+        dirCapacity = cap;
+    }
+    segments.push_back(std::make_unique<Segment>());
+    dirs.back()[seg] = segments.back().get();
+    return *segments.back();
+}
+
+RowStore::Segment &RowStore::segmentFor(size_t i)
+{
+    size_t seg = i >> kSegmentBits;
+    if (seg == segments.size())
+    {
+        Segment &s = addSegment();
+        s.residentOwner = std::make_unique<Payload>();
+        s.resident = s.residentOwner.get();
+        allocateSlots(s);
+    }
+    return *segments[seg];
+}
+
+RowStore::Slot *RowStore::allocateSlots(Segment &seg)
+{
+    // 新数组的初值就是表文件中未修改过的行的时间戳，先填好再发布
+    seg.metaOwner.reset(new Slot[kSegmentRows]);
+    seg.meta.store(seg.metaOwner.get(), std::memory_order_release);
+    return seg.metaOwner.get();
+}
+
+bool RowStore::openFile(const std::string &path, const TableFileIndex &index, PageCache &c,
+                        std::vector<DataType> types)
+{
+    file.open(path, std::ios::binary);
+    if (!file)
+        return false;
+    cache = &c;
+    fileTypes = std::move(types);
+    fileColumnar = index.columnar;
+    for (size_t k = 0; k < index.chunks.size(); k++)
+    {
+        Segment &seg = addSegment();
+        seg.fileBegin = index.chunks[k];
+        seg.fileEnd = k + 1 < index.chunks.size() ? index.chunks[k + 1] : index.fileSize;
+        seg.fileRows = uint32_t(std::min(kSegmentRows, index.rowCount - k * kSegmentRows));
+        if (seg.fileRows < kSegmentRows)
+        {
+            // 不满一段的末尾常驻内存，之后追加的行接着写在这一段
+            seg.residentOwner = std::make_unique<Payload>();
+            readSegment(seg, *seg.residentOwner);
+            seg.resident = seg.residentOwner.get();
+        }
+    }
+    count.store(index.rowCount, std::memory_order_release);
+    return true;
+}
+
+void RowStore::readSegment(const Segment &seg, Payload &out) const
+{
+    std::string buf(seg.fileEnd - seg.fileBegin, '\0');
+    file.clear();
+    file.seekg(std::streamoff(seg.fileBegin));
+    file.read(&buf[0], std::streamsize(buf.size()));
+    buf.resize(size_t(file.gcount()));
+    auto typeAt = [this](size_t c)
+    { return c < fileTypes.size() ? fileTypes[c] : DataType::TEXT; };
+    if (fileColumnar)
+    {
+        uint32_t k = 0;
+        forEachChunkRow(buf, fileTypes, [&](const std::vector<std::string_view> &cells)
+                        {
+                            if (k < seg.fileRows)
+                                out.place(k++, cells.begin(), cells.size(), 0, typeAt); });
+        return;
+    }
+    std::vector<std::string_view> cells;
+    std::string_view rest(buf);
+    for (uint32_t k = 0; k < seg.fileRows && !rest.empty();)
+    {
+        size_t nl = std::min(rest.find('\n'), rest.size());
+        std::string_view line = rest.substr(0, nl);
+        rest.remove_prefix(std::min(nl + 1, rest.size()));
+        if (line.empty())
+            continue;
+        splitLine(line, cells);
+        out.place(k++, cells.begin(), cells.size(), 0, typeAt);
+    }
+}
+
+std::shared_ptr<const RowStore::Payload> RowStore::load(size_t idx) const
+{
+    Segment &seg = *dir.load(std::memory_order_acquire)[idx];
+    if (!seg.referenced.load(std::memory_order_relaxed))
+        seg.referenced.store(true, std::memory_order_relaxed);
+    std::shared_ptr<Payload> p = std::atomic_load(&seg.paged);
+    if (p)
+        return p;
+    size_t bytes;
+    {
+        // 同一张表的载入串行进行，重复的请求等前一个载入完成后直接使用
+        std::lock_guard<std::mutex> lock(fileMutex);
+        p = std::atomic_load(&seg.paged);
+        if (p)
+            return p;
+        p = std::make_shared<Payload>();
+        readSegment(seg, *p);
+        std::atomic_store(&seg.paged, p);
+        bytes = sizeof(Payload) + p->arena.capacity();
+    }
+    // 登记时可能换出其他段（包括本表的），不能持有 fileMutex
+    cache->admit(const_cast<RowStore *>(this), idx, bytes);
+    return p;
+}
+
+bool RowStore::tryEvict(size_t idx)
+{
+    Segment &seg = *dir.load(std::memory_order_acquire)[idx];
+    if (seg.referenced.exchange(false, std::memory_order_relaxed))
+        return false;
+    std::atomic_store(&seg.paged, std::shared_ptr<Payload>());
+    return true;
+}
+
+void RowStore::clear()
+{
+    if (cache)
+    {
+        cache->forget(this);
+        cache = nullptr;
+        file.close();
+        fileTypes.clear();
+        fileColumnar = false;
+    }
+    dir.store(nullptr, std::memory_order_release);
+    count.store(0, std::memory_order_release);
+    segments.clear();
+    dirs.clear();
+    dirCapacity = 0;
+}
+
+void RowStore::swap(RowStore &other)
+{
+    // 缓存按对象登记段，交换后登记失效；已载入的段留在内存中直到 clear()
+    if (cache)
+        cache->forget(this);
+    if (other.cache)
+        other.cache->forget(&other);
+    Segment **d = dir.load(std::memory_order_relaxed);
+    dir.store(other.dir.load(std::memory_order_relaxed), std::memory_order_release);
+    other.dir.store(d, std::memory_order_release);
+    size_t n = count.load(std::memory_order_relaxed);
+    count.store(other.count.load(std::memory_order_relaxed), std::memory_order_release);
+    other.count.store(n, std::memory_order_release);
+    dirs.swap(other.dirs);
+    segments.swap(other.segments);
+    std::swap(dirCapacity, other.dirCapacity);
+    std::swap(cache, other.cache);
+    file.swap(other.file);
+    fileTypes.swap(other.fileTypes);
+    std::swap(fileColumnar, other.fileColumnar);
+}
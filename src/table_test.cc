@@ -1,6 +1,41 @@
 #include "table.h"
+#include "pagecache.h"
+#include "codec.h"
+#include "partition.h"
+#include "stats.h"
+#include "matview.h"
+#include "resultcache.h"
+#include "scanops.h"
+#include "extsort.h"
+#include "trace.h"
+#include "output.h"
+#include "db.h"
+#include "wal.h"
+#include <sstream>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <thread>
+#include <atomic>
 #include <iostream>
 #include <cassert>
+#include <cstdio>
+#include <csignal>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+#ifdef __linux__
+#include "server.h"
+#include <chrono>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
 
 int main()
 {
@@ -14,10 +49,12 @@ int main()
         {"age", DataType::INT}};
 
     // 定义行
-    table.rows = {
+    std::vector<Row> rows = {
         {{"1", "Alice", "30"}},
         {{"2", "Bob", "25"}},
         {{"3", "Charlie", "35"}}};
+    for (const auto &row : rows)
+        table.appendRow(row);
 
     // 保存到文件
     std::string tableName = "test_table";
@@ -42,6 +79,739 @@ int main()
         assert(loadedTable.rows[i].values == table.rows[i].values);
     }
 
+    // 结束的版本对之后的快照不可见，对之前的快照仍然可见
+    Snapshot before{kBootstrapTs, 0}, after{kBootstrapTs + 1, 0};
+    loadedTable.rows.setEnd(1, kBootstrapTs + 1);
+    assert(loadedTable.visible(1, before) && !loadedTable.visible(1, after));
+
+    // 增删列只修改元数据，旧行通过 schema 版本映射读取
+    table.addColumn({"city", DataType::TEXT, "Beijing"});
+    table.dropColumn(table.getColumnIndex("age"));
+    assert(table.rows[0].values.size() == 3);
+    assert(table.cell(table.rows[0], 2) == "Beijing");
+    table.saveToFile(tableName);
+
+    Table alteredTable;
+    alteredTable.loadFromFile(tableName);
+    assert(alteredTable.columns.size() == 3);
+    assert(alteredTable.columns[2].defaultValue == "Beijing");
+    assert(alteredTable.cell(alteredTable.rows[1], 1) == "Bob");
+    assert(alteredTable.cell(alteredTable.rows[1], 2) == "Beijing");
+
+    // 超过内联长度的值存放在段的 arena 中，压缩、保存与加载后内容不变
+    std::string longName(100, 'x');
+    alteredTable.appendRow({{"4", longName, "Shanghai"}});
+    alteredTable.rows.setEnd(0, kBootstrapTs + 1);
+    alteredTable.deadCount++;
+    alteredTable.compact();
+    assert(alteredTable.rows.size() == 3);
+    assert(alteredTable.cell(alteredTable.rows[2], 1) == longName);
+    assert(alteredTable.rows[0].values != alteredTable.rows[2].values);
+    alteredTable.saveToFile(tableName);
+    Table reloaded;
+    reloaded.loadFromFile(tableName);
+    assert(reloaded.rows[2].values == alteredTable.rows[2].values);
+
+    // 墓碑删除：提交后的版本只标记结束，compact 只回收在 horizon 之前结束的版本，可见的行与未提交的结束标记保持不变
+    Table tomb;
+    tomb.columns = {{"id", DataType::INT}, {"v", DataType::TEXT}};
+    for (int i = 0; i < 10; i++)
+        tomb.appendRow({{std::to_string(i), "v" + std::to_string(i)}});
+    WriteSet deleted;
+    deleted.ended = {1, 3};
+    for (size_t i : deleted.ended)
+        tomb.rows.setEnd(i, kTxnFlag | 7);
+    tomb.publish(deleted, 5);
+    WriteSet updated;
+    updated.inserted = {tomb.appendRow({{"2", "v2'"}})};
+    updated.ended = {2};
+    tomb.rows.setBegin(updated.inserted[0], kTxnFlag | 8);
+    tomb.rows.setEnd(2, kTxnFlag | 8);
+    tomb.publish(updated, 7);
+    tomb.rows.setEnd(4, kTxnFlag | 9);
+    auto visibleRows = [](const Table &t, const Snapshot &snap)
+    {
+        std::vector<std::string> out;
+        for (size_t i = 0; i < t.rows.size(); i++)
+            if (t.visible(i, snap))
+                out.push_back(std::string(t.cell(t.rows[i], 0)) + "=" + std::string(t.cell(t.rows[i], 1)));
+        std::sort(out.begin(), out.end());
+        return out;
+    };
+    std::vector<std::string> atSix = visibleRows(tomb, Snapshot{6, 0}), latest = visibleRows(tomb, Snapshot::latest());
+    assert(tomb.deadCount == 3 && !tomb.needsCompaction(0.3) && tomb.needsCompaction(0.25));
+    tomb.compact(6);
+    assert(tomb.rows.size() == 9 && tomb.deadCount == 1);
+    assert(visibleRows(tomb, Snapshot{6, 0}) == atSix && visibleRows(tomb, Snapshot::latest()) == latest);
+    tomb.compact();
+    assert(tomb.rows.size() == 8 && tomb.deadCount == 0 && visibleRows(tomb, Snapshot::latest()) == latest);
+    assert(latest.size() == 8 && atSix.size() == 8 && latest != atSix);
+    assert(std::count(latest.begin(), latest.end(), "2=v2'") == 1 && std::count(latest.begin(), latest.end(), "4=v4") == 1);
+    for (size_t i = 0; i < tomb.rows.size(); i++)
+        assert(tomb.cell(tomb.rows[i], 0) != "4" || tomb.rows.endTs(i) == (kTxnFlag | 9));
+
+    // 多线程：读者与写者在并行的线程上执行语句；每条语句读到的是同一时刻的表（一次 UPDATE 的结果要么全部可见要么都不可见），
+    // 读到的插入行数只增不减，最后不丢失任何写入
+    {
+        std::ostringstream quiet;
+        OutputCapture capture(quiet);
+        sqlDB db;
+        std::string shared = "shared_rw";
+        std::vector<Column> sharedCols = {{"id", DataType::INT}, {"g", DataType::INT}, {"v", DataType::INT}};
+        db.createTableWithTypes(shared, sharedCols);
+        for (int i = 0; i < 20; i++)
+            db.insertInto(shared, {std::to_string(i), "1", "0"}, {});
+        const int inserters = 2, perInserter = 100, updates = 30;
+        std::atomic<int> writersLeft{inserters + 1}, violations{0}, reads{0};
+        std::vector<std::thread> threads;
+        for (int w = 0; w < inserters; w++)
+            threads.emplace_back([&, w]
+                                 {
+                                     std::ostringstream out;
+                                     OutputCapture capture(out);
+                                     for (int k = 0; k < perInserter; k++)
+                                         db.insertInto(shared, {std::to_string(1000 * (w + 1) + k), "2", "0"}, {});
+                                     writersLeft--; });
+        threads.emplace_back([&]
+                             {
+                                 std::ostringstream out;
+                                 OutputCapture capture(out);
+                                 for (int k = 1; k <= updates; k++)
+                                     db.update(shared, "v", std::to_string(k), "g", "1");
+                                 writersLeft--; });
+        for (int r = 0; r < 2; r++)
+            threads.emplace_back([&]
+                                 {
+                                     size_t lastInserted = 0;
+                                     bool last = false;
+                                     while (!last)
+                                     {
+                                         last = writersLeft == 0;
+                                         std::ostringstream out;
+                                         {
+                                             OutputCapture capture(out);
+                                             db.selectAll(shared);
+                                         }
+                                         std::istringstream lines(out.str());
+                                         std::string line, id, g, v, firstV;
+                                         size_t inserted = 0, updated = 0;
+                                         std::getline(lines, line);
+                                         while (std::getline(lines, line))
+                                         {
+                                             std::istringstream fields(line);
+                                             if (!(fields >> id >> g >> v))
+                                                 continue;
+                                             if (g == "2")
+                                                 inserted++;
+                                             else if (updated++ == 0)
+                                                 firstV = v;
+                                             else if (v != firstV)
+                                                 violations++;
+                                         }
+                                         if (updated != 20 || inserted < lastInserted)
+                                             violations++;
+                                         lastInserted = inserted;
+                                         reads++;
+                                     } });
+        for (auto &th : threads)
+            th.join();
+        std::ostringstream final;
+        {
+            OutputCapture capture(final);
+            db.selectAll(shared, "g", "1");
+            std::string v = "v";
+            db.aggregate(shared, "COUNT", v);
+        }
+        assert(violations == 0 && reads >= 2);
+        assert(final.str().find("\t" + std::to_string(updates) + "\t") != std::string::npos);
+        assert(final.str().find("COUNT(v) = " + std::to_string(20 + inserters * perInserter)) != std::string::npos);
+        db.dropTable(shared);
+    }
+
+    // 重做日志：写入失败时不确认提交，没写出的记录留在缓冲区，之后的刷盘接着写完；
+    // 日志文件无法打开时每次等待都失败
+    {
+        LogRecord insert;
+        insert.op = LogRecord::INSERT;
+        insert.ts = 2;
+        insert.table = "t";
+        insert.values = {std::string(300, 'a')};
+        LogRecord done;
+        done.ts = 2;
+        std::string walPath = getDbPath("failing", ".wal"), error;
+        std::remove(walPath.c_str());
+#ifndef _WIN32
+        RedoLog log(walPath);
+        uint64_t lsn = log.append(insert.encode() + done.encode());
+        struct rlimit saved, small;
+        getrlimit(RLIMIT_FSIZE, &saved);
+        small = saved;
+        small.rlim_cur = 100;
+        auto prevHandler = std::signal(SIGXFSZ, SIG_IGN);
+        setrlimit(RLIMIT_FSIZE, &small);
+        assert(!log.waitDurable(lsn, error) && error.find("write failed") == 0);
+        setrlimit(RLIMIT_FSIZE, &saved);
+        std::signal(SIGXFSZ, prevHandler);
+        assert(log.waitDurable(lsn, error));
+        std::vector<LogRecord> replayed = log.readAll();
+        assert(replayed.size() == 2 && replayed[0].values == insert.values);
+#endif
+        RedoLog unopened(getDbPath("missing_dir/failing", ".wal"));
+        uint64_t lost = unopened.append(done.encode());
+        assert(!unopened.waitDurable(lost, error) && !unopened.waitDurable(lost, error));
+    }
+
+    // 按需分页打开：读取时才从文件载入各段，超出缓存容量的段被换出后可以再次载入
+    Table bigTable;
+    bigTable.columns = {{"id", DataType::INT}, {"name", DataType::TEXT}};
+    const size_t bigRows = 3 * RowStore::kSegmentRows + 5;
+    for (size_t i = 0; i < bigRows; i++)
+        bigTable.appendRow({{std::to_string(i), "name_" + std::to_string(i) + "_" + longName}});
+    bigTable.saveToFile("paged_table");
+    PageCache cache(1);
+    Table pagedTable;
+    assert(pagedTable.openPaged("paged_table", cache) && pagedTable.rows.paged());
+    assert(pagedTable.rows.size() == bigRows);
+    for (size_t round = 0; round < 2; round++)
+        for (size_t i = 0; i < bigRows; i++)
+            assert(pagedTable.cell(pagedTable.rows[i], 1) == bigTable.cell(bigTable.rows[i], 1));
+    // 容量小于一段时只保留最近载入的一段：每轮 3 次载入
+    assert(cache.faults() == 6 && cache.used() < (1 << 20));
+    pagedTable.rows.setEnd(7, kBootstrapTs + 1);
+    pagedTable.appendRow({{"x", "y"}});
+    assert(!pagedTable.visible(7, after) && pagedTable.visible(8, after) && pagedTable.visible(bigRows, after));
+
+    // DATE / TIMESTAMP：解析为原生整数，规范文本与整数一一对应
+    int64_t day, micros;
+    char text[kTemporalTextMax];
+    assert(parseTemporal(DataType::DATE, "1970-01-02", day) && day == 1);
+    assert(parseTemporal(DataType::DATE, "1969-12-31", day) && day == -1);
+    assert(parseTemporal(DataType::DATE, "2000-2-29", day));
+    assert(std::string(text, formatTemporal(DataType::DATE, day, text)) == "2000-02-29");
+    assert(!parseTemporal(DataType::DATE, "1900-02-29", day) && !parseTemporal(DataType::DATE, "2024-13-01", day));
+    assert(!parseTemporal(DataType::DATE, "NULL", day) && !parseTemporal(DataType::DATE, "2024-01-01x", day));
+    assert(parseTemporal(DataType::TIMESTAMP, "1969-12-31 23:59:59.25", micros) && micros == -750000);
+    assert(std::string(text, formatTemporal(DataType::TIMESTAMP, micros, text)) == "1969-12-31 23:59:59.250000");
+    assert(parseTemporal(DataType::TIMESTAMP, "2024-03-01", micros));
+    assert(std::string(text, formatTemporal(DataType::TIMESTAMP, micros, text)) == "2024-03-01 00:00:00");
+    assert(parseTemporal(DataType::TIMESTAMP, "2024-03-01 10:05", micros));
+    assert(!parseTemporal(DataType::TIMESTAMP, "2024-03-01 10:05.5", micros));
+
+    // DATE 列的值存为原生单元格，保存与加载后仍然是原生的；NULL 按文本存放
+    Table dated;
+    dated.columns = {{"id", DataType::INT}, {"day", DataType::DATE}};
+    dated.appendRow({{"1", "2024-1-5"}});
+    dated.appendRow({{"2", "NULL"}});
+    assert(dated.cell(dated.rows[0], 1) == "2024-01-05");
+    assert(dated.cellAt(dated.rows[0], 1)->native() && !dated.cellAt(dated.rows[1], 1)->native());
+    assert(dated.temporalValue(dated.rows[0], 1, day) && day == 19727);
+    assert(!dated.temporalValue(dated.rows[1], 1, day));
+    dated.saveToFile("dated_table");
+    Table datedLoaded;
+    datedLoaded.loadFromFile("dated_table");
+    assert(datedLoaded.cellAt(datedLoaded.rows[0], 1)->native());
+    assert(datedLoaded.temporalValue(datedLoaded.rows[0], 1, day) && day == 19727);
+
+    // NULL 是单元格的状态而不是字符串，BOOL 值规范为 true / false；每段按列维护有效位与真值位
+    Table flags;
+    flags.columns = {{"id", DataType::INT}, {"ok", DataType::BOOL}};
+    flags.appendRow({{"1", "TRUE"}});
+    flags.appendRow({{"2", "NULL"}});
+    flags.appendRow({{"3", "0"}});
+    assert(flags.cell(flags.rows[0], 1) == "true" && flags.cell(flags.rows[2], 1) == "false");
+    assert(flags.isNull(flags.rows[1], 1) && flags.cell(flags.rows[1], 1) == "NULL");
+    SegmentBitmap bm;
+    assert(flags.columnBitmap(0, 1, bm) && bm.bits);
+    assert(bm.bits->valid[0].load() == 0b101 && bm.bits->truth[0].load() == 0b001);
+    uint64_t mask[ColumnBitmap::kWords];
+    flags.visibleBits(0, flags.rows.size(), after, mask);
+    flags.clearNulls(0, 1, mask);
+    assert(mask[0] == 0b101);
+    // 加列后旧行取默认值 NULL，段内 schema 版本不一致时改为逐行判断
+    flags.addColumn({"note", DataType::TEXT});
+    flags.appendRow({{"4", "false", "x"}});
+    assert(!flags.columnBitmap(0, 2, bm));
+    flags.visibleBits(0, flags.rows.size(), after, mask);
+    flags.clearNulls(0, 2, mask);
+    assert(mask[0] == 0b1000);
+
+    // 列式压缩块：自增 id 用差值编码，重复的值用 RLE，长文本用 LZ，解码后与原值相同
+    ChunkEncoder encoder({DataType::INT, DataType::TEXT, DataType::TEXT, DataType::DATE});
+    for (size_t i = 0; i < RowStore::kSegmentRows; i++)
+    {
+        std::string id = std::to_string(1000 + i), name = "name_" + std::to_string(i) + "_" + longName;
+        encoder.addRow({id, i % 7 ? "Beijing" : "NULL", name, "2024-01-01"});
+    }
+    std::string block;
+    size_t blockSize = encoder.finish(block);
+    assert(blockSize == block.size() && blockSize < 20000);
+    assert(encoder.encodings()[0] == ColumnEncoding::DELTA && encoder.encodings()[1] == ColumnEncoding::RLE);
+    assert(encoder.encodings()[2] == ColumnEncoding::LZ && encoder.encodings()[3] == ColumnEncoding::DELTA);
+    std::vector<DecodedColumn> decoded;
+    assert(decodeChunk(block, {DataType::INT, DataType::TEXT, DataType::TEXT, DataType::DATE}, decoded));
+    assert(decoded[0].size() == RowStore::kSegmentRows && decoded[0][1023] == "2023");
+    assert(decoded[1][0] == "NULL" && decoded[1][1] == "Beijing" && decoded[3][5] == "2024-01-01");
+    assert(decoded[2][17] == "name_17_" + longName);
+    assert(!decodeChunk(std::string_view(block).substr(0, block.size() - 1), {DataType::INT}, decoded));
+    // 损坏的块头、长度与位宽只让解码失败，不会按损坏的大小分配内存
+    {
+        std::vector<DataType> types = {DataType::INT, DataType::TEXT, DataType::TEXT, DataType::DATE};
+        std::string bad = block;
+        std::memset(&bad[4], 0xff, 4);
+        assert(!decodeChunk(bad, types, decoded));
+        for (size_t i = 0; i < 256; i++)
+            for (char b : {char(0xff), char(0x7f)})
+            {
+                bad = block;
+                bad[i] = b;
+                decodeChunk(bad, types, decoded);
+            }
+    }
+
+    // 逐行文本的旧表文件仍然可以加载
+    {
+        std::ofstream legacy(getDbPath("legacy_table"), std::ios::trunc);
+        legacy << "id INT,name TEXT,\n1,Alice,\n2,Bob,\n";
+    }
+    Table legacyTable;
+    legacyTable.loadFromFile("legacy_table");
+    assert(legacyTable.rows.size() == 2 && legacyTable.cell(legacyTable.rows[1], 1) == "Bob");
+
+    // RANGE 分区：值按上界分配，NULL 在第一个分区；区间条件只保留可能有满足条件的行的分区
+    PartitionScheme byDay;
+    byDay.kind = PartitionKind::RANGE;
+    byDay.column = "day";
+    byDay.type = DataType::DATE;
+    byDay.parts = {{"p2023", "2024-01-01"}, {"p2024", "2025-01-01"}, {"pmax", ""}};
+    std::string partError;
+    assert(byDay.build(partError));
+    assert(byDay.route("2023-12-31") == 0 && byDay.route("2024-1-1") == 1 && byDay.route("2030-01-01") == 2);
+    assert(byDay.route("NULL") == 0 && byDay.prune("2024-06-01") == std::vector<size_t>{1});
+    assert(byDay.prune(ValueRange{"2024-03-01", "2025-01-01", true, false}) == std::vector<size_t>{1});
+    assert((byDay.prune(ValueRange{"2023-06-01", "2025-01-01", true, true}) == std::vector<size_t>{0, 1, 2}));
+    byDay.parts.pop_back();
+    assert(byDay.build(partError) && byDay.route("2025-01-01") == PartitionScheme::npos);
+    byDay.parts.push_back({"p2022", "2023-01-01"});
+    assert(!byDay.build(partError));
+    PartitionScheme byNumber;
+    byNumber.kind = PartitionKind::RANGE;
+    byNumber.type = DataType::INT;
+    byNumber.parts = {{"neg", "0"}, {"small", "9.5"}, {"big", "100"}};
+    assert(byNumber.build(partError));
+    assert(byNumber.route("-3") == 0 && byNumber.route("9") == 1 && byNumber.route("10") == 2);
+
+    // HASH 分区：等值条件下相等的值（大小写、首尾空白不同）分配到同一个分区，保存后再读取分配不变
+    PartitionScheme byKey;
+    byKey.column = "k";
+    for (int k = 0; k < 4; k++)
+        byKey.parts.push_back({"p" + std::to_string(k), ""});
+    assert(byKey.build(partError));
+    assert(byKey.route("Alice") == byKey.route(" alice ") && byKey.prune(ValueRange{"a", "b"}).size() == 4);
+    std::vector<size_t> hits(4, 0);
+    for (int i = 0; i < 400; i++)
+        hits[byKey.route("key" + std::to_string(i))]++;
+    assert(*std::min_element(hits.begin(), hits.end()) > 50);
+    assert(byKey.saveToFile(getDbPath("hashed", ".parts")));
+    PartitionScheme savedScheme;
+    assert(savedScheme.loadFromFile(getDbPath("hashed", ".parts")) && savedScheme.build(partError));
+    assert(savedScheme.kind == PartitionKind::HASH && savedScheme.route("key7") == byKey.route("key7"));
+
+    // 唯一索引：按规范化的值查找所有版本；被其他写者结束但未提交的版本仍算冲突，被自己结束的不算
+    Table keyed;
+    keyed.columns = {{"id", DataType::INT, "NULL", ColumnConstraint::PRIMARY_KEY},
+                     {"email", DataType::TEXT, "NULL", ColumnConstraint::UNIQUE},
+                     {"day", DataType::DATE}};
+    keyed.buildIndexes();
+    assert(keyed.hasKeyIndex(0) && keyed.hasKeyIndex(1) && !keyed.hasKeyIndex(2));
+    keyed.appendRow({{"1", "A@x.org", "2024-01-01"}});
+    keyed.appendRow({{"2", "NULL", "2024-01-02"}});
+    assert(keyed.findConflict(1, " a@X.org ", kTxnFlag | 7) == 0 && keyed.findConflict(1, "NULL", kTxnFlag | 7) == SIZE_MAX);
+    assert(keyed.lookupKey(0, "2") == std::vector<size_t>{1} && keyed.lookupKey(0, "3").empty());
+    keyed.rows.setEnd(0, kTxnFlag | 7);
+    assert(keyed.findConflict(0, "1", kTxnFlag | 7) == SIZE_MAX && keyed.findConflict(0, "1", kTxnFlag | 8) == 0);
+    keyed.rows.setEnd(0, 5);
+    keyed.deadCount++;
+    assert(keyed.findConflict(0, "1", kTxnFlag | 8) == SIZE_MAX);
+    // 约束写入表头，加载后重建索引；压缩改变行号后同样重建
+    keyed.saveToFile("keyed_table");
+    Table keyedLoaded;
+    keyedLoaded.loadFromFile("keyed_table");
+    assert(keyedLoaded.columns[0].constraint == ColumnConstraint::PRIMARY_KEY);
+    assert(keyedLoaded.columns[1].constraint == ColumnConstraint::UNIQUE && keyedLoaded.columns[2].constraint == ColumnConstraint::NONE);
+    assert(keyedLoaded.lookupKey(0, "2") == std::vector<size_t>{0});
+    keyed.compact();
+    assert(keyed.rows.size() == 1 && keyed.lookupKey(0, "2") == std::vector<size_t>{0} && keyed.lookupKey(0, "1").empty());
+
+    // LIKE：% 匹配任意个字符，_ 匹配一个字节，不区分大小写；SIMD 与逐字节查找的结果相同
+    assert(LikePattern("ab%").matches("ABC") && LikePattern("%bc").matches("abc") && !LikePattern("%bc").matches("abcd"));
+    assert(LikePattern("a_c").matches("aXc") && !LikePattern("a_c").matches("ac") && LikePattern("%").matches(""));
+    assert(LikePattern("%a%a%").matches("banana") && !LikePattern("%a%a%").matches("ba") && !LikePattern("ab%ba").matches("aba"));
+    assert(LikePattern("%x_z%").matches("--xyz--") && LikePattern("abc").matches("aBc") && !LikePattern("abc").matches("abcd"));
+    LikePattern parts("al%ice_%smith");
+    assert(parts.prefix() == "al" && (parts.literals() == std::vector<std::string>{"al", "ice", "smith"}));
+    std::string haystack(100, 'x');
+    haystack += "NeedLe";
+    assert(findCaseless(haystack, "needle") == 100 && findCaseless(haystack, "needles") == std::string_view::npos);
+    assert(findCaseless("xN", "n") == 1 && findCaseless(std::string(40, 'a') + "ab", "ab") == 40);
+
+    // LIKE 索引：有序索引按前缀、三元组索引按片段查找候选；写入表头，加载后重建
+    Table texted;
+    texted.columns = {{"id", DataType::INT}, {"name", DataType::TEXT}};
+    texted.appendRow({{"1", "Alice"}});
+    texted.appendRow({{"2", "alfred"}});
+    texted.appendRow({{"3", "NULL"}});
+    texted.appendRow({{"4", "Malice"}});
+    LikePattern alPrefix("al%"), lice("%LICE%"), shortRun("%ic%");
+    std::vector<size_t> found;
+    assert(!texted.likeIndexed(1, alPrefix) && !texted.likeCandidates(1, alPrefix, found));
+    texted.setTextIndex(1, TextIndex::kSorted);
+    assert(texted.likeCandidates(1, alPrefix, found) && (found == std::vector<size_t>{0, 1}));
+    assert(!texted.likeIndexed(1, lice));
+    texted.setTextIndex(1, TextIndex::kSorted | TextIndex::kTrigram);
+    texted.appendRow({{"5", "slicer"}});
+    assert(texted.likeCandidates(1, lice, found) && (found == std::vector<size_t>{0, 3, 4}));
+    assert(!texted.likeIndexed(1, shortRun));
+    texted.saveToFile("texted_table");
+    Table textedLoaded;
+    textedLoaded.loadFromFile("texted_table");
+    assert(textedLoaded.columns[1].textIndex == (TextIndex::kSorted | TextIndex::kTrigram));
+    assert(textedLoaded.likeCandidates(1, lice, found) && (found == std::vector<size_t>{0, 3, 4}));
+    assert(textedLoaded.applySchemaChange("INDEX name") && textedLoaded.texts.empty());
+
+    // APPROX_COUNT_DISTINCT：写满且全部可见的块缓存 sketch，之后只逐行读取其余的块；有行结束或行号改变后不再使用缓存
+    Table sketched;
+    sketched.columns = {{"id", DataType::INT}, {"city", DataType::TEXT}};
+    const size_t sketchRows = SketchCache::kChunkRows + 1000;
+    for (size_t i = 0; i < sketchRows; i++)
+        sketched.appendRow({{std::to_string(i), i % 10 ? "c" + std::to_string(i % 5000) : "NULL"}});
+    const size_t nonNullRows = sketchRows - (sketchRows + 9) / 10;
+    SketchCache sketchCache;
+    size_t read;
+    double distinct = sketchColumn(sketched, 1, Snapshot::latest(), &sketchCache, read).estimate();
+    assert(read == nonNullRows && distinct > 4300 && distinct < 4700);
+    assert(sketchColumn(sketched, 1, Snapshot::latest(), &sketchCache, read).estimate() == distinct && read == 900);
+    sketched.rows.setEnd(3, 5);
+    sketched.deadCount++;
+    sketchColumn(sketched, 1, Snapshot::latest(), &sketchCache, read);
+    assert(read == nonNullRows - 1);
+    sketched.compact();
+    sketchColumn(sketched, 1, Snapshot::latest(), &sketchCache, read);
+    assert(read == nonNullRows - 1);
+
+    // 物化视图：写集合作为增量应用（UPDATE = 加入新版本 + 减去旧版本），行数为 0 的分组被删除；序列化后读回相同
+    Table ledger;
+    ledger.columns = {{"region", DataType::TEXT}, {"amount", DataType::INT}};
+    ledger.appendRow({{"east", "10"}});
+    ledger.appendRow({{"west", "NULL"}});
+    ledger.appendRow({{"east", "5"}});
+    AggregateView byRegion("by_region", "ledger", "region", {{"SUM", "amount"}, {"COUNT", "*"}, {"AVG", "amount"}});
+    byRegion.rebuild({&ledger}, Snapshot::latest(), 1);
+    auto groupsOf = [](const AggregateView &v)
+    {
+        std::vector<std::vector<std::string>> out;
+        v.forEachGroup(nullptr, -1, [&](const std::vector<std::string> &row)
+                       { out.push_back(row); });
+        return out;
+    };
+    using Groups = std::vector<std::vector<std::string>>;
+    assert((groupsOf(byRegion) == Groups{{"east", "15", "2", "7.5"}, {"west", "NULL", "1", "NULL"}}));
+    WriteSet moved;
+    moved.inserted = {ledger.appendRow({{"west", "10"}})};
+    moved.ended = {0, 1};
+    byRegion.apply(ledger, moved, 2);
+    assert((groupsOf(byRegion) == Groups{{"east", "5", "1", "5"}, {"west", "10", "1", "10"}}));
+    std::string saved = byRegion.serialize(5);
+    assert(!byRegion.dirty());
+    size_t pos = 0;
+    uint64_t savedTs;
+    std::shared_ptr<AggregateView> reread = AggregateView::parse(saved, pos, savedTs);
+    assert(reread && savedTs == 5 && pos == saved.size() && groupsOf(*reread) == groupsOf(byRegion));
+    assert(reread->uses("AMOUNT") && !reread->uses("id"));
+
+    // 结果缓存：表版本不同的结果视为过期，超出容量时淘汰最久未使用的；记录输出时照常输出，有错误输出的结果不可缓存
+    ResultCache results;
+    uint64_t cachedRows = 0;
+    results.put("q", 1, "x", 1);
+    assert(!results.enabled() && !results.get("q", 1, cachedRows));
+    results.setCapacity(4096);
+    results.put("q1", 1, "a\n", 1);
+    results.put("q2", 1, std::string(400, 'b'), 2);
+    assert(results.get("q1", 1, cachedRows) && *results.get("q1", 1, cachedRows) == "a\n" && cachedRows == 1);
+    assert(!results.get("q2", 2, cachedRows) && !results.get("q2", 1, cachedRows));
+    for (char c = 'c'; c <= 'g'; c++)
+        results.put(std::string("q") + c, 1, std::string(700, c), 3);
+    results.put("big", 1, std::string(2000, 'x'), 1);
+    ResultCacheStats cacheStats = results.stats();
+    assert(cacheStats.invalidations == 1 && cacheStats.evictions >= 1 && cacheStats.bytes <= 4096);
+    assert(!results.get("big", 1, cachedRows) && !results.get("q1", 1, cachedRows) && results.get("qg", 1, cachedRows));
+    std::ostringstream shown;
+    {
+        OutputCapture capture(shown);
+        ResultRecorder ok(64);
+        dbOut() << "id\t" << 1 << "\n";
+        assert(ok.complete() && ok.take() == "id\t1\n");
+        ResultRecorder failed(64);
+        dbErr() << "Column not found\n";
+        assert(!failed.complete());
+    }
+    assert(shown.str() == "id\t1\nColumn not found\n");
+
+    // 按类型特化的扫描算子：整段筛选与逐行比较的结果相同（含 NaN 与开闭区间），聚合按行的顺序合并
+    double parsed;
+    assert(parseDouble("-42", true, parsed) && parsed == -42 && parseDouble(" 2.5 ", false, parsed) && parsed == 2.5);
+    assert(!parseDouble("2.5x", true, parsed) && parseDouble("2.5x", false, parsed) && !parseDouble("", false, parsed));
+    double numbers[RowStore::kSegmentRows] = {};
+    for (size_t i = 0; i < RowStore::kSegmentRows; i++)
+        numbers[i] = i % 7 == 0 ? std::nan("") : double(i % 100);
+    for (Bound lo : {Bound::NONE, Bound::INCLUSIVE, Bound::EXCLUSIVE})
+        for (Bound hi : {Bound::NONE, Bound::INCLUSIVE, Bound::EXCLUSIVE})
+        {
+            uint64_t selected[ColumnBitmap::kWords];
+            std::fill(selected, selected + ColumnBitmap::kWords, ~uint64_t(0));
+            withBoundOps(lo, hi, [&](auto lowOp, auto highOp)
+                         { selectBetween(numbers, 10.0, 20.0, selected, lowOp, highOp); });
+            for (size_t i = 0; i < RowStore::kSegmentRows; i++)
+            {
+                double v = numbers[i];
+                bool expected = (lo == Bound::NONE || (lo == Bound::INCLUSIVE ? !(v < 10) : 10 < v)) &&
+                                (hi == Bound::NONE || (hi == Bound::INCLUSIVE ? !(20 < v) : v < 20));
+                assert(bool(selected[i / 64] >> (i % 64) & 1) == expected);
+            }
+        }
+    double extremes[] = {3, std::nan(""), -1, 8};
+    double best = 0;
+    bool haveBest = false;
+    foldExtreme(extremes, 2, best, haveBest, std::greater<double>());
+    foldExtreme(extremes + 2, 2, best, haveBest, std::greater<double>());
+    assert(haveBest && best == 8 && sumValues(extremes + 2, 2, 0.5) == 7.5);
+    Table scanned;
+    scanned.columns = {{"n", DataType::INT}};
+    for (int i = 0; i < 1500; i++)
+        scanned.appendRow({{i % 3 ? std::to_string(i) : "x"}});
+    scanned.rows.setEnd(4, 2);
+    uint64_t live[ColumnBitmap::kWords];
+    scanned.visibleBits(1, scanned.rows.size(), Snapshot{3, 0}, live);
+    assert(__builtin_popcountll(live[0]) == 64 && __builtin_popcountll(live[7]) == 1500 - 1024 - 7 * 64);
+    scanned.visibleBits(0, scanned.rows.size(), Snapshot{1, 0}, live);
+    assert(live[0] >> 4 & 1);
+    scanned.visibleBits(0, scanned.rows.size(), Snapshot{2, 0}, live);
+    assert(!(live[0] >> 4 & 1));
+    double segmentValues[RowStore::kSegmentRows] = {};
+    decodeSegment(scanned, 0, live, segmentValues, [&](const RowRef &row, double &v)
+                  { return parseDouble(scanned.cell(row, 0), true, v); });
+    assert(!(live[0] & 1) && (live[0] >> 1 & 1) && segmentValues[1] == 1 && segmentValues[1022] == 1022);
+
+    // ANALYZE：数值列中无法解析的文本排在所有数值之后，排序保持严格弱序（"2" < "10" < "1x"）
+    Table mixed;
+    mixed.columns = {{"n", DataType::INT}};
+    for (int i = 0; i < 300; i++)
+        mixed.appendRow({{i % 3 == 0 ? "2" : i % 3 == 1 ? "10" : "1x"}});
+    mixed.appendRow({{"nan"}});
+    TableStats mixedStats = analyzeTable(mixed, Snapshot::latest(), 4);
+    const ColumnStats *mixedCol = mixedStats.find("n");
+    assert(mixedCol && mixedCol->minVal == "2" && mixedCol->maxVal == "nan");
+    auto rankOf = [](const std::string &v)
+    { return v == "2" ? 0 : v == "10" ? 1 : v == "1x" ? 2 : 3; };
+    assert(std::is_sorted(mixedCol->bounds.begin(), mixedCol->bounds.end(), [&](const std::string &a, const std::string &b)
+                          { return rankOf(a) < rankOf(b); }));
+
+    // 外部排序：有序段多于 kMaxFanIn 个时分轮归并，同时打开的文件数有上限；
+    // 有序段写不出或打不开时排序作废，merge() 返回 false 且不输出任何记录
+    {
+        MemoryBudget tiny(16, 1 << 20);
+        auto keyOf = [](int i)
+        {
+            char key[8];
+            std::snprintf(key, sizeof(key), "%05d", (i * 7919) % 3000);
+            return std::string(key);
+        };
+        auto sortAll = [&](ExternalSorter &sorter, int records, std::vector<std::string> &out)
+        {
+            for (int i = 0; i < records; i++)
+                sorter.add(keyOf(i), keyOf(i));
+            return sorter.merge([&](const std::string &payload)
+                                {
+                                    out.push_back(payload);
+                                    return true; });
+        };
+        MemoryReservation manyMem(tiny);
+        ExternalSorter many(manyMem, false);
+        std::vector<std::string> sorted;
+#ifndef _WIN32
+        struct rlimit files, fewFiles;
+        getrlimit(RLIMIT_NOFILE, &files);
+        fewFiles = files;
+        fewFiles.rlim_cur = ExternalSorter::kMaxFanIn + 32;
+        setrlimit(RLIMIT_NOFILE, &fewFiles);
+#endif
+        assert(sortAll(many, 3000, sorted) && many.valid());
+        assert(sorted.size() == 3000 && std::is_sorted(sorted.begin(), sorted.end()));
+        assert(many.runCount() <= ExternalSorter::kMaxFanIn);
+#ifndef _WIN32
+        MemoryReservation unopenedMem(tiny);
+        ExternalSorter unopened(unopenedMem, false);
+        sorted.clear();
+        for (int i = 0; i < 50; i++)
+            unopened.add(keyOf(i), keyOf(i));
+        fewFiles.rlim_cur = 3;
+        setrlimit(RLIMIT_NOFILE, &fewFiles);
+        bool merged = unopened.merge([&](const std::string &payload)
+                                     {
+                                         sorted.push_back(payload);
+                                         return true; });
+        setrlimit(RLIMIT_NOFILE, &files);
+        assert(!merged && sorted.empty() && unopened.error().find("Cannot open sort run file") == 0);
+
+        MemoryReservation fullMem(tiny);
+        ExternalSorter full(fullMem, false);
+        struct rlimit sizes, tinyFiles;
+        getrlimit(RLIMIT_FSIZE, &sizes);
+        tinyFiles = sizes;
+        tinyFiles.rlim_cur = 8;
+        auto prevHandler = std::signal(SIGXFSZ, SIG_IGN);
+        setrlimit(RLIMIT_FSIZE, &tinyFiles);
+        merged = sortAll(full, 50, sorted);
+        setrlimit(RLIMIT_FSIZE, &sizes);
+        std::signal(SIGXFSZ, prevHandler);
+        assert(!merged && !full.valid() && sorted.empty() && full.error().find("Cannot write sort run file") == 0);
+#endif
+    }
+
+#ifdef __linux__
+    // 服务器：请求按长度前缀切分（一帧可以分多次到达），流水线上的请求按顺序返回响应；
+    // 客户端发完请求后只关闭写方向，已收到的请求仍全部执行，响应发完后服务器才关闭连接
+    {
+        sqlDB db;
+        Server server(db, 2);
+        std::string sock = getDbPath("server_test", ".sock");
+        assert(server.listenUnix(sock));
+        std::thread loop([&]
+                         { server.run(); });
+        int client = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strcpy(addr.sun_path, sock.c_str());
+        assert(connect(client, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0);
+        const int pipelined = 200;
+        std::string request;
+        appendFrame(request, "CREATE TABLE piped (id INT, name TEXT)");
+        for (int i = 0; i < pipelined; i++)
+            appendFrame(request, "INSERT INTO piped VALUES (" + std::to_string(i) + ", 'n" + std::to_string(i) + "')");
+        appendFrame(request, "SELECT * FROM piped");
+        auto sendAll = [&](const char *p, size_t n)
+        {
+            while (n > 0)
+            {
+                ssize_t w = ::write(client, p, n);
+                assert(w > 0);
+                p += w;
+                n -= size_t(w);
+            }
+        };
+        sendAll(request.data(), 6); // 长度前缀与内容都不完整
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        sendAll(request.data() + 6, request.size() - 6);
+        ::shutdown(client, SHUT_WR);
+        std::string reply;
+        char chunk[4096];
+        for (ssize_t n; (n = ::read(client, chunk, sizeof(chunk))) > 0;)
+            reply.append(chunk, size_t(n));
+        ::close(client);
+        std::vector<std::string> responses;
+        for (size_t pos = 0; reply.size() - pos >= 4;)
+        {
+            uint32_t len;
+            std::memcpy(&len, reply.data() + pos, 4);
+            len = ntohl(len);
+            assert(reply.size() - pos - 4 >= len);
+            responses.emplace_back(reply, pos + 4, len);
+            pos += 4 + len;
+        }
+        assert(responses.size() == size_t(pipelined) + 2 && responses[0].find("Table created") == 0);
+        assert(std::count_if(responses.begin() + 1, responses.end() - 1, [](const std::string &r)
+                             { return r.find("Row inserted") == 0; }) == pipelined);
+        assert(std::count(responses.back().begin(), responses.back().end(), '\n') == pipelined + 1);
+        assert(responses.back().find("199\tn199") != std::string::npos);
+        server.stop();
+        loop.join();
+        std::ostringstream quiet;
+        OutputCapture capture(quiet);
+        db.dropTable("piped");
+    }
+#endif
+
+    // 追踪：未以 -DMINIDB_TRACE 编译时 enable() 返回 false，不记录任何 span；编译进来时每个 span 写成一条完整的 "X" 事件，
+    // 嵌套的 span 落在外层 span 的时间范围内，不同线程的 span 线程号不同
+    {
+        assert(Tracer::enable(true) == Tracer::compiledIn());
+        Tracer::clear();
+        {
+            TraceSpan outer("test.outer");
+            TraceSpan inner("test.inner");
+        }
+        std::thread([]
+                    { TraceSpan other("test.thread"); })
+            .join();
+        {
+            std::ostringstream quiet;
+            OutputCapture capture(quiet);
+            sqlDB db;
+            std::string traced = "traced";
+            std::vector<Column> tracedCols = {{"id", DataType::INT}};
+            db.createTableWithTypes(traced, tracedCols);
+            db.insertInto(traced, {"1"}, {});
+            db.selectAll(traced, "", "", "id");
+            db.dropTable(traced);
+        }
+        std::string tracePath = getDbPath("trace_test", ".json");
+        assert(Tracer::dump(tracePath));
+        Tracer::enable(false);
+        Tracer::clear();
+        std::ifstream traceFile(tracePath);
+        std::string traceJson((std::istreambuf_iterator<char>(traceFile)), std::istreambuf_iterator<char>());
+        std::remove(tracePath.c_str());
+        const std::string head = "{\"traceEvents\":[", tail = "\n],\"displayTimeUnit\":\"ns\"}\n";
+        assert(traceJson.compare(0, head.size(), head) == 0);
+        assert(traceJson.size() >= head.size() + tail.size() && traceJson.compare(traceJson.size() - tail.size(), tail.size(), tail) == 0);
+        struct TraceEvent
+        {
+            double ts, dur;
+            unsigned tid;
+        };
+        std::map<std::string, TraceEvent> spans;
+        std::istringstream events(traceJson.substr(head.size(), traceJson.size() - head.size() - tail.size()));
+        std::string line;
+        bool separated = true; // 除最后一条外每条事件以逗号结尾
+        while (std::getline(events, line))
+        {
+            if (line.empty())
+                continue;
+            assert(separated);
+            separated = line.back() == ',';
+            if (separated)
+                line.pop_back();
+            char name[64];
+            TraceEvent e;
+            int n = std::sscanf(line.c_str(),
+                                "{\"name\":\"%63[^\"]\",\"ph\":\"X\",\"ts\":%lf,\"dur\":%lf,\"pid\":1,\"tid\":%u}",
+                                name, &e.ts, &e.dur, &e.tid);
+            assert(n == 4 && line.back() == '}' && e.ts >= 0 && e.dur >= 0);
+            spans[name] = e;
+        }
+        assert(spans.empty() || !separated);
+        if (Tracer::compiledIn())
+        {
+            const TraceEvent &outer = spans.at("test.outer"), &inner = spans.at("test.inner");
+            assert(inner.tid == outer.tid && spans.at("test.thread").tid != outer.tid);
+            assert(inner.ts >= outer.ts && inner.ts + inner.dur <= outer.ts + outer.dur + 0.001);
+            assert(spans.count("sqlDB::insertInto") && spans.count("RedoLog::waitDurable"));
+            const TraceEvent &select = spans.at("sqlDB::selectAll"), &sort = spans.at("selectAll.sort");
+            assert(sort.ts >= select.ts && sort.ts + sort.dur <= select.ts + select.dur + 0.001);
+        }
+        else
+            assert(spans.empty());
+    }
+
     // 输出测试结果
     std::cout << "All tests passed!" << std::endl;
 
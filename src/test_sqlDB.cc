@@ -1,4 +1,7 @@
 #include <iostream>
+#include <fstream>
+#include <thread>
+#include <chrono>
 #include "db.h"
 
 int main()
@@ -32,6 +35,12 @@ int main()
     std::cout << "\n=== 按薪资排序, 取前2名 ===" << std::endl;
     db.selectAll(userTable, "", "", "salary", true, 2);
 
+    // 4.1 内存预算很小时排序改为外部排序，结果与内存中排序相同
+    std::cout << "\n=== 外部排序: 按姓名降序 ===" << std::endl;
+    db.setMemoryBudget(16, 1 << 20);
+    db.selectAll(userTable, "", "", "name", true);
+    db.setMemoryBudget(64 << 20, 256 << 20);
+
     // 5. 更新数据
     std::cout << "\n=== 将 Bob 的薪资改为 9000 ===" << std::endl;
     db.update(userTable, "salary", "9000", "name", "Bob");
@@ -51,6 +60,23 @@ int main()
     db.aggregate(userTable, "MAX", salaryCol);
     db.aggregate(userTable, "COUNT", salaryCol);
 
+    // 7.1 统计信息
+    std::cout << "\n=== ANALYZE 后按条件查询 ===" << std::endl;
+    db.analyze(userTable);
+    db.selectAll(userTable, "age", "30", "salary", true);
+
+    // 7.2 事务
+    std::cout << "\n=== 事务: 回滚与提交 ===" << std::endl;
+    db.begin();
+    db.update(userTable, "salary", "1", "name", "Alice");
+    db.deleteRows(userTable, "name", "David");
+    db.rollback();
+    db.begin();
+    db.insertInto(userTable, {"5", "Eve", "35", "7500"}, {});
+    db.update(userTable, "salary", "5500", "name", "Alice");
+    db.commit();
+    db.selectAll(userTable, "", "", "id");
+
     // 8. 添加列
     std::cout << "\n=== 添加列 address ===" << std::endl;
     db.addColumn(userTable, {"address", DataType::TEXT});
@@ -69,6 +95,194 @@ int main()
     db.loadAll({userTable});
     db.selectAll(userTable);
 
+    // 10.1 后台检查点：不调用 saveAll，修改也会按间隔写入表文件
+    std::cout << "\n=== 后台检查点 ===" << std::endl;
+    db.setCheckpointInterval(50);
+    db.insertInto(userTable, {"6", "Frank", "41", ""}, {});
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    Table onDisk;
+    onDisk.loadFromFile("users");
+    std::cout << "Rows in users.table: " << onDisk.liveCount() << std::endl;
+
+    // 10.2 运行统计
+    std::cout << "\n=== 运行统计 ===" << std::endl;
+    MetricsSnapshot stats = db.metrics();
+    const StatementSummary &selects = stats.statement(StatementKind::SELECT);
+    const StatementSummary &inserts = stats.statement(StatementKind::INSERT);
+    std::cout << "SELECT: " << selects.count << " statements, " << selects.rowsReturned << " rows returned" << std::endl;
+    std::cout << "INSERT: " << inserts.rowsWritten << " rows written, logged: " << (inserts.bytesWritten > 0) << std::endl;
+
+    // 10.3 慢查询日志：阈值为 0 时每条语句都被记录
+    std::cout << "\n=== 慢查询日志 ===" << std::endl;
+    std::string slowLog = getDbPath("slow_test", ".log");
+    std::remove(slowLog.c_str());
+    std::string ageCol = "age";
+    db.setSlowQueryLog(0, slowLog);
+    db.aggregate(userTable, "COUNT", ageCol);
+    db.setSlowQueryLog(-1);
+    db.aggregate(userTable, "COUNT", ageCol);
+    std::ifstream slowIn(slowLog);
+    std::string slowLine;
+    int slowCount = 0;
+    while (std::getline(slowIn, slowLine))
+        slowCount++;
+    std::cout << "Slow query log entries: " << slowCount << std::endl;
+
+    // 10.4 DATE / TIMESTAMP：插入时解析为原生整数，按时间区间过滤与排序
+    std::cout << "\n=== 日期类型 ===" << std::endl;
+    std::string eventTable = "events";
+    std::vector<Column> eventCols = {
+        {"id", DataType::INT},
+        {"day", DataType::DATE},
+        {"at", DataType::TIMESTAMP}};
+    db.createTableWithTypes(eventTable, eventCols);
+    db.insertInto(eventTable, {"1", "2024-1-5", "2024-01-05 08:30:00"}, {});
+    db.insertInto(eventTable, {"2", "2023-12-31", "2023-12-31T23:59:59.5"}, {});
+    db.insertInto(eventTable, {"3", "2024-02-29", "2024-02-29"}, {});
+    db.insertInto(eventTable, {"4", "NULL", "NULL"}, {});
+    db.insertInto(eventTable, {"5", "2023-02-29", "2023-03-01"}, {});
+    db.selectRange(eventTable, "day", {"2024-01-01", "2024-03-01", true, false}, "day", true);
+    db.selectRange(eventTable, "at", {"", "2024-01-05 08:30:00", true, false});
+    db.selectAll(eventTable, "", "", "at");
+
+    // 10.5 NULL 与 BOOL：COUNT 不计 NULL，BOOL 等值由列位图直接得到
+    std::cout << "\n=== NULL 与 BOOL ===" << std::endl;
+    Column flag{"active", DataType::BOOL};
+    db.addColumn(eventTable, flag);
+    db.update(eventTable, "active", "TRUE", "id", "1");
+    db.update(eventTable, "active", "0", "id", "2");
+    db.update(eventTable, "active", "maybe", "id", "3");
+    std::string dayCol = "day", activeCol = "active";
+    db.aggregate(eventTable, "COUNT", dayCol);
+    db.aggregate(eventTable, "COUNT", activeCol);
+    db.selectAll(eventTable, "active", "true");
+    db.dropTable(eventTable);
+
+    // 10.6 分区表：按 WHERE 裁剪分区，更新分区列时行移到新分区，删除分区不扫描行
+    std::cout << "\n=== 分区表 ===" << std::endl;
+    std::string orderTable = "orders";
+    std::vector<Column> orderCols = {{"id", DataType::INT}, {"day", DataType::DATE}};
+    PartitionScheme byYear;
+    byYear.kind = PartitionKind::RANGE;
+    byYear.column = "day";
+    byYear.parts = {{"p2023", "2024-01-01"}, {"p2024", "2025-01-01"}, {"pmax", ""}};
+    db.createPartitionedTable(orderTable, orderCols, byYear);
+    db.insertInto(orderTable, {"1", "2023-05-01"}, {});
+    db.insertInto(orderTable, {"2", "2024-02-01"}, {});
+    db.insertInto(orderTable, {"3", "2025-03-01"}, {});
+    db.insertInto(orderTable, {"4", "2024-11-30"}, {});
+    db.selectRange(orderTable, "day", {"2024-01-01", "2025-01-01", true, false}, "id");
+    db.update(orderTable, "day", "2023-01-01", "id", "4");
+    db.selectAll("orders#p2023", "", "", "id");
+    db.dropPartition(orderTable, "p2023");
+    std::string idCol = "id";
+    db.aggregate(orderTable, "COUNT", idCol);
+    db.loadAll({orderTable});
+    db.selectAll(orderTable, "", "", "day", true);
+    db.dropTable(orderTable);
+
+    // 10.7 PRIMARY KEY / UNIQUE：插入、更新时由唯一索引检查重复，ON CONFLICT 冲突时改为更新
+    std::cout << "\n=== 唯一约束 ===" << std::endl;
+    std::string accountTable = "accounts";
+    std::vector<Column> accountCols = {
+        {"id", DataType::INT, "NULL", ColumnConstraint::PRIMARY_KEY},
+        {"email", DataType::TEXT, "NULL", ColumnConstraint::UNIQUE},
+        {"visits", DataType::INT}};
+    db.createTableWithTypes(accountTable, accountCols);
+    db.insertInto(accountTable, {"1", "a@x.org", "1"}, {});
+    db.insertInto(accountTable, {"2", "b@x.org", "1"}, {});
+    db.insertInto(accountTable, {"1", "c@x.org", "1"}, {});
+    db.insertInto(accountTable, {"3", "A@X.org", "1"}, {});
+    db.insertInto(accountTable, {"NULL", "d@x.org", "1"}, {});
+    db.update(accountTable, "email", "b@x.org", "id", "1");
+    db.upsert(accountTable, {"1", "a@x.org", "5"}, {}, {"", {{"visits", "EXCLUDED.visits"}}});
+    db.upsert(accountTable, {"4", "d@x.org", "1"}, {}, {"id", {{"visits", "9"}}});
+    db.upsert(accountTable, {"9", "b@x.org", "1"}, {}, {"email", {}});
+    db.selectAll(accountTable, "id", "1");
+    db.selectAll(accountTable, "", "", "id");
+    db.dropTable(accountTable);
+
+    // 10.8 LIKE：没有索引时逐行查找子串，建立有序 / 三元组索引后前缀与子串模式由索引给出候选行
+    std::cout << "\n=== LIKE ===" << std::endl;
+    std::string cityTable = "cities";
+    std::vector<Column> cityCols = {{"id", DataType::INT}, {"name", DataType::TEXT}};
+    db.createTableWithTypes(cityTable, cityCols);
+    db.insertInto(cityTable, {"1", "Beijing"}, {});
+    db.insertInto(cityTable, {"2", "Berlin"}, {});
+    db.insertInto(cityTable, {"3", "Nanjing"}, {});
+    db.insertInto(cityTable, {"4", "NULL"}, {});
+    db.insertInto(cityTable, {"5", "Bern"}, {});
+    db.selectLike(cityTable, "name", "%JING", "id");
+    db.createIndex(cityTable, "name", false);
+    db.createIndex(cityTable, "name", true);
+    db.createIndex(cityTable, "name", true);
+    db.selectLike(cityTable, "name", "ber%", "id");
+    db.selectLike(cityTable, "name", "%erli%");
+    db.selectLike(cityTable, "name", "b_r_", "id");
+    db.dropIndex(cityTable, "name");
+    db.selectLike(cityTable, "name", "%n%", "id", true, 2);
+    db.dropTable(cityTable);
+
+    // 10.9 近似聚合：HyperLogLog 估计不同值个数；TABLESAMPLE 在抽样的行上估计并给出误差范围
+    std::cout << "\n=== 近似聚合 ===" << std::endl;
+    std::string visitTable = "visits";
+    std::vector<Column> visitCols = {{"user", DataType::TEXT}, {"ms", DataType::INT}};
+    db.createTableWithTypes(visitTable, visitCols);
+    db.begin();
+    for (int i = 0; i < 40; i++)
+        db.insertInto(visitTable, {"u" + std::to_string(i % 15), std::to_string(100 + i % 7)}, {});
+    db.commit();
+    std::string userCol = "user", msCol = "ms";
+    db.aggregate(visitTable, "APPROX_COUNT_DISTINCT", userCol);
+    db.aggregate(visitTable, "SUM", msCol, {100});
+    db.aggregate(visitTable, "AVG", msCol, {25, true, 7});
+    db.aggregate(visitTable, "MAX", msCol, {25});
+    db.dropTable(visitTable);
+
+    // 10.10 物化视图：每次提交增量更新分组，回滚的修改不进入视图；基表有视图时不能删除
+    std::cout << "\n=== 物化视图 ===" << std::endl;
+    std::string salesTable = "ledger";
+    std::vector<Column> salesCols = {{"id", DataType::INT}, {"region", DataType::TEXT}, {"amount", DataType::INT}};
+    db.createTableWithTypes(salesTable, salesCols);
+    db.insertInto(salesTable, {"1", "east", "10"}, {});
+    db.insertInto(salesTable, {"2", "west", "20"}, {});
+    db.createMaterializedView("sales", salesTable, "region", {{"SUM", "amount"}, {"COUNT", "*"}});
+    db.insertInto(salesTable, {"3", "east", "5"}, {});
+    db.update(salesTable, "region", "north", "id", "2");
+    db.begin();
+    db.deleteRows(salesTable, "id", "1");
+    db.rollback();
+    db.selectAll("sales");
+    db.selectAll("sales", "region", "east");
+    db.dropTable(salesTable);
+    db.dropMaterializedView("sales");
+    db.dropTable(salesTable);
+
+    // 10.11 结果缓存：重复的查询直接返回上次的结果，表有新的提交后重新执行；事务中不使用缓存
+    std::cout << "\n=== 结果缓存 ===" << std::endl;
+    std::string quoteTable = "quotes";
+    std::vector<Column> quoteCols = {{"symbol", DataType::TEXT}, {"price", DataType::INT}};
+    db.createTableWithTypes(quoteTable, quoteCols);
+    db.insertInto(quoteTable, {"abc", "10"}, {});
+    db.setResultCacheSize(1 << 20);
+    std::string priceCol = "price";
+    db.selectAll(quoteTable, "", "", "price", false, -1);
+    db.selectAll(quoteTable, "", "", "price", false, -1);
+    db.aggregate(quoteTable, "SUM", priceCol);
+    db.insertInto(quoteTable, {"xyz", "5"}, {});
+    db.selectAll(quoteTable, "", "", "price", false, -1);
+    db.aggregate(quoteTable, "SUM", priceCol);
+    db.begin();
+    db.insertInto(quoteTable, {"def", "1"}, {});
+    db.aggregate(quoteTable, "SUM", priceCol);
+    db.rollback();
+    db.aggregate(quoteTable, "SUM", priceCol);
+    ResultCacheStats cacheStats = db.metrics().resultCache;
+    std::cout << "Result cache: " << cacheStats.hits << " hits, " << cacheStats.misses << " misses, "
+              << cacheStats.invalidations << " invalidations" << std::endl;
+    db.setResultCacheSize(0);
+    db.dropTable(quoteTable);
+
     // 11. 删除表
     std::cout << "\n=== 删除表 users ===" << std::endl;
     db.dropTable(userTable);
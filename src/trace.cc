@@ -0,0 +1,114 @@
+#include "trace.h"
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdio>
+
+/**
+ * @brief 一个线程的环形缓冲区
+ */
+struct TraceBuffer
+{
+    struct Event
+    {
+        const char *name;
+        uint64_t start;
+        uint64_t end;
+    };
+
+    static constexpr size_t kCapacity = 1 << 16; ///< 每个线程最多保留的记录数
+
+    std::mutex mtx;            ///< 所属线程写入与 dump 之间互斥（几乎总是无竞争）
+    std::vector<Event> events; ///< 环形存储，写满后从头覆盖
+    size_t next = 0;           ///< 下一个写入位置
+    uint32_t tid = 0;          ///< 输出中的线程号
+};
+
+std::atomic<bool> Tracer::active{false};
+
+static std::mutex registryMutex;                           ///< 保护 registry
+static std::vector<std::shared_ptr<TraceBuffer>> registry; ///< 所有线程的缓冲区（线程退出后仍保留，可以 dump）
+
+/**
+ * @brief 当前线程的缓冲区，第一次记录时创建并登记
+ */
+static TraceBuffer &threadBuffer()
+{
+    thread_local std::shared_ptr<TraceBuffer> buffer = []
+    {
+        auto b = std::make_shared<TraceBuffer>();
+        std::lock_guard<std::mutex> lock(registryMutex);
+        b->tid = uint32_t(registry.size() + 1);
+        registry.push_back(b);
+        return b;
+    }();
+    return *buffer;
+}
+
+bool Tracer::enable(bool on)
+{
+    if (!compiledIn())
+        return false;
+    active.store(on, std::memory_order_relaxed);
+    return true;
+}
+
+void Tracer::record(const char *name, uint64_t start, uint64_t end)
+{
+    TraceBuffer &b = threadBuffer();
+    std::lock_guard<std::mutex> lock(b.mtx);
+    if (b.events.size() < TraceBuffer::kCapacity)
+        b.events.push_back({name, start, end});
+    else
+        b.events[b.next] = {name, start, end};
+    b.next = (b.next + 1) % TraceBuffer::kCapacity;
+}
+
+void Tracer::clear()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto &b : registry)
+    {
+        std::lock_guard<std::mutex> bufferLock(b->mtx);
+        b->events.clear();
+        b->next = 0;
+    }
+}
+
+bool Tracer::dump(const std::string &path)
+{
+    std::vector<std::pair<uint32_t, std::vector<TraceBuffer::Event>>> threads;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (auto &b : registry)
+        {
+            std::lock_guard<std::mutex> bufferLock(b->mtx);
+            threads.emplace_back(b->tid, b->events);
+        }
+    }
+    // 时间戳以最早的记录为 0，单位微秒，保留 3 位小数即纳秒精度
+    uint64_t origin = UINT64_MAX;
+    for (const auto &t : threads)
+        for (const auto &e : t.second)
+            origin = std::min(origin, e.start);
+
+    std::ofstream out(path, std::ios::trunc);
+    out << "{\"traceEvents\":[";
+    char buf[256];
+    bool first = true;
+    for (const auto &t : threads)
+    {
+        for (const auto &e : t.second)
+        {
+            std::snprintf(buf, sizeof(buf),
+                          "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+                          first ? "" : ",", e.name, (e.start - origin) / 1e3, (e.end - e.start) / 1e3, t.first);
+            out << buf;
+            first = false;
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    return bool(out.flush());
+}
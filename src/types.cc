@@ -1,4 +1,6 @@
 #include "types.h"
+#include <cstdio>
+#include <cctype>
 /**
  *  @brief 解析字符串到枚举类成员
  */
@@ -20,6 +22,181 @@ DataType parseType(const std::string &typeStr)
         return DataType::VARCHAR;
     if (t == "BOOL")
         return DataType::BOOL;
+    if (t == "TIMESTAMP")
+        return DataType::TIMESTAMP;
 
     throw std::invalid_argument("Unknown data type: " + typeStr);
-}
\ No newline at end of file
+}
+
+/**
+ *  @brief 将枚举类成员转换为字符串（parseType 的逆操作）
+ */
+std::string typeToString(DataType type)
+{
+    switch (type)
+    {
+    case DataType::INT:
+        return "INT";
+    case DataType::TEXT:
+        return "TEXT";
+    case DataType::FLOAT:
+        return "FLOAT";
+    case DataType::DOUBLE:
+        return "DOUBLE";
+    case DataType::DATE:
+        return "DATE";
+    case DataType::BOOL:
+        return "BOOL";
+    case DataType::VARCHAR:
+        return "VARCHAR";
+    case DataType::TIMESTAMP:
+        return "TIMESTAMP";
+    }
+    return "TEXT";
+}
+
+bool parseBool(std::string_view s, bool &value)
+{
+    std::string lower(s);
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    if (lower == "true" || lower == "1")
+        value = true;
+    else if (lower == "false" || lower == "0")
+        value = false;
+    else
+        return false;
+    return true;
+}
+
+static const int64_t kMicrosPerDay = 86400LL * 1000000;
+
+/**
+ * @brief 公历日期 → 自 1970-01-01 起的天数（适用于任意年份）
+ */
+static int64_t daysFromCivil(int64_t y, unsigned m, unsigned d)
+{
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = unsigned(y - era * 400);
+    unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + int64_t(doe) - 719468;
+}
+
+/**
+ * @brief daysFromCivil 的逆运算
+ */
+static void civilFromDays(int64_t z, int64_t &y, unsigned &m, unsigned &d)
+{
+    z += 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned doe = unsigned(z - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = int64_t(yoe) + era * 400 + (m <= 2);
+}
+
+/**
+ * @brief 从 s 的 pos 处读取 minDigits 到 maxDigits 位十进制数
+ */
+static bool readNumber(std::string_view s, size_t &pos, size_t minDigits, size_t maxDigits, unsigned &out)
+{
+    size_t start = pos;
+    out = 0;
+    while (pos < s.size() && pos - start < maxDigits && s[pos] >= '0' && s[pos] <= '9')
+        out = out * 10 + unsigned(s[pos++] - '0');
+    return pos - start >= minDigits;
+}
+
+/**
+ * @brief 解析 "YYYY-MM-DD"，成功时 pos 指向日期之后
+ */
+static bool parseDatePart(std::string_view s, size_t &pos, int64_t &days)
+{
+    unsigned y, m, d;
+    if (!readNumber(s, pos, 4, 4, y) || pos >= s.size() || s[pos++] != '-' ||
+        !readNumber(s, pos, 1, 2, m) || pos >= s.size() || s[pos++] != '-' || !readNumber(s, pos, 1, 2, d))
+        return false;
+    static const unsigned kDaysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+    if (m < 1 || m > 12 || d < 1 || d > kDaysInMonth[m - 1] + (m == 2 && leap))
+        return false;
+    days = daysFromCivil(y, m, d);
+    return true;
+}
+
+bool parseTemporal(DataType type, std::string_view s, int64_t &value)
+{
+    size_t pos = 0;
+    int64_t days;
+    if (!parseDatePart(s, pos, days))
+        return false;
+    if (type == DataType::DATE)
+    {
+        value = days;
+        return pos == s.size();
+    }
+    value = days * kMicrosPerDay;
+    if (pos == s.size())
+        return true;
+    // 秒可以省略（HH:MM）
+    unsigned hh, mm, ss = 0;
+    if ((s[pos] != ' ' && s[pos] != 'T' && s[pos] != 't') || !readNumber(s, ++pos, 1, 2, hh) || pos >= s.size() ||
+        s[pos++] != ':' || !readNumber(s, pos, 1, 2, mm))
+        return false;
+    bool seconds = pos < s.size() && s[pos] == ':';
+    if (seconds && !readNumber(s, ++pos, 1, 2, ss))
+        return false;
+    if (hh > 23 || mm > 59 || ss > 59)
+        return false;
+    int64_t micros = 0;
+    if (seconds && pos < s.size() && s[pos] == '.')
+    {
+        // 最多保留 6 位小数（微秒），多余的位截断
+        size_t start = ++pos;
+        while (pos < s.size() && s[pos] >= '0' && s[pos] <= '9')
+        {
+            if (pos - start < 6)
+                micros = micros * 10 + (s[pos] - '0');
+            pos++;
+        }
+        if (pos == start)
+            return false;
+        for (size_t k = pos - start; k < 6; k++)
+            micros *= 10;
+    }
+    value += (int64_t(hh) * 3600 + mm * 60 + ss) * 1000000 + micros;
+    return pos == s.size();
+}
+
+size_t formatTemporal(DataType type, int64_t value, char *buf)
+{
+    int64_t days = value, micros = 0;
+    if (type == DataType::TIMESTAMP)
+    {
+        // 向下取整，1970 年之前的时间戳也落在正确的一天
+        days = value / kMicrosPerDay;
+        micros = value % kMicrosPerDay;
+        if (micros < 0)
+        {
+            days--;
+            micros += kMicrosPerDay;
+        }
+    }
+    int64_t y;
+    unsigned m, d;
+    civilFromDays(days, y, m, d);
+    int n = std::snprintf(buf, kTemporalTextMax, "%04lld-%02u-%02u", (long long)y, m, d);
+    if (type == DataType::TIMESTAMP)
+    {
+        int64_t secs = micros / 1000000;
+        n += std::snprintf(buf + n, kTemporalTextMax - size_t(n), " %02d:%02d:%02d", int(secs / 3600),
+                           int(secs / 60 % 60), int(secs % 60));
+        if (micros % 1000000)
+            n += std::snprintf(buf + n, kTemporalTextMax - size_t(n), ".%06d", int(micros % 1000000));
+    }
+    return size_t(n);
+}
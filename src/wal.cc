@@ -0,0 +1,336 @@
+#include "wal.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <iterator>
+#include <fcntl.h>
+
+#ifdef _WIN32
+#include <io.h>
+#define FSYNC(fd) _commit(fd)
+#define WRITE(fd, buf, n) _write(fd, buf, unsigned(n))
+#define CLOSE(fd) _close(fd)
+#else
+#include <unistd.h>
+#define FSYNC(fd) fsync(fd)
+#define WRITE(fd, buf, n) ::write(fd, buf, n)
+#define CLOSE(fd) ::close(fd)
+#endif
+
+/**
+ * @brief 追加一个长度前缀字段 "<len>:<bytes>"
+ */
+static void putField(std::string &out, const std::string &s)
+{
+    out += std::to_string(s.size());
+    out += ':';
+    out += s;
+}
+
+/**
+ * @brief 读取一个十进制整数
+ */
+static bool getDigits(const std::string &buf, size_t &pos, uint64_t &out)
+{
+    size_t start = pos;
+    out = 0;
+    while (pos < buf.size() && buf[pos] >= '0' && buf[pos] <= '9' && pos - start < 20)
+        out = out * 10 + uint64_t(buf[pos++] - '0');
+    return pos != start && pos < buf.size();
+}
+
+/**
+ * @brief 读取一个十进制整数，后面必须紧跟 sep
+ */
+static bool getNumber(const std::string &buf, size_t &pos, char sep, uint64_t &out)
+{
+    if (!getDigits(buf, pos, out) || buf[pos] != sep)
+        return false;
+    pos++;
+    return true;
+}
+
+/**
+ * @brief 读取一个长度前缀字段
+ */
+static bool getField(const std::string &buf, size_t &pos, std::string &out)
+{
+    uint64_t len;
+    if (!getNumber(buf, pos, ':', len) || buf.size() - pos < len)
+        return false;
+    out.assign(buf, pos, len);
+    pos += len;
+    return true;
+}
+
+std::string LogRecord::encode() const
+{
+    std::string out;
+    out += char(op);
+    out += ' ';
+    out += std::to_string(ts);
+    out += ' ';
+    putField(out, table);
+    out += ' ';
+    out += std::to_string(values.size());
+    for (const auto &v : values)
+    {
+        out += ' ';
+        putField(out, v);
+    }
+    out += '\n';
+    return out;
+}
+
+bool LogRecord::decode(const std::string &buf, size_t &pos)
+{
+    size_t p = pos;
+    if (buf.size() - p < 2 || buf[p + 1] != ' ')
+        return false;
+    char c = buf[p];
+    if (c != INSERT && c != REMOVE && c != ALTER && c != COMMIT)
+        return false;
+    p += 2;
+    uint64_t n;
+    std::string name;
+    if (!getNumber(buf, p, ' ', ts) || !getField(buf, p, name) || p >= buf.size() || buf[p++] != ' ')
+        return false;
+    if (!getDigits(buf, p, n))
+        return false;
+    std::vector<std::string> vals;
+    for (uint64_t i = 0; i < n; i++)
+    {
+        std::string v;
+        if (p >= buf.size() || buf[p++] != ' ' || !getField(buf, p, v))
+            return false;
+        vals.push_back(std::move(v));
+    }
+    if (p >= buf.size() || buf[p++] != '\n')
+        return false;
+    op = Op(c);
+    table = std::move(name);
+    values = std::move(vals);
+    pos = p;
+    return true;
+}
+
+/**
+ * @brief 以追加方式打开（不存在时创建）日志文件
+ */
+static int openForAppend(const std::string &path)
+{
+#ifdef _WIN32
+    int fd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, 0644);
+#else
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+#endif
+    if (fd < 0)
+        std::cerr << "Cannot open redo log " << path << ": " << strerror(errno) << "\n";
+    return fd;
+}
+
+void syncFile(const std::string &path)
+{
+#ifdef _WIN32
+    int fd = _open(path.c_str(), _O_RDWR);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+#endif
+    if (fd < 0)
+        return;
+    FSYNC(fd);
+    CLOSE(fd);
+}
+
+RedoLog::RedoLog(const std::string &p) : path(p)
+{
+    // 崩溃时可能只写了半个事务，截掉它们，否则之后追加的记录无法被解析
+    size_t valid = 0;
+    readFile(&valid);
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (in && size_t(in.tellg()) != valid)
+    {
+        in.close();
+        std::ifstream src(path, std::ios::binary);
+        std::string content(valid, '\0');
+        src.read(&content[0], std::streamsize(valid));
+        src.close();
+        replaceFile(content);
+        return;
+    }
+    fd = openForAppend(path);
+}
+
+RedoLog::~RedoLog()
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    flushed.wait(lock, [this]
+                 { return !flushing; });
+    if (fd >= 0)
+    {
+        if (!buffer.empty())
+            WRITE(fd, buffer.data(), buffer.size());
+        FSYNC(fd);
+        CLOSE(fd);
+    }
+}
+
+uint64_t RedoLog::append(const std::string &records)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    buffer += records;
+    appendedLsn += records.size();
+    return appendedLsn;
+}
+
+bool RedoLog::waitDurable(uint64_t lsn, std::string &error)
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    while (durableLsn < lsn)
+    {
+        if (!failure.empty())
+        {
+            error = failure;
+            return false;
+        }
+        if (flushing)
+        {
+            // 已有 leader 在刷盘，等它完成后再看自己的记录是否已包含在内
+            flushed.wait(lock);
+            continue;
+        }
+        // 成为 leader：一次 write + fsync 带走缓冲区中所有事务的记录
+        flushing = true;
+        std::string batch;
+        batch.swap(buffer);
+        uint64_t target = appendedLsn;
+        lock.unlock();
+        size_t off = 0;
+        int writeErr = 0, syncErr = 0;
+        while (off < batch.size())
+        {
+            auto n = WRITE(fd, batch.data() + off, batch.size() - off);
+            if (n <= 0)
+            {
+                writeErr = n < 0 ? errno : EIO;
+                break;
+            }
+            off += size_t(n);
+        }
+        if (!writeErr && FSYNC(fd) != 0)
+            syncErr = errno;
+        lock.lock();
+        flushing = false;
+        flushed.notify_all();
+        if (writeErr)
+        {
+            // 没写出的部分放回缓冲区最前面，下一个 leader 接着写，文件仍是记录的连续前缀
+            buffer.insert(0, batch, off, std::string::npos);
+            error = std::string("write failed: ") + strerror(writeErr);
+            return false;
+        }
+        if (syncErr)
+        {
+            // fsync 失败后内核可能已丢弃脏页，再次 fsync 也无法确认之前的写入，此后不再确认任何提交
+            failure = std::string("fsync failed: ") + strerror(syncErr);
+            error = failure;
+            return false;
+        }
+        durableLsn = std::max(durableLsn, target);
+    }
+    return true;
+}
+
+std::vector<LogRecord> RedoLog::readAll()
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    flushed.wait(lock, [this]
+                 { return !flushing; });
+    std::vector<LogRecord> records = readFile();
+    parse(buffer, records);
+    return records;
+}
+
+std::vector<LogRecord> RedoLog::readFile(size_t *validBytes)
+{
+    std::vector<LogRecord> records;
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    size_t valid = parse(ss.str(), records);
+    if (validBytes)
+        *validBytes = valid;
+    return records;
+}
+
+size_t RedoLog::parse(const std::string &buf, std::vector<LogRecord> &out)
+{
+    size_t pos = 0, valid = 0, committed = out.size();
+    LogRecord r;
+    while (pos < buf.size() && r.decode(buf, pos))
+    {
+        out.push_back(r);
+        if (r.op == LogRecord::COMMIT)
+        {
+            committed = out.size();
+            valid = pos;
+        }
+    }
+    // 丢弃最后一个没有 COMMIT 的事务
+    out.resize(committed);
+    return valid;
+}
+
+void RedoLog::replaceFile(const std::string &content)
+{
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out << content;
+    }
+    syncFile(tmp);
+    swapIn(tmp);
+}
+
+void RedoLog::finishRewrite(const std::string &content, size_t upto)
+{
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out << content;
+    }
+    syncFile(tmp);
+
+    // 暂停刷盘，旧文件不再增长；缓冲区照常接受追加，恢复后由下一个 leader 写入新文件
+    std::unique_lock<std::mutex> lock(mtx);
+    flushed.wait(lock, [this]
+                 { return !flushing; });
+    flushing = true;
+    lock.unlock();
+    {
+        std::ifstream in(path, std::ios::binary);
+        in.seekg(std::streamoff(upto));
+        std::string tail((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::ofstream out(tmp, std::ios::binary | std::ios::app);
+        out << tail;
+    }
+    syncFile(tmp);
+    swapIn(tmp);
+    lock.lock();
+    flushing = false;
+    flushed.notify_all();
+}
+
+void RedoLog::swapIn(const std::string &tmp)
+{
+    if (fd >= 0)
+        CLOSE(fd);
+    std::rename(tmp.c_str(), path.c_str());
+    std::string dir = path.substr(0, path.find_last_of('/'));
+    syncFile(dir);
+    fd = openForAppend(path);
+}